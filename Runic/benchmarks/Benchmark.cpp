@@ -0,0 +1,306 @@
+#include "Benchmark.h"
+
+#include "Runic/Log.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+	constexpr uint64_t MAX_ITERATIONS = 1000000000U;
+	constexpr double MEGABYTE = 1000.0 * 1000.0;
+
+	struct Registered
+	{
+		std::string name;
+		std::function<void(Benchmark::State&)> function;
+	};
+
+	struct Options
+	{
+		std::string filter;
+		std::string outFile;
+		double minTime{ 0.5 };			// Seconds one repetition has to run for
+		uint32_t repetitions{ 5U };
+	};
+
+	struct Result
+	{
+		std::string name;
+		std::string error;
+		uint64_t iterations{ 0U };
+		std::vector<double> nsPerIteration;	// One per repetition
+		double itemsPerSecond{ 0.0 };
+		double bytesPerSecond{ 0.0 };
+	};
+
+	std::vector<Registered>& getRegistry()
+	{
+		static std::vector<Registered> registry;
+		return registry;
+	}
+
+	std::string& getAssetDirectoryStorage()
+	{
+		static std::string directory{ RNC_ASSET_DIR };
+		return directory;
+	}
+
+	Benchmark::State runOnce(const Registered& benchmark, uint64_t iterations)
+	{
+		Benchmark::State state(iterations);
+		benchmark.function(state);
+		return state;
+	}
+
+	Result runBenchmark(const Registered& benchmark, const Options& options)
+	{
+		Result result;
+		result.name = benchmark.name;
+
+		// Grow the iteration count until one run is long enough to time reliably
+		uint64_t iterations = 1U;
+		while (true)
+		{
+			const Benchmark::State state = runOnce(benchmark, iterations);
+			if (!state.GetError().empty())
+			{
+				result.error = state.GetError();
+				return result;
+			}
+
+			const double elapsed = state.GetElapsedSeconds();
+			if (elapsed >= options.minTime || iterations >= MAX_ITERATIONS)
+			{
+				break;
+			}
+			const double predicted = elapsed > 0.0 ? options.minTime * 1.4 * static_cast<double>(iterations) / elapsed : static_cast<double>(iterations) * 100.0;
+			iterations = std::clamp(static_cast<uint64_t>(predicted), iterations + 1U, std::min(iterations * 100U, MAX_ITERATIONS));
+		}
+		result.iterations = iterations;
+
+		std::vector<double> itemsPerSecond;
+		std::vector<double> bytesPerSecond;
+		for (uint32_t i = 0; i < options.repetitions; ++i)
+		{
+			const Benchmark::State state = runOnce(benchmark, iterations);
+			const double elapsed = std::max(state.GetElapsedSeconds(), 1e-9);
+			result.nsPerIteration.push_back(elapsed * 1e9 / static_cast<double>(iterations));
+			itemsPerSecond.push_back(static_cast<double>(state.GetItemsProcessed()) / elapsed);
+			bytesPerSecond.push_back(static_cast<double>(state.GetBytesProcessed()) / elapsed);
+		}
+
+		// Medians, a single descheduled repetition shouldn't move the result
+		const auto median = [](std::vector<double> values) {
+			std::sort(values.begin(), values.end());
+			const size_t middle = values.size() / 2;
+			return values.size() % 2 == 0 ? (values[middle - 1] + values[middle]) * 0.5 : values[middle];
+		};
+		result.itemsPerSecond = median(itemsPerSecond);
+		result.bytesPerSecond = median(bytesPerSecond);
+		return result;
+	}
+
+	std::string escape(const std::string& text)
+	{
+		std::string escaped;
+		for (const char c : text)
+		{
+			if (c == '"' || c == '\\')
+			{
+				escaped += '\\';
+			}
+			escaped += c;
+		}
+		return escaped;
+	}
+
+	void writeJson(std::ostream& out, const Options& options, const std::vector<Result>& results)
+	{
+		char date[32];
+		const std::time_t now = std::time(nullptr);
+		std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+#if defined(_MSC_VER)
+		const std::string compiler = "msvc " + std::to_string(_MSC_VER);
+#elif defined(__clang__)
+		const std::string compiler = "clang " __clang_version__;
+#elif defined(__GNUC__)
+		const std::string compiler = "gcc " __VERSION__;
+#else
+		const std::string compiler = "unknown";
+#endif
+#if defined(NDEBUG)
+		const char* buildType = "release";
+#else
+		const char* buildType = "debug";
+#endif
+
+		out << "{\n";
+		out << "\t\"context\": {\n";
+		out << "\t\t\"version\": \"" << RNC_VERSION << "\",\n";
+		out << "\t\t\"date\": \"" << date << "\",\n";
+		out << "\t\t\"compiler\": \"" << escape(compiler) << "\",\n";
+		out << "\t\t\"build_type\": \"" << buildType << "\",\n";
+		out << "\t\t\"min_time_s\": " << options.minTime << ",\n";
+		out << "\t\t\"repetitions\": " << options.repetitions << "\n";
+		out << "\t},\n";
+		out << "\t\"benchmarks\": [";
+		for (size_t i = 0; i < results.size(); ++i)
+		{
+			const Result& result = results[i];
+			out << (i == 0 ? "\n" : ",\n") << "\t\t{\n";
+			out << "\t\t\t\"name\": \"" << escape(result.name) << "\"";
+			if (!result.error.empty())
+			{
+				out << ",\n\t\t\t\"error\": \"" << escape(result.error) << "\"\n\t\t}";
+				continue;
+			}
+
+			std::vector<double> sorted = result.nsPerIteration;
+			std::sort(sorted.begin(), sorted.end());
+			const size_t middle = sorted.size() / 2;
+			const double median = sorted.size() % 2 == 0 ? (sorted[middle - 1] + sorted[middle]) * 0.5 : sorted[middle];
+			double mean = 0.0;
+			for (const double ns : sorted)
+			{
+				mean += ns;
+			}
+			mean /= static_cast<double>(sorted.size());
+
+			out << ",\n\t\t\t\"iterations\": " << result.iterations;
+			out << ",\n\t\t\t\"median_ns\": " << median;
+			out << ",\n\t\t\t\"mean_ns\": " << mean;
+			out << ",\n\t\t\t\"min_ns\": " << sorted.front();
+			out << ",\n\t\t\t\"max_ns\": " << sorted.back();
+			if (result.itemsPerSecond > 0.0)
+			{
+				out << ",\n\t\t\t\"items_per_second\": " << result.itemsPerSecond;
+			}
+			if (result.bytesPerSecond > 0.0)
+			{
+				out << ",\n\t\t\t\"mb_per_second\": " << result.bytesPerSecond / MEGABYTE;
+			}
+			out << "\n\t\t}";
+		}
+		out << "\n\t]\n}\n";
+	}
+
+	bool parseOptions(int argc, char** argv, Options& options)
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			const std::string_view arg = argv[i];
+			const auto value = [&](std::string_view flag, std::string& out) {
+				if (arg.substr(0, flag.size()) != flag)
+				{
+					return false;
+				}
+				out = std::string(arg.substr(flag.size()));
+				return true;
+			};
+
+			std::string text;
+			if (value("--filter=", options.filter) || value("--out=", options.outFile) || value("--assets=", getAssetDirectoryStorage()))
+			{
+				continue;
+			}
+			if (value("--min-time=", text))
+			{
+				options.minTime = std::stod(text);
+				continue;
+			}
+			if (value("--repetitions=", text))
+			{
+				options.repetitions = std::max(static_cast<uint32_t>(std::stoul(text)), 1U);
+				continue;
+			}
+
+			std::cerr << "Usage: RunicBenchmarks [--filter=<substring>] [--min-time=<seconds>] [--repetitions=<count>] [--out=<file.json>] [--assets=<dir>]\n";
+			return false;
+		}
+		return true;
+	}
+}
+
+void Benchmark::State::PauseTiming()
+{
+	if (m_running)
+	{
+		m_elapsed += std::chrono::steady_clock::now() - m_start;
+		m_running = false;
+	}
+}
+
+void Benchmark::State::ResumeTiming()
+{
+	if (!m_running)
+	{
+		m_running = true;
+		m_start = std::chrono::steady_clock::now();
+	}
+}
+
+bool Benchmark::Register(const std::string& name, std::function<void(State&)> function)
+{
+	getRegistry().push_back(Registered{ .name = name, .function = std::move(function) });
+	return true;
+}
+
+const std::string& Benchmark::GetAssetDirectory()
+{
+	return getAssetDirectoryStorage();
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!parseOptions(argc, argv, options))
+	{
+		return 1;
+	}
+
+	// Logging isn't what's being measured, and it would land in the JSON on stdout
+	Log::Init();
+	Log::GetCoreLogger()->set_level(spdlog::level::off);
+
+	// Registration order depends on link order, sort so runs diff cleanly
+	std::vector<Registered> benchmarks = getRegistry();
+	std::sort(benchmarks.begin(), benchmarks.end(), [](const Registered& a, const Registered& b) { return a.name < b.name; });
+
+	std::vector<Result> results;
+	for (const Registered& benchmark : benchmarks)
+	{
+		if (!options.filter.empty() && benchmark.name.find(options.filter) == std::string::npos)
+		{
+			continue;
+		}
+
+		// Progress goes to stderr, stdout only carries the JSON
+		std::cerr << benchmark.name << "..." << std::flush;
+		results.push_back(runBenchmark(benchmark, options));
+		std::cerr << (results.back().error.empty() ? " done\n" : " error: " + results.back().error + "\n");
+	}
+
+	if (options.outFile.empty())
+	{
+		writeJson(std::cout, options, results);
+		return 0;
+	}
+
+	std::ofstream file(options.outFile);
+	if (!file)
+	{
+		std::cerr << "Can't write " << options.outFile << "\n";
+		return 1;
+	}
+	writeJson(file, options, results);
+	return 0;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace Benchmark
+{
+	/*
+	*
+	* State: Handed to a benchmark, which runs its timed body while KeepRunning returns true.
+	*		 The timer starts on the first call and stops on the last, so setup before the loop isn't measured.
+	*
+	*/
+	class State
+	{
+	public:
+		explicit State(uint64_t iterations) : m_iterations(iterations) {}
+
+		bool KeepRunning()
+		{
+			if (m_completed == 0U && !m_running)
+			{
+				ResumeTiming();
+			}
+			if (m_completed < m_iterations && m_error.empty())
+			{
+				++m_completed;
+				return true;
+			}
+			PauseTiming();
+			return false;
+		}
+
+		/*
+		Excludes per iteration setup from the measurement
+		*/
+		void PauseTiming();
+		void ResumeTiming();
+
+		/*
+		Totals over every iteration, reported per second
+		*/
+		void SetItemsProcessed(uint64_t items) { m_items = items; }
+		void SetBytesProcessed(uint64_t bytes) { m_bytes = bytes; }
+
+		/*
+		Stops the benchmark, the message is reported instead of timings
+		*/
+		void SkipWithError(const std::string& message) { m_error = message; }
+
+		uint64_t GetIterations() const { return m_iterations; }
+		uint64_t GetItemsProcessed() const { return m_items; }
+		uint64_t GetBytesProcessed() const { return m_bytes; }
+		double GetElapsedSeconds() const { return m_elapsed.count(); }
+		const std::string& GetError() const { return m_error; }
+	private:
+		uint64_t m_iterations;
+		uint64_t m_completed{ 0U };
+		uint64_t m_items{ 0U };
+		uint64_t m_bytes{ 0U };
+
+		bool m_running{ false };
+		std::chrono::steady_clock::time_point m_start{};
+		std::chrono::duration<double> m_elapsed{ 0.0 };
+
+		std::string m_error;
+	};
+
+	/*
+	Returns a value to initialise a static with, so benchmarks register themselves before main
+	*/
+	bool Register(const std::string& name, std::function<void(State&)> function);
+
+	/*
+	Assets the engine ships with, overridden by --assets
+	*/
+	const std::string& GetAssetDirectory();
+
+	/*
+	Keeps the compiler from discarding a result that is never read
+	*/
+	template<typename T>
+	inline void DoNotOptimize(const T& value)
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		asm volatile("" : : "r,m"(value) : "memory");
+#else
+		static volatile const void* sink;
+		sink = &value;
+#endif
+	}
+}
+
+#define RNC_BENCHMARK(function) static const bool function##Registered = ::Benchmark::Register(#function, function)
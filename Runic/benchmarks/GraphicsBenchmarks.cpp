@@ -0,0 +1,110 @@
+#include "Benchmark.h"
+
+#include "Runic/Assets/AssetRegistry.h"
+#include "Runic/Graphics/Mesh.h"
+#include "Runic/Graphics/ModelDesc.h"
+
+#include <filesystem>
+#include <string>
+
+namespace
+{
+	uint64_t meshBytes(const Runic::MeshDesc& mesh)
+	{
+		return mesh.vertices.size() * sizeof(Runic::Vertex) + mesh.indices.size() * sizeof(Runic::MeshDesc::Index);
+	}
+
+	void GeneratePlane(Benchmark::State& state, int size)
+	{
+		uint64_t bytes = 0U;
+		while (state.KeepRunning())
+		{
+			const Runic::MeshDesc plane = Runic::MeshDesc::GeneratePlane(size);
+			bytes += meshBytes(plane);
+			Benchmark::DoNotOptimize(plane.vertices.data());
+		}
+		state.SetItemsProcessed(state.GetIterations() * static_cast<uint64_t>(size + 1) * static_cast<uint64_t>(size + 1));
+		state.SetBytesProcessed(bytes);
+	}
+
+	/*
+	Throughput is measured against the model's whole directory on disk, the glTF references every file in it.
+	With imagesLoaded every image counts as already uploaded, so they are hashed but not decoded.
+	*/
+	void ParseGLTF(Benchmark::State& state, const std::string& model, bool imagesLoaded)
+	{
+		const std::filesystem::path file = std::filesystem::path(Benchmark::GetAssetDirectory()) / "models" / model / (model + ".gltf");
+		std::error_code error;
+		if (!std::filesystem::exists(file, error))
+		{
+			state.SkipWithError("missing " + file.string());
+			return;
+		}
+
+		uint64_t modelBytes = 0U;
+		for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(file.parent_path()))
+		{
+			if (entry.is_regular_file())
+			{
+				modelBytes += entry.file_size();
+			}
+		}
+
+		const Runic::ModelDesc::ContentFilter isTextureLoaded = [imagesLoaded](uint64_t) { return imagesLoaded; };
+		while (state.KeepRunning())
+		{
+			const std::optional<Runic::ModelDesc> desc = Runic::ModelDesc::LoadFromGLTF(file.string(), isTextureLoaded);
+			if (!desc.has_value())
+			{
+				state.SkipWithError("failed to parse " + file.string());
+				return;
+			}
+			Benchmark::DoNotOptimize(desc->primitives.data());
+		}
+		state.SetBytesProcessed(state.GetIterations() * modelBytes);
+	}
+
+	void HashContent(Benchmark::State& state)
+	{
+		const Runic::MeshDesc plane = Runic::MeshDesc::GeneratePlane(1024);
+		while (state.KeepRunning())
+		{
+			const uint64_t hash = Runic::AssetRegistry::HashContent(plane.vertices.data(), plane.vertices.size() * sizeof(Runic::Vertex));
+			Benchmark::DoNotOptimize(hash);
+		}
+		state.SetBytesProcessed(state.GetIterations() * plane.vertices.size() * sizeof(Runic::Vertex));
+	}
+	RNC_BENCHMARK(HashContent);
+
+	/*
+	Narrowing runs on every mesh upload. The plane has too many vertices for narrow indices, they're truncated here.
+	*/
+	void PackIndices(Benchmark::State& state, uint32_t indexSize)
+	{
+		const Runic::MeshDesc plane = Runic::MeshDesc::GeneratePlane(1024);
+		while (state.KeepRunning())
+		{
+			const std::vector<uint32_t> packed = plane.PackIndices(indexSize);
+			Benchmark::DoNotOptimize(packed.data());
+		}
+		state.SetItemsProcessed(state.GetIterations() * plane.indices.size());
+		state.SetBytesProcessed(state.GetIterations() * plane.indices.size() * indexSize);
+	}
+
+	const bool registered = [] {
+		for (const int size : { 64, 256, 1024, 2048 })
+		{
+			Benchmark::Register("GeneratePlane/" + std::to_string(size), [size](Benchmark::State& state) { GeneratePlane(state, size); });
+		}
+		for (const uint32_t indexSize : { 1U, 2U, 4U })
+		{
+			Benchmark::Register("PackIndices/" + std::to_string(indexSize * 8U), [indexSize](Benchmark::State& state) { PackIndices(state, indexSize); });
+		}
+		for (const char* model : { "Cube", "DamagedHelmet", "Sponza" })
+		{
+			Benchmark::Register(std::string("ParseGLTF/") + model, [model](Benchmark::State& state) { ParseGLTF(state, model, false); });
+			Benchmark::Register(std::string("ParseGLTFCachedImages/") + model, [model](Benchmark::State& state) { ParseGLTF(state, model, true); });
+		}
+		return true;
+	}();
+}
@@ -0,0 +1,240 @@
+#include "Benchmark.h"
+
+#include "Runic/Assets/AssetRegistry.h"
+#include "Runic/Scene/Components/HierarchyComponent.h"
+#include "Runic/Scene/Components/LightComponent.h"
+#include "Runic/Scene/Components/RenderableComponent.h"
+#include "Runic/Scene/Components/TransformComponent.h"
+#include "Runic/Scene/Entity.h"
+#include "Runic/Scene/Scene.h"
+#include "Runic/Scene/SceneSerializer.h"
+
+#include <entt/entt.hpp>
+
+#include <filesystem>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace
+{
+	constexpr uint32_t TRANSFORM_COUNT = 10000U;
+	constexpr uint32_t ENTITY_COUNT = 100000U;
+
+	std::vector<Runic::TransformComponent> makeTransforms(uint32_t count)
+	{
+		std::mt19937 random{ 42U };
+		std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+		std::uniform_real_distribution<float> angle(-3.14f, 3.14f);
+		std::uniform_real_distribution<float> scale(0.5f, 2.0f);
+
+		std::vector<Runic::TransformComponent> transforms(count);
+		for (Runic::TransformComponent& transform : transforms)
+		{
+			transform.translation = { position(random), position(random), position(random) };
+			transform.rotation = { angle(random), angle(random), angle(random) };
+			transform.scale = glm::vec3{ scale(random) };
+		}
+		return transforms;
+	}
+
+	void TransformBuildMatrix(Benchmark::State& state)
+	{
+		const std::vector<Runic::TransformComponent> transforms = makeTransforms(TRANSFORM_COUNT);
+		while (state.KeepRunning())
+		{
+			for (const Runic::TransformComponent& transform : transforms)
+			{
+				const glm::mat4 model = transform.BuildMatrix();
+				Benchmark::DoNotOptimize(model);
+			}
+		}
+		state.SetItemsProcessed(state.GetIterations() * transforms.size());
+	}
+	RNC_BENCHMARK(TransformBuildMatrix);
+
+	/*
+	The renderer's per object transform upload, model matrix plus the inverse transpose for normals
+	*/
+	void TransformNormalMatrix(Benchmark::State& state)
+	{
+		const std::vector<Runic::TransformComponent> transforms = makeTransforms(TRANSFORM_COUNT);
+		while (state.KeepRunning())
+		{
+			for (const Runic::TransformComponent& transform : transforms)
+			{
+				const glm::mat4 model = transform.BuildMatrix();
+				const glm::mat4 normal = glm::mat3(glm::transpose(glm::inverse(model)));
+				Benchmark::DoNotOptimize(model);
+				Benchmark::DoNotOptimize(normal);
+			}
+		}
+		state.SetItemsProcessed(state.GetIterations() * transforms.size());
+	}
+	RNC_BENCHMARK(TransformNormalMatrix);
+
+	void RegistryViewRenderableTransform(Benchmark::State& state)
+	{
+		entt::registry registry;
+		const std::vector<Runic::TransformComponent> transforms = makeTransforms(ENTITY_COUNT);
+		for (uint32_t i = 0; i < ENTITY_COUNT; ++i)
+		{
+			const entt::entity entity = registry.create();
+			registry.emplace<Runic::RenderableComponent>(entity).meshHandle = i;
+			// Some entities are never moved, the view has to skip them
+			if (i % 8U != 0U)
+			{
+				registry.emplace<Runic::TransformComponent>(entity, transforms[i]);
+			}
+		}
+
+		while (state.KeepRunning())
+		{
+			glm::vec3 sum{ 0.0f };
+			uint64_t meshes = 0U;
+			registry.view<Runic::RenderableComponent, Runic::TransformComponent>().each(
+				[&](const Runic::RenderableComponent& renderable, const Runic::TransformComponent& transform) {
+					meshes += renderable.meshHandle;
+					sum += transform.translation;
+				});
+			Benchmark::DoNotOptimize(sum);
+			Benchmark::DoNotOptimize(meshes);
+		}
+		state.SetItemsProcessed(state.GetIterations() * ENTITY_COUNT);
+	}
+	RNC_BENCHMARK(RegistryViewRenderableTransform);
+
+	/*
+	The same walk through Scene's entity list, which is how the renderer reaches components today
+	*/
+	void SceneEntityGetComponent(Benchmark::State& state)
+	{
+		Runic::Scene scene;
+		const std::vector<Runic::TransformComponent> transforms = makeTransforms(ENTITY_COUNT);
+		for (uint32_t i = 0; i < ENTITY_COUNT; ++i)
+		{
+			std::shared_ptr<Runic::Entity> entity = scene.CreateEntity();
+			entity->AddComponent<Runic::RenderableComponent>().meshHandle = i;
+			if (i % 8U != 0U)
+			{
+				entity->AddComponent<Runic::TransformComponent>() = transforms[i];
+			}
+		}
+
+		while (state.KeepRunning())
+		{
+			glm::vec3 sum{ 0.0f };
+			uint64_t meshes = 0U;
+			for (const std::shared_ptr<Runic::Entity>& entity : scene.m_entities)
+			{
+				if (!entity->HasComponent<Runic::TransformComponent>())
+				{
+					continue;
+				}
+				meshes += entity->GetComponent<Runic::RenderableComponent>().meshHandle;
+				sum += entity->GetComponent<Runic::TransformComponent>().translation;
+			}
+			Benchmark::DoNotOptimize(sum);
+			Benchmark::DoNotOptimize(meshes);
+		}
+		state.SetItemsProcessed(state.GetIterations() * ENTITY_COUNT);
+	}
+	RNC_BENCHMARK(SceneEntityGetComponent);
+
+	/*
+	ENTITY_COUNT renderables sharing 64 registered meshes, a point light on every 16th and each group of 8
+	attached to its first entity
+	*/
+	void fillSerializableScene(Runic::Scene& scene, Runic::AssetRegistry& assets)
+	{
+		constexpr uint32_t MESH_COUNT = 64U;
+		for (uint32_t mesh = 0; mesh < MESH_COUNT; ++mesh)
+		{
+			const Runic::AssetSource source{ .path = "models/Benchmark.gltf", .index = mesh };
+			assets.AddMesh(Runic::AssetRegistry::MakeID(Runic::AssetType::MESH, source.path, mesh), mesh, source);
+		}
+
+		const std::vector<Runic::TransformComponent> transforms = makeTransforms(ENTITY_COUNT);
+		std::shared_ptr<Runic::Entity> parent;
+		for (uint32_t i = 0; i < ENTITY_COUNT; ++i)
+		{
+			std::shared_ptr<Runic::Entity> entity = scene.CreateEntity();
+			entity->AddComponent<Runic::TransformComponent>() = transforms[i];
+			entity->AddComponent<Runic::RenderableComponent>().meshHandle = i % MESH_COUNT;
+			if (i % 16U == 0U)
+			{
+				entity->AddComponent<LightComponent>().lightType = LightComponent::LightType::Point;
+			}
+			if (i % 8U == 0U)
+			{
+				parent = entity;
+			}
+			else
+			{
+				entity->AddComponent<Runic::HierarchyComponent>().parent = parent->GetHandle();
+			}
+		}
+	}
+
+	std::string serializedScenePath()
+	{
+		return (std::filesystem::temp_directory_path() / "RunicBenchmark.rscene").string();
+	}
+
+	void SceneSave(Benchmark::State& state)
+	{
+		Runic::Scene scene;
+		Runic::AssetRegistry assets;
+		fillSerializableScene(scene, assets);
+		const Runic::SceneSerializer serializer(&assets);
+		const std::string path = serializedScenePath();
+
+		while (state.KeepRunning())
+		{
+			if (!serializer.Save(scene, path))
+			{
+				state.SkipWithError("Can't write " + path);
+			}
+		}
+		state.SetItemsProcessed(state.GetIterations() * ENTITY_COUNT);
+		state.SetBytesProcessed(state.GetIterations() * std::filesystem::file_size(path));
+	}
+	RNC_BENCHMARK(SceneSave);
+
+	void SceneLoad(Benchmark::State& state)
+	{
+		const std::string path = serializedScenePath();
+		Runic::AssetRegistry assets;
+		{
+			Runic::Scene scene;
+			fillSerializableScene(scene, assets);
+			if (!Runic::SceneSerializer(&assets).Save(scene, path))
+			{
+				state.SkipWithError("Can't write " + path);
+				return;
+			}
+		}
+
+		const Runic::SceneSerializer serializer(&assets);
+		while (state.KeepRunning())
+		{
+			state.PauseTiming();
+			std::unique_ptr<Runic::Scene> scene = std::make_unique<Runic::Scene>();
+			state.ResumeTiming();
+
+			if (!serializer.Load(*scene, path))
+			{
+				state.SkipWithError("Can't read " + path);
+			}
+			Benchmark::DoNotOptimize(scene->m_entities.size());
+
+			// Tearing the scene down isn't part of loading it
+			state.PauseTiming();
+			scene.reset();
+			state.ResumeTiming();
+		}
+		state.SetItemsProcessed(state.GetIterations() * ENTITY_COUNT);
+		state.SetBytesProcessed(state.GetIterations() * std::filesystem::file_size(path));
+	}
+	RNC_BENCHMARK(SceneLoad);
+}
@@ -0,0 +1,111 @@
+#include "Benchmark.h"
+
+#include "Runic/Structures/DeletionQueue.h"
+#include "Runic/Structures/Slotmap.h"
+
+#include <glm.hpp>
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace
+{
+	// Handle 0 is never handed out
+	constexpr uint32_t SLOTMAP_CAPACITY = 4095U;
+	constexpr uint32_t DELETION_QUEUE_SIZE = 1024U;
+
+	// Sized like the resources the renderer keeps in slotmaps
+	struct SlotmapPayload
+	{
+		glm::mat4 matrix{ 1.0f };
+		uint64_t handle{ 0U };
+	};
+
+	std::unique_ptr<Slotmap<SlotmapPayload>> makeFullSlotmap(std::vector<uint32_t>& handles)
+	{
+		auto slotmap = std::make_unique<Slotmap<SlotmapPayload>>();
+		handles.clear();
+		for (uint32_t i = 0; i < SLOTMAP_CAPACITY; ++i)
+		{
+			handles.push_back(slotmap->add(SlotmapPayload{ .handle = i }));
+		}
+		return slotmap;
+	}
+
+	void SlotmapAddRemove(Benchmark::State& state)
+	{
+		auto slotmap = std::make_unique<Slotmap<SlotmapPayload>>();
+		std::vector<uint32_t> handles(SLOTMAP_CAPACITY);
+		while (state.KeepRunning())
+		{
+			for (uint32_t i = 0; i < SLOTMAP_CAPACITY; ++i)
+			{
+				handles[i] = slotmap->add(SlotmapPayload{ .handle = i });
+			}
+			for (const uint32_t handle : handles)
+			{
+				slotmap->remove(handle);
+			}
+			Benchmark::DoNotOptimize(slotmap->m_array);
+		}
+		state.SetItemsProcessed(state.GetIterations() * SLOTMAP_CAPACITY * 2U);
+	}
+	RNC_BENCHMARK(SlotmapAddRemove);
+
+	void SlotmapGetRandom(Benchmark::State& state)
+	{
+		std::vector<uint32_t> handles;
+		auto slotmap = makeFullSlotmap(handles);
+		std::shuffle(handles.begin(), handles.end(), std::mt19937{ 42U });
+
+		while (state.KeepRunning())
+		{
+			uint64_t sum = 0U;
+			for (const uint32_t handle : handles)
+			{
+				sum += slotmap->get(handle).handle;
+			}
+			Benchmark::DoNotOptimize(sum);
+		}
+		state.SetItemsProcessed(state.GetIterations() * handles.size());
+	}
+	RNC_BENCHMARK(SlotmapGetRandom);
+
+	void SlotmapIterate(Benchmark::State& state)
+	{
+		std::vector<uint32_t> handles;
+		auto slotmap = makeFullSlotmap(handles);
+
+		while (state.KeepRunning())
+		{
+			glm::vec4 sum{ 0.0f };
+			for (const SlotmapPayload& payload : slotmap->m_array)
+			{
+				sum += payload.matrix[3];
+			}
+			Benchmark::DoNotOptimize(sum);
+		}
+		state.SetItemsProcessed(state.GetIterations() * slotmap->m_array.size());
+	}
+	RNC_BENCHMARK(SlotmapIterate);
+
+	void DeletionQueuePushFlush(Benchmark::State& state)
+	{
+		DeletionQueue queue;
+		uint64_t deleted = 0U;
+		while (state.KeepRunning())
+		{
+			// Deletors capture a handle or two, like the ones the device pushes
+			for (uint32_t i = 0; i < DELETION_QUEUE_SIZE; ++i)
+			{
+				queue.push_function([&deleted, i]() { deleted += i; });
+			}
+			queue.flush();
+		}
+		Benchmark::DoNotOptimize(deleted);
+		state.SetItemsProcessed(state.GetIterations() * DELETION_QUEUE_SIZE);
+	}
+	RNC_BENCHMARK(DeletionQueuePushFlush);
+}
@@ -1,10 +1,11 @@
 
 #include "Runic/Engine.h"
 
-int main()
+int main(int argc, char** argv)
 {
 	Runic::Engine eng;
-	eng.Init();
-	eng.run();
+	eng.Init(Runic::EngineProps::FromCommandLine(argc, argv));
+	const int exitCode = eng.run();
 	eng.Deinit();
+	return exitCode;
 }
\ No newline at end of file
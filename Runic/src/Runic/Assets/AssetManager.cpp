@@ -0,0 +1,268 @@
+#include "Runic/Assets/AssetManager.h"
+
+#include "Runic/Graphics/ModelLoader.h"
+#include "Runic/Graphics/Renderer.h"
+#include "Runic/Log.h"
+#include "Runic/Scene/Components/HierarchyComponent.h"
+#include "Runic/Scene/Entity.h"
+#include "Runic/Scene/Scene.h"
+
+#include <Tracy.hpp>
+
+#include <filesystem>
+
+using namespace Runic;
+
+namespace
+{
+	float millisecondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+void AssetManager::Init(Renderer* rend, Scene* scene)
+{
+	m_rend = rend;
+	m_scene = scene;
+
+	RenderableComponent placeholder;
+	placeholder.meshHandle = m_rend->UploadMesh(MeshDesc::GenerateCube());
+	placeholder.textureHandle = 0;
+	m_placeholder = { placeholder };
+}
+
+void AssetManager::Deinit()
+{
+	for (PendingModel& pending : m_pendingModels)
+	{
+		pending.result.wait();
+	}
+	m_pendingModels.clear();
+	m_models.clear();
+	m_modelsByPath.clear();
+}
+
+void AssetManager::Update()
+{
+	ZoneScoped;
+
+	uint32_t uploads = 0U;
+	for (auto it = m_pendingModels.begin(); it != m_pendingModels.end() && uploads < MAX_MODEL_UPLOADS_PER_FRAME;)
+	{
+		if (it->result.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		{
+			++it;
+			continue;
+		}
+
+		ParsedModel parsed = it->result.get();
+		const ModelHandle handle = it->handle;
+		it = m_pendingModels.erase(it);
+		swapInModel(handle, parsed);
+		++uploads;
+	}
+}
+
+ModelHandle AssetManager::LoadModel(const std::string& filename, LoadCallback callback)
+{
+	if (const auto found = m_modelsByPath.find(filename); found != m_modelsByPath.end())
+	{
+		ModelAsset& model = m_models[found->second];
+		if (callback)
+		{
+			if (model.state == LoadState::LOADING)
+			{
+				model.callbacks.push_back(std::move(callback));
+			}
+			else
+			{
+				callback(found->second, model.state == LoadState::LOADED);
+			}
+		}
+		return found->second;
+	}
+
+	const ModelHandle handle = static_cast<ModelHandle>(m_models.size());
+	m_models.push_back(ModelAsset{ .filename = filename, .requestTime = std::chrono::steady_clock::now() });
+	if (callback)
+	{
+		m_models.back().callbacks.push_back(std::move(callback));
+	}
+	m_modelsByPath[filename] = handle;
+
+	// Images already uploaded by an earlier load are only hashed, not decoded again
+	const AssetRegistry* assets = &m_rend->GetAssets();
+	m_pendingModels.push_back(PendingModel{
+		.handle = handle,
+		.result = std::async(std::launch::async, [filename, assets]() {
+			const auto start = std::chrono::steady_clock::now();
+			const ModelDesc::ContentFilter isTextureLoaded = [assets](uint64_t contentHash) { return assets->HasTextureContent(contentHash); };
+			ParsedModel parsed;
+			parsed.model = std::filesystem::path(filename).extension() == ".obj" ? ModelDesc::LoadFromObj(filename, isTextureLoaded) : ModelDesc::LoadFromGLTF(filename, isTextureLoaded);
+			parsed.loadMs = millisecondsSince(start);
+			return parsed;
+		}),
+	});
+	return handle;
+}
+
+std::shared_ptr<Entity> AssetManager::Instantiate(ModelHandle handle, const TransformComponent& transform)
+{
+	ModelAsset& model = m_models.at(handle);
+
+	std::shared_ptr<Entity> root = m_scene->CreateEntity();
+	root->AddComponent<TransformComponent>() = transform;
+	std::vector<std::shared_ptr<Entity>> entities{ root };
+
+	if (model.state == LoadState::LOADED)
+	{
+		const std::vector<std::shared_ptr<Entity>> nodes = createNodeEntities(model, *root, nullptr);
+		entities.insert(entities.end(), nodes.begin(), nodes.end());
+	}
+	else
+	{
+		std::shared_ptr<Entity> placeholder = m_scene->CreateEntity();
+		placeholder->AddComponent<RenderableComponent>() = m_placeholder.front();
+		placeholder->AddComponent<TransformComponent>();
+		placeholder->AddComponent<HierarchyComponent>().parent = root->GetHandle();
+		entities.push_back(placeholder);
+		if (model.state == LoadState::LOADING)
+		{
+			model.instances.push_back(PendingInstance{ .root = root, .placeholder = placeholder });
+		}
+	}
+
+	m_rend->GiveRenderables(entities);
+	return root;
+}
+
+bool AssetManager::IsLoaded(ModelHandle handle) const
+{
+	return m_models.at(handle).state == LoadState::LOADED;
+}
+
+const std::vector<RenderableComponent>& AssetManager::GetRenderables(ModelHandle handle) const
+{
+	const ModelAsset& model = m_models.at(handle);
+	return model.state == LoadState::LOADED ? model.renderables : m_placeholder;
+}
+
+std::optional<AssetLoadTiming> AssetManager::GetLoadTiming(ModelHandle handle) const
+{
+	const ModelAsset& model = m_models.at(handle);
+	if (model.state == LoadState::LOADING)
+	{
+		return std::nullopt;
+	}
+	return model.timing;
+}
+
+void AssetManager::swapInModel(ModelHandle handle, ParsedModel& parsed)
+{
+	ZoneScoped;
+
+	ModelAsset& model = m_models[handle];
+	model.timing.loadMs = parsed.loadMs;
+
+	// A file without any primitives has nothing to swap in either, its instances keep the placeholder
+	if (parsed.model.has_value() && !parsed.model->primitives.empty())
+	{
+		const auto uploadStart = std::chrono::steady_clock::now();
+		ModelLoader loader(m_rend);
+		model.renderables = loader.UploadModel(parsed.model.value(), model.filename);
+		model.nodes = std::move(parsed.model->nodes);
+		model.timing.uploadMs = millisecondsSince(uploadStart);
+		model.state = LoadState::LOADED;
+	}
+	else
+	{
+		LOG_CORE_WARN("Failed to load model, keeping the placeholder: " + model.filename);
+		model.state = LoadState::FAILED;
+	}
+	model.timing.totalMs = millisecondsSince(model.requestTime);
+
+	if (model.state == LoadState::LOADED)
+	{
+		std::vector<std::shared_ptr<Entity>> entities;
+		for (const PendingInstance& instance : model.instances)
+		{
+			const std::vector<std::shared_ptr<Entity>> nodes = createNodeEntities(model, *instance.root, instance.placeholder);
+			entities.insert(entities.end(), nodes.begin(), nodes.end());
+		}
+
+		// Bounds change with the mesh even when no entities were added
+		m_rend->GiveRenderables(entities);
+	}
+	model.instances.clear();
+
+	const bool loaded = model.state == LoadState::LOADED;
+	std::vector<LoadCallback> callbacks = std::move(model.callbacks);
+	model.callbacks.clear();
+	for (const LoadCallback& callback : callbacks)
+	{
+		callback(handle, loaded);
+	}
+}
+
+std::vector<std::shared_ptr<Entity>> AssetManager::createNodeEntities(const ModelAsset& model, const Entity& root, std::shared_ptr<Entity> placeholder)
+{
+	std::vector<std::shared_ptr<Entity>> created;
+	const auto createEntity = [&](entt::entity parent, const ModelDesc::Transform& transform, const RenderableComponent* renderable) -> Entity& {
+		std::shared_ptr<Entity> entity;
+		if (renderable != nullptr && placeholder != nullptr)
+		{
+			// Already given to the renderer, so it's swapped in place
+			entity = std::move(placeholder);
+			entity->GetComponent<RenderableComponent>() = *renderable;
+		}
+		else
+		{
+			entity = m_scene->CreateEntity();
+			entity->AddComponent<TransformComponent>();
+			entity->AddComponent<HierarchyComponent>();
+			if (renderable != nullptr)
+			{
+				entity->AddComponent<RenderableComponent>() = *renderable;
+			}
+			created.push_back(entity);
+		}
+
+		TransformComponent& component = entity->GetComponent<TransformComponent>();
+		component.translation = transform.translation;
+		component.rotation = glm::eulerAngles(transform.rotation);
+		component.scale = transform.scale;
+		entity->GetComponent<HierarchyComponent>().parent = parent;
+		return *entity;
+	};
+
+	// Nodes come after their parents, so a parent's entity always exists already
+	const std::vector<ModelDesc::Transform> drawOnce{ ModelDesc::Transform{} };
+	std::vector<entt::entity> nodeEntities(model.nodes.size(), entt::entity{ entt::null });
+	for (size_t i = 0; i < model.nodes.size(); ++i)
+	{
+		const ModelDesc::Node& node = model.nodes[i];
+		const entt::entity parent = node.parent >= 0 ? nodeEntities[node.parent] : root.GetHandle();
+
+		// A node drawing one mesh once holds it, otherwise every draw is a child of the node
+		const bool drawsOnce = node.primitives.size() == 1U && node.instances.empty();
+		const Entity& nodeEntity = createEntity(parent, node.transform, drawsOnce ? &model.renderables[node.primitives.front()] : nullptr);
+		nodeEntities[i] = nodeEntity.GetHandle();
+		if (drawsOnce)
+		{
+			continue;
+		}
+
+		// Instances share the primitives' handles, so they are drawn as one instanced batch
+		for (const ModelDesc::Transform& instance : node.instances.empty() ? drawOnce : node.instances)
+		{
+			for (const int primitive : node.primitives)
+			{
+				createEntity(nodeEntities[i], instance, &model.renderables[primitive]);
+			}
+		}
+	}
+
+	// The placeholder stays if no node draws anything
+	return created;
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Runic/Graphics/ModelDesc.h"
+#include "Runic/Scene/Components/RenderableComponent.h"
+#include "Runic/Scene/Components/TransformComponent.h"
+
+namespace Runic
+{
+	class Entity;
+	class Renderer;
+	class Scene;
+
+	typedef uint32_t ModelHandle;
+
+	constexpr uint32_t MAX_MODEL_UPLOADS_PER_FRAME = 1U;		// Uploads block on the GPU, so they're spread over frames
+
+	struct AssetLoadTiming
+	{
+		float loadMs{ 0.0f };		// Reading, parsing and decoding on the worker thread
+		float uploadMs{ 0.0f };		// Uploading at the frame boundary
+		float totalMs{ 0.0f };		// From the request to the swap
+	};
+
+	/*
+	*
+	* AssetManager: Loads models in the background and hands back a handle straight away.
+	*
+	*	File reading, parsing and image decoding run on a worker thread. Until Update() uploads the result,
+	*	instances of the model render the placeholder cube instead. Uploads stay on the render thread, since
+	*	they submit to the GPU and wait for it.
+	*
+	*/
+	class AssetManager
+	{
+	public:
+		/*
+		Called once the model is swapped in, or with loaded false if it couldn't be read
+		*/
+		using LoadCallback = std::function<void(ModelHandle handle, bool loaded)>;
+
+		void Init(Renderer* rend, Scene* scene);
+		/*
+		Waits for loads still in flight, their results are dropped
+		*/
+		void Deinit();
+
+		/*
+		Swaps in finished loads. Call once per frame at a frame boundary.
+		*/
+		void Update();
+
+		/*
+		Requesting a file that's already loading or loaded returns its handle, the callback is still called.
+		*/
+		ModelHandle LoadModel(const std::string& filename, LoadCallback callback = {});
+
+		/*
+		Returns the root entity, with the model's nodes as children carrying their local transforms. Until the
+		model is loaded the root only has a placeholder child.
+		*/
+		std::shared_ptr<Entity> Instantiate(ModelHandle handle, const TransformComponent& transform);
+
+		bool IsLoaded(ModelHandle handle) const;
+		/*
+		The placeholder while the model is still loading, or if it failed to load
+		*/
+		const std::vector<RenderableComponent>& GetRenderables(ModelHandle handle) const;
+		std::optional<AssetLoadTiming> GetLoadTiming(ModelHandle handle) const;
+		uint32_t GetPendingCount() const { return static_cast<uint32_t>(m_pendingModels.size()); }
+	private:
+		enum class LoadState
+		{
+			LOADING,
+			LOADED,
+			FAILED,
+		};
+
+		struct PendingInstance
+		{
+			std::shared_ptr<Entity> root;
+			std::shared_ptr<Entity> placeholder;
+		};
+
+		struct ModelAsset
+		{
+			std::string filename;
+			LoadState state{ LoadState::LOADING };
+			std::vector<RenderableComponent> renderables;
+			std::vector<ModelDesc::Node> nodes;
+			std::vector<PendingInstance> instances;
+			std::vector<LoadCallback> callbacks;
+			AssetLoadTiming timing;
+			std::chrono::steady_clock::time_point requestTime;
+		};
+
+		struct ParsedModel
+		{
+			std::optional<ModelDesc> model;
+			float loadMs{ 0.0f };
+		};
+
+		struct PendingModel
+		{
+			ModelHandle handle;
+			std::future<ParsedModel> result;
+		};
+
+		void swapInModel(ModelHandle handle, ParsedModel& parsed);
+		/*
+		Adds the model's nodes under root. The placeholder, when given, is reused for the first drawn entity.
+		Returns the entities it created.
+		*/
+		std::vector<std::shared_ptr<Entity>> createNodeEntities(const ModelAsset& model, const Entity& root, std::shared_ptr<Entity> placeholder);
+
+		Renderer* m_rend{ nullptr };
+		Scene* m_scene{ nullptr };
+		std::vector<RenderableComponent> m_placeholder;
+		std::vector<ModelAsset> m_models;
+		std::unordered_map<std::string, ModelHandle> m_modelsByPath;
+		std::vector<PendingModel> m_pendingModels;
+	};
+}
@@ -0,0 +1,264 @@
+#include "Runic/Assets/AssetRegistry.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+
+using namespace Runic;
+
+AssetID AssetRegistry::MakeID(AssetType type, std::string_view path, uint32_t index)
+{
+	// FNV-1a over the normalised path, the index and the type, so "a/../b.gltf" and "b.gltf" agree
+	const std::string normalised = std::filesystem::path(path).lexically_normal().generic_string();
+
+	constexpr uint64_t FNV_OFFSET = 14695981039346656037ULL;
+	constexpr uint64_t FNV_PRIME = 1099511628211ULL;
+	uint64_t hash = FNV_OFFSET;
+	const auto mix = [&hash](uint8_t byte) {
+		hash ^= byte;
+		hash *= FNV_PRIME;
+	};
+
+	for (const char c : normalised)
+	{
+		mix(static_cast<uint8_t>(c));
+	}
+	for (int shift = 0; shift < 32; shift += 8)
+	{
+		mix(static_cast<uint8_t>(index >> shift));
+	}
+	mix(static_cast<uint8_t>(type));
+
+	return hash != 0U ? hash : 1U;
+}
+
+uint64_t AssetRegistry::HashContent(const void* data, size_t size, uint64_t seed)
+{
+	// Eight bytes per step, byte wise FNV is too slow for megabytes of pixels and vertices
+	constexpr uint64_t PRIME = 0x9E3779B97F4A7C15ULL;
+	const auto* bytes = static_cast<const unsigned char*>(data);
+	uint64_t hash = seed ^ (size * PRIME);
+	const auto mix = [&hash](uint64_t word) {
+		hash ^= word * PRIME;
+		hash = (hash << 31U) | (hash >> 33U);
+		hash *= PRIME;
+	};
+
+	size_t offset = 0U;
+	for (; offset + sizeof(uint64_t) <= size; offset += sizeof(uint64_t))
+	{
+		uint64_t word;
+		std::memcpy(&word, bytes + offset, sizeof(word));
+		mix(word);
+	}
+	if (offset < size)
+	{
+		uint64_t word = 0U;
+		std::memcpy(&word, bytes + offset, size - offset);
+		mix(word);
+	}
+
+	hash ^= hash >> 29U;
+	hash *= PRIME;
+	hash ^= hash >> 32U;
+	return hash;
+}
+
+void AssetRegistry::AddMesh(AssetID id, MeshHandle mesh, const AssetSource& source)
+{
+	addID(id, AssetType::MESH, mesh, source, m_meshIDs);
+}
+
+void AssetRegistry::AddTexture(AssetID id, TextureHandle texture, const AssetSource& source)
+{
+	addID(id, AssetType::TEXTURE, texture, source, m_textureIDs);
+}
+
+void AssetRegistry::RemoveMesh(MeshHandle mesh)
+{
+	removeIDs(mesh, m_meshIDs);
+	if (const auto it = m_meshReferences.find(mesh); it != m_meshReferences.end())
+	{
+		m_meshContents.erase(it->second.contentHash);
+		m_meshReferences.erase(it);
+	}
+}
+
+void AssetRegistry::RemoveTexture(TextureHandle texture)
+{
+	removeIDs(texture, m_textureIDs);
+	if (const auto it = m_textureReferences.find(texture); it != m_textureReferences.end())
+	{
+		std::lock_guard<std::mutex> lock(m_textureContentMutex);
+		m_textureContents.erase(it->second.contentHash);
+		m_textureReferences.erase(it);
+	}
+}
+
+std::optional<MeshHandle> AssetRegistry::FindMesh(AssetID id) const
+{
+	const auto it = m_assets.find(id);
+	if (it == m_assets.end() || it->second.type != AssetType::MESH)
+	{
+		return std::nullopt;
+	}
+	return it->second.handle;
+}
+
+std::optional<TextureHandle> AssetRegistry::FindTexture(AssetID id) const
+{
+	const auto it = m_assets.find(id);
+	if (it == m_assets.end() || it->second.type != AssetType::TEXTURE)
+	{
+		return std::nullopt;
+	}
+	return it->second.handle;
+}
+
+AssetID AssetRegistry::GetMeshID(MeshHandle mesh) const
+{
+	const auto it = m_meshIDs.find(mesh);
+	return it != m_meshIDs.end() ? it->second.front() : 0U;
+}
+
+AssetID AssetRegistry::GetTextureID(TextureHandle texture) const
+{
+	const auto it = m_textureIDs.find(texture);
+	return it != m_textureIDs.end() ? it->second.front() : 0U;
+}
+
+const AssetSource* AssetRegistry::GetSource(AssetID id) const
+{
+	const auto it = m_assets.find(id);
+	return it != m_assets.end() ? &it->second.source : nullptr;
+}
+
+std::optional<MeshHandle> AssetRegistry::AcquireMesh(uint64_t contentHash)
+{
+	const auto it = m_meshContents.find(contentHash);
+	if (it == m_meshContents.end())
+	{
+		return std::nullopt;
+	}
+	++m_meshReferences[it->second].references;
+	return it->second;
+}
+
+std::optional<TextureHandle> AssetRegistry::AcquireTexture(uint64_t contentHash)
+{
+	std::optional<TextureHandle> texture;
+	{
+		std::lock_guard<std::mutex> lock(m_textureContentMutex);
+		if (const auto it = m_textureContents.find(contentHash); it != m_textureContents.end())
+		{
+			texture = it->second;
+		}
+	}
+	if (texture.has_value())
+	{
+		++m_textureReferences[texture.value()].references;
+	}
+	return texture;
+}
+
+void AssetRegistry::AddMeshContent(uint64_t contentHash, MeshHandle mesh)
+{
+	m_meshContents[contentHash] = mesh;
+	m_meshReferences[mesh] = ContentEntry{ .contentHash = contentHash, .references = 1U };
+}
+
+void AssetRegistry::AddTextureContent(uint64_t contentHash, TextureHandle texture)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_textureContentMutex);
+		m_textureContents[contentHash] = texture;
+	}
+	m_textureReferences[texture] = ContentEntry{ .contentHash = contentHash, .references = 1U };
+}
+
+void AssetRegistry::RetainMesh(MeshHandle mesh)
+{
+	if (const auto it = m_meshReferences.find(mesh); it != m_meshReferences.end())
+	{
+		++it->second.references;
+	}
+}
+
+void AssetRegistry::RetainTexture(TextureHandle texture)
+{
+	if (const auto it = m_textureReferences.find(texture); it != m_textureReferences.end())
+	{
+		++it->second.references;
+	}
+}
+
+bool AssetRegistry::ReleaseMesh(MeshHandle mesh)
+{
+	const auto it = m_meshReferences.find(mesh);
+	if (it == m_meshReferences.end())
+	{
+		return false;
+	}
+	return --it->second.references == 0U;
+}
+
+bool AssetRegistry::ReleaseTexture(TextureHandle texture)
+{
+	const auto it = m_textureReferences.find(texture);
+	if (it == m_textureReferences.end())
+	{
+		return false;
+	}
+	return --it->second.references == 0U;
+}
+
+uint32_t AssetRegistry::GetMeshReferences(MeshHandle mesh) const
+{
+	const auto it = m_meshReferences.find(mesh);
+	return it != m_meshReferences.end() ? it->second.references : 0U;
+}
+
+uint32_t AssetRegistry::GetTextureReferences(TextureHandle texture) const
+{
+	const auto it = m_textureReferences.find(texture);
+	return it != m_textureReferences.end() ? it->second.references : 0U;
+}
+
+bool AssetRegistry::HasTextureContent(uint64_t contentHash) const
+{
+	std::lock_guard<std::mutex> lock(m_textureContentMutex);
+	return m_textureContents.count(contentHash) != 0U;
+}
+
+void AssetRegistry::addID(AssetID id, AssetType type, uint32_t handle, const AssetSource& source, std::unordered_map<uint32_t, std::vector<AssetID>>& ids)
+{
+	// Registering an ID again moves it to the new handle
+	if (const auto it = m_assets.find(id); it != m_assets.end() && it->second.type == type && it->second.handle != handle)
+	{
+		std::vector<AssetID>& previous = ids[it->second.handle];
+		previous.erase(std::remove(previous.begin(), previous.end(), id), previous.end());
+		if (previous.empty())
+		{
+			ids.erase(it->second.handle);
+		}
+	}
+
+	m_assets[id] = Entry{ .type = type, .handle = handle, .source = source };
+	std::vector<AssetID>& handleIDs = ids[handle];
+	if (std::find(handleIDs.begin(), handleIDs.end(), id) == handleIDs.end())
+	{
+		handleIDs.push_back(id);
+	}
+}
+
+void AssetRegistry::removeIDs(uint32_t handle, std::unordered_map<uint32_t, std::vector<AssetID>>& ids)
+{
+	if (const auto it = ids.find(handle); it != ids.end())
+	{
+		for (const AssetID id : it->second)
+		{
+			m_assets.erase(id);
+		}
+		ids.erase(it);
+	}
+}
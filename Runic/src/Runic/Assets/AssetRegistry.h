@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "Runic/Scene/Components/RenderableComponent.h"
+
+namespace Runic
+{
+	/*
+	Stable across runs and machines, unlike handles, which depend on load order. 0 is never a valid ID.
+	*/
+	typedef uint64_t AssetID;
+
+	enum class AssetType : uint32_t
+	{
+		MESH,
+		TEXTURE,
+	};
+
+	/*
+	Where an asset comes from: loading path through ModelLoader registers it, index tells it apart from the
+	file's other meshes or textures
+	*/
+	struct AssetSource
+	{
+		std::string path;
+		uint32_t index{ 0U };
+	};
+
+	/*
+	*
+	* AssetRegistry: Maps the renderer's mesh and texture handles to asset IDs and back, so anything saved to disk
+	*				 can refer to assets by ID and find, or reload, them later.
+	*
+	*	Loaded meshes and textures are also keyed by a hash of their contents, so a file that is loaded twice,
+	*	or two files that share a texture, reuse the handles already uploaded. Each load takes a reference,
+	*	the renderer destroys the asset when the last one is released.
+	*
+	*/
+	class AssetRegistry
+	{
+	public:
+		static AssetID MakeID(AssetType type, std::string_view path, uint32_t index);
+		/*
+		Not cryptographic, only has to tell apart different assets. seed chains several blocks into one hash.
+		*/
+		static uint64_t HashContent(const void* data, size_t size, uint64_t seed = 0U);
+
+		void AddMesh(AssetID id, MeshHandle mesh, const AssetSource& source);
+		void AddTexture(AssetID id, TextureHandle texture, const AssetSource& source);
+		void RemoveMesh(MeshHandle mesh);
+		void RemoveTexture(TextureHandle texture);
+
+		std::optional<MeshHandle> FindMesh(AssetID id) const;
+		std::optional<TextureHandle> FindTexture(AssetID id) const;
+
+		/*
+		0 for handles that weren't registered, e.g. generated meshes. Deduplicated content can be registered
+		under several IDs, this is the first of them.
+		*/
+		AssetID GetMeshID(MeshHandle mesh) const;
+		AssetID GetTextureID(TextureHandle texture) const;
+
+		const AssetSource* GetSource(AssetID id) const;
+
+		/*
+		Takes a reference to the already uploaded asset with these contents
+		*/
+		std::optional<MeshHandle> AcquireMesh(uint64_t contentHash);
+		std::optional<TextureHandle> AcquireTexture(uint64_t contentHash);
+		/*
+		Records a freshly uploaded asset, holding one reference
+		*/
+		void AddMeshContent(uint64_t contentHash, MeshHandle mesh);
+		void AddTextureContent(uint64_t contentHash, TextureHandle texture);
+		/*
+		Takes another reference to an uploaded asset, for renderables that use it without loading it, such as
+		ones read from a scene file. Assets that weren't added by content aren't counted.
+		*/
+		void RetainMesh(MeshHandle mesh);
+		void RetainTexture(TextureHandle texture);
+		/*
+		True when that was the last reference and the asset should be destroyed. Assets that weren't added by
+		content are never reference counted.
+		*/
+		bool ReleaseMesh(MeshHandle mesh);
+		bool ReleaseTexture(TextureHandle texture);
+		uint32_t GetMeshReferences(MeshHandle mesh) const;
+		uint32_t GetTextureReferences(TextureHandle texture) const;
+
+		/*
+		Safe to call from loader threads, so they can skip decoding images that are already uploaded
+		*/
+		bool HasTextureContent(uint64_t contentHash) const;
+	private:
+		void addID(AssetID id, AssetType type, uint32_t handle, const AssetSource& source, std::unordered_map<uint32_t, std::vector<AssetID>>& ids);
+		void removeIDs(uint32_t handle, std::unordered_map<uint32_t, std::vector<AssetID>>& ids);
+
+		struct Entry
+		{
+			AssetType type;
+			uint32_t handle;
+			AssetSource source;
+		};
+
+		std::unordered_map<AssetID, Entry> m_assets;
+		// Every ID registered for a handle, so none of them outlives the asset
+		std::unordered_map<MeshHandle, std::vector<AssetID>> m_meshIDs;
+		std::unordered_map<TextureHandle, std::vector<AssetID>> m_textureIDs;
+
+		struct ContentEntry
+		{
+			uint64_t contentHash;
+			uint32_t references;
+		};
+
+		std::unordered_map<uint64_t, MeshHandle> m_meshContents;
+		std::unordered_map<MeshHandle, ContentEntry> m_meshReferences;
+		std::unordered_map<uint64_t, TextureHandle> m_textureContents;		// Guarded by m_textureContentMutex
+		std::unordered_map<TextureHandle, ContentEntry> m_textureReferences;
+		mutable std::mutex m_textureContentMutex;
+	};
+}
@@ -0,0 +1,397 @@
+#include "Runic/Benchmark/BenchmarkRunner.h"
+
+#include <Tracy.hpp>
+
+#include "Runic/Graphics/Device.h"
+#include "Runic/Graphics/ModelLoader.h"
+#include "Runic/Graphics/Renderer.h"
+#include "Runic/Log.h"
+#include "Runic/Scene/Components/TransformComponent.h"
+#include "Runic/Scene/Entity.h"
+#include "Runic/Scene/Scene.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+using namespace Runic;
+
+namespace
+{
+	constexpr uint32_t DEFAULT_HELMETS = 4000U;
+	constexpr uint32_t DEFAULT_LIGHTS = MAX_POINT_LIGHTS;
+	constexpr uint32_t DEFAULT_STREAMED_MODELS = 8U;
+	constexpr uint64_t STREAMING_TEXTURE_BUDGET = 64ULL * 1024ULL * 1024ULL;
+	constexpr float HELMET_SPACING = 3.0f;
+
+	const char* HELMET_PATH = "../../assets/models/DamagedHelmet/DamagedHelmet.gltf";
+	const char* SPONZA_PATH = "../../assets/models/Sponza/Sponza.gltf";
+
+	std::optional<std::vector<RenderableComponent>> loadModel(Renderer* renderer, const char* path)
+	{
+		ModelLoader loader(renderer);
+		std::optional<std::vector<RenderableComponent>> model = loader.LoadModelFromGLTF(path);
+		if (!model.has_value())
+		{
+			LOG_CORE_ALWAYS(std::string("Benchmark: can't load ") + path);
+		}
+		return model;
+	}
+
+	std::shared_ptr<Entity> addRenderable(Scene* scene, const RenderableComponent& renderable, const glm::vec3& translation, const glm::vec3& rotation = glm::vec3{ 0.0f })
+	{
+		std::shared_ptr<Entity> entity = scene->CreateEntity();
+		entity->AddComponent<RenderableComponent>() = renderable;
+		TransformComponent& transform = entity->AddComponent<TransformComponent>();
+		transform.translation = translation;
+		transform.rotation = rotation;
+		return entity;
+	}
+
+	// Helmets are modelled facing down their z axis
+	constexpr glm::vec3 HELMET_ROTATION = { 1.25f, 0.0f, 0.0f };
+
+	// Nearest rank, samples are sorted
+	float percentile(const std::vector<float>& sorted, float p)
+	{
+		if (sorted.empty())
+		{
+			return 0.0f;
+		}
+		const size_t rank = static_cast<size_t>(std::ceil(p / 100.0f * static_cast<float>(sorted.size())));
+		return sorted[std::clamp(rank, size_t{ 1 }, sorted.size()) - 1];
+	}
+
+	void writeTimings(std::ofstream& out, const char* name, std::vector<float> samples)
+	{
+		std::sort(samples.begin(), samples.end());
+		float mean = 0.0f;
+		for (const float sample : samples)
+		{
+			mean += sample;
+		}
+		mean = samples.empty() ? 0.0f : mean / static_cast<float>(samples.size());
+
+		out << "\t\"" << name << "\": { ";
+		out << "\"p50\": " << percentile(samples, 50.0f) << ", ";
+		out << "\"p95\": " << percentile(samples, 95.0f) << ", ";
+		out << "\"p99\": " << percentile(samples, 99.0f) << ", ";
+		out << "\"mean\": " << mean << ", ";
+		out << "\"max\": " << (samples.empty() ? 0.0f : samples.back()) << " },\n";
+	}
+}
+
+bool BenchmarkRunner::Init(const BenchmarkSettings& settings, Device* device, Renderer* renderer, Scene* scene)
+{
+	ZoneScoped;
+
+	m_settings = settings;
+	m_device = device;
+	m_renderer = renderer;
+	m_scene = scene;
+
+	// Work has to be the same every run, the resolution would otherwise follow the GPU time
+	m_renderer->SetDynamicResolution(false);
+
+	bool ready = false;
+	if (settings.scenario == "sponza")
+	{
+		m_count = 1U;
+		ready = setupSponza();
+	}
+	else if (settings.scenario == "helmets")
+	{
+		m_count = settings.count > 0U ? settings.count : DEFAULT_HELMETS;
+		ready = setupHelmets(m_count);
+	}
+	else if (settings.scenario == "lights")
+	{
+		m_count = std::min(settings.count > 0U ? settings.count : DEFAULT_LIGHTS, MAX_POINT_LIGHTS);
+		ready = setupLights(m_count);
+	}
+	else if (settings.scenario == "streaming")
+	{
+		m_count = settings.count > 0U ? settings.count : DEFAULT_STREAMED_MODELS;
+		ready = setupStreaming(m_count);
+	}
+	else
+	{
+		LOG_CORE_ALWAYS("Benchmark: unknown scenario \"" + settings.scenario + "\", expected sponza, helmets, lights or streaming");
+	}
+
+	if (!ready)
+	{
+		return false;
+	}
+
+	if (!settings.cameraPath.empty() && !m_path.LoadFromFile(settings.cameraPath))
+	{
+		LOG_CORE_ALWAYS("Benchmark: can't read camera path " + settings.cameraPath);
+		return false;
+	}
+
+	m_cpuFrameMs.reserve(settings.frames);
+	m_gpuFrameMs.reserve(settings.frames);
+	m_drawCalls.reserve(settings.frames);
+	return true;
+}
+
+void BenchmarkRunner::addSun()
+{
+	std::shared_ptr<Entity> sun = m_scene->CreateEntity();
+	LightComponent* sunlight = &sun->AddComponent<LightComponent>();
+	sunlight->lightType = LightComponent::LightType::Directional;
+	sunlight->direction = { -0.15f, 0.1f, 0.4f };
+	sunlight->diffuse = { 1.0f, 1.0f, 1.0f };
+	sunlight->ambient = { 0.7f, 0.7f, 0.7f };
+}
+
+bool BenchmarkRunner::setupSponza()
+{
+	const std::optional<std::vector<RenderableComponent>> sponza = loadModel(m_renderer, SPONZA_PATH);
+	if (!sponza.has_value())
+	{
+		return false;
+	}
+
+	for (RenderableComponent renderable : sponza.value())
+	{
+		renderable.isStatic = true;
+		addRenderable(m_scene, renderable, glm::vec3{ 0.0f });
+	}
+	addSun();
+
+	// Down the atrium at head height, up to the gallery and back along the other side
+	m_path = CameraPath({
+		{ .position = { -11.0f, 1.8f, 0.0f }, .yaw = -90.0f, .pitch = 0.0f },
+		{ .position = { -4.0f, 2.0f, -2.5f }, .yaw = -75.0f, .pitch = 5.0f },
+		{ .position = { 4.0f, 3.5f, -2.5f }, .yaw = -100.0f, .pitch = 10.0f },
+		{ .position = { 10.0f, 6.0f, 0.0f }, .yaw = -180.0f, .pitch = -10.0f },
+		{ .position = { 4.0f, 4.5f, 2.5f }, .yaw = -260.0f, .pitch = 0.0f },
+		{ .position = { -4.0f, 2.0f, 2.5f }, .yaw = -280.0f, .pitch = 5.0f },
+		{ .position = { -11.0f, 1.8f, 0.0f }, .yaw = -270.0f, .pitch = 0.0f },
+	});
+	return true;
+}
+
+bool BenchmarkRunner::setupHelmets(uint32_t count)
+{
+	const std::optional<std::vector<RenderableComponent>> helmet = loadModel(m_renderer, HELMET_PATH);
+	if (!helmet.has_value())
+	{
+		return false;
+	}
+
+	// Every primitive of every helmet is one renderable
+	const uint32_t perHelmet = static_cast<uint32_t>(std::max<size_t>(helmet->size(), 1U));
+	count = std::min(count, (MAX_OBJECTS - 2U) / perHelmet);
+	m_count = count;
+
+	const uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(count))));
+	const float half = static_cast<float>(side) * HELMET_SPACING * 0.5f;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const glm::vec3 translation{ static_cast<float>(i % side) * HELMET_SPACING - half, 1.0f, static_cast<float>(i / side) * HELMET_SPACING - half };
+		const bool spinning = i % 8U == 0U;
+		for (RenderableComponent renderable : helmet.value())
+		{
+			renderable.isStatic = !spinning;
+			std::shared_ptr<Entity> entity = addRenderable(m_scene, renderable, translation, HELMET_ROTATION);
+			if (spinning)
+			{
+				m_spinning.push_back(entity);
+			}
+		}
+	}
+	addSun();
+
+	// Low over one corner, a climb across the diagonal looking down, then back in over the other corner
+	m_path = CameraPath({
+		{ .position = { -half, 3.0f, -half - 5.0f }, .yaw = -135.0f, .pitch = -5.0f },
+		{ .position = { -half * 0.5f, 15.0f, -half * 0.5f }, .yaw = -135.0f, .pitch = -30.0f },
+		{ .position = { 0.0f, 40.0f, 0.0f }, .yaw = -180.0f, .pitch = -60.0f },
+		{ .position = { half * 0.5f, 15.0f, half * 0.5f }, .yaw = -225.0f, .pitch = -30.0f },
+		{ .position = { half, 3.0f, half + 5.0f }, .yaw = -315.0f, .pitch = -5.0f },
+	});
+	return true;
+}
+
+bool BenchmarkRunner::setupLights(uint32_t count)
+{
+	const std::optional<std::vector<RenderableComponent>> helmet = loadModel(m_renderer, HELMET_PATH);
+	if (!helmet.has_value())
+	{
+		return false;
+	}
+
+	constexpr int GROUND_SIZE = 64;
+	RenderableComponent ground;
+	ground.meshHandle = m_renderer->UploadMesh(MeshDesc::GeneratePlane(GROUND_SIZE));
+	ground.textureHandle = 0;
+	ground.isStatic = true;
+	addRenderable(m_scene, ground, glm::vec3{ 0.0f });
+
+	for (uint32_t i = 0; i < 16U; ++i)
+	{
+		const glm::vec3 translation{ static_cast<float>(i % 4U) * 8.0f - 12.0f, 1.0f, static_cast<float>(i / 4U) * 8.0f - 12.0f };
+		for (RenderableComponent renderable : helmet.value())
+		{
+			renderable.isStatic = true;
+			addRenderable(m_scene, renderable, translation, HELMET_ROTATION);
+		}
+	}
+	addSun();
+
+	// A grid of lights just above the ground, colours cycle so overlapping lights stay distinguishable
+	const uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(count))));
+	const float spacing = static_cast<float>(GROUND_SIZE) / static_cast<float>(side + 1U);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		std::shared_ptr<Entity> entity = m_scene->CreateEntity();
+		LightComponent* light = &entity->AddComponent<LightComponent>();
+		light->lightType = LightComponent::LightType::Point;
+		light->position = { static_cast<float>(i % side + 1U) * spacing - GROUND_SIZE * 0.5f, 1.5f, static_cast<float>(i / side + 1U) * spacing - GROUND_SIZE * 0.5f };
+		light->diffuse = { (i % 3U) == 0U ? 1.0f : 0.2f, (i % 3U) == 1U ? 1.0f : 0.2f, (i % 3U) == 2U ? 1.0f : 0.2f };
+		light->ambient = { 0.0f, 0.0f, 0.0f };
+		light->linear = 0.35f;
+		light->quadratic = 0.44f;
+	}
+
+	// One circle around the field, looking in
+	std::vector<CameraPath::Keyframe> keyframes;
+	for (int i = 0; i <= 8; ++i)
+	{
+		const float angle = glm::radians(45.0f * static_cast<float>(i));
+		keyframes.push_back({ .position = { std::sin(angle) * 30.0f, 10.0f, std::cos(angle) * 30.0f }, .yaw = glm::degrees(angle), .pitch = -20.0f });
+	}
+	m_path = CameraPath(std::move(keyframes));
+	return true;
+}
+
+bool BenchmarkRunner::setupStreaming(uint32_t count)
+{
+	// Each load uploads its own copy of the textures, so nothing is shared between helmets
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const std::optional<std::vector<RenderableComponent>> helmet = loadModel(m_renderer, HELMET_PATH);
+		if (!helmet.has_value())
+		{
+			return false;
+		}
+
+		for (RenderableComponent renderable : helmet.value())
+		{
+			renderable.isStatic = true;
+			addRenderable(m_scene, renderable, glm::vec3{ static_cast<float>(i) * 6.0f, 1.0f, 0.0f }, HELMET_ROTATION);
+		}
+	}
+	addSun();
+
+	m_renderer->SetTextureMemoryBudget(STREAMING_TEXTURE_BUDGET);
+
+	// Close past every helmet, out to where they all need low mips only, then close past them again
+	const float length = static_cast<float>(count) * 6.0f;
+	m_path = CameraPath({
+		{ .position = { -4.0f, 1.0f, 3.0f }, .yaw = -90.0f, .pitch = 0.0f },
+		{ .position = { length * 0.5f, 1.0f, 3.0f }, .yaw = -90.0f, .pitch = 0.0f },
+		{ .position = { length + 4.0f, 1.0f, 3.0f }, .yaw = -90.0f, .pitch = 0.0f },
+		{ .position = { length * 0.5f, 20.0f, 80.0f }, .yaw = 0.0f, .pitch = -10.0f },
+		{ .position = { -4.0f, 1.0f, -3.0f }, .yaw = -90.0f, .pitch = 0.0f },
+		{ .position = { length + 4.0f, 1.0f, -3.0f }, .yaw = -90.0f, .pitch = 0.0f },
+	});
+	return true;
+}
+
+void BenchmarkRunner::BeginFrame()
+{
+	ZoneScoped;
+
+	const uint32_t total = m_settings.warmupFrames + m_settings.frames;
+	const float t = total > 1U ? static_cast<float>(m_frame) / static_cast<float>(total - 1U) : 0.0f;
+	m_path.Apply(t, *m_scene->m_camera);
+
+	for (const std::shared_ptr<Entity>& entity : m_spinning)
+	{
+		entity->GetComponent<TransformComponent>().rotation.y = static_cast<float>(m_frame) * 0.01f;
+	}
+
+	m_frameStart = std::chrono::steady_clock::now();
+}
+
+void BenchmarkRunner::EndFrame()
+{
+	ZoneScoped;
+
+	const std::chrono::duration<float, std::milli> cpuMs = std::chrono::steady_clock::now() - m_frameStart;
+	if (m_frame++ < m_settings.warmupFrames)
+	{
+		return;
+	}
+
+	m_cpuFrameMs.push_back(cpuMs.count());
+	m_gpuFrameMs.push_back(m_device->m_gpuProfiler.GetLastFrameMs());
+
+	const RendererFrameStats frameStats = m_renderer->GetFrameStats();
+	m_drawCalls.push_back(frameStats.drawCalls);
+	m_objects = frameStats.objects;
+
+	const MemoryStats memory = m_device->GetMemoryStats();
+	uint64_t deviceLocal = 0U;
+	for (const MemoryStats::Heap& heap : memory.heaps())
+	{
+		deviceLocal += heap.deviceLocal ? heap.usage : 0U;
+	}
+	m_peaks.deviceLocalBytes = std::max(m_peaks.deviceLocalBytes, deviceLocal);
+	for (size_t i = 0; i < m_peaks.categoryBytes.size(); ++i)
+	{
+		m_peaks.categoryBytes[i] = std::max<uint64_t>(m_peaks.categoryBytes[i], memory.categories[i].bytes);
+	}
+	m_peaks.streamedTextureBytes = std::max(m_peaks.streamedTextureBytes, m_renderer->GetTextureStreamingStats().residentBytes);
+	m_peaks.frameHeapAllocations = std::max(m_peaks.frameHeapAllocations, m_renderer->GetFrameHeapAllocations());
+}
+
+bool BenchmarkRunner::WriteReport() const
+{
+	std::ofstream out(m_settings.outFile);
+	if (!out)
+	{
+		LOG_CORE_ALWAYS("Benchmark: can't write " + m_settings.outFile);
+		return false;
+	}
+
+	const VkExtent2D extent = m_device->GetBackBufferExtent();
+	uint64_t drawCallSum = 0U;
+	for (const uint32_t drawCalls : m_drawCalls)
+	{
+		drawCallSum += drawCalls;
+	}
+
+	out << "{\n";
+	out << "\t\"scenario\": \"" << m_settings.scenario << "\",\n";
+	out << "\t\"count\": " << m_count << ",\n";
+	out << "\t\"frames\": " << m_settings.frames << ",\n";
+	out << "\t\"warmup_frames\": " << m_settings.warmupFrames << ",\n";
+	out << "\t\"device\": \"" << m_device->GetDeviceName() << "\",\n";
+	out << "\t\"headless\": " << (m_device->m_window->IsHeadless() ? "true" : "false") << ",\n";
+	out << "\t\"resolution\": [" << extent.width << ", " << extent.height << "],\n";
+	out << "\t\"render_path\": \"" << (m_renderer->GetRenderPath() == RenderPath::FORWARD ? "forward" : "visibility_buffer") << "\",\n";
+	writeTimings(out, "cpu_frame_ms", m_cpuFrameMs);
+	writeTimings(out, "gpu_frame_ms", m_gpuFrameMs);
+	out << "\t\"draws\": { ";
+	out << "\"objects\": " << m_objects << ", ";
+	out << "\"draw_calls_mean\": " << (m_drawCalls.empty() ? 0.0 : static_cast<double>(drawCallSum) / static_cast<double>(m_drawCalls.size())) << ", ";
+	out << "\"draw_calls_max\": " << (m_drawCalls.empty() ? 0U : *std::max_element(m_drawCalls.begin(), m_drawCalls.end())) << " },\n";
+	out << "\t\"memory_peaks\": {\n";
+	out << "\t\t\"device_local_bytes\": " << m_peaks.deviceLocalBytes << ",\n";
+	out << "\t\t\"streamed_texture_bytes\": " << m_peaks.streamedTextureBytes << ",\n";
+	out << "\t\t\"frame_heap_allocations\": " << m_peaks.frameHeapAllocations << ",\n";
+	out << "\t\t\"categories\": {";
+	for (size_t i = 0; i < m_peaks.categoryBytes.size(); ++i)
+	{
+		out << (i == 0 ? " " : ", ") << "\"" << MEMORY_CATEGORY_NAMES[i] << "\": " << m_peaks.categoryBytes[i];
+	}
+	out << " }\n";
+	out << "\t}\n";
+	out << "}\n";
+	return true;
+}
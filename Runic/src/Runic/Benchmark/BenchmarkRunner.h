@@ -0,0 +1,92 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Runic/Graphics/ResourceManager.h"
+#include "Runic/Scene/CameraPath.h"
+
+namespace Runic
+{
+	class Device;
+	class Entity;
+	class Renderer;
+	class Scene;
+
+	/*
+	sponza:		The Sponza atrium, flown through end to end
+	helmets:	count DamagedHelmets sharing one mesh and material, drawn instanced, every eighth one spinning
+	lights:		count point lights over a ground plane and a few helmets
+	streaming:	count separately loaded helmets, each with its own textures, under a small texture budget so mips
+				stream in and out as the camera passes
+	*/
+	struct BenchmarkSettings
+	{
+		std::string scenario;
+		uint32_t frames{ 1000U };
+		uint32_t warmupFrames{ 60U };		// Rendered before anything is recorded, lets streaming and caches settle
+		uint32_t count{ 0U };				// Scenario specific, 0 picks its default
+		std::string cameraPath;				// Replaces the scenario's own path
+		std::string outFile{ "benchmark.json" };
+	};
+
+	/*
+	*
+	* BenchmarkRunner: Builds a named scenario into the scene, flies its camera path over a fixed number of frames
+	*				   and writes frame time percentiles, draw counts and memory peaks as JSON.
+	*
+	*/
+	class BenchmarkRunner
+	{
+	public:
+		/*
+		Fails for an unknown scenario or missing assets, the reason is logged in release builds too
+		*/
+		bool Init(const BenchmarkSettings& settings, Device* device, Renderer* renderer, Scene* scene);
+
+		bool IsFinished() const { return m_frame >= m_settings.warmupFrames + m_settings.frames; }
+
+		/*
+		Bracket Renderer::Draw, the camera and animated objects only depend on the frame index
+		*/
+		void BeginFrame();
+		void EndFrame();
+
+		bool WriteReport() const;
+	private:
+		struct Peaks
+		{
+			uint64_t deviceLocalBytes{ 0U };
+			std::array<uint64_t, static_cast<size_t>(MemoryCategory::COUNT)> categoryBytes{};
+			uint64_t streamedTextureBytes{ 0U };
+			uint64_t frameHeapAllocations{ 0U };
+		};
+
+		bool setupSponza();
+		bool setupHelmets(uint32_t count);
+		bool setupLights(uint32_t count);
+		bool setupStreaming(uint32_t count);
+		void addSun();
+
+		BenchmarkSettings m_settings;
+		uint32_t m_count{ 0U };
+		Device* m_device{ nullptr };
+		Renderer* m_renderer{ nullptr };
+		Scene* m_scene{ nullptr };
+
+		CameraPath m_path;
+		std::vector<std::shared_ptr<Entity>> m_spinning;
+
+		uint32_t m_frame{ 0U };
+		std::chrono::steady_clock::time_point m_frameStart{};
+		std::vector<float> m_cpuFrameMs;
+		std::vector<float> m_gpuFrameMs;
+		std::vector<uint32_t> m_drawCalls;
+		uint32_t m_objects{ 0U };
+		Peaks m_peaks;
+	};
+}
@@ -8,37 +8,143 @@
 #include "Runic/Graphics/ModelLoader.h"
 #include "Runic/Scene/Components/TransformComponent.h"
 
+#include <string_view>
+
 using namespace Runic;
 
-void Engine::Init() {
+EngineProps EngineProps::FromCommandLine(int argc, char** argv)
+{
+	// Runs before Engine::Init, which leaves an existing logger as it is
+	Log::Init();
+
+	EngineProps props;
+	BenchmarkSettings benchmark;
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string_view arg = argv[i];
+		const auto value = [&](std::string_view flag) -> std::optional<std::string> {
+			if (arg.substr(0, flag.size()) != flag)
+			{
+				return std::nullopt;
+			}
+			return std::string(arg.substr(flag.size()));
+		};
+
+		if (arg == "--headless")
+		{
+			props.window.headless = true;
+		}
+		else if (const std::optional<std::string> scenario = value("--benchmark="))
+		{
+			benchmark.scenario = scenario.value();
+			props.benchmark = benchmark;
+		}
+		else if (const std::optional<std::string> frames = value("--frames="))
+		{
+			benchmark.frames = static_cast<uint32_t>(std::stoul(frames.value()));
+		}
+		else if (const std::optional<std::string> warmup = value("--warmup="))
+		{
+			benchmark.warmupFrames = static_cast<uint32_t>(std::stoul(warmup.value()));
+		}
+		else if (const std::optional<std::string> count = value("--count="))
+		{
+			benchmark.count = static_cast<uint32_t>(std::stoul(count.value()));
+		}
+		else if (const std::optional<std::string> path = value("--camera-path="))
+		{
+			benchmark.cameraPath = path.value();
+		}
+		else if (const std::optional<std::string> out = value("--out="))
+		{
+			benchmark.outFile = out.value();
+		}
+		else if (const std::optional<std::string> width = value("--width="))
+		{
+			props.window.width = static_cast<uint32_t>(std::stoul(width.value()));
+		}
+		else if (const std::optional<std::string> height = value("--height="))
+		{
+			props.window.height = static_cast<uint32_t>(std::stoul(height.value()));
+		}
+		else if (const std::optional<std::string> scene = value("--scene="))
+		{
+			props.scene = scene.value();
+		}
+		else
+		{
+			LOG_CORE_ALWAYS("Ignoring unknown argument " + std::string(arg));
+		}
+	}
+
+	// Options may come before or after --benchmark
+	if (props.benchmark.has_value())
+	{
+		props.benchmark = benchmark;
+	}
+	return props;
+}
+
+void Engine::Init(const EngineProps& props) {
 	ZoneScoped;
 
 	Log::Init();
-	m_window.Init(WindowProps{ .title = "Runic Engine",.width = 1920U, .height = 1080U });
+	m_window.Init(props.window);
 	m_device.Init(&m_window);
 	m_rend.Init(&m_device);
+	m_assetManager.Init(&m_rend, &m_scene);
 
-	setupScene();
-}
+	m_scene.m_camera = std::make_unique<Camera>();
+	m_scene.m_camera->m_aspect = static_cast<float>(props.window.width) / static_cast<float>(props.window.height);
 
-void Engine::setupScene() {
-	ModelLoader loader(&m_rend);
+	m_benchmarkSettings = props.benchmark;
+	if (m_benchmarkSettings.has_value())
+	{
+		m_benchmarkReady = m_benchmark.Init(m_benchmarkSettings.value(), &m_device, &m_rend, &m_scene);
+		loadSkybox();
+		m_rend.GiveRenderables(m_scene.m_entities);
+		return;
+	}
 
-	if (std::optional<std::vector<RenderableComponent>> sponzaObject = loader.LoadModelFromGLTF("../../assets/models/DamagedHelmet/DamagedHelmet.gltf"); sponzaObject.has_value())
+	if (props.scene.empty() || !loadScene(props.scene))
 	{
-		for (const auto& rendObj : sponzaObject.value())
-		{
-			m_obj = m_scene.CreateEntity();
-			RenderableComponent* sponzaValue = &m_obj->AddComponent<RenderableComponent>();
-			*sponzaValue = rendObj;
+		setupScene();
+	}
+}
 
-			TransformComponent* transform = &m_obj->AddComponent<TransformComponent>();
-			transform->translation = { 5.0f, 2.0f, 0.0f };
-			transform->rotation = {1.25f, -0.5f,0.0f};
-			transform->scale = { 2.0f,2.0f,2.0f };
+bool Engine::loadScene(const std::string& filename)
+{
+	ModelLoader loader(&m_rend);
+	std::vector<std::vector<RenderableComponent>> sourceModels;
+	const bool loaded = m_sceneSerializer.Load(m_scene, filename, [&](const std::string& source) {
+		std::optional<std::vector<RenderableComponent>> model = loader.LoadModel(source);
+		if (!model.has_value())
+		{
+			return false;
 		}
+		sourceModels.push_back(std::move(model.value()));
+		return true;
+	});
+
+	// The scene's renderables hold their own references by now, these only kept the assets alive until then
+	for (const std::vector<RenderableComponent>& model : sourceModels)
+	{
+		loader.ReleaseModel(model);
 	}
+	if (!loaded)
+	{
+		return false;
+	}
+
+	loadSkybox();
+	m_scene.m_camera->m_yaw = -90.0f;
+	m_scene.m_camera->m_pos = { 0.0f, 2.0f, 0.0f };
+	m_rend.GiveRenderables(m_scene.m_entities);
+	return true;
+}
 
+void Engine::loadSkybox()
+{
 	const char* skyboxImagePaths[6] = {
 		"../../assets/textures/skybox/skyrender0004.png",
 		"../../assets/textures/skybox/skyrender0001.png",
@@ -52,6 +158,10 @@ void Engine::setupScene() {
 	const TextureHandle skybox = m_rend.UploadTexture(skyboxImage);
 	m_rend.SetSkybox(skybox);
 	skyboxImage.destroy();
+}
+
+void Engine::setupScene() {
+	loadSkybox();
 
 	std::shared_ptr<Entity> sun = m_scene.CreateEntity();
 	LightComponent* sunlight = &sun->AddComponent<LightComponent>();
@@ -70,17 +180,34 @@ void Engine::setupScene() {
 		pointLight->ambient = { 0.7f, 0.7f, 0.7f };
 	}
 
-	m_scene.m_camera = std::make_unique<Camera>();
 	m_scene.m_camera->m_yaw = -90.0f;
 	m_scene.m_camera->m_pos = { 0.0f, 2.0f, 0.0f };
 
 	m_rend.GiveRenderables(m_scene.m_entities);
 
+	// Drawn as the placeholder until it finishes loading in the background
+	const ModelHandle helmet = m_assetManager.LoadModel("../../assets/models/DamagedHelmet/DamagedHelmet.gltf", [this](ModelHandle handle, bool loaded) {
+		if (const std::optional<AssetLoadTiming> timing = m_assetManager.GetLoadTiming(handle); loaded && timing.has_value())
+		{
+			LOG_CORE_INFO("Model loaded in " + std::to_string(timing->loadMs) + " ms, uploaded in " + std::to_string(timing->uploadMs) + " ms");
+		}
+	});
+	TransformComponent transform;
+	transform.translation = { 5.0f, 2.0f, 0.0f };
+	transform.rotation = { 1.25f, -0.5f, 0.0f };
+	transform.scale = { 2.0f, 2.0f, 2.0f };
+	m_obj = m_assetManager.Instantiate(helmet, transform);
+
 	LOG_CORE_INFO("Scene setup.");
 }
 
-void Engine::run()
+int Engine::run()
 {
+	if (m_benchmarkSettings.has_value())
+	{
+		return runBenchmark();
+	}
+
 	bool bQuit = { false };
 	SDL_Event e;
 
@@ -134,19 +261,61 @@ void Engine::run()
 				{
 					m_scene.m_camera.get()->m_yaw = m_scene.m_camera.get()->m_yaw + (speed * 10.0f);
 				}
+				if (e.key.keysym.sym == SDLK_F5)
+				{
+					// The text copy is for diffing, only the binary file can be loaded
+					m_sceneSerializer.Save(m_scene, "scene.rscene");
+					m_sceneSerializer.ExportText(m_scene, "scene.txt");
+				}
+				if (e.key.keysym.sym == SDLK_k)
+				{
+					m_recordedPath.AddKeyframe(*m_scene.m_camera);
+					m_recordedPath.SaveToFile("camera_path.txt");
+					LOG_CORE_INFO("Camera keyframe recorded to camera_path.txt");
+				}
 			}
 		}
+		m_assetManager.Update();
 		if (m_obj.get() && m_obj->HasComponent<TransformComponent>())
 		{
 			m_obj->GetComponent<TransformComponent>().rotation = m_obj->GetComponent<TransformComponent>().rotation + glm::vec3{0.0f, 0.001f, 0.0f};
 		}
 		m_rend.Draw(m_scene.m_camera.get());
 	}
+	return 0;
+}
+
+int Engine::runBenchmark()
+{
+	if (!m_benchmarkReady)
+	{
+		return 1;
+	}
+
+	SDL_Event e;
+	while (!m_benchmark.IsFinished())
+	{
+		// Closing the window abandons the run, there is no report for a partial flight
+		while (!m_window.IsHeadless() && SDL_PollEvent(&e) != 0)
+		{
+			if (e.type == SDL_QUIT)
+			{
+				return 1;
+			}
+		}
+
+		m_benchmark.BeginFrame();
+		m_rend.Draw(m_scene.m_camera.get());
+		m_benchmark.EndFrame();
+	}
+
+	return m_benchmark.WriteReport() ? 0 : 1;
 }
 
 void Engine::Deinit()
 {
 	ZoneScoped;
+	m_assetManager.Deinit();
 	m_rend.Deinit();
 	m_window.Deinit();
 }
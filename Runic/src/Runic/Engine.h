@@ -4,26 +4,59 @@
 #include "Graphics/Renderer.h"
 
 #include "Runic/Window.h"
+#include "Runic/Assets/AssetManager.h"
+#include "Runic/Benchmark/BenchmarkRunner.h"
+#include "Runic/Scene/CameraPath.h"
 #include "Runic/Scene/Scene.h"
+#include "Runic/Scene/SceneSerializer.h"
 #include "Runic/Graphics/Device.h"
 
+#include <optional>
+#include <string>
+
 namespace Runic
 {
+	struct EngineProps
+	{
+		WindowProps window;
+		std::optional<BenchmarkSettings> benchmark;		// Runs the scenario instead of the interactive scene
+		std::string scene;									// Scene file loaded instead of the built in scene
+
+		/*
+		--benchmark=<scenario> [--frames=N] [--warmup=N] [--count=N] [--camera-path=file] [--out=file.json]
+		[--headless] [--width=N] [--height=N] [--scene=file]
+		*/
+		static EngineProps FromCommandLine(int argc, char** argv);
+	};
+
 	class Engine
 	{
 	public:
-		void Init();
-		void run();
+		void Init(const EngineProps& props = {});
+		/*
+		Returns the process exit code, non zero when a benchmark couldn't run
+		*/
+		int run();
 		void Deinit();
 	private:
 		void setupScene();
+		bool loadScene(const std::string& filename);
+		void loadSkybox();
+		int runBenchmark();
 
 		Window m_window;
 		Device m_device;
 		Renderer m_rend;
 		Scene m_scene;
+		AssetManager m_assetManager;
 
 		std::shared_ptr<Entity> m_obj;
+
+		std::optional<BenchmarkSettings> m_benchmarkSettings;
+		BenchmarkRunner m_benchmark;
+		bool m_benchmarkReady{ false };
+		CameraPath m_recordedPath;		// K adds the camera as a keyframe, for benchmark paths
+		SceneSerializer m_sceneSerializer{ &m_rend.GetAssets() };		// F5 saves the scene
 	};
 }
 
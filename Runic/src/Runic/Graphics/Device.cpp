@@ -16,6 +16,8 @@
 #include "Runic/Graphics/Internal/VulkanInit.h"
 #include "Runic/Log.h"
 
+#include <algorithm>
+
 #define VK_CHECK(x)                                                 \
 	do                                                              \
 	{                                                               \
@@ -39,8 +41,13 @@ void Device::Init(Window* window)
 	initComputeCommands();
 
 	initSyncStructures();
+	m_retireQueue.Init(m_device, m_allocator, m_resourceManager.get());
+
+	// Tracy calibrates its GPU context with a few submits, the frame command buffers can be reset between them
+	m_gpuProfiler.Init(m_chosenGPU, m_device, m_graphics.queue, m_graphics.commands[0].buffer, m_graphics.queueFamily, MAX_FRAMES_IN_FLIGHT, m_pipelineStatisticsSupported);
 
 	VkSamplerCreateInfo samplerInfo = VulkanInit::samplerCreateInfo(VK_FILTER_NEAREST);
+	samplerInfo.maxLod = VK_LOD_CLAMP_NONE;  // Streamed textures only hold their resident mips, so allow all of them
 	vkCreateSampler(m_device, &samplerInfo, nullptr, &m_defaultSampler);
 	m_instanceDeletionQueue.push_function([=] {
 		vkDestroySampler(m_device, m_defaultSampler, nullptr);
@@ -49,31 +56,44 @@ void Device::Init(Window* window)
 	initImguiRenderpass();
 	initImgui();
 
-	m_pipelineManager = std::make_unique<PipelineManager>(m_device);
+	TracyPlotConfig("GPU memory usage", tracy::PlotFormatType::Memory);
+	TracyPlotConfig("GPU memory budget", tracy::PlotFormatType::Memory);
+	for (const char* category : MEMORY_CATEGORY_NAMES)
+	{
+		TracyPlotConfig(category, tracy::PlotFormatType::Memory);
+	}
+
+	m_pipelineManager = std::make_unique<PipelineManager>(m_device, m_gpuProperties, &m_retireQueue);
 }
 
 void Device::Deinit()
 {
+	retireSwapchain();
+	WaitIdle();
+
 	m_pipelineManager->Deinit();
 	m_resourceManager->Deinit();
 
-	vkDeviceWaitIdle(m_device);
-
+	m_gpuProfiler.Deinit();
 	m_instanceDeletionQueue.flush();
 
-	vkDestroyFence(m_device, m_uploadContext.uploadFence, nullptr);
+	for (const TimelineSemaphore& timeline : m_timelines)
+	{
+		vkDestroySemaphore(m_device, timeline.semaphore, nullptr);
+	}
 
-	for (int i = 0; i < FRAME_OVERLAP; ++i)
+	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
 	{
 		vkDestroySemaphore(m_device, m_frame[i].presentSem, nullptr);
 		vkDestroySemaphore(m_device, m_frame[i].renderSem, nullptr);
-		vkDestroyFence(m_device, m_frame[i].renderFen, nullptr);
 	}
 
 	vkDestroyCommandPool(m_device, m_uploadContext.commandPool, nullptr);
 
-	vkDestroyCommandPool(m_device, m_graphics.commands[0].pool, nullptr);
-	vkDestroyCommandPool(m_device, m_graphics.commands[1].pool, nullptr);
+	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+	{
+		vkDestroyCommandPool(m_device, m_graphics.commands[i].pool, nullptr);
+	}
 	vkDestroyCommandPool(m_device, m_compute.commands[0].pool, nullptr);
 
 	vmaDestroyAllocator(m_allocator);
@@ -85,7 +105,16 @@ void Device::Deinit()
 
 bool Device::BeginFrame()
 {
-	VK_CHECK(vkWaitForFences(m_device, 1, &GetCurrentFrame().renderFen, true, 1000000000));
+	// Frame slots are renumbered, so nothing may still be using them
+	if (m_requestedFramesInFlight != m_framesInFlight)
+	{
+		WaitRender();
+		m_framesInFlight = m_requestedFramesInFlight;
+	}
+
+	// Only waits for the last submission that used this slot's command buffer and semaphores
+	WaitTimeline(Timeline::GRAPHICS, GetCurrentFrame().graphicsValue);
+	m_retireQueue.Collect(GetCompletedValue(Timeline::GRAPHICS));
 
 	VkResult result = vkAcquireNextImageKHR(m_device, m_swapchain.swapchain, 1000000000, GetCurrentFrame().presentSem, nullptr, &m_currentSwapchainImage);
 	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || m_dirtySwapchain)
@@ -99,32 +128,41 @@ bool Device::BeginFrame()
 		throw std::runtime_error("failed to acquire swap chain image!");
 	}
 
-	VK_CHECK(vkResetFences(m_device, 1, &GetCurrentFrame().renderFen));
 	VK_CHECK(vkResetCommandBuffer(m_graphics.commands[GetCurrentFrameNumber()].buffer, 0));
 
+	// Lets VMA's budget and lost allocation tracking know a frame has passed
+	vmaSetCurrentFrameIndex(m_allocator, static_cast<uint32_t>(m_frameNumber));
+	const MemoryStats memoryStats = m_resourceManager->GetMemoryStats();
+	plotMemoryStats(memoryStats);
+
 	ImGui_ImplVulkan_NewFrame();
-	ImGui_ImplSDL2_NewFrame();
+	if (m_window->IsHeadless())
+	{
+		// What the SDL backend would fill in, there are no input events to read
+		ImGui::GetIO().DisplaySize = ImVec2(static_cast<float>(m_swapchainExtent.width), static_cast<float>(m_swapchainExtent.height));
+	}
+	else
+	{
+		ImGui_ImplSDL2_NewFrame();
+	}
 	ImGui::NewFrame();
 	ImGui::ShowDemoWindow();
-	ImGui::Render();
+	drawMemoryPanel(memoryStats);
+	drawGpuProfilerPanel();
 	return true;
 }
 
-void Device::AddImGuiToCommandBuffer()
+void Device::AddImGuiToCommandBuffer(VkCommandBuffer cmd)
 {
-	const VkCommandBuffer cmd = m_graphics.commands[GetCurrentFrameNumber()].buffer;
-
-	const VkClearValue clearValue{
-		.color = { 0.1f, 0.1f, 0.1f, 1.0f }
-	};
 	const VkExtent2D windowExtent{
 		.width = m_window->GetWidth(),
 		.height = m_window->GetHeight(),
 	};
 	VkRenderPassBeginInfo rpInfo = VulkanInit::renderpassBeginInfo(m_imguiPass, windowExtent, m_swapchain.framebuffers[m_currentSwapchainImage]);
-	const VkClearValue clearValues[] = { clearValue };
-	rpInfo.clearValueCount = 1;
-	rpInfo.pClearValues = &clearValues[0];
+	rpInfo.clearValueCount = 0;
+
+	// Windows can be added until now, the frame is only finalised when it is recorded
+	ImGui::Render();
 
 	vkCmdBeginRenderPass(cmd, &rpInfo, VK_SUBPASS_CONTENTS_INLINE);
 	ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), cmd);
@@ -157,14 +195,106 @@ void Device::Present()
 void Device::WaitIdle()
 {
 	vkDeviceWaitIdle(m_device);
+	m_retireQueue.Flush();
 }
 
 void Device::WaitRender()
 {
-	for (int i = 0; i < FRAME_OVERLAP; ++i)
+	WaitTimeline(Timeline::GRAPHICS, GetSubmittedValue(Timeline::GRAPHICS));
+}
+
+uint64_t Device::SubmitFrame(VkCommandBuffer cmd)
+{
+	TimelineSemaphore& graphics = m_timelines[static_cast<size_t>(Timeline::GRAPHICS)];
+	GetCurrentFrame().graphicsValue = ++graphics.value;
+	m_retireQueue.SetRetireValue(graphics.value + 1U);
+
+	const VkSemaphoreSubmitInfo waitInfo{
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+		.semaphore = GetCurrentFrame().presentSem,
+		.stageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+	};
+	const VkSemaphoreSubmitInfo signalInfos[] = {
+		{
+			.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+			.semaphore = GetCurrentFrame().renderSem,
+			.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+		},
+		{
+			.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+			.semaphore = graphics.semaphore,
+			.value = graphics.value,
+			.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+		},
+	};
+	const VkCommandBufferSubmitInfo cmdInfo{
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
+		.commandBuffer = cmd,
+	};
+	const VkSubmitInfo2 submit{
+		.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
+		.waitSemaphoreInfoCount = 1,
+		.pWaitSemaphoreInfos = &waitInfo,
+		.commandBufferInfoCount = 1,
+		.pCommandBufferInfos = &cmdInfo,
+		.signalSemaphoreInfoCount = static_cast<uint32_t>(std::size(signalInfos)),
+		.pSignalSemaphoreInfos = signalInfos,
+	};
+	VK_CHECK(vkQueueSubmit2(m_graphics.queue, 1, &submit, VK_NULL_HANDLE));
+
+	return graphics.value;
+}
+
+uint64_t Device::SubmitCompute(VkCommandBuffer cmd)
+{
+	TimelineSemaphore& compute = m_timelines[static_cast<size_t>(Timeline::COMPUTE)];
+	++compute.value;
+
+	const VkSemaphoreSubmitInfo signalInfo{
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+		.semaphore = compute.semaphore,
+		.value = compute.value,
+		.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+	};
+	const VkCommandBufferSubmitInfo cmdInfo{
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
+		.commandBuffer = cmd,
+	};
+	const VkSubmitInfo2 submit{
+		.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
+		.commandBufferInfoCount = 1,
+		.pCommandBufferInfos = &cmdInfo,
+		.signalSemaphoreInfoCount = 1,
+		.pSignalSemaphoreInfos = &signalInfo,
+	};
+	VK_CHECK(vkQueueSubmit2(m_compute.queue, 1, &submit, VK_NULL_HANDLE));
+
+	return compute.value;
+}
+
+void Device::WaitTimeline(Timeline timeline, uint64_t value)
+{
+	ZoneScoped;
+
+	if (value == 0U)
 	{
-		vkWaitForFences(m_device, 1, &m_frame[i].renderFen, true, 1000000000);
+		return;
 	}
+
+	const VkSemaphoreWaitInfo waitInfo{
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+		.semaphoreCount = 1,
+		.pSemaphores = &m_timelines[static_cast<size_t>(timeline)].semaphore,
+		.pValues = &value,
+	};
+	VK_CHECK(vkWaitSemaphores(m_device, &waitInfo, UINT64_MAX));
+}
+
+uint64_t Device::GetCompletedValue(Timeline timeline) const
+{
+	uint64_t value = 0U;
+	vkGetSemaphoreCounterValue(m_device, m_timelines[static_cast<size_t>(timeline)].semaphore, &value);
+	return value;
 }
 
 BufferHandle Device::CreateBuffer(const BufferCreateInfo& createInfo)
@@ -197,6 +327,15 @@ std::size_t Device::GetBufferSize(const BufferHandle buffer)
 	return m_resourceManager->GetBuffer(buffer).size;
 }
 
+VkDeviceAddress Device::GetBufferAddress(const BufferHandle buffer)
+{
+	const VkBufferDeviceAddressInfo addressInfo{
+		.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO,
+		.buffer = m_resourceManager->GetBuffer(buffer).buffer,
+	};
+	return vkGetBufferDeviceAddress(m_device, &addressInfo);
+}
+
 VkImage Device::GetImage(const ImageHandle image)
 {
 	return m_resourceManager->GetImage(image).image;
@@ -213,10 +352,119 @@ ImageHandle Device::GetRenderTargetImage(const RenderTargetHandle rendTargetHand
 }
 
 void Device::DestroyBuffer(const BufferHandle buffer)
+{
+	if (buffer.handle != 0U)
+	{
+		m_retireQueue.RetireBuffer(buffer);
+	}
+}
+
+void Device::DestroyImage(const ImageHandle image)
+{
+	if (image.handle != 0U)
+	{
+		m_retireQueue.RetireImage(image);
+	}
+}
+
+void Device::DestroyStagingBuffer(const BufferHandle buffer)
 {
 	m_resourceManager->DestroyBuffer(buffer);
 }
 
+Device::MemoryBudget Device::GetDeviceLocalBudget()
+{
+	MemoryBudget total{ .usage = 0U, .budget = 0U };
+	for (const MemoryStats::Heap& heap : m_resourceManager->GetMemoryStats().heaps())
+	{
+		if (heap.deviceLocal)
+		{
+			total.usage += heap.usage;
+			total.budget += heap.budget;
+		}
+	}
+	return total;
+}
+
+MemoryStats Device::GetMemoryStats()
+{
+	return m_resourceManager->GetMemoryStats();
+}
+
+void Device::BeginDefragmentation()
+{
+	m_resourceManager->BeginDefragmentation(DEFRAG_MAX_BYTES_PER_PASS, DEFRAG_MAX_ALLOCATIONS_PER_PASS);
+}
+
+std::pmr::vector<ImageHandle> Device::Defragment(VkCommandBuffer cmd, uint32_t maxImageMoves, std::pmr::memory_resource* frameMemory)
+{
+	// Old resources are released once the frame recording the copies has completed
+	return m_resourceManager->DefragmentStep(cmd, GetCompletedValue(Timeline::GRAPHICS), m_retireQueue.GetRetireValue(), DEFRAG_TIME_BUDGET_MS, maxImageMoves, frameMemory);
+}
+
+void Device::plotMemoryStats(const MemoryStats& stats)
+{
+	int64_t usage = 0;
+	int64_t budget = 0;
+	for (const MemoryStats::Heap& heap : stats.heaps())
+	{
+		if (heap.deviceLocal)
+		{
+			usage += static_cast<int64_t>(heap.usage);
+			budget += static_cast<int64_t>(heap.budget);
+		}
+	}
+	TracyPlot("GPU memory usage", usage);
+	TracyPlot("GPU memory budget", budget);
+
+	for (size_t i = 0; i < stats.categories.size(); ++i)
+	{
+		TracyPlot(MEMORY_CATEGORY_NAMES[i], static_cast<int64_t>(stats.categories[i].bytes));
+	}
+}
+
+void Device::drawMemoryPanel(const MemoryStats& stats)
+{
+	constexpr double MB = 1024.0 * 1024.0;
+
+	ImGui::Begin("Memory");
+
+	if (ImGui::CollapsingHeader("Heaps", ImGuiTreeNodeFlags_DefaultOpen))
+	{
+		for (size_t i = 0; i < stats.heapCount; ++i)
+		{
+			const MemoryStats::Heap& heap = stats.heapArray[i];
+			ImGui::Text("Heap %zu (%s)", i, heap.deviceLocal ? "device local" : "host");
+			ImGui::ProgressBar(heap.budget > 0U ? static_cast<float>(heap.usage) / static_cast<float>(heap.budget) : 0.0f);
+			ImGui::Text("Usage %.1f / %.1f MB", heap.usage / MB, heap.budget / MB);
+
+			// Space reserved in blocks but not holding allocations
+			const double fragmentation = heap.blockBytes > 0U ? 1.0 - static_cast<double>(heap.allocationBytes) / static_cast<double>(heap.blockBytes) : 0.0;
+			ImGui::Text("%u allocations in %u blocks, %.1f / %.1f MB, %.1f%% unused", heap.allocationCount, heap.blockCount,
+				heap.allocationBytes / MB, heap.blockBytes / MB, fragmentation * 100.0);
+		}
+	}
+
+	if (ImGui::CollapsingHeader("Categories", ImGuiTreeNodeFlags_DefaultOpen))
+	{
+		for (size_t i = 0; i < stats.categories.size(); ++i)
+		{
+			ImGui::Text("%-16s %6u  %10.1f MB", MEMORY_CATEGORY_NAMES[i], stats.categories[i].count, stats.categories[i].bytes / MB);
+		}
+	}
+
+	if (stats.defragmenting)
+	{
+		ImGui::Text("Defragmenting: %u moved, %.1f MB", stats.defragmentedAllocations, stats.defragmentedBytes / MB);
+	}
+	else if (ImGui::Button("Defragment"))
+	{
+		BeginDefragmentation();
+	}
+
+	ImGui::End();
+}
+
 void Device::ImmediateSubmit(std::function<void(VkCommandBuffer cmd)>&& function)
 {
 	VkCommandBuffer cmd = m_uploadContext.commandBuffer;
@@ -229,12 +477,30 @@ void Device::ImmediateSubmit(std::function<void(VkCommandBuffer cmd)>&& function
 
 	vkEndCommandBuffer(cmd);
 
-	VkSubmitInfo submit = VulkanInit::submitInfo(&cmd);
+	TimelineSemaphore& upload = m_timelines[static_cast<size_t>(Timeline::UPLOAD)];
+	++upload.value;
 
-	vkQueueSubmit(m_graphics.queue, 1, &submit, m_uploadContext.uploadFence);
+	const VkSemaphoreSubmitInfo signalInfo{
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+		.semaphore = upload.semaphore,
+		.value = upload.value,
+		.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+	};
+	const VkCommandBufferSubmitInfo cmdInfo{
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
+		.commandBuffer = cmd,
+	};
+	const VkSubmitInfo2 submit{
+		.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
+		.commandBufferInfoCount = 1,
+		.pCommandBufferInfos = &cmdInfo,
+		.signalSemaphoreInfoCount = 1,
+		.pSignalSemaphoreInfos = &signalInfo,
+	};
+	vkQueueSubmit2(m_graphics.queue, 1, &submit, VK_NULL_HANDLE);
 
-	vkWaitForFences(m_device, 1, &m_uploadContext.uploadFence, true, 9999999999);
-	vkResetFences(m_device, 1, &m_uploadContext.uploadFence);
+	// Only this upload, not the frames in flight on the same queue
+	WaitTimeline(Timeline::UPLOAD, upload.value);
 
 	vkResetCommandPool(m_device, m_uploadContext.commandPool, 0);
 }
@@ -243,32 +509,86 @@ void Device::initVulkan()
 {
 	ZoneScoped;
 	vkb::InstanceBuilder builder;
-
-	const auto inst_ret = builder.set_app_name("Runic Engine")
+	builder.set_app_name("Runic Engine")
 		.request_validation_layers(true)
 		.require_api_version(1, 3, 0)
 		.enable_extension("VK_EXT_debug_utils")
-		.use_default_debug_messenger()
-		.build();
+		.use_default_debug_messenger();
+
+	// No window system, the swapchain images are presented to nothing (lavapipe and other CI drivers support this)
+	if (m_window->IsHeadless())
+	{
+		builder.set_headless()
+			.enable_extension(VK_KHR_SURFACE_EXTENSION_NAME)
+			.enable_extension(VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME);
+	}
 
-	const vkb::Instance vkb_inst = inst_ret.value();
+	const vkb::Instance vkb_inst = builder.build().value();
 
 	m_instance = vkb_inst.instance;
 	m_debugMessenger = vkb_inst.debug_messenger;
 
-	SDL_Vulkan_CreateSurface(reinterpret_cast<SDL_Window*>(m_window->GetWindowPointer()), m_instance, &m_surface);
+	if (m_window->IsHeadless())
+	{
+		const auto createHeadlessSurface = reinterpret_cast<PFN_vkCreateHeadlessSurfaceEXT>(vkGetInstanceProcAddr(m_instance, "vkCreateHeadlessSurfaceEXT"));
+		const VkHeadlessSurfaceCreateInfoEXT surfaceInfo{ .sType = VK_STRUCTURE_TYPE_HEADLESS_SURFACE_CREATE_INFO_EXT };
+		VK_CHECK(createHeadlessSurface(m_instance, &surfaceInfo, nullptr, &m_surface));
+	}
+	else
+	{
+		SDL_Vulkan_CreateSurface(reinterpret_cast<SDL_Window*>(m_window->GetWindowPointer()), m_instance, &m_surface);
+	}
 
 	vkb::PhysicalDeviceSelector selector{ vkb_inst };
-	const vkb::PhysicalDevice physicalDevice = selector
+	vkb::PhysicalDevice physicalDevice = selector
 		.set_minimum_version(1, 2)
 		.set_surface(m_surface)
+		.require_present()
+		.add_desired_extension(VK_EXT_INDEX_TYPE_UINT8_EXTENSION_NAME)
 		.select()
 		.value();
 
+	// Optional, only used by the GPU profiler when pipeline statistics are turned on
+	VkPhysicalDeviceFeatures supportedFeatures;
+	vkGetPhysicalDeviceFeatures(physicalDevice.physical_device, &supportedFeatures);
+	m_pipelineStatisticsSupported = supportedFeatures.pipelineStatisticsQuery == VK_TRUE;
+	physicalDevice.features.pipelineStatisticsQuery = supportedFeatures.pipelineStatisticsQuery;
+
+	// Optional, gl_PrimitiveID in fragment shaders needs the geometry shader capability
+	m_fragmentPrimitiveIdSupported = supportedFeatures.geometryShader == VK_TRUE;
+	physicalDevice.features.geometryShader = supportedFeatures.geometryShader;
+
+	// Optional, meshes with at most 256 vertices use 8 bit indices when the extension is there
+	VkPhysicalDeviceIndexTypeUint8FeaturesEXT indexTypeUint8Features{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_INDEX_TYPE_UINT8_FEATURES_EXT };
+	const std::vector<std::string> extensions = physicalDevice.get_extensions();
+	if (std::find(extensions.begin(), extensions.end(), VK_EXT_INDEX_TYPE_UINT8_EXTENSION_NAME) != extensions.end())
+	{
+		VkPhysicalDeviceFeatures2 supportedFeatures2{
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+			.pNext = &indexTypeUint8Features,
+		};
+		vkGetPhysicalDeviceFeatures2(physicalDevice.physical_device, &supportedFeatures2);
+		m_indexTypeUint8Supported = indexTypeUint8Features.indexTypeUint8 == VK_TRUE;
+	}
+
 	vkb::DeviceBuilder m_deviceBuilder{ physicalDevice };
 
+	// Lets shaders read mesh buffers without a descriptor per mesh
+	VkPhysicalDeviceBufferDeviceAddressFeatures bufferAddressFeatures{
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_BUFFER_DEVICE_ADDRESS_FEATURES,
+		.pNext = m_indexTypeUint8Supported ? &indexTypeUint8Features : nullptr,
+		.bufferDeviceAddress = VK_TRUE,
+	};
+
+	VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures{
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES,
+		.pNext = &bufferAddressFeatures,
+		.timelineSemaphore = VK_TRUE,
+	};
+
 	VkPhysicalDeviceSynchronization2Features syncFeatures{
 		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES,
+		.pNext = &timelineFeatures,
 		.synchronization2 = true,
 	};
 
@@ -282,6 +602,8 @@ void Device::initVulkan()
 		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES,
 		.pNext = &dynamicRenderingFeature,
 		.shaderSampledImageArrayNonUniformIndexing = VK_TRUE,
+		.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE,
+		.descriptorBindingUpdateUnusedWhilePending = VK_TRUE,
 		.descriptorBindingPartiallyBound = VK_TRUE,
 		.descriptorBindingVariableDescriptorCount = VK_TRUE,
 		.runtimeDescriptorArray = VK_TRUE,
@@ -296,12 +618,19 @@ void Device::initVulkan()
 	m_chosenGPU = physicalDevice.physical_device;
 	m_gpuProperties = vkbDevice.physical_device.properties;
 
+	VkPhysicalDeviceProperties2 gpuProperties2{
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+		.pNext = &m_descriptorIndexingProperties,
+	};
+	vkGetPhysicalDeviceProperties2(m_chosenGPU, &gpuProperties2);
+
 	m_graphics.queue = vkbDevice.get_queue(vkb::QueueType::graphics).value();
 	m_graphics.queueFamily = vkbDevice.get_queue_index(vkb::QueueType::graphics).value();
 	m_compute.queue = vkbDevice.get_queue(vkb::QueueType::compute).value();
 	m_compute.queueFamily = vkbDevice.get_queue_index(vkb::QueueType::compute).value();
 
 	const VmaAllocatorCreateInfo m_allocatorInfo = {
+		.flags = VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT,
 		.physicalDevice = m_chosenGPU,
 		.device = m_device,
 		.instance = m_instance,
@@ -323,7 +652,7 @@ void Device::initGraphicsCommands()
 		.queueFamilyIndex = m_graphics.queueFamily
 	};
 
-	for (int i = 0; i < 2; ++i)
+	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
 	{
 		VkCommandPool* commandPool = &m_graphics.commands[i].pool;
 
@@ -387,6 +716,7 @@ void Device::createSwapchain()
 		.use_default_format_selection()
 		.set_desired_present_mode(VK_PRESENT_MODE_FIFO_KHR)
 		.set_desired_extent(windowExtent.width, windowExtent.height)
+		.set_old_swapchain(m_swapchain.swapchain)
 		.build()
 		.value();
 
@@ -394,20 +724,21 @@ void Device::createSwapchain()
 	m_swapchain.images = vkbm_swapchain.get_images().value();
 	m_swapchain.imageViews = vkbm_swapchain.get_image_views().value();
 	m_swapchain.imageFormat = vkbm_swapchain.image_format;
+	m_swapchainExtent = vkbm_swapchain.extent;
 
 	LOG_CORE_INFO("Create Swapchain");
 }
 
-void Device::destroySwapchain()
+void Device::retireSwapchain()
 {
 	for (int i = 0; i < m_swapchain.imageViews.size(); i++)
 	{
-		vkDestroyFramebuffer(m_device, m_swapchain.framebuffers[i], nullptr);
-		vkDestroyImageView(m_device, m_swapchain.imageViews[i], nullptr);
+		m_retireQueue.RetireFramebuffer(m_swapchain.framebuffers[i]);
+		m_retireQueue.RetireImageView(m_swapchain.imageViews[i]);
 	}
-	vkDestroyRenderPass(m_device, m_imguiPass, nullptr);
-	vkDestroySwapchainKHR(m_device, m_swapchain.swapchain, nullptr);
-	LOG_CORE_INFO("Destroy Swapchain");
+	m_retireQueue.RetireRenderPass(m_imguiPass);
+	m_retireQueue.RetireSwapchain(m_swapchain.swapchain);
+	LOG_CORE_INFO("Retire Swapchain");
 }
 
 void Device::recreateSwapchain()
@@ -415,7 +746,7 @@ void Device::recreateSwapchain()
 	ZoneScoped;
 
 	SDL_Event e;
-	int flags = SDL_GetWindowFlags(reinterpret_cast<SDL_Window*>(m_window->GetWindowPointer()));
+	int flags = m_window->IsHeadless() ? 0 : SDL_GetWindowFlags(reinterpret_cast<SDL_Window*>(m_window->GetWindowPointer()));
 	bool minimized = (flags & SDL_WINDOW_MINIMIZED) ? true : false;
 	while (minimized)
 	{
@@ -424,9 +755,8 @@ void Device::recreateSwapchain()
 		SDL_WaitEvent(&e);
 	}
 
-	vkDeviceWaitIdle(m_device);
-
-	destroySwapchain();
+	// The old swapchain stays valid until the frames using it complete, the new one is built from it
+	retireSwapchain();
 	createSwapchain();
 	recreateRenderTargetImages();
 
@@ -437,15 +767,9 @@ void Device::initSyncStructures()
 {
 	ZoneScoped;
 
-	for (int i = 0; i < FRAME_OVERLAP; ++i)
+	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
 	{
-		const VkFenceCreateInfo fenceCreateInfo = {
-			.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
-			.pNext = nullptr,
-			.flags = VK_FENCE_CREATE_SIGNALED_BIT
-		};
-
-		vkCreateFence(m_device, &fenceCreateInfo, nullptr, &m_frame[i].renderFen);
+		m_frame[i].graphicsValue = 0U;
 
 		const VkSemaphoreCreateInfo semaphoreCreateInfo = {
 			.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
@@ -457,21 +781,34 @@ void Device::initSyncStructures()
 		vkCreateSemaphore(m_device, &semaphoreCreateInfo, nullptr, &m_frame[i].renderSem);
 	}
 
-	const VkFenceCreateInfo uploadFenceCreateInfo = VulkanInit::fenceCreateInfo();
-	vkCreateFence(m_device, &uploadFenceCreateInfo, nullptr, &m_uploadContext.uploadFence);
+	const VkSemaphoreTypeCreateInfo timelineTypeInfo{
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+		.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+		.initialValue = 0,
+	};
+	const VkSemaphoreCreateInfo timelineCreateInfo{
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+		.pNext = &timelineTypeInfo,
+	};
+	for (TimelineSemaphore& timeline : m_timelines)
+	{
+		vkCreateSemaphore(m_device, &timelineCreateInfo, nullptr, &timeline.semaphore);
+		timeline.value = 0U;
+	}
 }
 
 void Device::initImguiRenderpass()
 {
+	// Drawn over the frame inside the renderer's graph, which owns the back buffer's transitions and barriers
 	const VkAttachmentDescription color_attachment = {
 		.format = m_swapchain.imageFormat,
 		.samples = VK_SAMPLE_COUNT_1_BIT,
-		.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+		.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD,
 		.storeOp = VK_ATTACHMENT_STORE_OP_STORE,
 		.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
 		.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
-		.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-		.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+		.initialLayout = VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL,
+		.finalLayout = VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL,
 	};
 
 	const VkAttachmentReference color_attachment_ref = {
@@ -485,7 +822,7 @@ void Device::initImguiRenderpass()
 		.pColorAttachments = &color_attachment_ref,
 	};
 
-	VkRenderPassCreateInfo renderPassInfo = {
+	const VkRenderPassCreateInfo renderPassInfo = {
 		.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
 		.attachmentCount = 1,
 		.pAttachments = &color_attachment,
@@ -493,20 +830,6 @@ void Device::initImguiRenderpass()
 		.pSubpasses = &subpass,
 	};
 
-	const VkSubpassDependency dependency = {
-		.srcSubpass = VK_SUBPASS_EXTERNAL,
-		.dstSubpass = 0,
-		.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-		.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-		.srcAccessMask = 0,
-		.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-	};
-
-	const VkSubpassDependency dependencies[2] = { dependency };
-
-	renderPassInfo.dependencyCount = 1;
-	renderPassInfo.pDependencies = &dependencies[0];
-
 	VK_CHECK(vkCreateRenderPass(m_device, &renderPassInfo, nullptr, &m_imguiPass));
 
 	VkFramebufferCreateInfo fb_info = {
@@ -566,7 +889,7 @@ void Device::initImgui()
 
 	ImGui::CreateContext();
 
-	// light style from Pacme Danhiez (user itamago) https://github.com/ocornut/imgui/pull/511#issuecomment-175719267
+	// light style from Pacôme Danhiez (user itamago) https://github.com/ocornut/imgui/pull/511#issuecomment-175719267
 	//ImGuiStyle& style = ImGui::GetStyle();
 	//
 	//style.Alpha = 1.0f;
@@ -633,7 +956,10 @@ void Device::initImgui()
 	//	}
 	//}
 
-	ImGui_ImplSDL2_InitForVulkan(reinterpret_cast<SDL_Window*>(m_window->GetWindowPointer()));
+	if (!m_window->IsHeadless())
+	{
+		ImGui_ImplSDL2_InitForVulkan(reinterpret_cast<SDL_Window*>(m_window->GetWindowPointer()));
+	}
 
 	//this initializes imgui for Vulkan
 	ImGui_ImplVulkan_InitInfo init_info = {
@@ -668,6 +994,70 @@ void Device::initImgui()
 		});
 }
 
+void Device::drawGpuProfilerPanel()
+{
+	ImGui::Begin("GPU Timings");
+
+	int framesInFlight = static_cast<int>(m_requestedFramesInFlight);
+	if (ImGui::SliderInt("Frames in flight", &framesInFlight, 1, static_cast<int>(MAX_FRAMES_IN_FLIGHT)))
+	{
+		SetFramesInFlight(static_cast<uint32_t>(framesInFlight));
+	}
+
+	m_gpuProfiler.GetStats(m_passStats);
+
+	if (ImGui::BeginTable("Passes", 5))
+	{
+		ImGui::TableSetupColumn("Pass");
+		ImGui::TableSetupColumn("Last ms");
+		ImGui::TableSetupColumn("Min ms");
+		ImGui::TableSetupColumn("Avg ms");
+		ImGui::TableSetupColumn("P99 ms");
+		ImGui::TableHeadersRow();
+		for (const GpuProfiler::PassStats& pass : m_passStats)
+		{
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(pass.name.c_str());
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3f", pass.lastMs);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3f", pass.minMs);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3f", pass.avgMs);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3f", pass.p99Ms);
+		}
+		ImGui::EndTable();
+	}
+
+	if (m_gpuProfiler.IsPipelineStatisticsSupported())
+	{
+		bool pipelineStatistics = m_gpuProfiler.IsPipelineStatisticsEnabled();
+		if (ImGui::Checkbox("Pipeline statistics", &pipelineStatistics))
+		{
+			m_gpuProfiler.SetPipelineStatistics(pipelineStatistics);
+		}
+
+		if (pipelineStatistics)
+		{
+			for (const GpuProfiler::PassStats& pass : m_passStats)
+			{
+				if (pass.pipelineStatistics.has_value())
+				{
+					const GpuProfiler::PipelineStatistics& statistics = pass.pipelineStatistics.value();
+					ImGui::Text("%s: %llu verts, %llu prims, %llu VS, %llu clipped, %llu FS", pass.name.c_str(),
+						static_cast<unsigned long long>(statistics.inputVertices), static_cast<unsigned long long>(statistics.inputPrimitives),
+						static_cast<unsigned long long>(statistics.vertexInvocations), static_cast<unsigned long long>(statistics.clippingPrimitives),
+						static_cast<unsigned long long>(statistics.fragmentInvocations));
+				}
+			}
+		}
+	}
+
+	ImGui::End();
+}
+
 ImageHandle Device::createRenderTargetImage(bool depth)
 {
 	const VkExtent3D imageExtent{
@@ -683,7 +1073,8 @@ ImageHandle Device::createRenderTargetImage(bool depth)
 		const ImageHandle newRT = m_resourceManager->CreateImage(ImageCreateInfo{
 			.imageInfo = imageInfo,
 			.imageType = ImageCreateInfo::ImageType::TEXTURE_2D,
-			.usage = ImageCreateInfo::Usage::COLOR
+			.usage = ImageCreateInfo::Usage::COLOR,
+			.category = MemoryCategory::RENDER_TARGET,
 			});
 
 		return newRT;
@@ -695,7 +1086,8 @@ ImageHandle Device::createRenderTargetImage(bool depth)
 		const ImageHandle newRT = m_resourceManager->CreateImage(ImageCreateInfo{
 			.imageInfo = depthImageInfo,
 			.imageType = ImageCreateInfo::ImageType::TEXTURE_2D,
-			.usage = ImageCreateInfo::Usage::DEPTH
+			.usage = ImageCreateInfo::Usage::DEPTH,
+			.category = MemoryCategory::RENDER_TARGET,
 			});
 
 		return newRT;
@@ -710,7 +1102,7 @@ void Device::recreateRenderTargetImages()
 		RenderTarget* target = &m_renderTargets.m_array[i];
 		if (target->imageHandle() != 0U)
 		{
-			m_resourceManager->DestroyImage(target->imageHandle);
+			DestroyImage(target->imageHandle);
 			target->imageHandle = createRenderTargetImage(target->depth);
 		}
 	}
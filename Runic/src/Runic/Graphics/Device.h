@@ -6,20 +6,29 @@
 #include <vk_mem_alloc.h>
 #include <imgui.h>
 
+#include <algorithm>
+#include <cassert>
 #include <memory>
 
 // internal
 #include "Runic/Structures/DeletionQueue.h"
+#include "Runic/Graphics/Internal/GpuProfiler.h"
 #include "Runic/Graphics/Internal/PipelineManager.h"
+#include "Runic/Graphics/Internal/RetireQueue.h"
 #include "Runic/Graphics/ResourceManager.h"
 
 
-constexpr unsigned int FRAME_OVERLAP = 2U;
+constexpr unsigned int MAX_FRAMES_IN_FLIGHT = 4U;		// Per frame resources are sized for this many
+constexpr unsigned int DEFAULT_FRAMES_IN_FLIGHT = 2U;
 
 constexpr VkFormat DEFAULT_FORMAT = { VK_FORMAT_R8G8B8A8_SRGB };
 constexpr VkFormat NORMAL_FORMAT = { VK_FORMAT_R8G8B8A8_UNORM };
 constexpr VkFormat DEPTH_FORMAT = { VK_FORMAT_D32_SFLOAT };
 
+constexpr double DEFRAG_TIME_BUDGET_MS = 2.0;
+constexpr VkDeviceSize DEFRAG_MAX_BYTES_PER_PASS = 16ULL * 1024 * 1024;
+constexpr uint32_t DEFRAG_MAX_ALLOCATIONS_PER_PASS = 64U;
+
 namespace Runic
 {
 	struct CommandContext
@@ -38,14 +47,13 @@ namespace Runic
 
 	struct UploadContext
 	{
-		VkFence uploadFence;
 		VkCommandPool commandPool;
 		VkCommandBuffer commandBuffer;
 	};
 
 	struct Swapchain
 	{
-		VkSwapchainKHR swapchain;
+		VkSwapchainKHR swapchain{ VK_NULL_HANDLE };
 		VkFormat imageFormat;
 		std::vector<VkImage> images;
 		std::vector<VkImageView> imageViews;
@@ -56,7 +64,19 @@ namespace Runic
 	{
 		VkSemaphore presentSem;
 		VkSemaphore	renderSem;
-		VkFence renderFen;
+		uint64_t graphicsValue;		// Graphics timeline value signalled by this slot's last submission
+	};
+
+	/*
+	Each queue's work signals a timeline semaphore with an increasing value, waiting on a value waits for exactly
+	the work submitted up to it
+	*/
+	enum class Timeline
+	{
+		GRAPHICS,
+		COMPUTE,
+		UPLOAD,
+		COUNT
 	};
 
 	struct RenderTargetHandle
@@ -71,16 +91,43 @@ namespace Runic
 		void Init(Window* window);
 		void Deinit();
 
+		/*
+		Also starts the ImGui frame, windows can be built until AddImGuiToCommandBuffer
+		*/
 		bool BeginFrame();
-		void AddImGuiToCommandBuffer();
+		/*
+		Begins and ends its own render pass, the back buffer must be a colour attachment
+		*/
+		void AddImGuiToCommandBuffer(VkCommandBuffer cmd);
 		void EndFrame();
 		void Present();
 
+		/*
+		Also releases everything in the retire queue, for shutdown
+		*/
 		void WaitIdle();
 		void WaitRender();
 
+		/*
+		Submits the frame's command buffer, waiting on the acquired swapchain image and signalling the graphics
+		timeline and the present semaphore. Returns the graphics timeline value.
+		*/
+		uint64_t SubmitFrame(VkCommandBuffer cmd);
+		uint64_t SubmitCompute(VkCommandBuffer cmd);
+		void WaitTimeline(Timeline timeline, uint64_t value);
+		[[nodiscard]] uint64_t GetSubmittedValue(Timeline timeline) const { return m_timelines[static_cast<size_t>(timeline)].value; }
+		[[nodiscard]] uint64_t GetCompletedValue(Timeline timeline) const;
+
+		/*
+		Between 1 and MAX_FRAMES_IN_FLIGHT, applied at the start of the next frame after the frames in flight finish
+		*/
+		void SetFramesInFlight(uint32_t frames) { m_requestedFramesInFlight = std::clamp(frames, 1U, MAX_FRAMES_IN_FLIGHT); }
+		[[nodiscard]] uint32_t GetFramesInFlight() const { return m_framesInFlight; }
+
 		Image GetBackBuffer() { return Image{ .image = m_swapchain.images[m_currentSwapchainImage],.imageView = m_swapchain.imageViews[m_currentSwapchainImage] }; }
 		VkFormat GetBackBufferImageFormat() { return m_swapchain.imageFormat; }
+		VkExtent2D GetBackBufferExtent() const { return m_swapchainExtent; }
+		VmaAllocator GetAllocator() const { return m_allocator; }
 
 		/** Functions:
 			- Resources
@@ -101,29 +148,72 @@ namespace Runic
 
 		VkBuffer GetBuffer(const BufferHandle buffer);
 		std::size_t GetBufferSize(const BufferHandle buffer);
+		/*
+		Only for buffers created with shaderAddress. Changes when defragmentation moves the buffer.
+		*/
+		VkDeviceAddress GetBufferAddress(const BufferHandle buffer);
 		template<typename T>
 		T* GetMappedData(const BufferHandle buffer)
 		{
+			// GPU_ONLY buffers are never mapped
+			assert(m_resourceManager->GetBuffer(buffer).ptr != nullptr);
 			return reinterpret_cast<T*>(m_resourceManager->GetBuffer(buffer).ptr);
 		}
 		VkImage GetImage(const ImageHandle image);
 		VkImageView GetImageView(const ImageHandle image);
 		ImageHandle GetRenderTargetImage(const RenderTargetHandle rendTargetHandle);
 
+		/*
+		Retired, released once the frames that may still use them have completed on the GPU
+		*/
 		void DestroyBuffer(const BufferHandle buffer);
+		void DestroyImage(const ImageHandle image);
+		/*
+		Released straight away, only for staging buffers whose ImmediateSubmit has returned
+		*/
+		void DestroyStagingBuffer(const BufferHandle buffer);
 
 		void ImmediateSubmit(std::function<void(VkCommandBuffer cmd)>&& function);
 
+		struct MemoryBudget
+		{
+			uint64_t usage;
+			uint64_t budget;
+		};
+		/*
+		Summed over the device local heaps, from VMA's heap budgets
+		*/
+		MemoryBudget GetDeviceLocalBudget();
+		MemoryStats GetMemoryStats();
+
+		/*
+		Defragmentation runs a pass at a time from Defragment, which records the copies into cmd and returns
+		the images that were moved so their views can be rebound, at most maxImageMoves of them, allocated from
+		frameMemory. Also started from the memory panel.
+		*/
+		void BeginDefragmentation();
+		std::pmr::vector<ImageHandle> Defragment(VkCommandBuffer cmd, uint32_t maxImageMoves, std::pmr::memory_resource* frameMemory);
+
+		[[nodiscard]] uint32_t GetMaxBindlessTextures() const
+		{
+			return std::min(m_descriptorIndexingProperties.maxDescriptorSetUpdateAfterBindSampledImages, m_descriptorIndexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages);
+		}
+		[[nodiscard]] bool IsFragmentPrimitiveIdSupported() const { return m_fragmentPrimitiveIdSupported; }
+		[[nodiscard]] bool IsIndexTypeUint8Supported() const { return m_indexTypeUint8Supported; }
+		[[nodiscard]] const char* GetDeviceName() const { return m_gpuProperties.deviceName; }
+
 		// Move to private once device functions setup
-		[[nodiscard]] int GetCurrentFrameNumber() { return m_frameNumber % FRAME_OVERLAP; }
+		[[nodiscard]] int GetCurrentFrameNumber() { return m_frameNumber % m_framesInFlight; }
 		[[nodiscard]] RenderFrame& GetCurrentFrame() { return m_frame[GetCurrentFrameNumber()]; }
 
 		Window* m_window;
 		VkDevice m_device;
-		Runic::QueueContext<FRAME_OVERLAP> m_graphics;
+		Runic::QueueContext<MAX_FRAMES_IN_FLIGHT> m_graphics;
 		bool m_dirtySwapchain {false};
 		VkSampler m_defaultSampler;
 		std::unique_ptr<PipelineManager> m_pipelineManager;
+		GpuProfiler m_gpuProfiler;
+		RetireQueue m_retireQueue;
 	private:
 		void initVulkan();
 
@@ -132,18 +222,27 @@ namespace Runic
 
 		void createSwapchain();
 		void recreateSwapchain();
-		void destroySwapchain();
+		void retireSwapchain();
 		void initSyncStructures();
 
 		void initImguiRenderpass();
 		void initImgui();
 
+		void plotMemoryStats(const MemoryStats& stats);
+		void drawMemoryPanel(const MemoryStats& stats);
+		void drawGpuProfilerPanel();
+
 		ImageHandle createRenderTargetImage(bool depth);
 		void recreateRenderTargetImages();
 
 		VkInstance m_instance;
 		VkPhysicalDevice m_chosenGPU;
 		VkPhysicalDeviceProperties m_gpuProperties;
+		bool m_pipelineStatisticsSupported{ false };
+		bool m_fragmentPrimitiveIdSupported{ false };
+		bool m_indexTypeUint8Supported{ false };
+		std::vector<GpuProfiler::PassStats> m_passStats;
+		VkPhysicalDeviceDescriptorIndexingProperties m_descriptorIndexingProperties{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES };
 		DeletionQueue m_instanceDeletionQueue;
 		std::unique_ptr<ResourceManager> m_resourceManager;
 
@@ -155,10 +254,20 @@ namespace Runic
 		Runic::UploadContext m_uploadContext;
 
 		Runic::Swapchain m_swapchain;
+		VkExtent2D m_swapchainExtent{};
 		uint32_t m_currentSwapchainImage;
 
-		RenderFrame m_frame[FRAME_OVERLAP];
+		RenderFrame m_frame[MAX_FRAMES_IN_FLIGHT];
 		int m_frameNumber{};
+		uint32_t m_framesInFlight{ DEFAULT_FRAMES_IN_FLIGHT };
+		uint32_t m_requestedFramesInFlight{ DEFAULT_FRAMES_IN_FLIGHT };
+
+		struct TimelineSemaphore
+		{
+			VkSemaphore semaphore{ VK_NULL_HANDLE };
+			uint64_t value{ 0U };	// Last value submitted
+		};
+		TimelineSemaphore m_timelines[static_cast<size_t>(Timeline::COUNT)];
 
 		VkRenderPass m_imguiPass;
 
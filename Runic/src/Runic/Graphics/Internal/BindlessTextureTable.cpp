@@ -0,0 +1,155 @@
+#include "Runic/Graphics/Internal/BindlessTextureTable.h"
+
+#include <Tracy.hpp>
+
+#include "Runic/Graphics/Internal/VulkanInit.h"
+#include "Runic/Log.h"
+
+using namespace Runic;
+
+void BindlessTextureTable::Init(VkDevice device, uint32_t capacity, RetireQueue* retireQueue)
+{
+	ZoneScoped;
+
+	m_device = device;
+	m_capacity = capacity;
+	m_retireQueue = retireQueue;
+
+	const VkDescriptorPoolSize poolSize{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, capacity };
+	const VkDescriptorPoolCreateInfo poolCreateInfo{
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+		.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT,
+		.maxSets = 1,
+		.poolSizeCount = 1,
+		.pPoolSizes = &poolSize,
+	};
+	vkCreateDescriptorPool(m_device, &poolCreateInfo, nullptr, &m_pool);
+
+	// Slots not used by in flight work may be rewritten while that work is pending
+	const VkDescriptorBindingFlags bindingFlags =
+		VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+		VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT |
+		VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+		VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT;
+
+	const VkDescriptorSetLayoutBindingFlagsCreateInfo layoutBindingFlags{
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO,
+		.bindingCount = 1,
+		.pBindingFlags = &bindingFlags,
+	};
+
+	const VkDescriptorSetLayoutBinding binding = VulkanInit::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 0, capacity);
+
+	const VkDescriptorSetLayoutCreateInfo layoutInfo{
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+		.pNext = &layoutBindingFlags,
+		.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT,
+		.bindingCount = 1,
+		.pBindings = &binding,
+	};
+	vkCreateDescriptorSetLayout(m_device, &layoutInfo, nullptr, &m_layout);
+
+	const VkDescriptorSetVariableDescriptorCountAllocateInfo variableCount{
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO,
+		.descriptorSetCount = 1,
+		.pDescriptorCounts = &capacity,
+	};
+
+	const VkDescriptorSetAllocateInfo allocInfo{
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+		.pNext = &variableCount,
+		.descriptorPool = m_pool,
+		.descriptorSetCount = 1,
+		.pSetLayouts = &m_layout,
+	};
+	vkAllocateDescriptorSets(m_device, &allocInfo, &m_set);
+}
+
+void BindlessTextureTable::Deinit()
+{
+	vkDestroyDescriptorPool(m_device, m_pool, nullptr);
+	vkDestroyDescriptorSetLayout(m_device, m_layout, nullptr);
+}
+
+uint32_t BindlessTextureTable::Allocate()
+{
+	if (!m_freeSlots.empty())
+	{
+		const uint32_t slot = m_freeSlots.back();
+		m_freeSlots.pop_back();
+		return slot;
+	}
+
+	if (m_nextSlot >= m_capacity)
+	{
+		LOG_CORE_ERROR("Bindless texture table is full.");
+		return 0U;
+	}
+	return m_nextSlot++;
+}
+
+void BindlessTextureTable::Free(uint32_t slot)
+{
+	if (slot == 0U)
+	{
+		return;
+	}
+
+	// Drop any write still queued for the slot
+	for (size_t i = 0; i < m_pendingSlots.size(); ++i)
+	{
+		if (m_pendingSlots[i] == slot)
+		{
+			m_pendingSlots.erase(m_pendingSlots.begin() + i);
+			m_pendingImages.erase(m_pendingImages.begin() + i);
+			break;
+		}
+	}
+
+	m_retireQueue->RetireBindlessSlot(this, slot);
+	++m_retiredSlots;
+}
+
+void BindlessTextureTable::Recycle(uint32_t slot)
+{
+	m_freeSlots.push_back(slot);
+	--m_retiredSlots;
+}
+
+void BindlessTextureTable::Write(uint32_t slot, VkImageView imageView, VkSampler sampler, VkImageLayout layout)
+{
+	m_pendingSlots.push_back(slot);
+	m_pendingImages.push_back(VkDescriptorImageInfo{
+		.sampler = sampler,
+		.imageView = imageView,
+		.imageLayout = layout,
+	});
+}
+
+void BindlessTextureTable::Flush()
+{
+	ZoneScoped;
+
+	if (m_pendingSlots.empty())
+	{
+		return;
+	}
+
+	m_writes.clear();
+	for (size_t i = 0; i < m_pendingSlots.size(); ++i)
+	{
+		m_writes.push_back(VkWriteDescriptorSet{
+			.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+			.dstSet = m_set,
+			.dstBinding = 0,
+			.dstArrayElement = m_pendingSlots[i],
+			.descriptorCount = 1,
+			.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+			.pImageInfo = &m_pendingImages[i],
+		});
+	}
+	vkUpdateDescriptorSets(m_device, static_cast<uint32_t>(m_writes.size()), m_writes.data(), 0, nullptr);
+
+	m_pendingSlots.clear();
+	m_pendingImages.clear();
+}
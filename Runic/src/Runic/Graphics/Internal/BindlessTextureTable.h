@@ -0,0 +1,80 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+
+#include "Runic/Graphics/ResourceManager.h"
+#include "Runic/Graphics/Internal/RetireQueue.h"
+
+namespace Runic
+{
+	/*
+	Image currently backing a texture handle and the table slot it is bound to
+	*/
+	struct BindlessTexture
+	{
+		ImageHandle image{ 0U };
+		uint32_t slot{ 0U };
+	};
+
+	/*
+	*
+	* BindlessTextureTable: One UPDATE_AFTER_BIND descriptor set of sampled images shared by every frame in flight.
+	*						Slot 0 is reserved for the "no texture" placeholder. Freed slots go through the retire queue and
+	*						are only handed out again once the frames that could still sample them have completed, so
+	*						textures can stream in and out without waiting on the device.
+	*
+	*/
+	class BindlessTextureTable
+	{
+	public:
+		void Init(VkDevice device, uint32_t capacity, RetireQueue* retireQueue);
+		void Deinit();
+
+		/*
+		Returns 0 when the table is full
+		*/
+		uint32_t Allocate();
+		void Free(uint32_t slot);
+
+		/*
+		Called by the retire queue once no submitted work can sample the slot
+		*/
+		void Recycle(uint32_t slot);
+
+		/*
+		Queued until Flush
+		*/
+		void Write(uint32_t slot, VkImageView imageView, VkSampler sampler, VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+		/*
+		Call once per frame before recording. Submits all queued writes in one vkUpdateDescriptorSets.
+		*/
+		void Flush();
+
+		VkDescriptorSetLayout GetLayout() const { return m_layout; }
+		VkDescriptorSet GetSet() const { return m_set; }
+		uint32_t GetCapacity() const { return m_capacity; }
+		uint32_t GetUsedSlots() const { return m_nextSlot - 1U - static_cast<uint32_t>(m_freeSlots.size()) - m_retiredSlots; }
+
+		/*
+		Slots Allocate can hand out right now, retired slots are not counted until recycled
+		*/
+		uint32_t GetFreeSlots() const { return m_capacity - m_nextSlot + static_cast<uint32_t>(m_freeSlots.size()); }
+	private:
+		VkDevice m_device{ VK_NULL_HANDLE };
+		VkDescriptorPool m_pool{ VK_NULL_HANDLE };
+		VkDescriptorSetLayout m_layout{ VK_NULL_HANDLE };
+		VkDescriptorSet m_set{ VK_NULL_HANDLE };
+
+		uint32_t m_capacity{ 0U };
+		RetireQueue* m_retireQueue{ nullptr };
+		uint32_t m_nextSlot{ 1U };
+		std::vector<uint32_t> m_freeSlots;
+		uint32_t m_retiredSlots{ 0U };
+
+		std::vector<VkDescriptorImageInfo> m_pendingImages;
+		std::vector<uint32_t> m_pendingSlots;
+		std::vector<VkWriteDescriptorSet> m_writes;		// Kept between flushes so its capacity is reused
+	};
+}
@@ -0,0 +1,55 @@
+#include "Runic/Graphics/Internal/DynamicResolution.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace Runic;
+
+void DynamicResolution::Init(uint32_t latencyFrames)
+{
+	m_latency = std::min(latencyFrames, DYNAMIC_RESOLUTION_MAX_LATENCY);
+	m_scale = m_maxScale;
+	m_smoothedMs = 0.0f;
+	m_history.fill(m_scale);
+}
+
+void DynamicResolution::SetScaleLimits(float minScale, float maxScale)
+{
+	m_minScale = std::max(minScale, 0.1f);
+	m_maxScale = std::max(maxScale, m_minScale);
+	m_scale = std::clamp(m_scale, m_minScale, m_maxScale);
+}
+
+void DynamicResolution::Update(float gpuFrameMs)
+{
+	const uint32_t slot = m_frame % static_cast<uint32_t>(m_history.size());
+	const float measuredScale = m_history[(m_frame + static_cast<uint32_t>(m_history.size()) - m_latency) % static_cast<uint32_t>(m_history.size())];
+	++m_frame;
+
+	if (gpuFrameMs > 0.0f)
+	{
+		// Follows a slower frame at once, a faster one only gradually
+		m_smoothedMs = gpuFrameMs > m_smoothedMs ? gpuFrameMs : m_smoothedMs + (gpuFrameMs - m_smoothedMs) * DYNAMIC_RESOLUTION_SMOOTHING;
+
+		const float desired = measuredScale * std::sqrt(m_budgetMs / m_smoothedMs);
+		if (m_smoothedMs > m_budgetMs)
+		{
+			m_scale = std::min(m_scale, desired);
+		}
+		else if (m_smoothedMs < m_budgetMs * DYNAMIC_RESOLUTION_HEADROOM)
+		{
+			m_scale = std::max(m_scale, std::min(desired, m_scale + DYNAMIC_RESOLUTION_MAX_STEP_UP));
+		}
+		m_scale = std::clamp(m_scale, m_minScale, m_maxScale);
+	}
+
+	m_history[slot] = m_scale;
+}
+
+VkExtent2D DynamicResolution::scaleExtent(VkExtent2D extent, float scale)
+{
+	return VkExtent2D{
+		.width = std::max(1U, static_cast<uint32_t>(std::lround(static_cast<float>(extent.width) * scale))),
+		.height = std::max(1U, static_cast<uint32_t>(std::lround(static_cast<float>(extent.height) * scale))),
+	};
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <array>
+#include <cstdint>
+
+namespace Runic
+{
+	constexpr float DYNAMIC_RESOLUTION_DEFAULT_BUDGET_MS = 16.0f;
+	constexpr float DYNAMIC_RESOLUTION_HEADROOM = 0.9f;			// Only grows while frames take less than this share of the budget
+	constexpr float DYNAMIC_RESOLUTION_MAX_STEP_UP = 0.02f;		// Scale gained per frame at most
+	constexpr float DYNAMIC_RESOLUTION_SMOOTHING = 0.1f;		// Weight of a new frame time once it is under the running one
+	constexpr uint32_t DYNAMIC_RESOLUTION_MAX_LATENCY = 8U;
+
+	/*
+	*
+	* DynamicResolution: Picks the fraction of the output resolution to render at from measured GPU frame times. GPU
+	*					 time is taken to follow the pixel count, so the scale moves by the square root of the budget
+	*					 over the frame time. It drops as soon as a frame runs over and grows back in small steps while
+	*					 there is headroom. Frame times arrive frames late and are compared against the scale that
+	*					 frame was rendered at, so one slow frame isn't corrected for again.
+	*
+	*/
+	class DynamicResolution
+	{
+	public:
+		/*
+		latencyFrames: How many Updates after rendering a frame its GPU time is passed in
+		*/
+		void Init(uint32_t latencyFrames);
+
+		void SetBudget(float gpuFrameMs) { m_budgetMs = gpuFrameMs; }
+		float GetBudget() const { return m_budgetMs; }
+
+		/*
+		Fractions of the output size per axis, maxScale above 1 supersamples
+		*/
+		void SetScaleLimits(float minScale, float maxScale);
+		float GetMinScale() const { return m_minScale; }
+		float GetMaxScale() const { return m_maxScale; }
+
+		/*
+		Once per frame with the newest GPU frame time, 0 when there is none yet
+		*/
+		void Update(float gpuFrameMs);
+
+		float GetScale() const { return m_scale; }
+		VkExtent2D GetRenderExtent(VkExtent2D outputExtent) const { return scaleExtent(outputExtent, m_scale); }
+		/*
+		Render targets are this size whatever the scale, so changing it never reallocates them
+		*/
+		VkExtent2D GetMaxExtent(VkExtent2D outputExtent) const { return scaleExtent(outputExtent, m_maxScale); }
+	private:
+		static VkExtent2D scaleExtent(VkExtent2D extent, float scale);
+
+		float m_budgetMs{ DYNAMIC_RESOLUTION_DEFAULT_BUDGET_MS };
+		float m_minScale{ 0.5f };
+		float m_maxScale{ 1.0f };
+		float m_scale{ 1.0f };
+		float m_smoothedMs{ 0.0f };
+
+		std::array<float, DYNAMIC_RESOLUTION_MAX_LATENCY + 1U> m_history{};		// Scale of each recent frame
+		uint32_t m_latency{ 0U };
+		uint32_t m_frame{ 0U };
+	};
+}
@@ -0,0 +1,273 @@
+#include "Runic/Graphics/Internal/GpuProfiler.h"
+
+#include <Tracy.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include "Runic/Log.h"
+
+using namespace Runic;
+
+namespace
+{
+	constexpr VkQueryPipelineStatisticFlags PIPELINE_STATISTICS_FLAGS =
+		VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |
+		VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+		VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+		VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+		VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+}
+
+void GpuProfiler::Init(VkPhysicalDevice physicalDevice, VkDevice device, VkQueue queue, VkCommandBuffer setupCmd, uint32_t queueFamily, uint32_t framesInFlight, bool pipelineStatisticsSupported)
+{
+	ZoneScoped;
+
+	assert(framesInFlight <= MAX_FRAMES);
+	m_device = device;
+	m_framesInFlight = framesInFlight;
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	m_timestampPeriod = properties.limits.timestampPeriod;
+
+	uint32_t familyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> families(familyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, families.data());
+	const uint32_t validBits = queueFamily < familyCount ? families[queueFamily].timestampValidBits : 64U;
+	m_timestampMask = validBits >= 64U ? ~0ULL : (1ULL << validBits) - 1ULL;
+
+	if (!properties.limits.timestampComputeAndGraphics)
+	{
+		LOG_CORE_WARN("Device does not support timestamps on all graphics queues, GPU timings may be missing.");
+	}
+
+	for (uint32_t i = 0; i < m_framesInFlight; ++i)
+	{
+		const VkQueryPoolCreateInfo timestampInfo{
+			.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+			.queryType = VK_QUERY_TYPE_TIMESTAMP,
+			.queryCount = MAX_GPU_ZONES * 2U,
+		};
+		vkCreateQueryPool(m_device, &timestampInfo, nullptr, &m_timestampPool[i]);
+
+		if (pipelineStatisticsSupported)
+		{
+			const VkQueryPoolCreateInfo statisticsInfo{
+				.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+				.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS,
+				.queryCount = MAX_GPU_ZONES,
+				.pipelineStatistics = PIPELINE_STATISTICS_FLAGS,
+			};
+			vkCreateQueryPool(m_device, &statisticsInfo, nullptr, &m_statisticsPool[i]);
+		}
+	}
+
+	// Nothing has been written yet, so resolve has nothing to read for the first frames
+	for (FrameQueries& frame : m_frames)
+	{
+		frame.zones.reserve(MAX_GPU_ZONES);
+		frame.statisticsQueries = 0U;
+	}
+
+	m_tracyContext = TracyVkContext(physicalDevice, device, queue, setupCmd);
+	TracyVkContextName(m_tracyContext, "Graphics", 8);
+}
+
+void GpuProfiler::Deinit()
+{
+	TracyVkDestroy(m_tracyContext);
+
+	for (uint32_t i = 0; i < m_framesInFlight; ++i)
+	{
+		vkDestroyQueryPool(m_device, m_timestampPool[i], nullptr);
+		if (m_statisticsPool[i] != VK_NULL_HANDLE)
+		{
+			vkDestroyQueryPool(m_device, m_statisticsPool[i], nullptr);
+		}
+	}
+}
+
+void GpuProfiler::BeginFrame(VkCommandBuffer cmd, uint32_t frameIndex)
+{
+	ZoneScoped;
+
+	m_currentFrame = frameIndex;
+	resolve(frameIndex);
+
+	FrameQueries& frame = m_frames[frameIndex];
+	frame.zones.clear();
+	frame.statisticsQueries = 0U;
+	m_depth = 0U;
+
+	vkCmdResetQueryPool(cmd, m_timestampPool[frameIndex], 0, MAX_GPU_ZONES * 2U);
+	if (m_statisticsPool[frameIndex] != VK_NULL_HANDLE)
+	{
+		vkCmdResetQueryPool(cmd, m_statisticsPool[frameIndex], 0, MAX_GPU_ZONES);
+	}
+
+	TracyVkCollect(m_tracyContext, cmd);
+}
+
+uint32_t GpuProfiler::BeginZone(VkCommandBuffer cmd, const char* name)
+{
+	FrameQueries& frame = m_frames[m_currentFrame];
+	if (frame.zones.size() >= MAX_GPU_ZONES)
+	{
+		return NO_QUERY;
+	}
+
+	const uint32_t zone = static_cast<uint32_t>(frame.zones.size());
+	uint32_t statisticsQuery = NO_QUERY;
+	if (m_pipelineStatistics && m_depth == 0U)
+	{
+		statisticsQuery = frame.statisticsQueries++;
+		vkCmdBeginQuery(cmd, m_statisticsPool[m_currentFrame], statisticsQuery, 0);
+	}
+
+	frame.zones.push_back(Zone{ .name = name, .statisticsQuery = statisticsQuery, .depth = m_depth, .ended = false });
+	vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_timestampPool[m_currentFrame], zone * 2U);
+	++m_depth;
+	return zone;
+}
+
+void GpuProfiler::EndZone(VkCommandBuffer cmd, uint32_t zone)
+{
+	if (zone == NO_QUERY)
+	{
+		return;
+	}
+
+	Zone& frameZone = m_frames[m_currentFrame].zones[zone];
+	vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_timestampPool[m_currentFrame], zone * 2U + 1U);
+	if (frameZone.statisticsQuery != NO_QUERY)
+	{
+		vkCmdEndQuery(cmd, m_statisticsPool[m_currentFrame], frameZone.statisticsQuery);
+	}
+	frameZone.ended = true;
+	--m_depth;
+}
+
+void GpuProfiler::GetStats(std::vector<PassStats>& stats) const
+{
+	stats.clear();
+
+	std::array<float, GPU_ZONE_HISTORY> sorted;
+	for (const std::string& name : m_order)
+	{
+		const History& history = m_history.at(name);
+		if (history.count == 0U)
+		{
+			continue;
+		}
+
+		const size_t count = history.count;
+		std::copy(history.samples.begin(), history.samples.begin() + count, sorted.begin());
+		std::sort(sorted.begin(), sorted.begin() + count);
+
+		float total = 0.0f;
+		for (size_t i = 0; i < count; ++i)
+		{
+			total += sorted[i];
+		}
+
+		const uint32_t last = (history.next + GPU_ZONE_HISTORY - 1U) % GPU_ZONE_HISTORY;
+		const size_t p99 = std::min(count - 1, static_cast<size_t>(static_cast<float>(count) * 0.99f));
+		stats.push_back(PassStats{
+			.name = name,
+			.lastMs = history.samples[last],
+			.minMs = sorted.front(),
+			.avgMs = total / static_cast<float>(count),
+			.p99Ms = sorted[p99],
+			.samples = history.count,
+			.pipelineStatistics = history.pipelineStatistics,
+		});
+	}
+}
+
+void GpuProfiler::resolve(uint32_t frameIndex)
+{
+	ZoneScoped;
+
+	const FrameQueries& frame = m_frames[frameIndex];
+	if (frame.zones.empty())
+	{
+		return;
+	}
+
+	const uint32_t queryCount = static_cast<uint32_t>(frame.zones.size()) * 2U;
+	uint64_t timestamps[MAX_GPU_ZONES * 2U];
+	if (vkGetQueryPoolResults(m_device, m_timestampPool[frameIndex], 0, queryCount, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+	{
+		return;
+	}
+
+	std::array<PipelineStatistics, MAX_GPU_ZONES> statistics;
+	uint32_t statisticsCount = frame.statisticsQueries;
+	if (statisticsCount > 0U)
+	{
+		static_assert(sizeof(PipelineStatistics) == 5 * sizeof(uint64_t));
+		if (vkGetQueryPoolResults(m_device, m_statisticsPool[frameIndex], 0, statisticsCount, statisticsCount * sizeof(PipelineStatistics),
+			statistics.data(), sizeof(PipelineStatistics), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+		{
+			statisticsCount = 0U;
+		}
+	}
+
+	uint64_t frameStart = ~0ULL;
+	uint64_t frameEnd = 0U;
+	for (size_t i = 0; i < frame.zones.size(); ++i)
+	{
+		const Zone& zone = frame.zones[i];
+		if (!zone.ended)
+		{
+			continue;
+		}
+
+		if (zone.depth == 0U)
+		{
+			frameStart = std::min(frameStart, timestamps[i * 2U] & m_timestampMask);
+			frameEnd = std::max(frameEnd, timestamps[i * 2U + 1U] & m_timestampMask);
+		}
+
+		const uint64_t ticks = ((timestamps[i * 2U + 1U] & m_timestampMask) - (timestamps[i * 2U] & m_timestampMask)) & m_timestampMask;
+		const float ms = static_cast<float>(static_cast<double>(ticks) * m_timestampPeriod / 1000000.0);
+
+		auto [it, inserted] = m_history.try_emplace(zone.name, History{ .samples{}, .next = 0U, .count = 0U });
+		if (inserted)
+		{
+			m_order.push_back(zone.name);
+		}
+		History& history = it->second;
+		history.samples[history.next] = ms;
+		history.next = (history.next + 1U) % GPU_ZONE_HISTORY;
+		history.count = std::min(history.count + 1U, GPU_ZONE_HISTORY);
+
+		if (zone.statisticsQuery != NO_QUERY && zone.statisticsQuery < statisticsCount)
+		{
+			history.pipelineStatistics = statistics[zone.statisticsQuery];
+		}
+	}
+
+	if (frameEnd > frameStart)
+	{
+		m_lastFrameMs = static_cast<float>(static_cast<double>(frameEnd - frameStart) * m_timestampPeriod / 1000000.0);
+	}
+}
+
+GpuZone::GpuZone(GpuProfiler& profiler, VkCommandBuffer cmd, const char* name)
+	: m_profiler(profiler)
+	, m_cmd(cmd)
+	, m_zone(profiler.BeginZone(cmd, name))
+#ifdef TRACY_ENABLE
+	, m_tracyZone(profiler.GetTracyContext(), __LINE__, __FILE__, std::strlen(__FILE__), __func__, std::strlen(__func__), name, std::strlen(name), cmd, true)
+#endif
+{
+}
+
+GpuZone::~GpuZone()
+{
+	m_profiler.EndZone(m_cmd, m_zone);
+}
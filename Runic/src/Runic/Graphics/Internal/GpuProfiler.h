@@ -0,0 +1,143 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <TracyVulkan.hpp>
+
+#include <array>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Runic
+{
+	constexpr uint32_t MAX_GPU_ZONES = 64U;				// Per frame
+	constexpr uint32_t GPU_ZONE_HISTORY = 240U;			// Frames kept for min/avg/p99
+
+	/*
+	*
+	* GpuProfiler: Timestamp queries written around each pass of a frame. Results are read back once the frame
+	*			   slot's timeline value has been waited on, frames in flight later, so reading never stalls. Pass times
+	*			   also go to Tracy's GPU context. Pipeline statistics are opt in and only collected for outermost
+	*			   zones, as only one query of a type may be active at once.
+	*
+	*/
+	class GpuProfiler
+	{
+	public:
+		struct PipelineStatistics
+		{
+			uint64_t inputVertices;
+			uint64_t inputPrimitives;
+			uint64_t vertexInvocations;
+			uint64_t clippingPrimitives;
+			uint64_t fragmentInvocations;
+		};
+
+		struct PassStats
+		{
+			std::string name;
+			float lastMs;
+			float minMs;
+			float avgMs;
+			float p99Ms;
+			uint32_t samples;
+			std::optional<PipelineStatistics> pipelineStatistics;
+		};
+
+		void Init(VkPhysicalDevice physicalDevice, VkDevice device, VkQueue queue, VkCommandBuffer setupCmd, uint32_t queueFamily, uint32_t framesInFlight, bool pipelineStatisticsSupported);
+		void Deinit();
+
+		/*
+		Reads back the results of the last use of this frame slot, whose timeline value must have been waited on, and
+		resets its queries. Records into cmd, which must be outside of rendering.
+		*/
+		void BeginFrame(VkCommandBuffer cmd, uint32_t frameIndex);
+
+		/*
+		Returns the zone index to pass to EndZone. Zones may nest, name must outlive the frame.
+		*/
+		uint32_t BeginZone(VkCommandBuffer cmd, const char* name);
+		void EndZone(VkCommandBuffer cmd, uint32_t zone);
+
+		void SetPipelineStatistics(bool enable) { m_pipelineStatistics = enable && m_statisticsPool[0] != VK_NULL_HANDLE; }
+		bool IsPipelineStatisticsEnabled() const { return m_pipelineStatistics; }
+		bool IsPipelineStatisticsSupported() const { return m_statisticsPool[0] != VK_NULL_HANDLE; }
+
+		/*
+		Refills stats, reusing its storage
+		*/
+		void GetStats(std::vector<PassStats>& stats) const;
+
+		/*
+		Span from the first to the last outermost zone of the newest resolved frame, 0 before any frame resolved
+		*/
+		float GetLastFrameMs() const { return m_lastFrameMs; }
+		TracyVkCtx GetTracyContext() const { return m_tracyContext; }
+	private:
+		static constexpr uint32_t MAX_FRAMES = 4U;
+		static constexpr uint32_t NO_QUERY = ~0U;
+
+		struct Zone
+		{
+			const char* name;
+			uint32_t statisticsQuery;
+			uint32_t depth;
+			bool ended;
+		};
+
+		struct FrameQueries
+		{
+			std::vector<Zone> zones;
+			uint32_t statisticsQueries;
+		};
+
+		struct History
+		{
+			std::array<float, GPU_ZONE_HISTORY> samples;
+			uint32_t next;
+			uint32_t count;
+			std::optional<PipelineStatistics> pipelineStatistics;
+		};
+
+		void resolve(uint32_t frameIndex);
+
+		VkDevice m_device{ VK_NULL_HANDLE };
+		float m_timestampPeriod{ 1.0f };	// Nanoseconds per tick
+		uint64_t m_timestampMask{ ~0ULL };
+		uint32_t m_framesInFlight{ 0U };
+		uint32_t m_currentFrame{ 0U };
+		uint32_t m_depth{ 0U };
+		bool m_pipelineStatistics{ false };
+		float m_lastFrameMs{ 0.0f };
+
+		VkQueryPool m_timestampPool[MAX_FRAMES]{};
+		VkQueryPool m_statisticsPool[MAX_FRAMES]{};
+		FrameQueries m_frames[MAX_FRAMES];
+
+		std::unordered_map<std::string, History> m_history;
+		std::vector<std::string> m_order;	// Passes in first seen order
+
+		TracyVkCtx m_tracyContext{ nullptr };
+	};
+
+	/*
+	Scoped GPU zone, also a Tracy GPU zone when Tracy is enabled
+	*/
+	class GpuZone
+	{
+	public:
+		GpuZone(GpuProfiler& profiler, VkCommandBuffer cmd, const char* name);
+		~GpuZone();
+
+		GpuZone(const GpuZone&) = delete;
+		GpuZone& operator=(const GpuZone&) = delete;
+	private:
+		GpuProfiler& m_profiler;
+		const VkCommandBuffer m_cmd;
+		const uint32_t m_zone;
+#ifdef TRACY_ENABLE
+		tracy::VkCtxScope m_tracyZone;
+#endif
+	};
+}
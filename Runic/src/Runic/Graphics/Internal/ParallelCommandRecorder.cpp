@@ -0,0 +1,182 @@
+#include "Runic/Graphics/Internal/ParallelCommandRecorder.h"
+
+#include <Tracy.hpp>
+
+#include <algorithm>
+
+#include "Runic/Graphics/Internal/VulkanInit.h"
+
+using namespace Runic;
+
+void ParallelCommandRecorder::Init(VkDevice device, uint32_t queueFamily, uint32_t framesInFlight)
+{
+	ZoneScoped;
+
+	m_device = device;
+	m_framesInFlight = framesInFlight;
+	m_threadCount = std::clamp(std::thread::hardware_concurrency(), 1U, MAX_RECORDING_THREADS);
+
+	const VkCommandPoolCreateInfo poolInfo = VulkanInit::commandPoolCreateInfo(queueFamily, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+
+	m_pools.resize(m_framesInFlight);
+	for (std::vector<ThreadPool>& framePools : m_pools)
+	{
+		framePools.resize(m_threadCount + 1U);
+		for (ThreadPool& threadPool : framePools)
+		{
+			vkCreateCommandPool(m_device, &poolInfo, nullptr, &threadPool.pool);
+		}
+	}
+
+	m_stopWorkers = false;
+	m_workers.reserve(m_threadCount - 1U);
+	for (uint32_t worker = 0; worker + 1U < m_threadCount; ++worker)
+	{
+		m_workers.emplace_back(&ParallelCommandRecorder::workerLoop, this, worker);
+	}
+}
+
+void ParallelCommandRecorder::Deinit()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_jobMutex);
+		m_stopWorkers = true;
+	}
+	m_jobReady.notify_all();
+	for (std::thread& worker : m_workers)
+	{
+		worker.join();
+	}
+	m_workers.clear();
+
+	for (std::vector<ThreadPool>& framePools : m_pools)
+	{
+		for (ThreadPool& threadPool : framePools)
+		{
+			vkDestroyCommandPool(m_device, threadPool.pool, nullptr);
+		}
+	}
+	m_pools.clear();
+}
+
+void ParallelCommandRecorder::BeginFrame(uint32_t frameIndex)
+{
+	ZoneScoped;
+
+	m_currentFrame = frameIndex;
+	for (ThreadPool& threadPool : m_pools[frameIndex])
+	{
+		vkResetCommandPool(m_device, threadPool.pool, 0);
+		threadPool.used = 0U;
+	}
+}
+
+std::pmr::vector<VkCommandBuffer> ParallelCommandRecorder::Record(const VkCommandBufferInheritanceRenderingInfo& renderingInfo, uint32_t itemCount, const RecordChunk& recordChunk,
+	std::pmr::memory_resource* frameMemory)
+{
+	ZoneScoped;
+
+	std::pmr::vector<VkCommandBuffer> secondaries(frameMemory);
+	if (itemCount == 0U)
+	{
+		return secondaries;
+	}
+
+	const uint32_t chunkCount = std::clamp((itemCount + MIN_DRAWS_PER_CHUNK - 1U) / MIN_DRAWS_PER_CHUNK, 1U, m_threadCount);
+	const uint32_t chunkSize = (itemCount + chunkCount - 1U) / chunkCount;
+	secondaries.resize(chunkCount);
+
+	// Every chunk has its own pool, pools are only touched by their own thread while recording
+	std::latch done(chunkCount - 1U);
+	const RecordJob job{
+		.pools = &m_pools[m_currentFrame],
+		.renderingInfo = &renderingInfo,
+		.recordChunk = &recordChunk,
+		.secondaries = secondaries.data(),
+		.done = &done,
+		.itemCount = itemCount,
+		.chunkCount = chunkCount,
+		.chunkSize = chunkSize,
+	};
+	if (chunkCount > 1U)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_jobMutex);
+			m_job = job;
+			++m_jobGeneration;
+		}
+		m_jobReady.notify_all();
+	}
+
+	// The last chunk is recorded on this thread while the workers run
+	recordJobChunk(job, chunkCount - 1U);
+	done.wait();
+	return secondaries;
+}
+
+void ParallelCommandRecorder::recordJobChunk(const RecordJob& job, uint32_t chunk)
+{
+	ZoneScopedN("Record chunk");
+
+	const uint32_t begin = chunk * job.chunkSize;
+	const uint32_t end = std::min(begin + job.chunkSize, job.itemCount);
+	const VkCommandBuffer cmd = beginSecondary((*job.pools)[chunk], *job.renderingInfo);
+	(*job.recordChunk)(cmd, chunk + 1U, begin, end);
+	vkEndCommandBuffer(cmd);
+	job.secondaries[chunk] = cmd;
+}
+
+void ParallelCommandRecorder::workerLoop(uint32_t worker)
+{
+	uint64_t seenGeneration = 0U;
+	while (true)
+	{
+		RecordJob job;
+		{
+			std::unique_lock<std::mutex> lock(m_jobMutex);
+			m_jobReady.wait(lock, [this, seenGeneration]() { return m_stopWorkers || m_jobGeneration != seenGeneration; });
+			if (m_stopWorkers)
+			{
+				return;
+			}
+			seenGeneration = m_jobGeneration;
+			job = m_job;
+		}
+
+		// Small frames use fewer chunks than there are workers
+		if (worker + 1U < job.chunkCount)
+		{
+			recordJobChunk(job, worker);
+			job.done->count_down();
+		}
+	}
+}
+
+VkCommandBuffer ParallelCommandRecorder::BeginSecondary(const VkCommandBufferInheritanceRenderingInfo& renderingInfo)
+{
+	return beginSecondary(m_pools[m_currentFrame].back(), renderingInfo);
+}
+
+VkCommandBuffer ParallelCommandRecorder::beginSecondary(ThreadPool& threadPool, const VkCommandBufferInheritanceRenderingInfo& renderingInfo)
+{
+	if (threadPool.used == threadPool.buffers.size())
+	{
+		const VkCommandBufferAllocateInfo allocInfo = VulkanInit::commandBufferAllocateInfo(threadPool.pool, 1, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+		VkCommandBuffer buffer{ VK_NULL_HANDLE };
+		vkAllocateCommandBuffers(m_device, &allocInfo, &buffer);
+		threadPool.buffers.push_back(buffer);
+	}
+	const VkCommandBuffer cmd = threadPool.buffers[threadPool.used++];
+
+	const VkCommandBufferInheritanceInfo inheritanceInfo{
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+		.pNext = &renderingInfo,
+	};
+	const VkCommandBufferBeginInfo beginInfo{
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT,
+		.pInheritanceInfo = &inheritanceInfo,
+	};
+	vkBeginCommandBuffer(cmd, &beginInfo);
+	return cmd;
+}
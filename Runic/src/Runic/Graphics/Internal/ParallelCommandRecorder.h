@@ -0,0 +1,98 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <condition_variable>
+#include <functional>
+#include <latch>
+#include <memory_resource>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Runic
+{
+	constexpr uint32_t MAX_RECORDING_THREADS = 8U;
+	constexpr uint32_t MIN_DRAWS_PER_CHUNK = 256U;		// Below this a chunk isn't worth a thread
+
+	/*
+	*
+	* ParallelCommandRecorder: Splits a draw list into chunks recorded into secondary command buffers on worker
+	*						   threads, for execution inside a dynamic rendering instance begun with
+	*						   VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT. Every thread has its own command
+	*						   pool per frame in flight, so no pool is shared between threads, and a frame's pools
+	*						   are all reset together once that frame has finished on the GPU. The worker threads
+	*						   are started once in Init and wait for chunks between frames.
+	*
+	*/
+	class ParallelCommandRecorder
+	{
+	public:
+		/*
+		Records items [begin, end) into cmd. Secondary command buffers inherit no dynamic state or bindings.
+		thread is 1 based and unique per chunk, for picking a per thread FrameArena.
+		*/
+		using RecordChunk = std::function<void(VkCommandBuffer cmd, uint32_t thread, uint32_t begin, uint32_t end)>;
+
+		void Init(VkDevice device, uint32_t queueFamily, uint32_t framesInFlight);
+		void Deinit();
+
+		/*
+		Resets this frame's pools, the frame's previous submission must have completed
+		*/
+		void BeginFrame(uint32_t frameIndex);
+
+		/*
+		Returns the secondary command buffers in item order, ready for vkCmdExecuteCommands. The list is
+		allocated from frameMemory.
+		*/
+		std::pmr::vector<VkCommandBuffer> Record(const VkCommandBufferInheritanceRenderingInfo& renderingInfo, uint32_t itemCount, const RecordChunk& recordChunk,
+			std::pmr::memory_resource* frameMemory);
+
+		/*
+		A secondary command buffer recorded on the calling thread, end it before executing
+		*/
+		VkCommandBuffer BeginSecondary(const VkCommandBufferInheritanceRenderingInfo& renderingInfo);
+
+		uint32_t GetThreadCount() const { return m_threadCount; }
+	private:
+		struct ThreadPool
+		{
+			VkCommandPool pool{ VK_NULL_HANDLE };
+			std::vector<VkCommandBuffer> buffers;
+			uint32_t used{ 0U };
+		};
+
+		// One frame's recording, shared with the workers for the duration of Record
+		struct RecordJob
+		{
+			std::vector<ThreadPool>* pools{ nullptr };
+			const VkCommandBufferInheritanceRenderingInfo* renderingInfo{ nullptr };
+			const RecordChunk* recordChunk{ nullptr };
+			VkCommandBuffer* secondaries{ nullptr };
+			std::latch* done{ nullptr };
+			uint32_t itemCount{ 0U };
+			uint32_t chunkCount{ 0U };
+			uint32_t chunkSize{ 0U };
+		};
+
+		VkCommandBuffer beginSecondary(ThreadPool& pool, const VkCommandBufferInheritanceRenderingInfo& renderingInfo);
+		void recordJobChunk(const RecordJob& job, uint32_t chunk);
+		void workerLoop(uint32_t worker);
+
+		VkDevice m_device{ VK_NULL_HANDLE };
+		uint32_t m_threadCount{ 1U };
+		uint32_t m_framesInFlight{ 0U };
+		uint32_t m_currentFrame{ 0U };
+
+		// [frame][thread], the last pool of each frame belongs to the calling thread
+		std::vector<std::vector<ThreadPool>> m_pools;
+
+		// Worker n records chunk n, the calling thread records the last chunk
+		std::vector<std::thread> m_workers;
+		std::mutex m_jobMutex;
+		std::condition_variable m_jobReady;
+		RecordJob m_job;
+		uint64_t m_jobGeneration{ 0U };
+		bool m_stopWorkers{ false };
+	};
+}
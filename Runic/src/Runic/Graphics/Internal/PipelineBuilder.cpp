@@ -1,8 +1,19 @@
 #include "Runic/Graphics/Internal/PipelineBuilder.h"
 #include <assert.h>
 #include <fstream>
+#include <iterator>
 
 std::optional<VkShaderModule> PipelineBuild::loadShaderModule(VkDevice device, const char* filePath){
+	const std::optional<std::vector<uint32_t>> code = loadShaderCode(filePath);
+	if (!code.has_value())
+	{
+		return std::nullopt;
+	}
+	return createShaderModule(device, code.value());
+}
+
+std::optional<std::vector<uint32_t>> PipelineBuild::loadShaderCode(const char* filePath)
+{
 	//open the file. With cursor at the end
 	std::ifstream file(filePath, std::ios::ate | std::ios::binary);
 
@@ -20,12 +31,16 @@ std::optional<VkShaderModule> PipelineBuild::loadShaderModule(VkDevice device, c
 	file.read((char*)buffer.data(), fileSize);
 	file.close();
 
+	return buffer;
+}
 
+std::optional<VkShaderModule> PipelineBuild::createShaderModule(VkDevice device, const std::vector<uint32_t>& code)
+{
 	VkShaderModuleCreateInfo createInfo = {
 		.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
 		.pNext = nullptr,
-		.codeSize = buffer.size() * sizeof(uint32_t),
-		.pCode = buffer.data()
+		.codeSize = code.size() * sizeof(uint32_t),
+		.pCode = code.data()
 	};
 
 	VkShaderModule shaderModule;
@@ -34,13 +49,16 @@ std::optional<VkShaderModule> PipelineBuild::loadShaderModule(VkDevice device, c
 		return std::nullopt;
 	}
 	return shaderModule;
-	}
+}
 
-VkPipeline PipelineBuild::BuildPipeline(VkDevice device, const BuildInfo& buildInfo)
+VkPipeline PipelineBuild::BuildPipeline(VkDevice device, const BuildInfo& buildInfo, VkPipelineCache pipelineCache)
 {
-	assert(buildInfo.shaderStages.empty() == false);
-	assert(buildInfo.pipelineLayout != VK_NULL_HANDLE);
+	return BuildPipelines(device, { buildInfo }, pipelineCache)[0];
+}
 
+std::vector<VkPipeline> PipelineBuild::BuildPipelines(VkDevice device, const std::vector<BuildInfo>& buildInfos, VkPipelineCache pipelineCache)
+{
+	// Fixed state shared by every pipeline in the batch
 	const VkPipelineViewportStateCreateInfo viewportState = {
 		.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
 		.pNext = nullptr,
@@ -50,21 +68,13 @@ VkPipeline PipelineBuild::BuildPipeline(VkDevice device, const BuildInfo& buildI
 		.pScissors = nullptr,
 	};
 
-	const std::vector<VkDynamicState> dynamicStateEnables = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+	const VkDynamicState dynamicStateEnables[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
 
 	const VkPipelineDynamicStateCreateInfo dynamicStateInfo = {
 		.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
 		.flags = 0,
-		.dynamicStateCount = static_cast<uint32_t>(dynamicStateEnables.size()),
-		.pDynamicStates = dynamicStateEnables.data(),
-	};
-
-	const VkPipelineColorBlendStateCreateInfo colorBlending = {
-		.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
-		.logicOpEnable = VK_FALSE,
-		.logicOp = VK_LOGIC_OP_COPY,
-		.attachmentCount = 1,
-		.pAttachments = &buildInfo.colorBlendAttachment,
+		.dynamicStateCount = static_cast<uint32_t>(std::size(dynamicStateEnables)),
+		.pDynamicStates = dynamicStateEnables,
 	};
 
 	const VkPipelineInputAssemblyStateCreateInfo inputAssemblyCreateInfo = {
@@ -89,39 +99,61 @@ VkPipeline PipelineBuild::BuildPipeline(VkDevice device, const BuildInfo& buildI
 		.alphaToOneEnable = VK_FALSE,
 	};
 
-	VkPipelineRenderingCreateInfo dynamicRenderingInfo = { 
-		.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO,
-		.colorAttachmentCount = static_cast<uint32_t>(buildInfo.colorAttachmentFormats.size()),
-		.pColorAttachmentFormats = buildInfo.colorAttachmentFormats.data(),
-		.depthAttachmentFormat = buildInfo.depthAttachmentFormat.has_value() ? buildInfo.depthAttachmentFormat.value() : VK_FORMAT_UNDEFINED,
-		.stencilAttachmentFormat = buildInfo.stencilAttachmentFormat.has_value() ? buildInfo.stencilAttachmentFormat.value() : VK_FORMAT_UNDEFINED,
-	};
+	// Per pipeline state, sized up front so pointers into it stay valid
+	std::vector<VkPipelineColorBlendStateCreateInfo> colorBlending(buildInfos.size());
+	std::vector<VkPipelineRenderingCreateInfo> dynamicRenderingInfos(buildInfos.size());
+	std::vector<VkGraphicsPipelineCreateInfo> pipelineInfos(buildInfos.size());
 
-	const VkGraphicsPipelineCreateInfo pipelineInfo = {
-		.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
-		.pNext = &dynamicRenderingInfo,
-		.stageCount = static_cast<uint32_t>(buildInfo.shaderStages.size()),
-		.pStages = buildInfo.shaderStages.data(),
-		.pVertexInputState = &buildInfo.vertexInputInfo,
-		.pInputAssemblyState = &inputAssemblyCreateInfo,
-		.pTessellationState = &tessState,
-		.pViewportState = &viewportState,
-		.pRasterizationState = &buildInfo.rasterizer,
-		.pMultisampleState = &sampleState,
-		.pDepthStencilState = &buildInfo.depthStencil,
-		.pColorBlendState = &colorBlending,
-		.pDynamicState = &dynamicStateInfo,
-		.layout = buildInfo.pipelineLayout,
-		.renderPass = nullptr,
-		.basePipelineHandle = VK_NULL_HANDLE,
-	};
+	for (size_t i = 0; i < buildInfos.size(); ++i)
+	{
+		const BuildInfo& buildInfo = buildInfos[i];
+		assert(buildInfo.shaderStages.empty() == false);
+		assert(buildInfo.pipelineLayout != VK_NULL_HANDLE);
+
+		colorBlending[i] = {
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+			.logicOpEnable = VK_FALSE,
+			.logicOp = VK_LOGIC_OP_COPY,
+			// Must match the rendering colour attachments, depth only pipelines have none
+			.attachmentCount = static_cast<uint32_t>(buildInfo.colorAttachmentFormats.size()),
+			.pAttachments = &buildInfo.colorBlendAttachment,
+		};
+
+		dynamicRenderingInfos[i] = {
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO,
+			.colorAttachmentCount = static_cast<uint32_t>(buildInfo.colorAttachmentFormats.size()),
+			.pColorAttachmentFormats = buildInfo.colorAttachmentFormats.data(),
+			.depthAttachmentFormat = buildInfo.depthAttachmentFormat.has_value() ? buildInfo.depthAttachmentFormat.value() : VK_FORMAT_UNDEFINED,
+			.stencilAttachmentFormat = buildInfo.stencilAttachmentFormat.has_value() ? buildInfo.stencilAttachmentFormat.value() : VK_FORMAT_UNDEFINED,
+		};
+
+		pipelineInfos[i] = {
+			.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+			.pNext = &dynamicRenderingInfos[i],
+			.stageCount = static_cast<uint32_t>(buildInfo.shaderStages.size()),
+			.pStages = buildInfo.shaderStages.data(),
+			.pVertexInputState = &buildInfo.vertexInputInfo,
+			.pInputAssemblyState = &inputAssemblyCreateInfo,
+			.pTessellationState = &tessState,
+			.pViewportState = &viewportState,
+			.pRasterizationState = &buildInfo.rasterizer,
+			.pMultisampleState = &sampleState,
+			.pDepthStencilState = &buildInfo.depthStencil,
+			.pColorBlendState = &colorBlending[i],
+			.pDynamicState = &dynamicStateInfo,
+			.layout = buildInfo.pipelineLayout,
+			.renderPass = nullptr,
+			.basePipelineHandle = VK_NULL_HANDLE,
+		};
+	}
 
-	VkPipeline newPipeline;
-	VkResult result = vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &newPipeline);
-	if (result != VK_SUCCESS)
+	std::vector<VkPipeline> newPipelines(buildInfos.size(), VK_NULL_HANDLE);
+	if (buildInfos.empty())
 	{
-		//assert(newPipeline != VK_NULL_HANDLE);
-		return VK_NULL_HANDLE; // failed to create graphics pipeline
+		return newPipelines;
 	}
-	return newPipeline;
+
+	// On failure the implementation leaves VK_NULL_HANDLE in the slots of pipelines it could not create
+	vkCreateGraphicsPipelines(device, pipelineCache, static_cast<uint32_t>(pipelineInfos.size()), pipelineInfos.data(), nullptr, newPipelines.data());
+	return newPipelines;
 }
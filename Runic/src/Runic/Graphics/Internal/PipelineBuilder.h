@@ -6,6 +6,8 @@
 
 namespace PipelineBuild {
 	std::optional<VkShaderModule> loadShaderModule(VkDevice device,const char* filePath);
+	std::optional<std::vector<uint32_t>> loadShaderCode(const char* filePath);
+	std::optional<VkShaderModule> createShaderModule(VkDevice device, const std::vector<uint32_t>& code);
 
 	struct BuildInfo
 	{
@@ -20,5 +22,10 @@ namespace PipelineBuild {
 		std::optional<VkFormat> stencilAttachmentFormat = {};
 	};
 
-	VkPipeline BuildPipeline(VkDevice device, const BuildInfo& pipelineBuildInfo);
+	VkPipeline BuildPipeline(VkDevice device, const BuildInfo& pipelineBuildInfo, VkPipelineCache pipelineCache = VK_NULL_HANDLE);
+
+	/*
+	Builds every pipeline in a single vkCreateGraphicsPipelines call. Failed pipelines are returned as VK_NULL_HANDLE.
+	*/
+	std::vector<VkPipeline> BuildPipelines(VkDevice device, const std::vector<BuildInfo>& pipelineBuildInfos, VkPipelineCache pipelineCache = VK_NULL_HANDLE);
 };
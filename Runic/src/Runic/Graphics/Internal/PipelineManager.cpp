@@ -1,6 +1,12 @@
 #include "Runic/Graphics/Internal/PipelineManager.h"
 
 #include <optional>
+#include <fstream>
+#include <thread>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <filesystem>
 
 #include "Runic/Graphics/Internal/VulkanInit.h"
 #include "Runic/Graphics/Internal/PipelineBuilder.h"
@@ -21,8 +27,61 @@ using namespace Runic;
 	} while (0)
 
 
+namespace
+{
+	constexpr const char* PIPELINE_CACHE_FILE = "pipeline_cache.bin";
+	constexpr uint32_t PIPELINE_CACHE_MAGIC = 0x43505552; // "RUPC"
+	constexpr uint32_t PIPELINE_CACHE_VERSION = 1U;
+
+#ifndef RNC_GLSL_VALIDATOR
+#define RNC_GLSL_VALIDATOR "glslangValidator"
+#endif
+
+	bool compileShader(const std::string& sourceFile, const std::string& spirvFile)
+	{
+		const std::string command = std::string("\"") + RNC_GLSL_VALIDATOR + "\" -V \"" + sourceFile + "\" -o \"" + spirvFile + "\"";
+		return std::system(command.c_str()) == 0;
+	}
+
+	// Written in front of the driver blob so a cache from another GPU or driver is discarded
+	struct PipelineCacheHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t vendorID;
+		uint32_t deviceID;
+		uint32_t driverVersion;
+		uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+		uint64_t dataSize;
+	};
+}
+
+PipelineManager::PipelineManager(VkDevice device, const VkPhysicalDeviceProperties& gpuProperties, RetireQueue* retireQueue) : m_device(device), m_gpuProperties(gpuProperties), m_retireQueue(retireQueue), m_shaderModules(device)
+{
+	loadPipelineCache();
+}
+
 void PipelineManager::Deinit()
 {
+	if (m_hotReload)
+	{
+		m_shaderWatcher.Deinit();
+	}
+	for (ShaderCompile& compile : m_shaderCompiles)
+	{
+		compile.result.wait();
+	}
+	m_shaderCompiles.clear();
+
+	for (PendingPipelines& pending : m_pendingPipelines)
+	{
+		for (const CompiledPipeline& compiled : pending.result.get())
+		{
+			destroyCompiledPipeline(compiled);
+		}
+	}
+	m_pendingPipelines.clear();
+
 	for (const VkPipelineLayout layout : m_pipelineLayouts)
 	{
 		vkDestroyPipelineLayout(m_device, layout, nullptr);
@@ -31,11 +90,167 @@ void PipelineManager::Deinit()
 	{
 		vkDestroyPipeline(m_device, pipeline.pipeline, nullptr);
 	}
+	m_shaderModules.Deinit();
+
+	savePipelineCache();
+	vkDestroyPipelineCache(m_device, m_pipelineCache, nullptr);
+}
+
+void PipelineManager::Update()
+{
+	if (m_hotReload)
+	{
+		pollShaderChanges();
+	}
+
+	for (auto it = m_pendingPipelines.begin(); it != m_pendingPipelines.end();)
+	{
+		if (it->result.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		{
+			++it;
+			continue;
+		}
+
+		landPipelines(*it);
+		it = m_pendingPipelines.erase(it);
+	}
+}
+
+void PipelineManager::EnableHotReload(const std::string& shaderSourceFolder)
+{
+	m_sourceFolder = shaderSourceFolder;
+	m_hotReload = m_shaderWatcher.Init(shaderSourceFolder);
+	if (m_hotReload)
+	{
+		LOG_CORE_INFO("Shader hot reload watching: " + shaderSourceFolder);
+	}
+}
+
+void PipelineManager::pollShaderChanges()
+{
+	for (const std::string& sourceFile : m_shaderWatcher.PollChangedFiles())
+	{
+		const std::string spirvFile = sourceFile + ".spv";
+		LOG_CORE_INFO("Shader changed, recompiling: " + sourceFile);
+		m_shaderCompiles.push_back(ShaderCompile{
+			.spirvFile = spirvFile,
+			.result = std::async(std::launch::async, compileShader, sourceFile, spirvFile),
+		});
+	}
+
+	for (auto it = m_shaderCompiles.begin(); it != m_shaderCompiles.end();)
+	{
+		if (it->result.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		{
+			++it;
+			continue;
+		}
+
+		if (!it->result.get())
+		{
+			LOG_CORE_ERROR("Shader failed to compile: " + it->spirvFile);
+			it = m_shaderCompiles.erase(it);
+			continue;
+		}
+
+		// Only rebuild pipelines that reference the recompiled module
+		const std::filesystem::path changedModule = std::filesystem::path(it->spirvFile).filename();
+		std::vector<PipelineHandle> handles;
+		std::vector<PipelineInfo> infos;
+		for (size_t i = 0; i < m_pipelines.size(); ++i)
+		{
+			const PipelineInfo& info = m_pipelines[i];
+			if (std::filesystem::path(info.vertexShader).filename() == changedModule || std::filesystem::path(info.fragmentShader).filename() == changedModule)
+			{
+				handles.push_back(static_cast<PipelineHandle>(i));
+				infos.push_back(info);
+			}
+		}
+
+		if (!infos.empty())
+		{
+			m_pendingPipelines.push_back(queuePipelines(std::move(handles), std::async(std::launch::async, [this, infos = std::move(infos)]() {
+				return createPipelinesParallel(infos);
+			})));
+		}
+		it = m_shaderCompiles.erase(it);
+	}
+}
+
+PipelineManager::PendingPipelines PipelineManager::queuePipelines(std::vector<PipelineHandle> handles, std::future<std::vector<CompiledPipeline>> result)
+{
+	std::vector<uint32_t> generations;
+	generations.reserve(handles.size());
+	for (const PipelineHandle handle : handles)
+	{
+		generations.push_back(++m_pipelineGenerations.at(handle));
+	}
+	return PendingPipelines{
+		.handles = std::move(handles),
+		.generations = std::move(generations),
+		.result = std::move(result),
+	};
+}
+
+void PipelineManager::landPipelines(PendingPipelines& pending)
+{
+	const std::vector<CompiledPipeline> pipelines = pending.result.get();
+	for (size_t i = 0; i < pipelines.size(); ++i)
+	{
+		const PipelineHandle handle = pending.handles[i];
+		PipelineInfo& info = m_pipelines.at(handle);
+
+		// A shader saved twice can finish out of order, only the latest compile may land
+		if (pending.generations[i] != m_pipelineGenerations.at(handle))
+		{
+			destroyCompiledPipeline(pipelines[i]);
+			continue;
+		}
+		if (pipelines[i].pipeline == VK_NULL_HANDLE)
+		{
+			LOG_CORE_ERROR("Failed to create pipeline, keeping previous: " + info.name);
+			continue;
+		}
+		replacePipeline(info, pipelines[i]);
+	}
+}
+
+void PipelineManager::replacePipeline(PipelineInfo& info, const CompiledPipeline& compiled)
+{
+	// Frames in flight may still reference the pipeline being replaced
+	if (info.pipeline != VK_NULL_HANDLE)
+	{
+		m_retireQueue->RetirePipeline(info.pipeline);
+	}
+	// Built pipelines don't need their modules, so these can go straight away
+	m_shaderModules.Release(info.vertexModule);
+	m_shaderModules.Release(info.fragmentModule);
+
+	info.pipeline = compiled.pipeline;
+	info.vertexModule = compiled.vertexModule;
+	info.fragmentModule = compiled.fragmentModule;
+}
+
+void PipelineManager::destroyCompiledPipeline(const CompiledPipeline& compiled)
+{
+	vkDestroyPipeline(m_device, compiled.pipeline, nullptr);
+	m_shaderModules.Release(compiled.vertexModule);
+	m_shaderModules.Release(compiled.fragmentModule);
 }
 
 VkPipeline PipelineManager::GetPipeline(PipelineHandle handle)
 {
-	return m_pipelines.at(handle).pipeline;
+	const VkPipeline pipeline = m_pipelines.at(handle).pipeline;
+	if (pipeline == VK_NULL_HANDLE && m_fallbackPipeline.has_value())
+	{
+		return m_pipelines.at(m_fallbackPipeline.value()).pipeline;
+	}
+	return pipeline;
+}
+
+bool PipelineManager::IsPipelineReady(PipelineHandle handle) const
+{
+	return m_pipelines.at(handle).pipeline != VK_NULL_HANDLE;
 }
 
 VkPipelineLayout PipelineManager::CreatePipelineLayout(std::vector<VkDescriptorSetLayout> descLayouts, std::vector<VkPushConstantRange> pushConstants)
@@ -53,55 +268,263 @@ VkPipelineLayout PipelineManager::CreatePipelineLayout(std::vector<VkDescriptorS
 
 PipelineHandle PipelineManager::CreatePipeline(PipelineInfo info)
 {
-	uint32_t index = (uint32_t)m_pipelines.size();
+	return CreatePipelines({ info })[0];
+}
+
+std::vector<PipelineHandle> PipelineManager::CreatePipelines(const std::vector<PipelineInfo>& infos)
+{
+	const std::vector<CompiledPipeline> pipelines = createPipelinesParallel(infos);
+
+	std::vector<PipelineHandle> handles;
+	handles.reserve(infos.size());
+	for (size_t i = 0; i < infos.size(); ++i)
+	{
+		handles.push_back(static_cast<PipelineHandle>(m_pipelines.size()));
+		m_pipelines.push_back(infos[i]);
+		m_pipelineGenerations.push_back(0);
+		m_pipelines.back().pipeline = pipelines[i].pipeline;
+		m_pipelines.back().vertexModule = pipelines[i].vertexModule;
+		m_pipelines.back().fragmentModule = pipelines[i].fragmentModule;
+		if (pipelines[i].pipeline == VK_NULL_HANDLE)
+		{
+			LOG_CORE_ERROR("Failed to create pipeline: " + infos[i].name);
+		}
+	}
+	return handles;
+}
+
+PipelineHandle PipelineManager::CreatePipelineAsync(PipelineInfo info)
+{
+	const PipelineHandle handle = static_cast<PipelineHandle>(m_pipelines.size());
 	m_pipelines.push_back(info);
-	m_pipelines.back().pipeline = createPipelineInternal(info);
-	return index;
+	m_pipelines.back().pipeline = VK_NULL_HANDLE;
+	m_pipelines.back().vertexModule = VK_NULL_HANDLE;
+	m_pipelines.back().fragmentModule = VK_NULL_HANDLE;
+	m_pipelineGenerations.push_back(0);
+
+	m_pendingPipelines.push_back(queuePipelines({ handle }, std::async(std::launch::async, [this, info]() {
+		return createPipelinesInternal({ info });
+	})));
+	return handle;
+}
+
+void PipelineManager::SetFallbackPipeline(PipelineHandle handle)
+{
+	m_fallbackPipeline = handle;
 }
 
 void PipelineManager::RecompilePipelines()
 {
-	for (PipelineInfo& info : m_pipelines)
+	// Let outstanding async work land first so it cannot overwrite the recompiled pipeline
+	for (PendingPipelines& pending : m_pendingPipelines)
 	{
-		vkDestroyPipeline(m_device, info.pipeline, nullptr);
+		landPipelines(pending);
+	}
+	m_pendingPipelines.clear();
 
-		info.pipeline = createPipelineInternal(info);
+	const std::vector<CompiledPipeline> pipelines = createPipelinesParallel(m_pipelines);
+
+	for (size_t i = 0; i < m_pipelines.size(); ++i)
+	{
+		PipelineInfo& info = m_pipelines[i];
+		if (pipelines[i].pipeline == VK_NULL_HANDLE)
+		{
+			LOG_CORE_ERROR("Failed to recompile pipeline, keeping previous: " + info.name);
+			continue;
+		}
+		replacePipeline(info, pipelines[i]);
 	}
 }
 
-VkPipeline PipelineManager::createPipelineInternal(PipelineInfo info)
+std::vector<PipelineManager::CompiledPipeline> PipelineManager::createPipelinesParallel(const std::vector<PipelineInfo>& infos)
 {
-	auto shaderLoadFunc = [this](const std::string& fileLoc)->VkShaderModule {
-		std::optional<VkShaderModule> shader = PipelineBuild::loadShaderModule(m_device, fileLoc.c_str());
-		assert(shader.has_value());
-		LOG_CORE_INFO("Shader successfully loaded" + fileLoc);
-		return shader.value();
-	};
+	const size_t workerCount = std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1U), infos.size());
+	if (workerCount <= 1)
+	{
+		return createPipelinesInternal(infos);
+	}
+
+	// Each worker compiles one contiguous batch, the pipeline cache is internally synchronised
+	const size_t batchSize = (infos.size() + workerCount - 1) / workerCount;
+	std::vector<std::future<std::vector<CompiledPipeline>>> batches;
+	for (size_t first = 0; first < infos.size(); first += batchSize)
+	{
+		const size_t last = std::min(first + batchSize, infos.size());
+		std::vector<PipelineInfo> batch(infos.begin() + first, infos.begin() + last);
+		batches.push_back(std::async(std::launch::async, [this, batch = std::move(batch)]() {
+			return createPipelinesInternal(batch);
+		}));
+	}
+
+	std::vector<CompiledPipeline> pipelines;
+	pipelines.reserve(infos.size());
+	for (auto& batch : batches)
+	{
+		const std::vector<CompiledPipeline> batchPipelines = batch.get();
+		pipelines.insert(pipelines.end(), batchPipelines.begin(), batchPipelines.end());
+	}
+	return pipelines;
+}
+
+std::vector<PipelineManager::CompiledPipeline> PipelineManager::createPipelinesInternal(const std::vector<PipelineInfo>& infos)
+{
+	// May run on a worker thread, so failures are reported by the caller rather than logged here
+	std::vector<CompiledPipeline> pipelines(infos.size());
+	std::vector<PipelineBuild::BuildInfo> buildInfos;
+	std::vector<size_t> buildIndices;
+	buildInfos.reserve(infos.size());
+
+	for (size_t i = 0; i < infos.size(); ++i)
+	{
+		const PipelineInfo& info = infos[i];
+
+		// Shared stages are only read and created once across every pipeline using them
+		const bool depthOnly = info.fragmentShader.empty();
+		const std::optional<VkShaderModule> vertexShader = m_shaderModules.Acquire(info.vertexShader);
+		const std::optional<VkShaderModule> fragShader = depthOnly ? std::nullopt : m_shaderModules.Acquire(info.fragmentShader);
+		pipelines[i].vertexModule = vertexShader.value_or(VK_NULL_HANDLE);
+		pipelines[i].fragmentModule = fragShader.value_or(VK_NULL_HANDLE);
+		if (!vertexShader.has_value() || (!depthOnly && !fragShader.has_value()))
+		{
+			continue;
+		}
 
-	VkShaderModule vertexShader = shaderLoadFunc(info.vertexShader);
-	VkShaderModule fragShader = shaderLoadFunc(info.fragmentShader);
-
-	VkPipelineVertexInputStateCreateInfo vertexInputInfo = VulkanInit::vertexInputStateCreateInfo();;
-	vertexInputInfo.pVertexAttributeDescriptions = info.vertexInputDesc.attributes.data();
-	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(info.vertexInputDesc.attributes.size());
-	vertexInputInfo.pVertexBindingDescriptions = info.vertexInputDesc.bindings.data();
-	vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(info.vertexInputDesc.bindings.size());
-
-	PipelineBuild::BuildInfo buildInfo{
-		.colorBlendAttachment = VulkanInit::colorBlendAttachmentState(),
-		.depthStencil = VulkanInit::depthStencilStateCreateInfo(true, info.enableDepthWrite),
-		.pipelineLayout = info.pipelineLayout,
-		.rasterizer = VulkanInit::rasterizationStateCreateInfo(VK_POLYGON_MODE_FILL),
-		.shaderStages = {VulkanInit::pipelineShaderStageCreateInfo(VK_SHADER_STAGE_VERTEX_BIT, vertexShader),
-					VulkanInit::pipelineShaderStageCreateInfo(VK_SHADER_STAGE_FRAGMENT_BIT, fragShader)},
-		.vertexInputInfo = vertexInputInfo,
-		.colorAttachmentFormats = {info.colourFormat},
-		.depthAttachmentFormat = {info.depthFormat}
+		std::vector<VkPipelineShaderStageCreateInfo> shaderStages = { VulkanInit::pipelineShaderStageCreateInfo(VK_SHADER_STAGE_VERTEX_BIT, vertexShader.value()) };
+		if (!depthOnly)
+		{
+			shaderStages.push_back(VulkanInit::pipelineShaderStageCreateInfo(VK_SHADER_STAGE_FRAGMENT_BIT, fragShader.value()));
+		}
+
+		std::vector<VkFormat> colourFormats;
+		if (info.colourFormat != VK_FORMAT_UNDEFINED)
+		{
+			colourFormats.push_back(info.colourFormat);
+		}
+
+		VkPipelineVertexInputStateCreateInfo vertexInputInfo = VulkanInit::vertexInputStateCreateInfo();;
+		vertexInputInfo.pVertexAttributeDescriptions = info.vertexInputDesc.attributes.data();
+		vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(info.vertexInputDesc.attributes.size());
+		vertexInputInfo.pVertexBindingDescriptions = info.vertexInputDesc.bindings.data();
+		vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(info.vertexInputDesc.bindings.size());
+
+		buildInfos.push_back(PipelineBuild::BuildInfo{
+			.colorBlendAttachment = VulkanInit::colorBlendAttachmentState(),
+			.depthStencil = VulkanInit::depthStencilStateCreateInfo(true, info.enableDepthWrite, info.depthCompareOp),
+			.pipelineLayout = info.pipelineLayout,
+			.rasterizer = VulkanInit::rasterizationStateCreateInfo(VK_POLYGON_MODE_FILL),
+			.shaderStages = std::move(shaderStages),
+			.vertexInputInfo = vertexInputInfo,
+			.colorAttachmentFormats = std::move(colourFormats),
+			.depthAttachmentFormat = {info.depthFormat}
+		});
+		buildIndices.push_back(i);
+	}
+
+	const std::vector<VkPipeline> built = PipelineBuild::BuildPipelines(m_device, buildInfos, m_pipelineCache);
+	for (size_t i = 0; i < built.size(); ++i)
+	{
+		pipelines[buildIndices[i]].pipeline = built[i];
+	}
+
+	// Failed pipelines hold no references
+	for (CompiledPipeline& compiled : pipelines)
+	{
+		if (compiled.pipeline == VK_NULL_HANDLE)
+		{
+			destroyCompiledPipeline(compiled);
+			compiled = CompiledPipeline{};
+		}
+	}
+	return pipelines;
+}
+
+void PipelineManager::loadPipelineCache()
+{
+	std::vector<char> cacheData;
+
+	std::ifstream file(PIPELINE_CACHE_FILE, std::ios::ate | std::ios::binary);
+	if (file.is_open())
+	{
+		const size_t fileSize = static_cast<size_t>(file.tellg());
+		PipelineCacheHeader header{};
+		file.seekg(0);
+		if (fileSize >= sizeof(PipelineCacheHeader) && file.read(reinterpret_cast<char*>(&header), sizeof(PipelineCacheHeader)))
+		{
+			const bool valid = header.magic == PIPELINE_CACHE_MAGIC
+				&& header.version == PIPELINE_CACHE_VERSION
+				&& header.vendorID == m_gpuProperties.vendorID
+				&& header.deviceID == m_gpuProperties.deviceID
+				&& header.driverVersion == m_gpuProperties.driverVersion
+				&& memcmp(header.pipelineCacheUUID, m_gpuProperties.pipelineCacheUUID, VK_UUID_SIZE) == 0
+				&& header.dataSize == fileSize - sizeof(PipelineCacheHeader);
+
+			if (valid)
+			{
+				cacheData.resize(header.dataSize);
+				if (!file.read(cacheData.data(), cacheData.size()))
+				{
+					cacheData.clear();
+				}
+			}
+			else
+			{
+				LOG_CORE_WARN("Pipeline cache does not match device or driver, discarding.");
+			}
+		}
+	}
+
+	const VkPipelineCacheCreateInfo cacheInfo{
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.initialDataSize = cacheData.size(),
+		.pInitialData = cacheData.empty() ? nullptr : cacheData.data(),
 	};
 
-	VkPipeline pipeline = PipelineBuild::BuildPipeline(m_device, buildInfo);
+	// Drivers reject incompatible blobs, in which case start with an empty cache
+	if (vkCreatePipelineCache(m_device, &cacheInfo, nullptr, &m_pipelineCache) != VK_SUCCESS)
+	{
+		const VkPipelineCacheCreateInfo emptyCacheInfo{
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+		};
+		VK_CHECK(vkCreatePipelineCache(m_device, &emptyCacheInfo, nullptr, &m_pipelineCache));
+	}
+	else if (!cacheData.empty())
+	{
+		LOG_CORE_INFO("Pipeline cache loaded.");
+	}
+}
 
-	vkDestroyShaderModule(m_device, vertexShader, nullptr);
-	vkDestroyShaderModule(m_device, fragShader, nullptr);
-	return pipeline;
+void PipelineManager::savePipelineCache()
+{
+	size_t dataSize = 0;
+	if (vkGetPipelineCacheData(m_device, m_pipelineCache, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0)
+	{
+		return;
+	}
+
+	std::vector<char> cacheData(dataSize);
+	if (vkGetPipelineCacheData(m_device, m_pipelineCache, &dataSize, cacheData.data()) != VK_SUCCESS)
+	{
+		return;
+	}
+
+	PipelineCacheHeader header{
+		.magic = PIPELINE_CACHE_MAGIC,
+		.version = PIPELINE_CACHE_VERSION,
+		.vendorID = m_gpuProperties.vendorID,
+		.deviceID = m_gpuProperties.deviceID,
+		.driverVersion = m_gpuProperties.driverVersion,
+		.dataSize = dataSize,
+	};
+	memcpy(header.pipelineCacheUUID, m_gpuProperties.pipelineCacheUUID, VK_UUID_SIZE);
+
+	std::ofstream file(PIPELINE_CACHE_FILE, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		LOG_CORE_WARN("Failed to write pipeline cache.");
+		return;
+	}
+	file.write(reinterpret_cast<const char*>(&header), sizeof(PipelineCacheHeader));
+	file.write(cacheData.data(), dataSize);
 }
@@ -3,9 +3,16 @@
 #include <vulkan/vulkan.h>
 #include <vector>
 #include <string>
+#include <future>
+#include <optional>
+
+#include "Runic/Graphics/Internal/ShaderModuleCache.h"
+#include "Runic/Graphics/Internal/ShaderWatcher.h"
 
 namespace Runic
 {
+	class RetireQueue;
+
 	typedef uint32_t PipelineHandle;
 
 	struct VertexInputDescription
@@ -19,33 +26,105 @@ namespace Runic
 	{
 		std::string name;
 		VkPipeline pipeline{};
+		VkShaderModule vertexModule{};
+		VkShaderModule fragmentModule{};
 		VkPipelineLayout pipelineLayout{};
 
 		std::string vertexShader;
-		std::string fragmentShader;
+		std::string fragmentShader;		// Empty for depth only pipelines
 
 		VertexInputDescription vertexInputDesc;
 		bool enableDepthWrite{ true };
-		VkFormat colourFormat;
+		VkCompareOp depthCompareOp{ VK_COMPARE_OP_LESS_OR_EQUAL };
+		VkFormat colourFormat;			// VK_FORMAT_UNDEFINED for no colour attachment
 		VkFormat depthFormat;
 	};
 
 	class PipelineManager
 	{
 	public:
-		PipelineManager(VkDevice device) : m_device(device) {}
+		PipelineManager(VkDevice device, const VkPhysicalDeviceProperties& gpuProperties, RetireQueue* retireQueue);
 		void Deinit();
+
+		/*
+		Swaps in pipelines finished by async creation or hot reload. Call once per frame at a frame boundary.
+		*/
+		void Update();
+
+		/*
+		Watches the GLSL sources in a folder, recompiling changed files to SPIR-V in the background and
+		rebuilding only the pipelines that use them.
+		*/
+		void EnableHotReload(const std::string& shaderSourceFolder);
+
+		/*
+		Returns the fallback pipeline while an async pipeline is still compiling.
+		*/
 		VkPipeline GetPipeline(PipelineHandle handle);
+		bool IsPipelineReady(PipelineHandle handle) const;
 		VkPipelineLayout CreatePipelineLayout(std::vector<VkDescriptorSetLayout> descLayouts,
 			std::vector<VkPushConstantRange> pushConstants);
 		PipelineHandle CreatePipeline(PipelineInfo info);
+
+		/*
+		Compiles all pipelines together, split across worker threads.
+		*/
+		std::vector<PipelineHandle> CreatePipelines(const std::vector<PipelineInfo>& infos);
+
+		/*
+		Returns a handle straight away and compiles on a worker thread. Until Update() swaps the result in,
+		GetPipeline returns the fallback pipeline, which should share the same pipeline layout.
+		*/
+		PipelineHandle CreatePipelineAsync(PipelineInfo info);
+		void SetFallbackPipeline(PipelineHandle handle);
 		void RecompilePipelines();
+
+		ShaderModuleCache::Stats GetShaderModuleStats() { return m_shaderModules.GetStats(); }
 	private:
-		VkPipeline createPipelineInternal(PipelineInfo info);
+		struct CompiledPipeline
+		{
+			VkPipeline pipeline{ VK_NULL_HANDLE };
+			VkShaderModule vertexModule{ VK_NULL_HANDLE };
+			VkShaderModule fragmentModule{ VK_NULL_HANDLE };
+		};
+
+		struct PendingPipelines
+		{
+			std::vector<PipelineHandle> handles;
+			std::vector<uint32_t> generations;		// Generation of each handle when the batch was queued
+			std::future<std::vector<CompiledPipeline>> result;
+		};
+
+		void pollShaderChanges();
+		PendingPipelines queuePipelines(std::vector<PipelineHandle> handles, std::future<std::vector<CompiledPipeline>> result);
+		void landPipelines(PendingPipelines& pending);
+		void replacePipeline(PipelineInfo& info, const CompiledPipeline& compiled);
+		void destroyCompiledPipeline(const CompiledPipeline& compiled);
+		std::vector<CompiledPipeline> createPipelinesInternal(const std::vector<PipelineInfo>& infos);
+		std::vector<CompiledPipeline> createPipelinesParallel(const std::vector<PipelineInfo>& infos);
+
+		void loadPipelineCache();
+		void savePipelineCache();
+
 		const VkDevice m_device;
+		const VkPhysicalDeviceProperties m_gpuProperties;
+		RetireQueue* const m_retireQueue;
+		VkPipelineCache m_pipelineCache{ VK_NULL_HANDLE };
+		ShaderModuleCache m_shaderModules;
 		std::string m_sourceFolder;
 		std::vector<VkPipelineLayout> m_pipelineLayouts;
 		std::vector<PipelineInfo> m_pipelines;
+		std::vector<uint32_t> m_pipelineGenerations;	// Bumped per handle whenever a newer compile is queued
+		std::vector<PendingPipelines> m_pendingPipelines;
+		std::optional<PipelineHandle> m_fallbackPipeline;
+
+		struct ShaderCompile
+		{
+			std::string spirvFile;
+			std::future<bool> result;
+		};
+		ShaderWatcher m_shaderWatcher;
+		bool m_hotReload{ false };
+		std::vector<ShaderCompile> m_shaderCompiles;
 	};
 }
-
@@ -0,0 +1,613 @@
+#include "Runic/Graphics/Internal/RenderGraph.h"
+
+#include <Tracy.hpp>
+
+#include <algorithm>
+#include <cassert>
+
+#include "Runic/Graphics/Device.h"
+#include "Runic/Graphics/Internal/GpuProfiler.h"
+#include "Runic/Graphics/Internal/VulkanInit.h"
+#include "Runic/Log.h"
+
+using namespace Runic;
+
+namespace
+{
+	constexpr uint32_t NO_PASS = ~0U;
+
+	constexpr VkAccessFlags2 WRITE_ACCESS =
+		VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT |
+		VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+		VK_ACCESS_2_SHADER_WRITE_BIT |
+		VK_ACCESS_2_TRANSFER_WRITE_BIT |
+		VK_ACCESS_2_MEMORY_WRITE_BIT;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::Color(RenderGraphImage image, VkAttachmentLoadOp loadOp, VkClearColorValue clear)
+{
+	return use(image, USAGE_COLOR, loadOp, VkClearValue{ .color = clear });
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::Depth(RenderGraphImage image, VkAttachmentLoadOp loadOp, float clearDepth)
+{
+	return use(image, USAGE_DEPTH_WRITE, loadOp, VkClearValue{ .depthStencil = { .depth = clearDepth } });
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::DepthTest(RenderGraphImage image)
+{
+	return use(image, USAGE_DEPTH_READ, VK_ATTACHMENT_LOAD_OP_LOAD, VkClearValue{});
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::Sample(RenderGraphImage image)
+{
+	return use(image, USAGE_SAMPLED, VK_ATTACHMENT_LOAD_OP_LOAD, VkClearValue{});
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::RenderingFlags(VkRenderingFlags flags)
+{
+	m_graph.m_passes[m_pass].renderingFlags = flags;
+	return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::RenderArea(VkExtent2D extent)
+{
+	m_graph.m_passes[m_pass].renderArea = extent;
+	return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::External()
+{
+	m_graph.m_passes[m_pass].external = true;
+	return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::SideEffects()
+{
+	m_graph.m_passes[m_pass].sideEffects = true;
+	return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::use(RenderGraphImage image, Usage usage, VkAttachmentLoadOp loadOp, VkClearValue clear)
+{
+	Pass& pass = m_graph.m_passes[m_pass];
+	assert(image.IsValid() && pass.useCount < MAX_PASS_IMAGES);
+	pass.uses[pass.useCount++] = ImageUse{ .image = image.index, .usage = usage, .loadOp = loadOp, .clear = clear };
+	return *this;
+}
+
+void RenderGraph::Init(Device* device)
+{
+	m_device = device;
+	m_vkDevice = device->m_device;
+	m_allocator = device->GetAllocator();
+}
+
+void RenderGraph::Deinit()
+{
+	Reset();
+	destroyPhysical();
+}
+
+void RenderGraph::Reset()
+{
+	for (const Pass& pass : m_passes)
+	{
+		pass.execute.destroy(pass.execute.object);
+	}
+	m_passes.clear();
+	m_images.clear();
+	m_callableMemory.Reset();
+}
+
+RenderGraphImage RenderGraph::Import(const char* name, const ImportedImageDesc& desc)
+{
+	m_images.push_back(Image{
+		.name = name,
+		.imported = true,
+		.importDesc = desc,
+		.image = desc.image,
+		.imageView = desc.imageView,
+		.aspect = desc.aspect,
+		.extent = desc.extent,
+		.format = desc.format,
+		.state = { .stage = desc.initialStage, .access = VK_ACCESS_2_NONE, .layout = desc.initialLayout },
+	});
+	return RenderGraphImage{ .index = static_cast<uint32_t>(m_images.size() - 1U) };
+}
+
+RenderGraphImage RenderGraph::CreateTransient(const char* name, const TransientImageDesc& desc)
+{
+	m_images.push_back(Image{
+		.name = name,
+		.imported = false,
+		.transientDesc = desc,
+		.aspect = static_cast<VkImageAspectFlags>(desc.depth ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT),
+		.extent = desc.extent,
+		.format = desc.format,
+	});
+	return RenderGraphImage{ .index = static_cast<uint32_t>(m_images.size() - 1U) };
+}
+
+RenderGraph::PassBuilder RenderGraph::addPass(const char* name, const Callback& execute)
+{
+	m_passes.push_back(Pass{ .name = name, .execute = execute, .useCount = 0U });
+	return PassBuilder(*this, static_cast<uint32_t>(m_passes.size() - 1U));
+}
+
+VkImage RenderGraph::GetImage(RenderGraphImage image) const
+{
+	return m_images[image.index].image;
+}
+
+VkImageView RenderGraph::GetImageView(RenderGraphImage image) const
+{
+	return m_images[image.index].imageView;
+}
+
+bool RenderGraph::Execute(VkCommandBuffer cmd)
+{
+	ZoneScoped;
+
+	cull();
+	computeLifetimes();
+	const bool placed = placeTransients();
+
+	m_stats.passes = 0U;
+	m_stats.culledPasses = 0U;
+	m_stats.barriers = 0U;
+	for (Pass& pass : m_passes)
+	{
+		if (placed && pass.live)
+		{
+			recordPass(cmd, pass);
+			++m_stats.passes;
+		}
+		else
+		{
+			++m_stats.culledPasses;
+		}
+	}
+
+	// Imported images are handed back in the layout their owner expects
+	m_barriers.clear();
+	for (Image& image : m_images)
+	{
+		if (!image.imported || image.importDesc.finalLayout == VK_IMAGE_LAYOUT_UNDEFINED || image.importDesc.finalLayout == image.state.layout)
+		{
+			continue;
+		}
+		m_barriers.push_back(VkImageMemoryBarrier2{
+			.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+			.srcStageMask = image.state.stage,
+			.srcAccessMask = image.state.access & WRITE_ACCESS,
+			.dstStageMask = VK_PIPELINE_STAGE_2_NONE,
+			.dstAccessMask = VK_ACCESS_2_NONE,
+			.oldLayout = image.state.layout,
+			.newLayout = image.importDesc.finalLayout,
+			.image = image.image,
+			.subresourceRange = { .aspectMask = image.aspect, .levelCount = VK_REMAINING_MIP_LEVELS, .layerCount = VK_REMAINING_ARRAY_LAYERS },
+		});
+		image.state = ImageState{ .stage = VK_PIPELINE_STAGE_2_NONE, .access = VK_ACCESS_2_NONE, .layout = image.importDesc.finalLayout };
+	}
+	if (!m_barriers.empty())
+	{
+		const VkDependencyInfo dependency{
+			.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+			.imageMemoryBarrierCount = static_cast<uint32_t>(m_barriers.size()),
+			.pImageMemoryBarriers = m_barriers.data(),
+		};
+		vkCmdPipelineBarrier2(cmd, &dependency);
+		m_stats.barriers += static_cast<uint32_t>(m_barriers.size());
+	}
+	return placed;
+}
+
+void RenderGraph::cull()
+{
+	// Imported images are seen outside the graph, transients only matter if a later live pass reads them
+	for (Image& image : m_images)
+	{
+		image.needed = image.imported;
+	}
+
+	for (auto pass = m_passes.rbegin(); pass != m_passes.rend(); ++pass)
+	{
+		pass->live = pass->sideEffects;
+		for (uint32_t i = 0; i < pass->useCount && !pass->live; ++i)
+		{
+			const ImageUse& use = pass->uses[i];
+			const bool writes = use.usage == USAGE_COLOR || use.usage == USAGE_DEPTH_WRITE;
+			pass->live = writes && m_images[use.image].needed;
+		}
+		if (!pass->live)
+		{
+			continue;
+		}
+
+		// Overwritten contents aren't needed from earlier passes, anything read or loaded is
+		for (uint32_t i = 0; i < pass->useCount; ++i)
+		{
+			const ImageUse& use = pass->uses[i];
+			Image& image = m_images[use.image];
+			if ((use.usage == USAGE_COLOR || use.usage == USAGE_DEPTH_WRITE) && use.loadOp != VK_ATTACHMENT_LOAD_OP_LOAD && !image.imported)
+			{
+				image.needed = false;
+			}
+		}
+		for (uint32_t i = 0; i < pass->useCount; ++i)
+		{
+			const ImageUse& use = pass->uses[i];
+			if (use.usage == USAGE_SAMPLED || use.usage == USAGE_DEPTH_READ || use.loadOp == VK_ATTACHMENT_LOAD_OP_LOAD)
+			{
+				m_images[use.image].needed = true;
+			}
+		}
+	}
+}
+
+void RenderGraph::computeLifetimes()
+{
+	for (Image& image : m_images)
+	{
+		image.firstPass = NO_PASS;
+		image.lastPass = NO_PASS;
+	}
+
+	for (uint32_t passIndex = 0; passIndex < m_passes.size(); ++passIndex)
+	{
+		const Pass& pass = m_passes[passIndex];
+		if (!pass.live)
+		{
+			continue;
+		}
+		for (uint32_t i = 0; i < pass.useCount; ++i)
+		{
+			Image& image = m_images[pass.uses[i].image];
+			image.firstPass = std::min(image.firstPass, passIndex);
+			image.lastPass = image.lastPass == NO_PASS ? passIndex : std::max(image.lastPass, passIndex);
+		}
+	}
+}
+
+bool RenderGraph::placeTransients()
+{
+	ZoneScoped;
+
+	m_frameKeys.clear();
+	for (const Image& image : m_images)
+	{
+		if (!image.imported && image.firstPass != NO_PASS)
+		{
+			m_frameKeys.push_back(TransientKey{ .desc = image.transientDesc, .firstPass = image.firstPass, .lastPass = image.lastPass });
+		}
+	}
+
+	// Usually the same frame as last time, so the existing images are reused as they are
+	if (m_frameKeys != m_transientKeys)
+	{
+		destroyPhysical();
+		m_transientKeys = m_frameKeys;
+
+		std::vector<VkImageCreateInfo> createInfos;
+		std::vector<VkMemoryRequirements> requirements;
+		for (const TransientKey& key : m_transientKeys)
+		{
+			const VkImageUsageFlags attachmentUsage = key.desc.depth ? VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT : VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+			createInfos.push_back(VulkanInit::imageCreateInfo(key.desc.format, attachmentUsage | key.desc.usage, VkExtent3D{ key.desc.extent.width, key.desc.extent.height, 1U }));
+
+			const VkDeviceImageMemoryRequirements requirementsInfo{
+				.sType = VK_STRUCTURE_TYPE_DEVICE_IMAGE_MEMORY_REQUIREMENTS,
+				.pCreateInfo = &createInfos.back(),
+			};
+			VkMemoryRequirements2 imageRequirements{ .sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2 };
+			vkGetDeviceImageMemoryRequirements(m_vkDevice, &requirementsInfo, &imageRequirements);
+			requirements.push_back(imageRequirements.memoryRequirements);
+		}
+
+		// Greedy by first use: each transient goes in the best fitting memory whose previous occupant is done with it
+		struct Group
+		{
+			VkMemoryRequirements requirements;
+			uint32_t lastPass;
+		};
+		std::vector<Group> groups;
+		std::vector<uint32_t> order(m_transientKeys.size());
+		for (uint32_t i = 0; i < order.size(); ++i)
+		{
+			order[i] = i;
+		}
+		std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return m_transientKeys[a].firstPass < m_transientKeys[b].firstPass; });
+
+		std::vector<uint32_t> placement(m_transientKeys.size());
+		m_stats.unaliasedBytes = 0U;
+		for (const uint32_t transient : order)
+		{
+			const VkMemoryRequirements& required = requirements[transient];
+			m_stats.unaliasedBytes += required.size;
+
+			uint32_t best = NO_PASS;
+			for (uint32_t group = 0; group < groups.size(); ++group)
+			{
+				const Group& candidate = groups[group];
+				if (candidate.lastPass >= m_transientKeys[transient].firstPass || (candidate.requirements.memoryTypeBits & required.memoryTypeBits) == 0U)
+				{
+					continue;
+				}
+				// Smallest memory that already fits, otherwise the largest, which grows least
+				if (best == NO_PASS)
+				{
+					best = group;
+					continue;
+				}
+				const VkDeviceSize bestSize = groups[best].requirements.size;
+				const VkDeviceSize size = candidate.requirements.size;
+				const bool fits = size >= required.size;
+				const bool bestFits = bestSize >= required.size;
+				if ((fits && (!bestFits || size < bestSize)) || (!fits && !bestFits && size > bestSize))
+				{
+					best = group;
+				}
+			}
+
+			if (best == NO_PASS)
+			{
+				groups.push_back(Group{ .requirements = required, .lastPass = m_transientKeys[transient].lastPass });
+				best = static_cast<uint32_t>(groups.size() - 1U);
+			}
+			else
+			{
+				VkMemoryRequirements& groupRequirements = groups[best].requirements;
+				groupRequirements.size = std::max(groupRequirements.size, required.size);
+				groupRequirements.alignment = std::max(groupRequirements.alignment, required.alignment);
+				groupRequirements.memoryTypeBits &= required.memoryTypeBits;
+				groups[best].lastPass = m_transientKeys[transient].lastPass;
+			}
+			placement[transient] = best;
+		}
+
+		const VmaAllocationCreateInfo allocInfo{
+			.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		};
+		m_stats.transientBytes = 0U;
+		for (const Group& group : groups)
+		{
+			PhysicalMemory memory{
+				.size = group.requirements.size,
+				.state = { .stage = VK_PIPELINE_STAGE_2_NONE, .access = VK_ACCESS_2_NONE, .layout = VK_IMAGE_LAYOUT_UNDEFINED },
+			};
+			if (vmaAllocateMemory(m_allocator, &group.requirements, &allocInfo, &memory.allocation, nullptr) != VK_SUCCESS)
+			{
+				// Nothing is bound to a partial placement, the next frame tries again from scratch
+				LOG_CORE_ERROR("Failed to allocate render graph transient memory.");
+				destroyPhysical();
+				m_stats.transientBytes = 0U;
+				m_stats.transientImages = 0U;
+				return false;
+			}
+			m_physicalMemory.push_back(memory);
+			m_stats.transientBytes += group.requirements.size;
+		}
+
+		for (uint32_t i = 0; i < m_transientKeys.size(); ++i)
+		{
+			const TransientKey& key = m_transientKeys[i];
+			PhysicalImage physical{ .desc = key.desc, .memory = placement[i] };
+			vkCreateImage(m_vkDevice, &createInfos[i], nullptr, &physical.image);
+			vmaBindImageMemory(m_allocator, m_physicalMemory[physical.memory].allocation, physical.image);
+
+			const VkImageViewCreateInfo viewInfo = VulkanInit::imageViewCreateInfo(key.desc.format, physical.image, key.desc.depth ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT);
+			vkCreateImageView(m_vkDevice, &viewInfo, nullptr, &physical.imageView);
+			m_physicalImages.push_back(physical);
+		}
+		m_stats.transientImages = static_cast<uint32_t>(m_physicalImages.size());
+	}
+
+	uint32_t physical = 0U;
+	for (Image& image : m_images)
+	{
+		if (!image.imported && image.firstPass != NO_PASS)
+		{
+			image.physical = physical;
+			image.image = m_physicalImages[physical].image;
+			image.imageView = m_physicalImages[physical].imageView;
+			++physical;
+		}
+	}
+	return true;
+}
+
+void RenderGraph::destroyPhysical()
+{
+	// Frames in flight may still be using them
+	RetireQueue& retireQueue = m_device->m_retireQueue;
+	for (const PhysicalImage& physical : m_physicalImages)
+	{
+		retireQueue.RetireImageView(physical.imageView);
+		retireQueue.RetireVkImage(physical.image);
+	}
+	for (const PhysicalMemory& memory : m_physicalMemory)
+	{
+		if (memory.allocation != VK_NULL_HANDLE)
+		{
+			retireQueue.RetireAllocation(memory.allocation);
+		}
+	}
+	m_physicalImages.clear();
+	m_physicalMemory.clear();
+	m_transientKeys.clear();
+}
+
+RenderGraph::ImageState RenderGraph::requiredState(const ImageUse& use) const
+{
+	switch (use.usage)
+	{
+	case USAGE_COLOR:
+		return ImageState{
+			.stage = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+			.access = VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT | (use.loadOp == VK_ATTACHMENT_LOAD_OP_LOAD ? VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT : VK_ACCESS_2_NONE),
+			.layout = VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL,
+		};
+	case USAGE_DEPTH_WRITE:
+		return ImageState{
+			.stage = VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+			.access = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+			.layout = VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL,
+		};
+	case USAGE_DEPTH_READ:
+		return ImageState{
+			.stage = VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+			.access = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
+			.layout = VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL,
+		};
+	case USAGE_SAMPLED:
+	default:
+		return ImageState{
+			.stage = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+			.access = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+			.layout = VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL,
+		};
+	}
+}
+
+void RenderGraph::recordPass(VkCommandBuffer cmd, Pass& pass)
+{
+	const uint32_t passIndex = static_cast<uint32_t>(&pass - m_passes.data());
+	const GpuZone zone(m_device->m_gpuProfiler, cmd, pass.name);
+
+	// Uses of one image within the pass are combined into a single state
+	std::array<uint32_t, MAX_PASS_IMAGES> images{};
+	std::array<ImageState, MAX_PASS_IMAGES> states{};
+	uint32_t imageCount = 0U;
+	for (uint32_t i = 0; i < pass.useCount; ++i)
+	{
+		const ImageState required = requiredState(pass.uses[i]);
+		uint32_t slot = 0U;
+		while (slot < imageCount && images[slot] != pass.uses[i].image)
+		{
+			++slot;
+		}
+		if (slot == imageCount)
+		{
+			images[imageCount] = pass.uses[i].image;
+			states[imageCount++] = required;
+			continue;
+		}
+		assert(states[slot].layout == required.layout && "An image is used in two layouts by one pass");
+		states[slot].stage |= required.stage;
+		states[slot].access |= required.access;
+	}
+
+	m_barriers.clear();
+	for (uint32_t i = 0; i < imageCount; ++i)
+	{
+		Image& image = m_images[images[i]];
+		const ImageState& next = states[i];
+
+		// A transient's first use follows whatever last used its memory, its contents are undefined
+		ImageState previous = image.state;
+		if (!image.imported && passIndex == image.firstPass)
+		{
+			previous = m_physicalMemory[m_physicalImages[image.physical].memory].state;
+			previous.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		}
+
+		const bool transition = previous.layout != next.layout;
+		const bool hazard = (previous.access & WRITE_ACCESS) != 0U || ((next.access & WRITE_ACCESS) != 0U && previous.stage != VK_PIPELINE_STAGE_2_NONE);
+		if (transition || hazard)
+		{
+			m_barriers.push_back(VkImageMemoryBarrier2{
+				.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+				.srcStageMask = previous.stage,
+				.srcAccessMask = previous.access & WRITE_ACCESS,
+				.dstStageMask = next.stage,
+				.dstAccessMask = next.access,
+				.oldLayout = previous.layout,
+				.newLayout = next.layout,
+				.image = image.image,
+				.subresourceRange = { .aspectMask = image.aspect, .levelCount = VK_REMAINING_MIP_LEVELS, .layerCount = VK_REMAINING_ARRAY_LAYERS },
+			});
+			image.state = next;
+		}
+		else
+		{
+			// Reads after reads in the same layout need nothing, a later write has to wait for all of them
+			image.state = ImageState{ .stage = previous.stage | next.stage, .access = previous.access | next.access, .layout = next.layout };
+		}
+
+		if (!image.imported)
+		{
+			m_physicalMemory[m_physicalImages[image.physical].memory].state = image.state;
+		}
+	}
+
+	if (!m_barriers.empty())
+	{
+		const VkDependencyInfo dependency{
+			.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+			.imageMemoryBarrierCount = static_cast<uint32_t>(m_barriers.size()),
+			.pImageMemoryBarriers = m_barriers.data(),
+		};
+		vkCmdPipelineBarrier2(cmd, &dependency);
+		m_stats.barriers += static_cast<uint32_t>(m_barriers.size());
+	}
+
+	if (pass.external)
+	{
+		pass.execute.invoke(pass.execute.object, cmd);
+		return;
+	}
+
+	std::array<VkRenderingAttachmentInfo, MAX_PASS_IMAGES> colorAttachments{};
+	uint32_t colorCount = 0U;
+	VkRenderingAttachmentInfo depthAttachment{};
+	bool hasDepth = false;
+	VkExtent2D extent{};
+	for (uint32_t i = 0; i < pass.useCount; ++i)
+	{
+		const ImageUse& use = pass.uses[i];
+		if (use.usage == USAGE_SAMPLED)
+		{
+			continue;
+		}
+
+		const Image& image = m_images[use.image];
+		// Nothing reads a transient after its last pass, so it needn't be written back
+		const bool discard = !image.imported && image.lastPass == passIndex;
+		const VkRenderingAttachmentInfo attachment{
+			.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
+			.imageView = image.imageView,
+			.imageLayout = requiredState(use).layout,
+			.loadOp = use.loadOp,
+			.storeOp = use.usage == USAGE_DEPTH_READ ? VK_ATTACHMENT_STORE_OP_NONE : (discard ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE),
+			.clearValue = use.clear,
+		};
+		if (use.usage == USAGE_COLOR)
+		{
+			colorAttachments[colorCount++] = attachment;
+		}
+		else
+		{
+			depthAttachment = attachment;
+			hasDepth = true;
+		}
+		extent = image.extent;
+	}
+	if (pass.renderArea.width != 0U)
+	{
+		extent = pass.renderArea;
+	}
+
+	const VkRenderingInfo renderInfo{
+		.sType = VK_STRUCTURE_TYPE_RENDERING_INFO,
+		.flags = pass.renderingFlags,
+		.renderArea = { .offset = { 0, 0 }, .extent = extent },
+		.layerCount = 1,
+		.colorAttachmentCount = colorCount,
+		.pColorAttachments = colorAttachments.data(),
+		.pDepthAttachment = hasDepth ? &depthAttachment : nullptr,
+	};
+	vkCmdBeginRendering(cmd, &renderInfo);
+	pass.execute.invoke(pass.execute.object, cmd);
+	vkCmdEndRendering(cmd);
+}
@@ -0,0 +1,277 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vk_mem_alloc.h>
+#include <array>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Runic/Structures/FrameArena.h"
+
+namespace Runic
+{
+	class Device;
+
+	constexpr uint32_t MAX_PASS_IMAGES = 8U;		// Images one pass may declare
+
+	/*
+	Image declared to the graph, only valid for the frame it was declared in
+	*/
+	struct RenderGraphImage
+	{
+		uint32_t index{ ~0U };
+		bool IsValid() const { return index != ~0U; }
+	};
+
+	/*
+	An image the graph does not own, such as the back buffer. Its state on entry is given by the initial fields,
+	it is left in finalLayout, or wherever its last use put it when finalLayout is UNDEFINED.
+	*/
+	struct ImportedImageDesc
+	{
+		VkImage image;
+		VkImageView imageView;
+		VkFormat format;
+		VkExtent2D extent;
+		VkImageAspectFlags aspect{ VK_IMAGE_ASPECT_COLOR_BIT };
+		VkImageLayout initialLayout{ VK_IMAGE_LAYOUT_UNDEFINED };
+		VkPipelineStageFlags2 initialStage{ VK_PIPELINE_STAGE_2_NONE };		// Stage a semaphore wait or earlier work made it available in
+		VkImageLayout finalLayout{ VK_IMAGE_LAYOUT_UNDEFINED };
+	};
+
+	/*
+	An image the graph allocates. Transients only live between their first and last use in a frame, transients
+	whose lifetimes don't overlap share memory.
+	*/
+	struct TransientImageDesc
+	{
+		VkFormat format;
+		VkExtent2D extent;
+		bool depth{ false };
+		VkImageUsageFlags usage{ 0U };	// On top of the attachment usage, e.g. SAMPLED
+
+		bool operator==(const TransientImageDesc& other) const
+		{
+			return format == other.format && extent.width == other.extent.width && extent.height == other.extent.height &&
+				depth == other.depth && usage == other.usage;
+		}
+	};
+
+	/*
+	*
+	* RenderGraph: Passes are declared each frame along with the images they read and write. Execute culls passes
+	*			   whose results are never used, places transient images in aliased memory, then records each pass
+	*			   behind one batched vkCmdPipelineBarrier2 holding only the transitions and hazards it needs.
+	*			   Passes with attachments are wrapped in dynamic rendering, external passes begin their own render
+	*			   pass and only get their images transitioned. Every pass is a GPU profiler zone.
+	*
+	*			   Sampled and read only depth images are in VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL, attachments are in
+	*			   VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL.
+	*
+	*/
+	class RenderGraph
+	{
+	private:
+		enum Usage : uint8_t
+		{
+			USAGE_COLOR,
+			USAGE_DEPTH_WRITE,
+			USAGE_DEPTH_READ,
+			USAGE_SAMPLED,
+		};
+	public:
+		class PassBuilder
+		{
+		public:
+			PassBuilder& Color(RenderGraphImage image, VkAttachmentLoadOp loadOp, VkClearColorValue clear = {});
+			PassBuilder& Depth(RenderGraphImage image, VkAttachmentLoadOp loadOp, float clearDepth = 1.0f);
+			/*
+			Depth attachment that is tested but not written
+			*/
+			PassBuilder& DepthTest(RenderGraphImage image);
+			PassBuilder& Sample(RenderGraphImage image);
+
+			PassBuilder& RenderingFlags(VkRenderingFlags flags);
+			/*
+			Renders to the top left of the attachments only, clears and stores included
+			*/
+			PassBuilder& RenderArea(VkExtent2D extent);
+			/*
+			The pass begins its own rendering, the graph only transitions its images
+			*/
+			PassBuilder& External();
+			/*
+			Never culled, for passes with effects the graph can't see
+			*/
+			PassBuilder& SideEffects();
+		private:
+			friend class RenderGraph;
+			PassBuilder(RenderGraph& graph, uint32_t pass) : m_graph(graph), m_pass(pass) {}
+
+			PassBuilder& use(RenderGraphImage image, Usage usage, VkAttachmentLoadOp loadOp, VkClearValue clear);
+
+			RenderGraph& m_graph;
+			const uint32_t m_pass;
+		};
+
+		struct Stats
+		{
+			uint32_t passes;
+			uint32_t culledPasses;
+			uint32_t barriers;
+			uint32_t transientImages;
+			VkDeviceSize transientBytes;		// Memory actually allocated
+			VkDeviceSize unaliasedBytes;		// What the transients would take without aliasing
+		};
+
+		void Init(Device* device);
+		void Deinit();
+
+		/*
+		Drops last frame's passes and images, call before declaring a frame
+		*/
+		void Reset();
+
+		RenderGraphImage Import(const char* name, const ImportedImageDesc& desc);
+		RenderGraphImage CreateTransient(const char* name, const TransientImageDesc& desc);
+
+		/*
+		The callable is copied into frame memory and called with the frame's command buffer from Execute
+		*/
+		template<typename F>
+		PassBuilder AddPass(const char* name, F&& execute)
+		{
+			using Callable = std::decay_t<F>;
+			void* memory = m_callableMemory.allocate(sizeof(Callable), alignof(Callable));
+			Callable* callable = new (memory) Callable(std::forward<F>(execute));
+			return addPass(name, Callback{
+				.object = callable,
+				.invoke = [](void* object, VkCommandBuffer cmd) { (*static_cast<Callable*>(object))(cmd); },
+				.destroy = [](void* object) { static_cast<Callable*>(object)->~Callable(); },
+			});
+		}
+
+		/*
+		Compiles and records the frame's passes into cmd, which must be outside of rendering. Returns false if
+		the transient images couldn't be allocated, then no passes are recorded and imported images are only
+		handed back in their final layout.
+		*/
+		bool Execute(VkCommandBuffer cmd);
+
+		/*
+		Valid inside the pass callbacks
+		*/
+		VkImage GetImage(RenderGraphImage image) const;
+		VkImageView GetImageView(RenderGraphImage image) const;
+
+		const Stats& GetStats() const { return m_stats; }
+	private:
+		struct ImageState
+		{
+			VkPipelineStageFlags2 stage;
+			VkAccessFlags2 access;
+			VkImageLayout layout;
+		};
+
+		struct Callback
+		{
+			void* object;
+			void (*invoke)(void* object, VkCommandBuffer cmd);
+			void (*destroy)(void* object);
+		};
+
+		struct ImageUse
+		{
+			uint32_t image;
+			Usage usage;
+			VkAttachmentLoadOp loadOp;
+			VkClearValue clear;
+		};
+
+		struct Pass
+		{
+			const char* name;
+			Callback execute;
+			std::array<ImageUse, MAX_PASS_IMAGES> uses;
+			uint32_t useCount;
+			VkRenderingFlags renderingFlags;
+			VkExtent2D renderArea;		// Zero for the whole attachment
+			bool external;
+			bool sideEffects;
+			bool live;
+		};
+
+		struct Image
+		{
+			const char* name;
+			bool imported;
+			ImportedImageDesc importDesc;
+			TransientImageDesc transientDesc;
+			VkImage image;
+			VkImageView imageView;
+			VkImageAspectFlags aspect;
+			VkExtent2D extent;
+			VkFormat format;
+			ImageState state;
+			uint32_t physical;		// Transients only
+			uint32_t firstPass;
+			uint32_t lastPass;
+			bool needed;
+		};
+
+		/*
+		Transient images and the aliased memory behind them persist between frames and are only rebuilt when the
+		frame's transients or their lifetimes change
+		*/
+		struct PhysicalImage
+		{
+			TransientImageDesc desc;
+			uint32_t memory;
+			VkImage image;
+			VkImageView imageView;
+		};
+
+		struct PhysicalMemory
+		{
+			VmaAllocation allocation;
+			VkDeviceSize size;
+			ImageState state;		// Last access by any image placed in it, carried into the next frame
+		};
+
+		struct TransientKey
+		{
+			TransientImageDesc desc;
+			uint32_t firstPass;
+			uint32_t lastPass;
+
+			bool operator==(const TransientKey&) const = default;
+		};
+
+		PassBuilder addPass(const char* name, const Callback& execute);
+
+		void cull();
+		void computeLifetimes();
+		bool placeTransients();
+		void destroyPhysical();
+		void recordPass(VkCommandBuffer cmd, Pass& pass);
+		ImageState requiredState(const ImageUse& use) const;
+
+		Device* m_device{ nullptr };
+		VkDevice m_vkDevice{ VK_NULL_HANDLE };
+		VmaAllocator m_allocator{ VK_NULL_HANDLE };
+
+		std::vector<Pass> m_passes;
+		std::vector<Image> m_images;
+		FrameArena m_callableMemory;
+
+		std::vector<PhysicalImage> m_physicalImages;
+		std::vector<PhysicalMemory> m_physicalMemory;
+		std::vector<TransientKey> m_transientKeys;		// Used transients in declaration order, as last placed
+		std::vector<TransientKey> m_frameKeys;
+
+		std::vector<VkImageMemoryBarrier2> m_barriers;
+		Stats m_stats{};
+	};
+}
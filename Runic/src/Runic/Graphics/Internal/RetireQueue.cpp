@@ -0,0 +1,142 @@
+#include "Runic/Graphics/Internal/RetireQueue.h"
+
+#include <Tracy.hpp>
+
+#include <algorithm>
+
+#include "Runic/Graphics/Internal/BindlessTextureTable.h"
+
+using namespace Runic;
+
+void RetireQueue::Init(VkDevice device, VmaAllocator allocator, ResourceManager* resourceManager, uint32_t capacity)
+{
+	m_device = device;
+	m_allocator = allocator;
+	m_resourceManager = resourceManager;
+	m_entries.resize(capacity);
+	m_head = 0U;
+	m_count = 0U;
+}
+
+void RetireQueue::RetireBuffer(BufferHandle buffer)
+{
+	push(Entry{ .value = m_retireValue, .type = Type::BUFFER, .buffer = buffer });
+}
+
+void RetireQueue::RetireImage(ImageHandle image)
+{
+	push(Entry{ .value = m_retireValue, .type = Type::IMAGE, .image = image });
+}
+
+void RetireQueue::RetireVkImage(VkImage image)
+{
+	push(Entry{ .value = m_retireValue, .type = Type::VK_IMAGE, .vkImage = image });
+}
+
+void RetireQueue::RetireAllocation(VmaAllocation allocation)
+{
+	push(Entry{ .value = m_retireValue, .type = Type::ALLOCATION, .allocation = allocation });
+}
+
+void RetireQueue::RetirePipeline(VkPipeline pipeline)
+{
+	push(Entry{ .value = m_retireValue, .type = Type::PIPELINE, .pipeline = pipeline });
+}
+
+void RetireQueue::RetireImageView(VkImageView imageView)
+{
+	push(Entry{ .value = m_retireValue, .type = Type::IMAGE_VIEW, .imageView = imageView });
+}
+
+void RetireQueue::RetireFramebuffer(VkFramebuffer framebuffer)
+{
+	push(Entry{ .value = m_retireValue, .type = Type::FRAMEBUFFER, .framebuffer = framebuffer });
+}
+
+void RetireQueue::RetireRenderPass(VkRenderPass renderPass)
+{
+	push(Entry{ .value = m_retireValue, .type = Type::RENDER_PASS, .renderPass = renderPass });
+}
+
+void RetireQueue::RetireSwapchain(VkSwapchainKHR swapchain)
+{
+	push(Entry{ .value = m_retireValue, .type = Type::SWAPCHAIN, .swapchain = swapchain });
+}
+
+void RetireQueue::RetireBindlessSlot(BindlessTextureTable* table, uint32_t slot)
+{
+	push(Entry{ .value = m_retireValue, .type = Type::BINDLESS_SLOT, .bindlessSlot = BindlessSlot{ .table = table, .slot = slot } });
+}
+
+void RetireQueue::Collect(uint64_t completedValue)
+{
+	ZoneScoped;
+
+	while (m_count > 0U && m_entries[m_head].value <= completedValue)
+	{
+		release(m_entries[m_head]);
+		m_head = (m_head + 1U) % static_cast<uint32_t>(m_entries.size());
+		--m_count;
+	}
+}
+
+void RetireQueue::Flush()
+{
+	Collect(~0ULL);
+}
+
+void RetireQueue::push(const Entry& entry)
+{
+	const uint32_t capacity = static_cast<uint32_t>(m_entries.size());
+	if (m_count == capacity)
+	{
+		// Unwrap into a larger ring, only happens if retiring outpaces the GPU for a long time
+		std::vector<Entry> entries(std::max(capacity * 2U, RETIRE_QUEUE_CAPACITY));
+		for (uint32_t i = 0; i < m_count; ++i)
+		{
+			entries[i] = m_entries[(m_head + i) % capacity];
+		}
+		m_entries = std::move(entries);
+		m_head = 0U;
+	}
+
+	m_entries[(m_head + m_count) % static_cast<uint32_t>(m_entries.size())] = entry;
+	++m_count;
+}
+
+void RetireQueue::release(const Entry& entry)
+{
+	switch (entry.type)
+	{
+	case Type::BUFFER:
+		m_resourceManager->DestroyBuffer(entry.buffer);
+		break;
+	case Type::IMAGE:
+		m_resourceManager->DestroyImage(entry.image);
+		break;
+	case Type::VK_IMAGE:
+		vkDestroyImage(m_device, entry.vkImage, nullptr);
+		break;
+	case Type::ALLOCATION:
+		vmaFreeMemory(m_allocator, entry.allocation);
+		break;
+	case Type::PIPELINE:
+		vkDestroyPipeline(m_device, entry.pipeline, nullptr);
+		break;
+	case Type::IMAGE_VIEW:
+		vkDestroyImageView(m_device, entry.imageView, nullptr);
+		break;
+	case Type::FRAMEBUFFER:
+		vkDestroyFramebuffer(m_device, entry.framebuffer, nullptr);
+		break;
+	case Type::RENDER_PASS:
+		vkDestroyRenderPass(m_device, entry.renderPass, nullptr);
+		break;
+	case Type::SWAPCHAIN:
+		vkDestroySwapchainKHR(m_device, entry.swapchain, nullptr);
+		break;
+	case Type::BINDLESS_SLOT:
+		entry.bindlessSlot.table->Recycle(entry.bindlessSlot.slot);
+		break;
+	}
+}
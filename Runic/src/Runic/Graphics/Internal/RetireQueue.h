@@ -0,0 +1,114 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vk_mem_alloc.h>
+#include <cstdint>
+#include <vector>
+
+#include "Runic/Graphics/ResourceManager.h"
+
+namespace Runic
+{
+	class BindlessTextureTable;
+
+	constexpr uint32_t RETIRE_QUEUE_CAPACITY = 1024U;		// Entries reserved up front, doubled if ever exceeded
+
+	/*
+	*
+	* RetireQueue: Resources that are no longer wanted but may still be used by submitted work. Each entry is tagged
+	*			   with the graphics timeline value of the first submission that can no longer use it and released
+	*			   once that value has completed, so destroying never waits on the device. Entries are plain tagged
+	*			   handles in a ring buffer, retiring does not allocate.
+	*
+	*/
+	class RetireQueue
+	{
+	public:
+		void Init(VkDevice device, VmaAllocator allocator, ResourceManager* resourceManager, uint32_t capacity = RETIRE_QUEUE_CAPACITY);
+
+		/*
+		Timeline value the next frame submission signals, everything retired from now on waits for it
+		*/
+		void SetRetireValue(uint64_t value) { m_retireValue = value; }
+		uint64_t GetRetireValue() const { return m_retireValue; }
+
+		void RetireBuffer(BufferHandle buffer);
+		void RetireImage(ImageHandle image);
+
+		/*
+		Images and memory created outside the resource manager
+		*/
+		void RetireVkImage(VkImage image);
+		void RetireAllocation(VmaAllocation allocation);
+		void RetirePipeline(VkPipeline pipeline);
+		void RetireImageView(VkImageView imageView);
+		void RetireFramebuffer(VkFramebuffer framebuffer);
+		void RetireRenderPass(VkRenderPass renderPass);
+		void RetireSwapchain(VkSwapchainKHR swapchain);
+		void RetireBindlessSlot(BindlessTextureTable* table, uint32_t slot);
+
+		/*
+		Releases every entry whose timeline value has completed
+		*/
+		void Collect(uint64_t completedValue);
+
+		/*
+		Releases everything, only once the device is idle
+		*/
+		void Flush();
+
+		uint32_t GetSize() const { return m_count; }
+	private:
+		enum class Type : uint8_t
+		{
+			BUFFER,
+			IMAGE,
+			VK_IMAGE,
+			ALLOCATION,
+			PIPELINE,
+			IMAGE_VIEW,
+			FRAMEBUFFER,
+			RENDER_PASS,
+			SWAPCHAIN,
+			BINDLESS_SLOT,
+		};
+
+		struct BindlessSlot
+		{
+			BindlessTextureTable* table;
+			uint32_t slot;
+		};
+
+		struct Entry
+		{
+			uint64_t value;
+			Type type;
+			union
+			{
+				BufferHandle buffer;
+				ImageHandle image;
+				VkImage vkImage;
+				VmaAllocation allocation;
+				VkPipeline pipeline;
+				VkImageView imageView;
+				VkFramebuffer framebuffer;
+				VkRenderPass renderPass;
+				VkSwapchainKHR swapchain;
+				BindlessSlot bindlessSlot;
+			};
+		};
+
+		void push(const Entry& entry);
+		void release(const Entry& entry);
+
+		VkDevice m_device{ VK_NULL_HANDLE };
+		VmaAllocator m_allocator{ VK_NULL_HANDLE };
+		ResourceManager* m_resourceManager{ nullptr };
+		uint64_t m_retireValue{ 1U };
+
+		// Values only increase, so the oldest entries are always at the head
+		std::vector<Entry> m_entries;
+		uint32_t m_head{ 0U };
+		uint32_t m_count{ 0U };
+	};
+}
@@ -0,0 +1,122 @@
+#include "Runic/Graphics/Internal/ShaderModuleCache.h"
+
+#include "Runic/Graphics/Internal/PipelineBuilder.h"
+
+using namespace Runic;
+
+namespace
+{
+	// FNV-1a, 64 bit
+	uint64_t hashCode(const std::vector<uint32_t>& code)
+	{
+		uint64_t hash = 14695981039346656037ULL;
+		const uint8_t* bytes = reinterpret_cast<const uint8_t*>(code.data());
+		for (size_t i = 0; i < code.size() * sizeof(uint32_t); ++i)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ULL;
+		}
+		return hash;
+	}
+}
+
+void ShaderModuleCache::Deinit()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (const auto& [hash, entry] : m_modules)
+	{
+		vkDestroyShaderModule(m_device, entry.module, nullptr);
+	}
+	m_modules.clear();
+	m_moduleHashes.clear();
+	m_files.clear();
+}
+
+std::optional<VkShaderModule> ShaderModuleCache::Acquire(const std::string& filePath)
+{
+	std::error_code ec;
+	const std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(filePath, ec);
+	if (ec)
+	{
+		return std::nullopt;
+	}
+
+	{
+		// Unchanged file whose module is still alive, skip the read entirely
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (const auto file = m_files.find(filePath); file != m_files.end() && file->second.writeTime == writeTime)
+		{
+			if (const auto module = m_modules.find(file->second.hash); module != m_modules.end())
+			{
+				++module->second.refCount;
+				++m_hits;
+				return module->second.module;
+			}
+		}
+	}
+
+	// Read outside the lock so workers loading different files don't serialise on I/O
+	const std::optional<std::vector<uint32_t>> code = PipelineBuild::loadShaderCode(filePath.c_str());
+	if (!code.has_value())
+	{
+		return std::nullopt;
+	}
+	const uint64_t hash = hashCode(code.value());
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	++m_fileReads;
+	m_files[filePath] = FileEntry{ .writeTime = writeTime, .hash = hash };
+
+	// Different path, same SPIR-V
+	if (const auto module = m_modules.find(hash); module != m_modules.end())
+	{
+		++module->second.refCount;
+		++m_hits;
+		return module->second.module;
+	}
+
+	const std::optional<VkShaderModule> shaderModule = PipelineBuild::createShaderModule(m_device, code.value());
+	if (!shaderModule.has_value())
+	{
+		return std::nullopt;
+	}
+
+	++m_misses;
+	m_modules[hash] = ModuleEntry{ .module = shaderModule.value(), .refCount = 1U };
+	m_moduleHashes[shaderModule.value()] = hash;
+	return shaderModule;
+}
+
+void ShaderModuleCache::Release(VkShaderModule shaderModule)
+{
+	if (shaderModule == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	const auto hash = m_moduleHashes.find(shaderModule);
+	if (hash == m_moduleHashes.end())
+	{
+		return;
+	}
+
+	ModuleEntry& entry = m_modules.at(hash->second);
+	if (--entry.refCount == 0U)
+	{
+		vkDestroyShaderModule(m_device, entry.module, nullptr);
+		m_modules.erase(hash->second);
+		m_moduleHashes.erase(hash);
+	}
+}
+
+ShaderModuleCache::Stats ShaderModuleCache::GetStats()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return Stats{
+		.hits = m_hits,
+		.misses = m_misses,
+		.fileReads = m_fileReads,
+		.liveModules = static_cast<uint32_t>(m_modules.size()),
+	};
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+namespace Runic
+{
+	/*
+	*
+	* ShaderModuleCache: Shares VkShaderModules between pipelines, keyed by a hash of the SPIR-V. Modules are
+	*					 reference counted and destroyed when the last pipeline using them releases them.
+	*					 Files are only re-read when their write time changes. Safe to use from worker threads.
+	*
+	*/
+	class ShaderModuleCache
+	{
+	public:
+		struct Stats
+		{
+			uint32_t hits;
+			uint32_t misses;
+			uint32_t fileReads;
+			uint32_t liveModules;
+		};
+
+		ShaderModuleCache(VkDevice device) : m_device(device) {}
+		void Deinit();
+
+		std::optional<VkShaderModule> Acquire(const std::string& filePath);
+		void Release(VkShaderModule shaderModule);
+
+		Stats GetStats();
+	private:
+		const VkDevice m_device;
+		std::mutex m_mutex;
+
+		struct ModuleEntry
+		{
+			VkShaderModule module;
+			uint32_t refCount;
+		};
+		std::unordered_map<uint64_t, ModuleEntry> m_modules;
+		std::unordered_map<VkShaderModule, uint64_t> m_moduleHashes;
+
+		struct FileEntry
+		{
+			std::filesystem::file_time_type writeTime;
+			uint64_t hash;
+		};
+		std::unordered_map<std::string, FileEntry> m_files;
+
+		uint32_t m_hits{ 0U };
+		uint32_t m_misses{ 0U };
+		uint32_t m_fileReads{ 0U };
+	};
+}
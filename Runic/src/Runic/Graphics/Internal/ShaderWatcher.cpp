@@ -0,0 +1,131 @@
+#include "Runic/Graphics/Internal/ShaderWatcher.h"
+
+#include <algorithm>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <climits>
+#endif
+
+#include "Runic/Log.h"
+
+using namespace Runic;
+
+bool ShaderWatcher::Init(const std::string& directory)
+{
+	m_directory = directory;
+
+#ifdef __linux__
+	m_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (m_inotifyFd < 0)
+	{
+		LOG_CORE_WARN("Failed to initialise inotify, shader hot reload disabled.");
+		return false;
+	}
+
+	// Editors either rewrite in place or save to a temp file and rename it over the original
+	m_watchFd = inotify_add_watch(m_inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+	if (m_watchFd < 0)
+	{
+		LOG_CORE_WARN("Failed to watch shader folder: " + directory);
+		close(m_inotifyFd);
+		m_inotifyFd = -1;
+		return false;
+	}
+#else
+	std::error_code ec;
+	for (const auto& entry : std::filesystem::directory_iterator(directory, ec))
+	{
+		if (IsShaderSource(entry.path()))
+		{
+			m_writeTimes[entry.path().string()] = entry.last_write_time(ec);
+		}
+	}
+	if (ec)
+	{
+		LOG_CORE_WARN("Failed to watch shader folder: " + directory);
+		return false;
+	}
+#endif
+	return true;
+}
+
+void ShaderWatcher::Deinit()
+{
+#ifdef __linux__
+	if (m_inotifyFd >= 0)
+	{
+		if (m_watchFd >= 0)
+		{
+			inotify_rm_watch(m_inotifyFd, m_watchFd);
+		}
+		close(m_inotifyFd);
+	}
+	m_inotifyFd = -1;
+	m_watchFd = -1;
+#else
+	m_writeTimes.clear();
+#endif
+}
+
+std::vector<std::string> ShaderWatcher::PollChangedFiles()
+{
+	std::vector<std::string> changedFiles;
+
+#ifdef __linux__
+	if (m_inotifyFd < 0)
+	{
+		return changedFiles;
+	}
+
+	alignas(inotify_event) char buffer[4096];
+	ssize_t length;
+	while ((length = read(m_inotifyFd, buffer, sizeof(buffer))) > 0)
+	{
+		for (char* ptr = buffer; ptr < buffer + length;)
+		{
+			const inotify_event* event = reinterpret_cast<const inotify_event*>(ptr);
+			if (event->len > 0 && IsShaderSource(event->name))
+			{
+				changedFiles.push_back((std::filesystem::path(m_directory) / event->name).string());
+			}
+			ptr += sizeof(inotify_event) + event->len;
+		}
+	}
+#else
+	const auto now = std::chrono::steady_clock::now();
+	if (now - m_lastScan < std::chrono::milliseconds(250))
+	{
+		return changedFiles;
+	}
+	m_lastScan = now;
+
+	std::error_code ec;
+	for (const auto& entry : std::filesystem::directory_iterator(m_directory, ec))
+	{
+		if (!IsShaderSource(entry.path()))
+		{
+			continue;
+		}
+		const auto writeTime = entry.last_write_time(ec);
+		auto [it, inserted] = m_writeTimes.try_emplace(entry.path().string(), writeTime);
+		if (inserted || it->second != writeTime)
+		{
+			it->second = writeTime;
+			changedFiles.push_back(entry.path().string());
+		}
+	}
+#endif
+
+	// A single save can raise several events
+	std::sort(changedFiles.begin(), changedFiles.end());
+	changedFiles.erase(std::unique(changedFiles.begin(), changedFiles.end()), changedFiles.end());
+	return changedFiles;
+}
+
+bool ShaderWatcher::IsShaderSource(const std::filesystem::path& path)
+{
+	const std::filesystem::path extension = path.extension();
+	return extension == ".vert" || extension == ".frag" || extension == ".comp";
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Runic
+{
+	/*
+	*
+	* ShaderWatcher: Reports GLSL sources in a folder that changed since the last poll. Uses inotify on Linux,
+	*				 elsewhere falls back to comparing file write times at a throttled interval.
+	*
+	*/
+	class ShaderWatcher
+	{
+	public:
+		bool Init(const std::string& directory);
+		void Deinit();
+
+		/*
+		Non-blocking, returns each changed shader source path once
+		*/
+		std::vector<std::string> PollChangedFiles();
+
+		static bool IsShaderSource(const std::filesystem::path& path);
+	private:
+		std::string m_directory;
+#ifdef __linux__
+		int m_inotifyFd{ -1 };
+		int m_watchFd{ -1 };
+#else
+		std::chrono::steady_clock::time_point m_lastScan{};
+		std::unordered_map<std::string, std::filesystem::file_time_type> m_writeTimes;
+#endif
+	};
+}
@@ -0,0 +1,100 @@
+#include "Runic/Graphics/Internal/ShadowCascades.h"
+
+#include <Tracy.hpp>
+
+#include <gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace Runic;
+
+void ShadowCascades::SetSceneBounds(const glm::vec3& center, float radius)
+{
+	m_sceneCenter = center;
+	m_sceneRadius = std::max(radius, 1.0f);
+	Invalidate();
+}
+
+void ShadowCascades::Invalidate()
+{
+	for (Placement& placement : m_placements)
+	{
+		placement.valid = false;
+	}
+}
+
+void ShadowCascades::Update(const glm::mat4& cameraView, float fovY, float aspect, float nearPlane, const glm::vec3& lightDirection)
+{
+	ZoneScoped;
+
+	// The light's rotation is fixed, so a cascade only ever slides across it in whole texels
+	const glm::vec3 direction = glm::normalize(lightDirection);
+	if (glm::dot(direction, m_lightDirection) < 0.99999f)
+	{
+		m_lightDirection = direction;
+		const glm::vec3 up = std::abs(direction.y) > 0.99f ? glm::vec3{ 0.0f, 0.0f, 1.0f } : glm::vec3{ 0.0f, 1.0f, 0.0f };
+		m_lightView = glm::lookAt(glm::vec3{ 0.0f }, direction, up);
+		Invalidate();
+	}
+
+	// Every cascade covers the whole scene in depth, casters behind the camera still shadow what it sees
+	const float sceneDepth = (m_lightView * glm::vec4(m_sceneCenter, 1.0f)).z;
+	const float zNear = -(sceneDepth + m_sceneRadius);
+	const float zFar = -(sceneDepth - m_sceneRadius);
+
+	const glm::mat4 inverseView = glm::inverse(cameraView);
+	const float tanY = std::tan(fovY * 0.5f);
+	const float tanX = tanY * aspect;
+
+	float sliceNear = nearPlane;
+	for (uint32_t i = 0; i < SHADOW_CASCADE_COUNT; ++i)
+	{
+		const float t = static_cast<float>(i + 1U) / static_cast<float>(SHADOW_CASCADE_COUNT);
+		const float logSplit = nearPlane * std::pow(SHADOW_DISTANCE / nearPlane, t);
+		const float uniformSplit = nearPlane + (SHADOW_DISTANCE - nearPlane) * t;
+		const float sliceFar = uniformSplit + (logSplit - uniformSplit) * SHADOW_SPLIT_LAMBDA;
+
+		// Sphere around the slice in view space, where it only depends on the projection and not on the camera
+		const float centerDepth = (sliceNear + sliceFar) * 0.5f;
+		const glm::vec3 viewCenter{ 0.0f, 0.0f, -centerDepth };
+		float radius = 0.0f;
+		for (const float depth : { sliceNear, sliceFar })
+		{
+			radius = std::max(radius, glm::length(glm::vec3{ depth * tanX, depth * tanY, -depth } - viewCenter));
+		}
+		const float halfSize = radius * SHADOW_CACHE_GUARD;
+		const float texelSize = halfSize * 2.0f / static_cast<float>(SHADOW_MAP_SIZE);
+
+		const glm::vec3 worldCenter = glm::vec3(inverseView * glm::vec4(viewCenter, 1.0f));
+		const glm::vec2 lightCenter = glm::vec2(m_lightView * glm::vec4(worldCenter, 1.0f));
+
+		Placement& placement = m_placements[i];
+		const glm::vec2 offset = glm::abs(lightCenter - placement.center);
+		const bool outside = std::max(offset.x, offset.y) + radius > placement.halfSize;
+
+		Cascade& cascade = m_cascades[i];
+		cascade.staticDirty = !placement.valid || placement.halfSize != halfSize || outside;
+		if (cascade.staticDirty)
+		{
+			placement.center = glm::round(lightCenter / texelSize) * texelSize;
+			placement.halfSize = halfSize;
+			placement.valid = true;
+		}
+
+		const glm::mat4 proj = glm::orthoRH_ZO(placement.center.x - halfSize, placement.center.x + halfSize,
+			placement.center.y - halfSize, placement.center.y + halfSize, zNear, zFar);
+		cascade.viewProj = proj * m_lightView;
+		cascade.splitDepth = sliceFar;
+		cascade.texelSize = texelSize;
+
+		sliceNear = sliceFar;
+	}
+}
+
+bool ShadowCascades::Intersects(uint32_t cascade, const glm::vec3& center, float radius) const
+{
+	const Placement& placement = m_placements[cascade];
+	const glm::vec2 offset = glm::abs(glm::vec2(m_lightView * glm::vec4(center, 1.0f)) - placement.center);
+	return std::max(offset.x, offset.y) <= placement.halfSize + radius;
+}
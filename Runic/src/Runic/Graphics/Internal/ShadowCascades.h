@@ -0,0 +1,64 @@
+#pragma once
+
+#include <glm.hpp>
+#include <array>
+#include <cstdint>
+
+namespace Runic
+{
+	constexpr uint32_t SHADOW_CASCADE_COUNT = 4U;		// Packed into vec4s on the GPU
+	constexpr uint32_t SHADOW_MAP_SIZE = 2048U;
+	constexpr float SHADOW_DISTANCE = 150.0f;			// View depth the last cascade ends at
+	constexpr float SHADOW_SPLIT_LAMBDA = 0.75f;		// 1 is logarithmic splits, 0 uniform
+	constexpr float SHADOW_CACHE_GUARD = 1.25f;			// Cascade half size over the slice radius, how far a slice moves before its cache does
+
+	/*
+	*
+	* ShadowCascades: Fits directional light cascades to slices of the camera frustum. A cascade covers the bounding
+	*				  sphere of its slice, whose size doesn't change as the camera turns, plus a guard band. The cascade
+	*				  stays put until the sphere leaves the guard band and then moves in whole texels, so the static
+	*				  casters rendered into it stay valid until it moves or the light turns.
+	*
+	*/
+	class ShadowCascades
+	{
+	public:
+		struct Cascade
+		{
+			glm::mat4 viewProj{ 1.0f };
+			float splitDepth{ 0.0f };		// View space depth the cascade ends at
+			float texelSize{ 0.0f };		// World units
+			bool staticDirty{ true };		// Static casters have to be rendered again this frame
+		};
+
+		/*
+		Light space depth range of every caster, changing it invalidates every cascade
+		*/
+		void SetSceneBounds(const glm::vec3& center, float radius);
+		void Invalidate();
+
+		void Update(const glm::mat4& cameraView, float fovY, float aspect, float nearPlane, const glm::vec3& lightDirection);
+
+		/*
+		Whether a sphere can cast into the cascade
+		*/
+		bool Intersects(uint32_t cascade, const glm::vec3& center, float radius) const;
+
+		const Cascade& GetCascade(uint32_t cascade) const { return m_cascades[cascade]; }
+	private:
+		struct Placement
+		{
+			glm::vec2 center{ 0.0f };		// Light space, snapped to texels
+			float halfSize{ 0.0f };
+			bool valid{ false };
+		};
+
+		std::array<Cascade, SHADOW_CASCADE_COUNT> m_cascades{};
+		std::array<Placement, SHADOW_CASCADE_COUNT> m_placements{};
+
+		glm::mat4 m_lightView{ 1.0f };
+		glm::vec3 m_lightDirection{ 0.0f };
+		glm::vec3 m_sceneCenter{ 0.0f };
+		float m_sceneRadius{ 1.0f };
+	};
+}
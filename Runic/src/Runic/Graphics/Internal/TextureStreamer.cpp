@@ -0,0 +1,426 @@
+#include "Runic/Graphics/Internal/TextureStreamer.h"
+
+#include <Tracy.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+#include "Runic/Graphics/Device.h"
+#include "Runic/Graphics/Internal/VulkanInit.h"
+#include "Runic/Log.h"
+
+using namespace Runic;
+
+namespace
+{
+	constexpr uint32_t BYTES_PER_TEXEL = 4U;
+
+	// 2x2 box filter, edge texels are repeated for odd sizes
+	void downsample(const uint8_t* src, uint32_t srcWidth, uint32_t srcHeight, uint8_t* dst, uint32_t dstWidth, uint32_t dstHeight)
+	{
+		for (uint32_t y = 0; y < dstHeight; ++y)
+		{
+			const uint32_t y0 = std::min(y * 2U, srcHeight - 1U);
+			const uint32_t y1 = std::min(y * 2U + 1U, srcHeight - 1U);
+			for (uint32_t x = 0; x < dstWidth; ++x)
+			{
+				const uint32_t x0 = std::min(x * 2U, srcWidth - 1U);
+				const uint32_t x1 = std::min(x * 2U + 1U, srcWidth - 1U);
+				for (uint32_t c = 0; c < BYTES_PER_TEXEL; ++c)
+				{
+					const uint32_t sum =
+						src[(y0 * srcWidth + x0) * BYTES_PER_TEXEL + c] +
+						src[(y0 * srcWidth + x1) * BYTES_PER_TEXEL + c] +
+						src[(y1 * srcWidth + x0) * BYTES_PER_TEXEL + c] +
+						src[(y1 * srcWidth + x1) * BYTES_PER_TEXEL + c];
+					dst[(y * dstWidth + x) * BYTES_PER_TEXEL + c] = static_cast<uint8_t>((sum + 2U) / 4U);
+				}
+			}
+		}
+	}
+}
+
+void TextureStreamer::Init(Device* device, BindlessTextureTable* table, std::vector<BindlessTexture>* textures, VkSampler sampler)
+{
+	m_device = device;
+	m_table = table;
+	m_bindlessTextures = textures;
+	m_sampler = sampler;
+}
+
+void TextureStreamer::Deinit()
+{
+	m_textures.clear();
+}
+
+void TextureStreamer::Register(TextureHandle handle, const Texture& texture, VkFormat format)
+{
+	ZoneScoped;
+
+	StreamedTexture streamed{
+		.format = format,
+		.requestedMip = 0U,
+		.lastRequestedFrame = m_frame,
+	};
+
+	uint32_t width = static_cast<uint32_t>(texture.texWidth);
+	uint32_t height = static_cast<uint32_t>(texture.texHeight);
+	size_t offset = 0U;
+	while (true)
+	{
+		const size_t size = static_cast<size_t>(width) * height * BYTES_PER_TEXEL;
+		streamed.mips.push_back(MipLevel{ .width = width, .height = height, .offset = offset, .size = size });
+		offset += size;
+		if (width == 1U && height == 1U)
+		{
+			break;
+		}
+		width = std::max(width / 2U, 1U);
+		height = std::max(height / 2U, 1U);
+	}
+
+	streamed.pixels.resize(offset);
+	memcpy(streamed.pixels.data(), texture.ptr[0], streamed.mips[0].size);
+	for (size_t i = 1; i < streamed.mips.size(); ++i)
+	{
+		const MipLevel& src = streamed.mips[i - 1];
+		const MipLevel& dst = streamed.mips[i];
+		downsample(streamed.pixels.data() + src.offset, src.width, src.height, streamed.pixels.data() + dst.offset, dst.width, dst.height);
+	}
+
+	const uint32_t mipCount = static_cast<uint32_t>(streamed.mips.size());
+	streamed.baseMip = mipCount - 1U;
+	for (uint32_t i = 0; i < mipCount; ++i)
+	{
+		if (std::max(streamed.mips[i].width, streamed.mips[i].height) <= STREAMING_MIN_RESIDENT_SIZE)
+		{
+			streamed.baseMip = i;
+			break;
+		}
+	}
+	streamed.residentMip = mipCount;
+	streamed.requestedMip = streamed.baseMip;
+
+	m_textures[handle] = std::move(streamed);
+}
+
+void TextureStreamer::Unregister(TextureHandle handle)
+{
+	const auto it = m_textures.find(handle);
+	if (it == m_textures.end())
+	{
+		return;
+	}
+
+	if (it->second.residentMip < it->second.mips.size())
+	{
+		m_residentBytes -= chainBytes(it->second, it->second.residentMip);
+	}
+
+	BindlessTexture& bindless = (*m_bindlessTextures)[handle];
+	if (bindless.slot != 0U)
+	{
+		m_table->Free(bindless.slot);
+		m_device->DestroyImage(bindless.image);
+	}
+	bindless = BindlessTexture{};
+
+	m_textures.erase(it);
+}
+
+void TextureStreamer::RequestMip(TextureHandle handle, uint32_t mip)
+{
+	const auto it = m_textures.find(handle);
+	if (it == m_textures.end())
+	{
+		return;
+	}
+
+	StreamedTexture& texture = it->second;
+	texture.requestedMip = std::min({ texture.requestedMip, mip, texture.baseMip });
+	texture.lastRequestedFrame = m_frame;
+}
+
+uint32_t TextureStreamer::GetMipCount(TextureHandle handle) const
+{
+	const auto it = m_textures.find(handle);
+	return it != m_textures.end() ? static_cast<uint32_t>(it->second.mips.size()) : 1U;
+}
+
+uint32_t TextureStreamer::GetWidth(TextureHandle handle) const
+{
+	const auto it = m_textures.find(handle);
+	return it != m_textures.end() ? std::max(it->second.mips[0].width, it->second.mips[0].height) : 1U;
+}
+
+void TextureStreamer::Update(VkCommandBuffer cmd, std::pmr::memory_resource* frameMemory)
+{
+	ZoneScoped;
+
+	const uint64_t limit = memoryLimit();
+	std::pmr::unordered_map<TextureHandle, uint32_t> targets(frameMemory);
+	uint64_t targetBytes = m_residentBytes;
+
+	const auto targetOf = [&](TextureHandle handle, const StreamedTexture& texture) {
+		const auto target = targets.find(handle);
+		return target != targets.end() ? target->second : texture.residentMip;
+	};
+
+	// Lowers the least recently requested texture by one mip, skipping anything requested this frame when protectCurrent is set
+	const auto evictOne = [&](bool protectCurrent) {
+		TextureHandle victim = 0U;
+		const StreamedTexture* victimTexture = nullptr;
+		for (const auto& [handle, texture] : m_textures)
+		{
+			const uint32_t current = targetOf(handle, texture);
+			if (current >= texture.baseMip || (protectCurrent && texture.lastRequestedFrame == m_frame))
+			{
+				continue;
+			}
+			if (victimTexture == nullptr || texture.lastRequestedFrame < victimTexture->lastRequestedFrame)
+			{
+				victim = handle;
+				victimTexture = &texture;
+			}
+		}
+		if (victimTexture == nullptr)
+		{
+			return false;
+		}
+
+		const uint32_t current = targetOf(victim, *victimTexture);
+		targetBytes -= chainBytes(*victimTexture, current) - chainBytes(*victimTexture, current + 1U);
+		targets[victim] = current + 1U;
+		return true;
+	};
+
+	// The base mips always come first and are not held back by the upload budget
+	for (auto& [handle, texture] : m_textures)
+	{
+		if (texture.residentMip == texture.mips.size())
+		{
+			targets[handle] = texture.baseMip;
+			targetBytes += chainBytes(texture, texture.baseMip);
+		}
+	}
+
+	while (targetBytes > limit && evictOne(false))
+	{
+	}
+
+	// Raise the textures seen this frame, biggest shortfall first
+	std::pmr::vector<TextureHandle> candidates(frameMemory);
+	for (const auto& [handle, texture] : m_textures)
+	{
+		if (texture.lastRequestedFrame == m_frame && texture.requestedMip < targetOf(handle, texture))
+		{
+			candidates.push_back(handle);
+		}
+	}
+	std::sort(candidates.begin(), candidates.end(), [&](TextureHandle a, TextureHandle b) {
+		const StreamedTexture& textureA = m_textures.at(a);
+		const StreamedTexture& textureB = m_textures.at(b);
+		return (targetOf(a, textureA) - textureA.requestedMip) > (targetOf(b, textureB) - textureB.requestedMip);
+	});
+
+	uint64_t uploadBudget = STREAMING_UPLOAD_BYTES_PER_FRAME;
+	for (const TextureHandle handle : candidates)
+	{
+		const StreamedTexture& texture = m_textures.at(handle);
+		const uint32_t current = targetOf(handle, texture);
+		const uint64_t newBytes = chainBytes(texture, texture.requestedMip);
+		if (newBytes > uploadBudget && uploadBudget != STREAMING_UPLOAD_BYTES_PER_FRAME)
+		{
+			break;
+		}
+
+		const uint64_t growth = newBytes - chainBytes(texture, current);
+		while (targetBytes + growth > limit && evictOne(true))
+		{
+		}
+		if (targetBytes + growth > limit)
+		{
+			continue;
+		}
+
+		targetBytes += growth;
+		targets[handle] = texture.requestedMip;
+		uploadBudget -= std::min(uploadBudget, newBytes);
+	}
+
+	for (const auto& [handle, finestMip] : targets)
+	{
+		StreamedTexture& texture = m_textures.at(handle);
+		if (finestMip != texture.residentMip)
+		{
+			makeResident(cmd, handle, texture, finestMip, frameMemory);
+		}
+	}
+
+	// Demand is rebuilt every frame
+	for (auto& [handle, texture] : m_textures)
+	{
+		texture.requestedMip = texture.baseMip;
+	}
+	++m_frame;
+}
+
+TextureStreamer::Stats TextureStreamer::GetStats() const
+{
+	uint32_t fullyResident = 0U;
+	for (const auto& [handle, texture] : m_textures)
+	{
+		fullyResident += texture.residentMip == 0U ? 1U : 0U;
+	}
+
+	return Stats{
+		.residentBytes = m_residentBytes,
+		.memoryLimit = memoryLimit(),
+		.streamedTextures = static_cast<uint32_t>(m_textures.size()),
+		.fullyResidentTextures = fullyResident,
+	};
+}
+
+uint64_t TextureStreamer::chainBytes(const StreamedTexture& texture, uint32_t finestMip) const
+{
+	uint64_t bytes = 0U;
+	for (size_t i = finestMip; i < texture.mips.size(); ++i)
+	{
+		bytes += texture.mips[i].size;
+	}
+	return bytes;
+}
+
+uint64_t TextureStreamer::memoryLimit() const
+{
+	// Keep some of the heap budget free for everything that isn't a texture
+	const Device::MemoryBudget budget = m_device->GetDeviceLocalBudget();
+	const uint64_t usable = budget.budget - budget.budget / 20U;
+
+	// Our own allocations are already counted in the heap usage
+	uint64_t limit = 0U;
+	if (budget.usage > usable)
+	{
+		const uint64_t overshoot = budget.usage - usable;
+		limit = m_residentBytes > overshoot ? m_residentBytes - overshoot : 0U;
+	}
+	else
+	{
+		limit = m_residentBytes + (usable - budget.usage);
+	}
+	return std::min(m_memoryCeiling, limit);
+}
+
+void TextureStreamer::makeResident(VkCommandBuffer cmd, TextureHandle handle, StreamedTexture& texture, uint32_t finestMip, std::pmr::memory_resource* frameMemory)
+{
+	ZoneScoped;
+
+	const uint32_t levelCount = static_cast<uint32_t>(texture.mips.size()) - finestMip;
+	const uint64_t bytes = chainBytes(texture, finestMip);
+
+	const uint32_t newSlot = m_table->Allocate();
+	if (newSlot == 0U)
+	{
+		return;
+	}
+
+	const BufferHandle stagingBuffer = m_device->CreateBuffer(BufferCreateInfo{
+		.size = bytes,
+		.usage = GFX::Buffer::Usage::NONE,
+		.transfer = BufferCreateInfo::Transfer::SRC,
+		.memory = BufferCreateInfo::Memory::UPLOAD,
+		.category = MemoryCategory::STAGING,
+	});
+	memcpy(m_device->GetMappedData<void>(stagingBuffer), texture.pixels.data() + texture.mips[finestMip].offset, bytes);
+
+	const VkExtent3D imageExtent{
+		.width = texture.mips[finestMip].width,
+		.height = texture.mips[finestMip].height,
+		.depth = 1,
+	};
+
+	VkImageCreateInfo imageInfo = VulkanInit::imageCreateInfo(texture.format, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, imageExtent);
+	imageInfo.mipLevels = levelCount;
+	const ImageHandle newImage = m_device->CreateImage(ImageCreateInfo{ .imageInfo = imageInfo, .imageType = ImageCreateInfo::ImageType::TEXTURE_2D, .category = MemoryCategory::TEXTURE });
+
+	const VkImageSubresourceRange range{
+		.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+		.baseMipLevel = 0,
+		.levelCount = levelCount,
+		.baseArrayLayer = 0,
+		.layerCount = 1,
+	};
+
+	const VkImageMemoryBarrier2 toTransfer{
+		.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+		.srcStageMask = VK_PIPELINE_STAGE_2_NONE,
+		.srcAccessMask = 0,
+		.dstStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+		.dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+		.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+		.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		.image = m_device->GetImage(newImage),
+		.subresourceRange = range,
+	};
+	const VkDependencyInfo toTransferDependency = {
+		.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+		.imageMemoryBarrierCount = 1,
+		.pImageMemoryBarriers = &toTransfer,
+	};
+	vkCmdPipelineBarrier2(cmd, &toTransferDependency);
+
+	std::pmr::vector<VkBufferImageCopy> copyRegions(frameMemory);
+	copyRegions.reserve(levelCount);
+	for (uint32_t level = 0; level < levelCount; ++level)
+	{
+		const MipLevel& mip = texture.mips[finestMip + level];
+		copyRegions.push_back(VkBufferImageCopy{
+			.bufferOffset = mip.offset - texture.mips[finestMip].offset,
+			.bufferRowLength = 0,
+			.bufferImageHeight = 0,
+			.imageSubresource = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+				.mipLevel = level,
+				.baseArrayLayer = 0,
+				.layerCount = 1},
+			.imageExtent = {.width = mip.width, .height = mip.height, .depth = 1 },
+		});
+	}
+	vkCmdCopyBufferToImage(cmd, m_device->GetBuffer(stagingBuffer), m_device->GetImage(newImage), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, levelCount, copyRegions.data());
+
+	const VkImageMemoryBarrier2 toReadable{
+		.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+		.srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+		.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+		.dstStageMask = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+		.dstAccessMask = VK_ACCESS_2_SHADER_READ_BIT,
+		.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		.image = m_device->GetImage(newImage),
+		.subresourceRange = range,
+	};
+	const VkDependencyInfo toReadableDependency = {
+		.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+		.imageMemoryBarrierCount = 1,
+		.pImageMemoryBarriers = &toReadable,
+	};
+	vkCmdPipelineBarrier2(cmd, &toReadableDependency);
+
+	// Frames in flight keep sampling the old slot, so the new image goes in a fresh one
+	m_table->Write(newSlot, m_device->GetImageView(newImage), m_sampler);
+
+	BindlessTexture& bindless = (*m_bindlessTextures)[handle];
+	if (bindless.slot != 0U)
+	{
+		m_table->Free(bindless.slot);
+		m_device->DestroyImage(bindless.image);
+	}
+	m_device->DestroyBuffer(stagingBuffer);
+	bindless = BindlessTexture{ .image = newImage, .slot = newSlot };
+
+	if (texture.residentMip < texture.mips.size())
+	{
+		m_residentBytes -= chainBytes(texture, texture.residentMip);
+	}
+	m_residentBytes += bytes;
+	texture.residentMip = finestMip;
+}
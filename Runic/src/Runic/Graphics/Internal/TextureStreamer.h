@@ -0,0 +1,101 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <memory_resource>
+#include <unordered_map>
+#include <vector>
+
+#include "Runic/Graphics/Internal/BindlessTextureTable.h"
+#include "Runic/Graphics/ResourceManager.h"
+#include "Runic/Graphics/Texture.h"
+#include "Runic/Scene/Components/RenderableComponent.h"
+
+namespace Runic
+{
+	class Device;
+
+	constexpr uint32_t STREAMING_MIN_RESIDENT_SIZE = 64U;						// Mips at or below this size are always resident
+	constexpr uint64_t STREAMING_UPLOAD_BYTES_PER_FRAME = 32ULL * 1024 * 1024;
+	constexpr uint64_t STREAMING_DEFAULT_MEMORY_CEILING = 1024ULL * 1024 * 1024;
+
+	/*
+	*
+	* TextureStreamer: Keeps a CPU copy of each 2D texture's mip chain and only makes the mips that are needed
+	*				   resident. Textures start with their low mips, are raised to the mip requested each frame
+	*				   and are lowered again, least recently used first, when the device local heap budget or the
+	*				   fixed memory ceiling is exceeded. A residency change builds a new image holding only the
+	*				   resident mips, moves it to a fresh bindless slot and hands the old image and slot to the
+	*				   device's retire queue, so nothing waits on the device.
+	*
+	*/
+	class TextureStreamer
+	{
+	public:
+		struct Stats
+		{
+			uint64_t residentBytes;
+			uint64_t memoryLimit;
+			uint32_t streamedTextures;
+			uint32_t fullyResidentTextures;
+		};
+
+		void Init(Device* device, BindlessTextureTable* table, std::vector<BindlessTexture>* textures, VkSampler sampler);
+		void Deinit();
+
+		/*
+		Copies the pixels and builds the mip chain on the CPU, the texture becomes resident on the next Update
+		*/
+		void Register(TextureHandle handle, const Texture& texture, VkFormat format);
+		void Unregister(TextureHandle handle);
+		bool IsStreamed(TextureHandle handle) const { return m_textures.contains(handle); }
+
+		/*
+		Finest mip needed this frame, computed from screen space size
+		*/
+		void RequestMip(TextureHandle handle, uint32_t mip);
+		uint32_t GetMipCount(TextureHandle handle) const;
+		uint32_t GetWidth(TextureHandle handle) const;
+
+		/*
+		Records this frame's uploads into cmd, which must be outside of rendering. Scratch containers are
+		allocated from frameMemory.
+		*/
+		void Update(VkCommandBuffer cmd, std::pmr::memory_resource* frameMemory);
+
+		void SetMemoryCeiling(uint64_t bytes) { m_memoryCeiling = bytes; }
+		Stats GetStats() const;
+	private:
+		struct MipLevel
+		{
+			uint32_t width;
+			uint32_t height;
+			size_t offset;
+			size_t size;
+		};
+
+		struct StreamedTexture
+		{
+			VkFormat format;
+			std::vector<uint8_t> pixels;
+			std::vector<MipLevel> mips;
+			uint32_t baseMip;			// Coarsest mip that is streamed, everything from here down stays resident
+			uint32_t residentMip;		// Finest resident mip, mip count when nothing is resident yet
+			uint32_t requestedMip;
+			uint64_t lastRequestedFrame;
+		};
+
+		uint64_t chainBytes(const StreamedTexture& texture, uint32_t finestMip) const;
+		uint64_t memoryLimit() const;
+		void makeResident(VkCommandBuffer cmd, TextureHandle handle, StreamedTexture& texture, uint32_t finestMip, std::pmr::memory_resource* frameMemory);
+
+		Device* m_device{ nullptr };
+		BindlessTextureTable* m_table{ nullptr };
+		std::vector<BindlessTexture>* m_bindlessTextures{ nullptr };
+		VkSampler m_sampler{ VK_NULL_HANDLE };
+
+		std::unordered_map<TextureHandle, StreamedTexture> m_textures;
+		uint64_t m_residentBytes{ 0U };
+		uint64_t m_memoryCeiling{ STREAMING_DEFAULT_MEMORY_CEILING };
+		uint64_t m_frame{ 0U };
+	};
+}
@@ -2,6 +2,7 @@
 
 #include <iostream>
 #include <array>
+#include <cstring>
 
 #include "Runic/Log.h"
 
@@ -310,4 +311,34 @@ bool Runic::MeshDesc::hasIndices() const {
 		return true;
 	}
 	return false;
-}
\ No newline at end of file
+}
+
+uint32_t Runic::MeshDesc::GetIndexSize(bool allowUint8) const {
+	if (allowUint8 && vertices.size() <= 256U) {
+		return 1U;
+	}
+	if (vertices.size() <= 65536U) {
+		return 2U;
+	}
+	return 4U;
+}
+
+std::vector<uint32_t> Runic::MeshDesc::PackIndices(uint32_t indexSize) const {
+	std::vector<uint32_t> words((indices.size() * indexSize + 3U) / 4U, 0U);
+	if (indexSize == 4U) {
+		std::memcpy(words.data(), indices.data(), indices.size() * sizeof(Index));
+	}
+	else if (indexSize == 2U) {
+		uint16_t* packed = reinterpret_cast<uint16_t*>(words.data());
+		for (size_t i = 0; i < indices.size(); ++i) {
+			packed[i] = static_cast<uint16_t>(indices[i]);
+		}
+	}
+	else {
+		uint8_t* packed = reinterpret_cast<uint8_t*>(words.data());
+		for (size_t i = 0; i < indices.size(); ++i) {
+			packed[i] = static_cast<uint8_t>(indices[i]);
+		}
+	}
+	return words;
+}
@@ -24,6 +24,14 @@ namespace Runic
 		std::vector<Index> indices;
 
 		bool hasIndices() const;
+		/*
+		Smallest index size in bytes that can address every vertex. 1 is only picked when allowUint8 is set.
+		*/
+		uint32_t GetIndexSize(bool allowUint8) const;
+		/*
+		Indices narrowed to indexSize bytes and packed into 32 bit words, the last word is zero padded
+		*/
+		std::vector<uint32_t> PackIndices(uint32_t indexSize) const;
 
 		static glm::vec3 CalculateSurfaceNormal(glm::vec3 pointA, glm::vec3 pointB, glm::vec3 pointC)
 		{
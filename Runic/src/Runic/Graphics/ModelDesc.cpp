@@ -0,0 +1,533 @@
+#include "Runic/Graphics/ModelDesc.h"
+
+// Define these only in *one* .cc file.
+#define TINYGLTF_IMPLEMENTATION
+#ifndef STB_IMAGE_IMPLEMENTATION
+#define STB_IMAGE_IMPLEMENTATION
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#endif
+
+// #define TINYGLTF_NOEXCEPTION // optional. disable exception handling.
+#include "tiny_gltf.h"
+#include "tiny_obj_loader.h"
+
+#include "Runic/Log.h"
+#include "Runic/Assets/AssetRegistry.h"
+
+#include <Tracy.hpp>
+#include <gtc/type_ptr.hpp>
+#include <gtx/matrix_decompose.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+#include <fstream>
+#include <iterator>
+
+using namespace Runic;
+using namespace tinygltf;
+
+namespace
+{
+	uint64_t hashImage(const unsigned char* encoded, size_t size, TextureDesc::Format format)
+	{
+		// The same file uploaded as colour and as normal map is two different textures
+		return AssetRegistry::HashContent(encoded, size, static_cast<uint64_t>(format) + 1U);
+	}
+
+	uint64_t hashMesh(const MeshDesc& mesh)
+	{
+		const uint64_t vertexHash = AssetRegistry::HashContent(mesh.vertices.data(), mesh.vertices.size() * sizeof(Vertex));
+		return AssetRegistry::HashContent(mesh.indices.data(), mesh.indices.size() * sizeof(MeshDesc::Index), vertexHash);
+	}
+
+	struct ImageLoadContext
+	{
+		const ModelDesc::ContentFilter* isTextureLoaded{ nullptr };
+		std::vector<uint64_t> hashes;
+		std::vector<std::vector<unsigned char>> encoded;
+	};
+
+	// Hashes every image before tinygltf decodes it, and skips decoding the ones already uploaded
+	bool loadImageData(tinygltf::Image* image, const int imageIndex, std::string* err, std::string* warn, int reqWidth, int reqHeight, const unsigned char* bytes, int size, void* userData)
+	{
+		ImageLoadContext* context = static_cast<ImageLoadContext*>(userData);
+		const size_t index = static_cast<size_t>(imageIndex);
+		if (context->hashes.size() <= index)
+		{
+			context->hashes.resize(index + 1U, 0U);
+			context->encoded.resize(index + 1U);
+		}
+
+		// glTF images are all uploaded as colour textures
+		context->hashes[index] = hashImage(bytes, static_cast<size_t>(size), TextureDesc::Format::DEFAULT);
+		if (*context->isTextureLoaded && (*context->isTextureLoaded)(context->hashes[index]))
+		{
+			context->encoded[index].assign(bytes, bytes + size);
+			return true;
+		}
+		return tinygltf::LoadImageData(image, imageIndex, err, warn, reqWidth, reqHeight, bytes, size, nullptr);
+	}
+}
+
+namespace
+{
+	/*
+	Index accessors are tightly packed, but not necessarily aligned to their component size
+	*/
+	template<typename T>
+	void readIndices(const unsigned char* data, size_t count, std::vector<MeshDesc::Index>& indices)
+	{
+		indices.assign(count, {});
+		for (size_t i = 0; i < count; ++i)
+		{
+			T index;
+			std::memcpy(&index, data + i * sizeof(T), sizeof(T));
+			indices[i] = index;
+		}
+	}
+
+	ModelDesc::Primitive parsePrimitive(const Model& model, const tinygltf::Primitive& prim)
+	{
+		MeshDesc mesh;
+
+		auto posAttribute = prim.attributes.find("POSITION");
+		const int vertexAttributeIndex = posAttribute->second;
+		const Accessor& vertexAccessor = model.accessors[vertexAttributeIndex];
+		mesh.vertices.assign(vertexAccessor.count, {});
+
+		if (prim.indices >= 0)
+		{
+			const Accessor& indexAccessor = model.accessors[prim.indices];
+			const BufferView& indexBufferView = model.bufferViews[indexAccessor.bufferView];
+			const tinygltf::Buffer& indexBuffer = model.buffers[indexBufferView.buffer];
+			const unsigned char* indices = &indexBuffer.data[indexBufferView.byteOffset + indexAccessor.byteOffset];
+			switch (indexAccessor.componentType)
+			{
+			case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+				mesh.indices.assign(indices, indices + indexAccessor.count);
+				break;
+			case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+				readIndices<uint16_t>(indices, indexAccessor.count, mesh.indices);
+				break;
+			case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+				readIndices<uint32_t>(indices, indexAccessor.count, mesh.indices);
+				break;
+			default:
+				LOG_CORE_WARN("Unsupported glTF index component type " + std::to_string(indexAccessor.componentType));
+				break;
+			}
+		}
+
+		for (const auto& [attributeName, accessorIndex] : prim.attributes)
+		{
+			const Accessor& currentAccessor = model.accessors[accessorIndex];
+			const BufferView& bufferView = model.bufferViews[currentAccessor.bufferView];
+			const tinygltf::Buffer& currentBuffer = model.buffers[bufferView.buffer];
+
+			const float* positions = reinterpret_cast<const float*>(&currentBuffer.data[bufferView.byteOffset + currentAccessor.byteOffset]);
+
+			if (attributeName == "POSITION")
+			{
+				for (size_t i = 0; i < currentAccessor.count; ++i)
+				{
+					const size_t index = i * 3;
+					mesh.vertices[i].position = glm::make_vec3(&positions[index]);
+
+				}
+			}
+			else if (attributeName == "NORMAL")
+			{
+				for (size_t i = 0; i < currentAccessor.count; ++i)
+				{
+					const size_t index = i * 3;
+					mesh.vertices[i].normal = glm::make_vec3(&positions[index]);
+				}
+			}
+			else if (attributeName == "TEXCOORD_0")
+			{
+				for (size_t i = 0; i < currentAccessor.count; ++i)
+				{
+					const size_t index = i * 2;
+					mesh.vertices[i].uv = glm::make_vec2(&positions[index]);
+				}
+			}
+			else if (attributeName == "TANGENT")
+			{
+				for (size_t i = 0; i < currentAccessor.count; ++i)
+				{
+					const size_t index = i * 4;
+					mesh.vertices[i].tangent = glm::make_vec4(&positions[index]);
+				}
+			}
+		}
+
+		const auto getTextureIndex = [&model](const int materialImageIndex)->int {
+			if (materialImageIndex < 0)
+			{
+				return -1;
+			}
+			return model.textures[materialImageIndex].source;
+		};
+
+		const uint64_t meshHash = hashMesh(mesh);
+		if (prim.material < 0)
+		{
+			return ModelDesc::Primitive{ .mesh = std::move(mesh), .meshHash = meshHash };
+		}
+
+		const Material& modelMat = model.materials[prim.material];
+		return ModelDesc::Primitive{
+			.mesh = std::move(mesh),
+			.meshHash = meshHash,
+			.colorImage = getTextureIndex(modelMat.pbrMetallicRoughness.baseColorTexture.index),
+			.normalImage = getTextureIndex(modelMat.normalTexture.index),
+			.roughnessImage = getTextureIndex(modelMat.pbrMetallicRoughness.metallicRoughnessTexture.index),
+			.emissionImage = getTextureIndex(modelMat.emissiveTexture.index),
+		};
+	}
+
+	ModelDesc::Transform readNodeTransform(const tinygltf::Node& node)
+	{
+		ModelDesc::Transform transform;
+		if (node.matrix.size() == 16U)
+		{
+			// Skew and perspective can't be stored in a TRS and are dropped
+			glm::vec3 skew;
+			glm::vec4 perspective;
+			glm::decompose(glm::mat4(glm::make_mat4(node.matrix.data())), transform.scale, transform.rotation, transform.translation, skew, perspective);
+			return transform;
+		}
+
+		if (node.translation.size() == 3U)
+		{
+			transform.translation = glm::vec3(glm::make_vec3(node.translation.data()));
+		}
+		if (node.rotation.size() == 4U)
+		{
+			// glTF stores quaternions as x, y, z, w
+			transform.rotation = glm::quat(static_cast<float>(node.rotation[3]), static_cast<float>(node.rotation[0]), static_cast<float>(node.rotation[1]), static_cast<float>(node.rotation[2]));
+		}
+		if (node.scale.size() == 3U)
+		{
+			transform.scale = glm::vec3(glm::make_vec3(node.scale.data()));
+		}
+		return transform;
+	}
+
+	/*
+	Float accessors only, the extension also allows normalised integer rotations and scales
+	*/
+	template<typename T>
+	std::vector<T> readFloatAccessor(const Model& model, const tinygltf::Value& attributes, const std::string& name)
+	{
+		if (!attributes.Has(name))
+		{
+			return {};
+		}
+
+		const Accessor& accessor = model.accessors[attributes.Get(name).GetNumberAsInt()];
+		if (accessor.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT || accessor.bufferView < 0)
+		{
+			LOG_CORE_WARN("Unsupported EXT_mesh_gpu_instancing accessor type for " + name);
+			return {};
+		}
+
+		const BufferView& view = model.bufferViews[accessor.bufferView];
+		const size_t stride = view.byteStride != 0U ? view.byteStride : sizeof(T);
+		const unsigned char* data = &model.buffers[view.buffer].data[view.byteOffset + accessor.byteOffset];
+		std::vector<T> values(accessor.count);
+		for (size_t i = 0; i < values.size(); ++i)
+		{
+			std::memcpy(&values[i], data + i * stride, sizeof(T));
+		}
+		return values;
+	}
+
+	std::vector<ModelDesc::Transform> readInstances(const Model& model, const tinygltf::Node& node)
+	{
+		const auto extension = node.extensions.find("EXT_mesh_gpu_instancing");
+		if (extension == node.extensions.end() || !extension->second.Has("attributes"))
+		{
+			return {};
+		}
+
+		const tinygltf::Value& attributes = extension->second.Get("attributes");
+		const std::vector<glm::vec3> translations = readFloatAccessor<glm::vec3>(model, attributes, "TRANSLATION");
+		const std::vector<glm::vec4> rotations = readFloatAccessor<glm::vec4>(model, attributes, "ROTATION");
+		const std::vector<glm::vec3> scales = readFloatAccessor<glm::vec3>(model, attributes, "SCALE");
+
+		std::vector<ModelDesc::Transform> instances(std::max({ translations.size(), rotations.size(), scales.size() }));
+		for (size_t i = 0; i < instances.size(); ++i)
+		{
+			if (i < translations.size())
+			{
+				instances[i].translation = translations[i];
+			}
+			if (i < rotations.size())
+			{
+				instances[i].rotation = glm::quat(rotations[i].w, rotations[i].x, rotations[i].y, rotations[i].z);
+			}
+			if (i < scales.size())
+			{
+				instances[i].scale = scales[i];
+			}
+		}
+		return instances;
+	}
+}
+
+bool Runic::ModelDesc::DecodeImage(Image& image)
+{
+	ZoneScoped;
+
+	int width = 0;
+	int height = 0;
+	int channels = 0;
+	stbi_uc* pixels = stbi_load_from_memory(image.encoded.data(), static_cast<int>(image.encoded.size()), &width, &height, &channels, STBI_rgb_alpha);
+	if (pixels == nullptr)
+	{
+		return false;
+	}
+
+	image.width = width;
+	image.height = height;
+	image.channels = STBI_rgb_alpha;
+	image.pixels.assign(pixels, pixels + static_cast<size_t>(width) * height * STBI_rgb_alpha);
+	stbi_image_free(pixels);
+	image.encoded = {};
+	return true;
+}
+
+std::optional<ModelDesc> Runic::ModelDesc::LoadFromGLTF(const std::string& filename, const ContentFilter& isTextureLoaded)
+{
+	ZoneScoped;
+
+	Model model;
+	TinyGLTF loader;
+	std::string err;
+	std::string warn;
+
+	ImageLoadContext imageContext;
+	imageContext.isTextureLoaded = &isTextureLoaded;
+	loader.SetImageLoader(&loadImageData, &imageContext);
+
+	bool ret = loader.LoadASCIIFromFile(&model, &err, &warn, filename);
+	//bool ret = loader.LoadBinaryFromFile(&model, &err, &warn, argv[1]); // for binary glTF(.glb)
+
+	if (!warn.empty())
+	{
+		LOG_CORE_WARN(warn);
+	}
+
+	if (!err.empty())
+	{
+		LOG_CORE_ERROR(err);
+	}
+
+	if (!ret)
+	{
+		LOG_CORE_ERROR("Failed to parse glTF: " + filename);
+		return std::nullopt;
+	}
+
+	ModelDesc desc;
+	desc.images.reserve(model.images.size());
+	imageContext.hashes.resize(model.images.size(), 0U);
+	imageContext.encoded.resize(model.images.size());
+	for (size_t i = 0; i < model.images.size(); ++i)
+	{
+		tinygltf::Image& img = model.images[i];
+		desc.images.push_back(ModelDesc::Image{
+			.width = img.width,
+			.height = img.height,
+			.channels = img.component,
+			.pixels = std::move(img.image),
+			.contentHash = imageContext.hashes[i],
+			.encoded = std::move(imageContext.encoded[i]),
+		});
+	}
+
+	// Every mesh is parsed once, the first time a node uses it
+	std::vector<std::optional<std::vector<int>>> meshPrimitives(model.meshes.size());
+	const auto getMeshPrimitives = [&](int meshIndex) -> const std::vector<int>& {
+		std::optional<std::vector<int>>& primitives = meshPrimitives[meshIndex];
+		if (!primitives.has_value())
+		{
+			primitives.emplace();
+			for (const tinygltf::Primitive& prim : model.meshes[meshIndex].primitives)
+			{
+				primitives->push_back(static_cast<int>(desc.primitives.size()));
+				desc.primitives.push_back(parsePrimitive(model, prim));
+			}
+		}
+		return primitives.value();
+	};
+
+	// Depth first, so every node is added after its parent
+	const int sceneIndex = model.defaultScene >= 0 ? model.defaultScene : 0;
+	std::vector<std::pair<int, int>> pendingNodes;		// glTF node, parent in desc.nodes
+	if (static_cast<size_t>(sceneIndex) < model.scenes.size())
+	{
+		const std::vector<int>& roots = model.scenes[sceneIndex].nodes;
+		for (auto it = roots.rbegin(); it != roots.rend(); ++it)
+		{
+			pendingNodes.emplace_back(*it, -1);
+		}
+	}
+
+	while (!pendingNodes.empty())
+	{
+		const auto [nodeIndex, parent] = pendingNodes.back();
+		pendingNodes.pop_back();
+
+		const tinygltf::Node& node = model.nodes[nodeIndex];
+		ModelDesc::Node descNode;
+		descNode.parent = parent;
+		descNode.transform = readNodeTransform(node);
+		if (node.mesh >= 0)
+		{
+			descNode.primitives = getMeshPrimitives(node.mesh);
+			descNode.instances = readInstances(model, node);
+		}
+		desc.nodes.push_back(std::move(descNode));
+
+		const int index = static_cast<int>(desc.nodes.size()) - 1;
+		for (auto it = node.children.rbegin(); it != node.children.rend(); ++it)
+		{
+			pendingNodes.emplace_back(*it, index);
+		}
+	}
+
+	return desc;
+}
+
+std::optional<ModelDesc> Runic::ModelDesc::LoadFromObj(const std::string& filename, const ContentFilter& isTextureLoaded)
+{
+	ZoneScoped;
+
+	tinyobj::attrib_t attrib;
+	std::vector<tinyobj::shape_t> shapes;
+	std::vector<tinyobj::material_t> materials;
+
+	std::string warn;
+	std::string err;
+
+	const std::size_t directoryPos = filename.find_last_of("/");
+	const std::string directory = filename.substr(0, directoryPos);
+	tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, filename.c_str(), directory.c_str());
+	if (!warn.empty())
+	{
+		LOG_CORE_WARN(warn);
+	}
+	if (!err.empty())
+	{
+		LOG_CORE_WARN(err);
+		return std::nullopt;
+	}
+
+	ModelDesc desc;
+
+	// Returns the index into desc.images, -1 when the file can't be read or decoded
+	const auto loadImage = [&](const std::string& textureName, TextureDesc::Format format) -> int {
+		std::ifstream file(textureName, std::ios::binary);
+		ModelDesc::Image image;
+		image.format = format;
+		image.encoded.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		if (image.encoded.empty())
+		{
+			LOG_CORE_WARN("Failed to load texture file: " + textureName);
+			return -1;
+		}
+
+		image.contentHash = hashImage(image.encoded.data(), image.encoded.size(), format);
+		if (!(isTextureLoaded && isTextureLoaded(image.contentHash)) && !DecodeImage(image))
+		{
+			LOG_CORE_WARN("Failed to load texture file: " + textureName);
+			return -1;
+		}
+		desc.images.push_back(std::move(image));
+		return static_cast<int>(desc.images.size()) - 1;
+	};
+
+	// Textures are numbered per material, colour then normal, with -1 for the slots a material doesn't use
+	std::vector<int> materialImages(materials.size() * 2, -1);
+	for (size_t m = 0; m < materials.size(); m++)
+	{
+		if (materials[m].diffuse_texname != "")
+		{
+			materialImages[m * 2] = loadImage(directory + "/" + materials[m].diffuse_texname, TextureDesc::Format::DEFAULT);
+		}
+		if (materials[m].normal_texname != "" && materials[m].diffuse_texname != materials[m].ambient_texname)
+		{
+			materialImages[m * 2 + 1] = loadImage(directory + "/" + materials[m].ambient_texname, TextureDesc::Format::NORMAL);
+		}
+	}
+
+	desc.primitives.reserve(shapes.size());
+	for (size_t s = 0; s < shapes.size(); s++)
+	{
+		MeshDesc newMesh;
+		size_t index_offset = 0;
+		for (size_t f = 0; f < shapes[s].mesh.num_face_vertices.size(); f++)
+		{
+			const size_t fv = 3;
+			for (size_t v = 0; v < fv; v++)
+			{
+				// access to vertex
+				tinyobj::index_t idx = shapes[s].mesh.indices[index_offset + v];
+
+				//vertex position
+				tinyobj::real_t vx = attrib.vertices[3 * idx.vertex_index + 0];
+				tinyobj::real_t vy = attrib.vertices[3 * idx.vertex_index + 1];
+				tinyobj::real_t vz = attrib.vertices[3 * idx.vertex_index + 2];
+				//vertex normal
+				tinyobj::real_t nx = attrib.normals[3 * idx.normal_index + 0];
+				tinyobj::real_t ny = attrib.normals[3 * idx.normal_index + 1];
+				tinyobj::real_t nz = attrib.normals[3 * idx.normal_index + 2];
+
+				//copy it into our vertex
+				Vertex new_vert{};
+				new_vert.position.x = vx;
+				new_vert.position.y = vy;
+				new_vert.position.z = vz;
+
+				new_vert.normal.x = nx;
+				new_vert.normal.y = ny;
+				new_vert.normal.z = nz;
+
+				//we are setting the vertex color as the vertex normal. This is just for display purposes
+				new_vert.color = new_vert.normal;
+
+				tinyobj::real_t ux = attrib.texcoords[2 * idx.texcoord_index + 0];
+				tinyobj::real_t uy = attrib.texcoords[2 * idx.texcoord_index + 1];
+
+				new_vert.uv.x = ux;
+				new_vert.uv.y = 1 - uy;
+
+				newMesh.vertices.push_back(new_vert);
+			}
+			index_offset += fv;
+		}
+
+		const int material = shapes[s].mesh.material_ids.empty() ? -1 : shapes[s].mesh.material_ids[0];
+		const bool hasMaterial = material >= 0 && static_cast<size_t>(material) < materials.size();
+		const uint64_t meshHash = hashMesh(newMesh);
+		desc.primitives.push_back(ModelDesc::Primitive{
+			.mesh = std::move(newMesh),
+			.meshHash = meshHash,
+			.colorImage = hasMaterial ? materialImages[material * 2] : -1,
+			.normalImage = hasMaterial ? materialImages[material * 2 + 1] : -1,
+		});
+	}
+
+	// OBJ has no hierarchy, a single node draws every shape
+	ModelDesc::Node root;
+	for (size_t i = 0; i < desc.primitives.size(); ++i)
+	{
+		root.primitives.push_back(static_cast<int>(i));
+	}
+	desc.nodes.push_back(std::move(root));
+
+	return desc;
+}
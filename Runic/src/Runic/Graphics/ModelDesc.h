@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <gtc/quaternion.hpp>
+
+#include "Runic/Graphics/Mesh.h"
+#include "Runic/Graphics/Texture.h"
+
+namespace Runic
+{
+	/*
+	*
+	* ModelDesc: CPU side contents of a model file. Parsing it never touches the renderer, ModelLoader uploads
+	*			 what it parsed afterwards, so parsing and decoding can run on any thread.
+	*
+	*/
+	struct ModelDesc
+	{
+		struct Image
+		{
+			int width{ 0 };
+			int height{ 0 };
+			int channels{ 0 };
+			TextureDesc::Format format{ TextureDesc::Format::DEFAULT };
+			std::vector<unsigned char> pixels;
+
+			uint64_t contentHash{ 0U };				// Of the encoded file and the format
+			std::vector<unsigned char> encoded;		// Only kept when decoding was skipped, pixels is empty then
+		};
+
+		struct Primitive
+		{
+			MeshDesc mesh;
+			uint64_t meshHash{ 0U };		// Of the vertices and indices
+
+			// Index into images, -1 when the material has no such texture
+			int colorImage{ -1 };
+			int normalImage{ -1 };
+			int roughnessImage{ -1 };
+			int emissionImage{ -1 };
+		};
+
+		struct Transform
+		{
+			glm::vec3 translation{ 0.0f };
+			glm::quat rotation{ 1.0f, 0.0f, 0.0f, 0.0f };
+			glm::vec3 scale{ 1.0f };
+		};
+
+		struct Node
+		{
+			int parent{ -1 };					// Index into nodes, -1 for a root
+			Transform transform;				// Relative to the parent
+			std::vector<int> primitives;		// Index into primitives, nodes sharing a mesh share its primitives
+			std::vector<Transform> instances;	// EXT_mesh_gpu_instancing, relative to the node. Empty draws it once.
+		};
+
+		std::vector<Image> images;
+		std::vector<Primitive> primitives;		// Each mesh's primitives once, however many nodes use them
+		std::vector<Node> nodes;				// Parents come before their children
+
+		/*
+		Images whose contents isTextureLoaded reports as already uploaded aren't decoded, see Image::encoded.
+		It is called from the loading thread.
+		*/
+		using ContentFilter = std::function<bool(uint64_t contentHash)>;
+
+		static std::optional<ModelDesc> LoadFromGLTF(const std::string& filename, const ContentFilter& isTextureLoaded = {});
+		/*
+		Textures are read from the file's folder
+		*/
+		static std::optional<ModelDesc> LoadFromObj(const std::string& filename, const ContentFilter& isTextureLoaded = {});
+
+		/*
+		Decodes an image skipped at load time, for when its uploaded copy was destroyed in the meantime
+		*/
+		static bool DecodeImage(Image& image);
+	};
+}
@@ -9,13 +9,31 @@
 namespace Runic
 {
 	class Renderer;
+	struct ModelDesc;
 
 	class ModelLoader
 	{
 	public:
 		ModelLoader(Renderer* rend);
+		/*
+		.obj files go to LoadModelFromObj, anything else is read as glTF. Meshes and textures are registered in
+		the renderer's AssetRegistry with the file as their source.
+		*/
+		std::optional<std::vector<RenderableComponent>> LoadModel(const std::string& filename);
 		std::optional<std::vector<RenderableComponent>> LoadModelFromObj(const std::string& filename);
 		std::optional<std::vector<RenderableComponent>> LoadModelFromGLTF(const std::string& filename);
+
+		/*
+		Uploads an already parsed model, one renderable per primitive. Its images and primitives are registered
+		by their index in the ModelDesc, with filename as the source. Meshes and images with the same contents
+		as ones already uploaded reuse their handles. Every renderable holds a reference to its mesh and to each
+		of its textures. Must be called from the render thread.
+		*/
+		std::vector<RenderableComponent> UploadModel(const ModelDesc& model, const std::string& filename);
+		/*
+		Drops the references UploadModel took, destroying what nothing else uses
+		*/
+		void ReleaseModel(const std::vector<RenderableComponent>& renderables);
 	private:
 		Renderer* m_rend;
 	};
@@ -13,8 +13,12 @@
 #include <gtx/transform.hpp>
 #include <gtx/quaternion.hpp>
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <limits>
 #include <memory>
+#include <optional>
 #include <unordered_set>
 #include <stb_image.h>
 
@@ -36,6 +40,20 @@ using namespace Runic;
 		}                                                           \
 	} while (0)
 
+namespace
+{
+#ifdef RNC_SHADER_HOT_RELOAD
+	// Hot reload rebuilds the SPIR-V next to the sources in the tree, so pipelines load it from there too
+	constexpr const char* SHADER_DIR = RNC_ASSET_DIR "/shaders";
+#else
+	constexpr const char* SHADER_DIR = "../../assets/shaders";
+#endif
+
+	std::string shaderPath(const char* file)
+	{
+		return std::string(SHADER_DIR) + "/" + file;
+	}
+}
 
 void Renderer::Init(Device* device)
 {
@@ -43,9 +61,31 @@ void Renderer::Init(Device* device)
 
 	m_graphicsDevice = device;
 
-	m_depthTarget = m_graphicsDevice->CreateRenderTarget(true);
+	m_renderGraph.Init(m_graphicsDevice);
+	m_commandRecorder.Init(m_graphicsDevice->m_device, m_graphicsDevice->m_graphics.queueFamily, MAX_FRAMES_IN_FLIGHT);
+	m_frameArenas.Init(MAX_FRAMES_IN_FLIGHT, m_commandRecorder.GetThreadCount() + 1U);
 	initShaders();
+
+	// GPU times are read back a frame after the frame's slot comes round again
+	m_dynamicResolution.Init(MAX_FRAMES_IN_FLIGHT + 1U);
+	const VkSamplerCreateInfo upscaleSamplerInfo = VulkanInit::samplerCreateInfo(VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE);
+	vkCreateSampler(m_graphicsDevice->m_device, &upscaleSamplerInfo, nullptr, &m_upscaleSampler);
+
+	// Handle 0 and slot 0 are the white placeholder sampled when a material has no texture
+	uint32_t whitePixel = 0xFFFFFFFF;
+	Texture placeholder{ .m_desc = {.format = TextureDesc::Format::DEFAULT, .type = TextureDesc::Type::TEXTURE_2D }, .texWidth = 1, .texHeight = 1, .texChannels = 4 };
+	placeholder.ptr[0] = &whitePixel;
+	m_textures.push_back(BindlessTexture{ .image = uploadTextureInternal(placeholder), .slot = 0U });
+	m_bindlessTable.Write(0U, m_graphicsDevice->GetImageView(m_textures[0].image), m_graphicsDevice->m_defaultSampler);
+	m_textureStreamer.Init(m_graphicsDevice, &m_bindlessTable, &m_textures, m_graphicsDevice->m_defaultSampler);
+
 	initShaderData();
+	initShadows();
+
+#ifdef RNC_SHADER_HOT_RELOAD
+	// The sources in the tree, not the working directory, the recompiled SPIR-V is written next to them
+	m_graphicsDevice->m_pipelineManager->EnableHotReload(SHADER_DIR);
+#endif
 }
 
 void Renderer::initShaderData()
@@ -56,10 +96,15 @@ void Renderer::initShaderData()
 	m_skybox.textureHandle = 0;
 }
 
-void Renderer::drawObjects(VkCommandBuffer cmd, const std::vector<Runic::Entity*>& renderObjects)
+void Renderer::prepareDraws(const std::vector<Runic::Entity*>& renderObjects)
 {
 	ZoneScoped;
-	const int COUNT = static_cast<int>(renderObjects.size());
+	// The skybox takes the slot after the last object and slot 0 is the identity transform
+	const int COUNT = static_cast<int>(std::min<size_t>(renderObjects.size(), MAX_OBJECTS - 2U));
+	if (COUNT < static_cast<int>(renderObjects.size()))
+	{
+		LOG_CORE_WARN("Only the first " + std::to_string(COUNT) + " renderables are drawn.");
+	}
 	const Runic::RenderableComponent* FIRST = &renderObjects[0]->GetComponent<RenderableComponent>();
 
 	// fill buffers
@@ -76,33 +121,28 @@ void Renderer::drawObjects(VkCommandBuffer cmd, const std::vector<Runic::Entity*
 
 		if (renderObjects[i]->HasComponent<TransformComponent>())
 		{
-			const Runic::TransformComponent& transform = renderObjects[i]->GetComponent<TransformComponent>();
-
-			const glm::mat4 modelMatrix = transform.BuildMatrix();
+			const glm::mat4 modelMatrix = renderObjects[i]->BuildWorldMatrix();
 			objectSSBO[bufferPos].modelMatrix = modelMatrix;
 			objectSSBO[bufferPos].normalMatrix = glm::mat3(glm::transpose(glm::inverse(modelMatrix)));
-
-			drawDataSSBO[i].transformIndex = bufferPos;
 		}
 
-		drawDataSSBO[i].materialIndex = bufferPos;
-
 		materialSSBO[bufferPos] = GPUData::Material{
 			.specular = {0.4f,0.4,0.4f},
 			.shininess = 64.0f,
-			.textureIndices = {object.textureHandle.has_value() ? object.textureHandle.value() : -1,
-							object.normalHandle.has_value() ? object.normalHandle.value() : -1,
-							object.roughnessHandle.has_value() ? object.roughnessHandle.value() : -1,
-							object.emissionHandle.has_value() ? object.emissionHandle.value() : -1},
+			.textureIndices = {getTextureSlot(object.textureHandle),
+							getTextureSlot(object.normalHandle),
+							getTextureSlot(object.roughnessHandle),
+							getTextureSlot(object.emissionHandle)},
 		};
 	}
 
 	int skyboxCount = COUNT + 1;
+	m_skyboxDrawIndex = COUNT;
 	drawDataSSBO[COUNT].transformIndex = skyboxCount;
 	drawDataSSBO[COUNT].materialIndex = skyboxCount;
 
 	materialSSBO[skyboxCount] = GPUData::Material{
-			.textureIndices = {m_skybox.textureHandle.value(),
+			.textureIndices = {getTextureSlot(m_skybox.textureHandle),
 							0,
 							0,
 							0},
@@ -116,7 +156,9 @@ void Renderer::drawObjects(VkCommandBuffer cmd, const std::vector<Runic::Entity*
 	GPUData::Camera* cameraSSBO = m_graphicsDevice->GetMappedData<GPUData::Camera>(GetCurrentFrame().cameraBuffer);
 	cameraSSBO->view = m_currentCamera->BuildViewMatrix();
 	cameraSSBO->proj = m_currentCamera->BuildProjMatrix();
-	cameraSSBO->pos = {m_currentCamera->GetPosition(), 0.0f};
+	// Shaders loop over w point lights
+	const size_t pointLightCount = m_entities_with_lights.count(LightComponent::LightType::Point) > 0 ? std::min<size_t>(m_entities_with_lights[LightComponent::LightType::Point].size(), MAX_POINT_LIGHTS) : 0U;
+	cameraSSBO->pos = {m_currentCamera->GetPosition(), static_cast<float>(pointLightCount)};
 		//slot 1 - directionalLight
 	GPUData::DirectionalLight* dirLightSSBO = m_graphicsDevice->GetMappedData<GPUData::DirectionalLight>(GetCurrentFrame().dirLightBuffer);
 	if (m_entities_with_lights.count(LightComponent::LightType::Directional) > 0)
@@ -135,7 +177,7 @@ void Renderer::drawObjects(VkCommandBuffer cmd, const std::vector<Runic::Entity*
 	GPUData::PointLight* pointLightSSBO = m_graphicsDevice->GetMappedData<GPUData::PointLight>(GetCurrentFrame().pointLightBuffer);
 	if (m_entities_with_lights.count(LightComponent::LightType::Point) > 0)
 	{
-		if (int numberOfPointLights = m_entities_with_lights[LightComponent::LightType::Point].size(); numberOfPointLights > 0)
+		if (int numberOfPointLights = static_cast<int>(pointLightCount); numberOfPointLights > 0)
 		{
 			for (int i = 0; i < numberOfPointLights; ++i)
 			{
@@ -152,205 +194,710 @@ void Renderer::drawObjects(VkCommandBuffer cmd, const std::vector<Runic::Entity*
 		}
 	}
 
-	const MaterialType* lastMaterialType = nullptr;
-	const RenderMesh* lastMesh = nullptr;
-	for (int i = 0; i < COUNT + 1; ++i)
+	// Resolved here, the chunks recorded on worker threads only read
+	int drawCount = COUNT;
+	for (int i = 0; i < COUNT; ++i)
 	{
-		if (i < COUNT && !renderObjects[i]->HasComponent<RenderableComponent>())
+		if (!renderObjects[i]->HasComponent<RenderableComponent>())
 		{
-			return;
+			drawCount = i;
+			break;
 		}
-		const Runic::RenderableComponent& object = i != COUNT ? renderObjects[i]->GetComponent<RenderableComponent>() : m_skybox;
+	}
+
+	// Keeps its capacity between frames
+	m_drawItems.resize(drawCount);
+	const MaterialType* defaultMaterial = &m_materials["defaultMaterial"];
+	for (int i = 0; i < drawCount; ++i)
+	{
+		const RenderableComponent& renderable = renderObjects[i]->GetComponent<RenderableComponent>();
+		const RenderMesh& mesh = m_meshes.get(renderable.meshHandle);
+		const glm::mat4 modelMatrix = renderObjects[i]->BuildWorldMatrix();
+		const float maxScale = std::max({ glm::length(glm::vec3(modelMatrix[0])), glm::length(glm::vec3(modelMatrix[1])), glm::length(glm::vec3(modelMatrix[2])) });
 
 		// TODO : RenderObjects hold material handle for different m_materials
-		const MaterialType* currentMaterialType{ i != COUNT ? &m_materials["defaultMaterial"] : &m_materials["skyboxMaterial"]};
+		m_drawItems[i] = DrawItem{
+			.material = defaultMaterial,
+			.mesh = &mesh,
+			.boundsCenter = glm::vec3(modelMatrix * glm::vec4(mesh.boundsCenter, 1.0f)),
+			.boundsRadius = mesh.boundsRadius * maxScale,
+			.isStatic = renderable.isStatic,
+			.transformIndex = renderObjects[i]->HasComponent<TransformComponent>() ? i + 1 : 0,
+			.materialIndex = i + 1,
+		};
+	}
+
+	// Pairs that can share a draw end up next to each other, ties keep entity order so the sort is stable
+	std::sort(m_drawItems.begin(), m_drawItems.end(), [](const DrawItem& a, const DrawItem& b) {
+		if (a.material != b.material)
+		{
+			return std::less<>{}(a.material, b.material);
+		}
+		if (a.mesh != b.mesh)
+		{
+			return std::less<>{}(a.mesh, b.mesh);
+		}
+		return a.materialIndex < b.materialIndex;
+	});
+
+	// Textures and transforms are per instance data, so only the material and mesh split a batch
+	m_drawBatches.clear();
+	for (int i = 0; i < drawCount; ++i)
+	{
+		const DrawItem& item = m_drawItems[i];
+		const RenderMesh& mesh = *item.mesh;
+
+		// Looked up every frame, defragmentation can move the buffers
+		drawDataSSBO[i] = GPUData::DrawData{
+			.transformIndex = item.transformIndex,
+			.materialIndex = item.materialIndex,
+			.vertexAddress = m_graphicsDevice->GetBufferAddress(mesh.vertexBuffer),
+			.indexAddress = mesh.meshDesc.hasIndices() ? m_graphicsDevice->GetBufferAddress(mesh.indexBuffer) : 0U,
+			.indexSize = mesh.indexSize,
+		};
+
+		if (!m_drawBatches.empty() && m_drawBatches.back().material == item.material && m_drawBatches.back().mesh == item.mesh)
+		{
+			++m_drawBatches.back().instanceCount;
+		}
+		else
+		{
+			m_drawBatches.push_back(DrawBatch{ .material = item.material, .mesh = item.mesh, .firstIndex = i, .instanceCount = 1U });
+		}
+	}
+}
+
+void Renderer::drawObjects(VkCommandBuffer cmd, DrawMode mode)
+{
+	ZoneScoped;
+
+	const VkFormat colourFormat = mode == DrawMode::VISIBILITY ? VISIBILITY_FORMAT : m_graphicsDevice->GetBackBufferImageFormat();
+	const VkCommandBufferInheritanceRenderingInfo renderingInfo{
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO,
+		.colorAttachmentCount = mode == DrawMode::DEPTH ? 0U : 1U,
+		.pColorAttachmentFormats = mode == DrawMode::DEPTH ? nullptr : &colourFormat,
+		.depthAttachmentFormat = DEPTH_FORMAT,
+		.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
+	};
+
+	std::pmr::vector<VkCommandBuffer> secondaries = m_commandRecorder.Record(renderingInfo, static_cast<uint32_t>(m_drawBatches.size()), [&](VkCommandBuffer secondary, uint32_t, uint32_t begin, uint32_t end) {
+		recordDraws(secondary, m_drawBatches.data() + begin, end - begin, mode);
+		}, &m_frameArenas.Get());
+
+	// The skybox is drawn behind everything and has no depth of its own
+	if (mode == DrawMode::SHADED)
+	{
+		const DrawBatch skyboxBatch{ .material = &m_materials["skyboxMaterial"], .mesh = &m_meshes.get(m_skybox.meshHandle), .firstIndex = m_skyboxDrawIndex, .instanceCount = 1U };
+
+		// Recorded on this thread so its GPU zone stays on the profiler's thread
+		const VkCommandBuffer skyboxCmd = m_commandRecorder.BeginSecondary(renderingInfo);
+		{
+			const GpuZone skyboxZone(m_graphicsDevice->m_gpuProfiler, skyboxCmd, "Skybox");
+			recordDraws(skyboxCmd, &skyboxBatch, 1U, DrawMode::SHADED);
+		}
+		vkEndCommandBuffer(skyboxCmd);
+		secondaries.push_back(skyboxCmd);
+	}
+
+	vkCmdExecuteCommands(cmd, static_cast<uint32_t>(secondaries.size()), secondaries.data());
+}
+
+void Renderer::recordDraws(VkCommandBuffer cmd, const DrawBatch* batches, uint32_t count, DrawMode mode)
+{
+	const VkDescriptorSet globalSet = GetCurrentFrame().globalSet;
+	const VkDescriptorSet sceneSet = GetCurrentFrame().sceneSet;
+	const VkDescriptorSet bindlessSet = m_bindlessTable.GetSet();
+	const VkViewport viewport{
+		.x = 0.0f,
+		.y = 0.0f,
+		.width = static_cast<float>(m_renderExtent.width),
+		.height = static_cast<float>(m_renderExtent.height),
+		.minDepth = 0.0f,
+		.maxDepth = 1.0f,
+	};
+	const VkRect2D scissor{
+		.offset = {.x = 0,.y = 0},
+		.extent = m_renderExtent,
+	};
+
+	// Secondary command buffers start with no state, so each chunk sets its own
+	vkCmdSetViewport(cmd, 0, 1, &viewport);
+	vkCmdSetScissor(cmd, 0, 1, &scissor);
+
+	const MaterialType* lastMaterialType = nullptr;
+	const RenderMesh* lastMesh = nullptr;
+	for (uint32_t batch = 0; batch < count; ++batch)
+	{
+		const MaterialType* currentMaterialType = batches[batch].material;
 		if (currentMaterialType != lastMaterialType)
 		{
-			vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, currentMaterialType->pipelineLayout, 0, 1, &GetCurrentFrame().globalSet, 0, nullptr);
-			vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, currentMaterialType->pipelineLayout, 1, 1, &GetCurrentFrame().sceneSet, 0, nullptr);
+			vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, currentMaterialType->pipelineLayout, 0, 1, &globalSet, 0, nullptr);
+			vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, currentMaterialType->pipelineLayout, 1, 1, &sceneSet, 0, nullptr);
+			vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, currentMaterialType->pipelineLayout, 2, 1, &bindlessSet, 0, nullptr);
 
-			vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphicsDevice->m_pipelineManager->GetPipeline(currentMaterialType->pipeline));
+			// Every opaque material shares the one position only pipeline in the pre-pass and visibility pass
+			PipelineHandle pipeline = m_depthPrePass ? currentMaterialType->depthEqualPipeline : currentMaterialType->pipeline;
+			if (mode == DrawMode::DEPTH)
+			{
+				pipeline = m_depthPrePassPipeline;
+			}
+			else if (mode == DrawMode::VISIBILITY)
+			{
+				pipeline = m_visibilityPipeline;
+			}
+			vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphicsDevice->m_pipelineManager->GetPipeline(pipeline));
 
 			lastMaterialType = currentMaterialType;
 		}
 
 		const GPUData::PushConstants constants = {
-			.drawDataIndex = i,
+			.drawDataIndex = batches[batch].firstIndex,
 		};
 		vkCmdPushConstants(cmd, currentMaterialType->pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(GPUData::PushConstants), &constants);
 
-		const RenderMesh* currentMesh { &m_meshes.get(object.meshHandle)};
+		const RenderMesh* currentMesh = batches[batch].mesh;
 		const Runic::MeshDesc* currentMeshDesc = { &currentMesh->meshDesc };
 		if (currentMesh != lastMesh)
 		{
 			const VkDeviceSize offset{ 0 };
-			const VkBuffer vertexBuffer =m_graphicsDevice->GetBuffer(currentMesh->vertexBuffer);
+			const VkBuffer vertexBuffer = m_graphicsDevice->GetBuffer(mode == DrawMode::SHADED ? currentMesh->vertexBuffer : currentMesh->positionBuffer);
 			vkCmdBindVertexBuffers(cmd, 0, 1, &vertexBuffer, &offset);
 			if (currentMeshDesc->hasIndices())
 			{
-				const VkBuffer indexBuffer =m_graphicsDevice->GetBuffer(currentMesh->indexBuffer);
-				vkCmdBindIndexBuffer(cmd, indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+				const VkBuffer indexBuffer = m_graphicsDevice->GetBuffer(currentMesh->indexBuffer);
+				vkCmdBindIndexBuffer(cmd, indexBuffer, 0, currentMesh->indexType);
 			}
 			lastMesh = currentMesh;
 		}
 
+		const uint32_t instanceCount = batches[batch].instanceCount;
 		if (currentMeshDesc->hasIndices())
 		{
-			vkCmdDrawIndexed(cmd, static_cast<uint32_t>(currentMeshDesc->indices.size()), 1, 0, 0, 0);
+			vkCmdDrawIndexed(cmd, static_cast<uint32_t>(currentMeshDesc->indices.size()), instanceCount, 0, 0, 0);
 		}
 		else
 		{
-			vkCmdDraw(cmd, static_cast<uint32_t>(currentMeshDesc->vertices.size()), 1, 0, 0);
+			vkCmdDraw(cmd, static_cast<uint32_t>(currentMeshDesc->vertices.size()), instanceCount, 0, 0);
 		}
 	}
 }
 
-void Renderer::Draw(Camera* const camera)
+void Renderer::resolveVisibility(VkCommandBuffer cmd, VkImageView visibilityView)
 {
 	ZoneScoped;
 
-	m_currentCamera = camera;
-
-	if (!m_graphicsDevice->BeginFrame())
+	const uint32_t slot = rebindFrameSlot(m_visibilitySlot, visibilityView, m_graphicsDevice->m_defaultSampler);
+	if (slot == 0U)
 	{
+		LOG_CORE_WARN("Bindless table full, skipping visibility buffer resolve.");
 		return;
 	}
 
-	const VkCommandBuffer cmd = m_graphicsDevice->m_graphics.commands[m_graphicsDevice->GetCurrentFrameNumber()].buffer;
+	const VkExtent2D extent = m_renderExtent;
+	const VkViewport viewport{
+		.x = 0.0f,
+		.y = 0.0f,
+		.width = static_cast<float>(extent.width),
+		.height = static_cast<float>(extent.height),
+		.minDepth = 0.0f,
+		.maxDepth = 1.0f,
+	};
+	const VkRect2D scissor{
+		.offset = {.x = 0,.y = 0},
+		.extent = extent,
+	};
+	vkCmdSetViewport(cmd, 0, 1, &viewport);
+	vkCmdSetScissor(cmd, 0, 1, &scissor);
 
-	const VkCommandBufferBeginInfo cmdBeginInfo = {
-		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-		.pNext = nullptr,
-		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
-		.pInheritanceInfo = nullptr,
+	const VkDescriptorSet sets[] = { GetCurrentFrame().globalSet, GetCurrentFrame().sceneSet, m_bindlessTable.GetSet() };
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_visibilityResolveLayout, 0, static_cast<uint32_t>(std::size(sets)), sets, 0, nullptr);
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphicsDevice->m_pipelineManager->GetPipeline(m_visibilityResolvePipeline));
+
+	const GPUData::VisibilityResolveConstants constants{
+		.visibilityIndex = static_cast<int>(slot),
+		.renderSize = { static_cast<float>(extent.width), static_cast<float>(extent.height) },
 	};
+	vkCmdPushConstants(cmd, m_visibilityResolveLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(GPUData::VisibilityResolveConstants), &constants);
+	vkCmdDraw(cmd, 3, 1, 0, 0);
 
-	vkBeginCommandBuffer(cmd, &cmdBeginInfo);
+	// Fills the pixels the resolve discarded, tested against the visibility pass depth
+	const DrawBatch skyboxBatch{ .material = &m_materials["skyboxMaterial"], .mesh = &m_meshes.get(m_skybox.meshHandle), .firstIndex = m_skyboxDrawIndex, .instanceCount = 1U };
+	const GpuZone skyboxZone(m_graphicsDevice->m_gpuProfiler, cmd, "Skybox");
+	recordDraws(cmd, &skyboxBatch, 1U, DrawMode::SHADED);
+}
+
+uint32_t Renderer::rebindFrameSlot(uint32_t& slot, VkImageView view, VkSampler sampler)
+{
+	// A fresh slot each frame, frames in flight keep reading the previous one until it is retired
+	const uint32_t newSlot = m_bindlessTable.Allocate();
+	if (newSlot == 0U)
+	{
+		return 0U;
+	}
+	m_bindlessTable.Write(newSlot, view, sampler, VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL);
+	m_bindlessTable.Flush();
+	if (slot != 0U)
+	{
+		m_bindlessTable.Free(slot);
+	}
+	slot = newSlot;
+	return newSlot;
+}
+
+void Renderer::upscale(VkCommandBuffer cmd, VkImageView sceneView, VkExtent2D sceneExtent)
+{
+	ZoneScoped;
 
+	const uint32_t slot = rebindFrameSlot(m_upscaleSlot, sceneView, m_upscaleSampler);
+	if (slot == 0U)
+	{
+		LOG_CORE_WARN("Bindless table full, skipping upscale.");
+		return;
+	}
+
+	const VkExtent2D extent = m_graphicsDevice->GetBackBufferExtent();
 	const VkViewport viewport{
 		.x = 0.0f,
 		.y = 0.0f,
-		.width = static_cast<float>(m_graphicsDevice->m_window->GetWidth()),
-		.height = static_cast<float>(m_graphicsDevice->m_window->GetHeight()),
+		.width = static_cast<float>(extent.width),
+		.height = static_cast<float>(extent.height),
 		.minDepth = 0.0f,
 		.maxDepth = 1.0f,
 	};
-
 	const VkRect2D scissor{
 		.offset = {.x = 0,.y = 0},
-		.extent = {.width = m_graphicsDevice->m_window->GetWidth(), .height = m_graphicsDevice->m_window->GetHeight()}
+		.extent = extent,
 	};
-
 	vkCmdSetViewport(cmd, 0, 1, &viewport);
 	vkCmdSetScissor(cmd, 0, 1, &scissor);
 
-	// Why src is NONE, https://github.com/KhronosGroup/Vulkan-Docs/wiki/Synchronization-Examples#interactions-with-semaphores
-	const VkImageMemoryBarrier2 presentImgMemBarrier{
-		.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
-		.srcStageMask = VK_PIPELINE_STAGE_2_NONE,
-		.srcAccessMask = VK_ACCESS_2_NONE,
-		.dstStageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
-		.dstAccessMask = VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
-		.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-		.newLayout = VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL,
-		.image = m_graphicsDevice->GetBackBuffer().image,
-		.subresourceRange = {
-			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-			.baseMipLevel = 0,
-			.levelCount = 1,
-			.baseArrayLayer = 0,
-			.layerCount = 1,
-		}
+	const VkDescriptorSet bindlessSet = m_bindlessTable.GetSet();
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_upscaleLayout, 2, 1, &bindlessSet, 0, nullptr);
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphicsDevice->m_pipelineManager->GetPipeline(m_upscalePipeline));
+
+	// The rendered pixels are the top left of the scene image
+	const glm::vec2 sceneSize{ static_cast<float>(sceneExtent.width), static_cast<float>(sceneExtent.height) };
+	const glm::vec2 renderSize{ static_cast<float>(m_renderExtent.width), static_cast<float>(m_renderExtent.height) };
+	const glm::vec2 outputSize{ static_cast<float>(extent.width), static_cast<float>(extent.height) };
+	const GPUData::UpscaleConstants constants{
+		.sourceIndex = static_cast<int>(slot),
+		.pixelToUv = renderSize / (sceneSize * outputSize),
+		.maxUv = (renderSize - 0.5f) / sceneSize,
 	};
+	vkCmdPushConstants(cmd, m_upscaleLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(GPUData::UpscaleConstants), &constants);
+	vkCmdDraw(cmd, 3, 1, 0, 0);
+}
 
-	const VkImageMemoryBarrier2 renderImgMemBarrier = presentImgMemBarrier;
+void Renderer::SetRenderPath(RenderPath path)
+{
+	if (path == RenderPath::VISIBILITY_BUFFER && !m_graphicsDevice->IsFragmentPrimitiveIdSupported())
+	{
+		LOG_CORE_WARN("Visibility buffer needs the geometry shader feature, staying on the forward path.");
+		return;
+	}
+	m_renderPath = path;
+}
 
-	const VkImageMemoryBarrier2 depthImgMemBarrier{
-		.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
-		.srcStageMask = VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT,
-		.srcAccessMask = VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
-		.dstStageMask = VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT,
-		.dstAccessMask = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
-		.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-		.newLayout = VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL,
-		.image = m_graphicsDevice->GetImage(m_graphicsDevice->GetRenderTargetImage(m_depthTarget)),
-		.subresourceRange = {
-			.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT,
-			.baseMipLevel = 0,
-			.levelCount = 1,
-			.baseArrayLayer = 0,
-			.layerCount = 1,
-		}
+void Renderer::initShadows()
+{
+	ZoneScoped;
+
+	const VkImageCreateInfo imageInfo = VulkanInit::imageCreateInfo(DEPTH_FORMAT, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VkExtent3D{ .width = SHADOW_MAP_SIZE, .height = SHADOW_MAP_SIZE, .depth = 1 });
+	const ImageCreateInfo createInfo{
+		.imageInfo = imageInfo,
+		.imageType = ImageCreateInfo::ImageType::TEXTURE_2D,
+		.usage = ImageCreateInfo::Usage::DEPTH,
+		.category = MemoryCategory::RENDER_TARGET,
 	};
 
-	const VkImageMemoryBarrier2 initialBarriers[] = { presentImgMemBarrier,renderImgMemBarrier, depthImgMemBarrier};
+	// Render targets are never moved by defragmentation, so the slots are written once
+	for (ShadowCascadeImages& images : m_shadowImages)
+	{
+		images.staticCache = m_graphicsDevice->CreateImage(createInfo);
+		images.shadowMap = m_graphicsDevice->CreateImage(createInfo);
+		images.staticCacheSlot = m_bindlessTable.Allocate();
+		images.shadowMapSlot = m_bindlessTable.Allocate();
+		images.staticCacheLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		images.shadowMapLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		m_bindlessTable.Write(images.staticCacheSlot, m_graphicsDevice->GetImageView(images.staticCache), m_graphicsDevice->m_defaultSampler, VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL);
+		m_bindlessTable.Write(images.shadowMapSlot, m_graphicsDevice->GetImageView(images.shadowMap), m_graphicsDevice->m_defaultSampler, VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL);
+	}
+}
+
+void Renderer::updateShadowBounds()
+{
+	if (m_entities.empty())
+	{
+		return;
+	}
+
+	// Cascades cover this in depth, dynamic casters that later leave it are clipped
+	glm::vec3 minBounds{ std::numeric_limits<float>::max() };
+	glm::vec3 maxBounds{ std::numeric_limits<float>::lowest() };
+	for (Runic::Entity* entity : m_entities)
+	{
+		const RenderMesh& mesh = m_meshes.get(entity->GetComponent<RenderableComponent>().meshHandle);
+		const glm::mat4 modelMatrix = entity->BuildWorldMatrix();
+		const float maxScale = std::max({ glm::length(glm::vec3(modelMatrix[0])), glm::length(glm::vec3(modelMatrix[1])), glm::length(glm::vec3(modelMatrix[2])) });
+		const glm::vec3 center = glm::vec3(modelMatrix * glm::vec4(mesh.boundsCenter, 1.0f));
+		const float radius = mesh.boundsRadius * maxScale;
+		minBounds = glm::min(minBounds, center - radius);
+		maxBounds = glm::max(maxBounds, center + radius);
+	}
 
-	const VkDependencyInfo presentImgDependencyInfo = {
-		.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
-		.imageMemoryBarrierCount = std::size(initialBarriers),
-		.pImageMemoryBarriers = initialBarriers,
+	const glm::vec3 center = (minBounds + maxBounds) * 0.5f;
+	m_shadowCascades.SetSceneBounds(center, glm::length(maxBounds - center));
+}
+
+std::array<RenderGraphImage, SHADOW_CASCADE_COUNT> Renderer::addShadowPasses()
+{
+	ZoneScoped;
+
+	std::array<RenderGraphImage, SHADOW_CASCADE_COUNT> sampledImages{};
+	m_shadowCacheRefreshes = 0U;
+
+	GPUData::Shadows* shadowData = m_graphicsDevice->GetMappedData<GPUData::Shadows>(GetCurrentFrame().shadowBuffer);
+	if (m_entities_with_lights.count(LightComponent::LightType::Directional) == 0)
+	{
+		shadowData->params = { 0.0f, 0.0f, 0.0f, 0.0f };
+		return sampledImages;
+	}
+
+	const LightComponent& light = m_entities_with_lights[LightComponent::LightType::Directional][0]->GetComponent<LightComponent>();
+	m_shadowCascades.Update(m_currentCamera->BuildViewMatrix(), glm::radians(m_currentCamera->m_fov), m_currentCamera->m_aspect, m_currentCamera->m_near, light.direction);
+	shadowData->params = { 1.0f / static_cast<float>(SHADOW_MAP_SIZE), 1.0f, 0.0f, 0.0f };
+
+	static constexpr const char* STATIC_CACHE_NAMES[] = { "Shadow cache 0", "Shadow cache 1", "Shadow cache 2", "Shadow cache 3" };
+	static constexpr const char* SHADOW_MAP_NAMES[] = { "Shadow cascade 0", "Shadow cascade 1", "Shadow cascade 2", "Shadow cascade 3" };
+	static_assert(std::size(STATIC_CACHE_NAMES) == SHADOW_CASCADE_COUNT && std::size(SHADOW_MAP_NAMES) == SHADOW_CASCADE_COUNT);
+
+	// Earlier frames on the queue may still sample or write these, ALL_COMMANDS orders against all of them
+	const auto importShadowImage = [this](const char* name, ImageHandle image, VkImageLayout& layout) {
+		const RenderGraphImage graphImage = m_renderGraph.Import(name, ImportedImageDesc{
+			.image = m_graphicsDevice->GetImage(image),
+			.imageView = m_graphicsDevice->GetImageView(image),
+			.format = DEPTH_FORMAT,
+			.extent = { SHADOW_MAP_SIZE, SHADOW_MAP_SIZE },
+			.aspect = VK_IMAGE_ASPECT_DEPTH_BIT,
+			.initialLayout = layout,
+			.initialStage = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+			.finalLayout = VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL,
+		});
+		layout = VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL;
+		return graphImage;
 	};
 
-	vkCmdPipelineBarrier2(cmd, &presentImgDependencyInfo);
+	const VkExtent2D extent{ SHADOW_MAP_SIZE, SHADOW_MAP_SIZE };
+	for (uint32_t i = 0; i < SHADOW_CASCADE_COUNT; ++i)
+	{
+		const ShadowCascades::Cascade& cascade = m_shadowCascades.GetCascade(i);
+		ShadowCascadeImages& images = m_shadowImages[i];
 
-	const VkRenderingAttachmentInfo colorAttachInfo{
-		.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
-		.imageView = m_graphicsDevice->GetBackBuffer().imageView,
-		.imageLayout = VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL,
-		.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
-		.storeOp = VK_ATTACHMENT_STORE_OP_STORE,
-		.clearValue = { 
-			.color = {0.0f, 0.0f, 0.0f, 1.0f}
+		shadowData->viewProj[i] = cascade.viewProj;
+		shadowData->splitDepths[i] = cascade.splitDepth;
+		shadowData->texelSizes[i] = cascade.texelSize;
+		shadowData->staticCacheIndices[i] = static_cast<int>(images.staticCacheSlot);
+
+		const RenderGraphImage staticCache = importShadowImage(STATIC_CACHE_NAMES[i], images.staticCache, images.staticCacheLayout);
+		if (cascade.staticDirty)
+		{
+			m_renderGraph.AddPass(STATIC_CACHE_NAMES[i], [this, i](VkCommandBuffer passCmd) { drawShadowCasters(passCmd, i, true, false); })
+				.Depth(staticCache, VK_ATTACHMENT_LOAD_OP_CLEAR, 1.0f);
+			++m_shadowCacheRefreshes;
 		}
-	};
 
-	const VkRenderingAttachmentInfo depthAttachInfo{
-		.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
-		.imageView = m_graphicsDevice->GetImageView(m_graphicsDevice->GetRenderTargetImage(m_depthTarget)),
-		.imageLayout = VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL,
-		.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
-		.storeOp = VK_ATTACHMENT_STORE_OP_STORE,
-		.clearValue = {
-			.depthStencil = {1.0f},
+		// With nothing dynamic in the cascade, shading samples the cache and the cascade costs nothing
+		const bool hasDynamicCasters = std::any_of(m_drawItems.begin(), m_drawItems.end(), [this, i](const DrawItem& item) {
+			return !item.isStatic && m_shadowCascades.Intersects(i, item.boundsCenter, item.boundsRadius);
+		});
+		if (!hasDynamicCasters)
+		{
+			shadowData->shadowMapIndices[i] = static_cast<int>(images.staticCacheSlot);
+			sampledImages[i] = staticCache;
+			continue;
 		}
+
+		// The composite writes every texel, so the old contents are never loaded
+		const RenderGraphImage shadowMap = importShadowImage(SHADOW_MAP_NAMES[i], images.shadowMap, images.shadowMapLayout);
+		m_renderGraph.AddPass(SHADOW_MAP_NAMES[i], [this, i](VkCommandBuffer passCmd) { drawShadowCasters(passCmd, i, false, true); })
+			.Depth(shadowMap, VK_ATTACHMENT_LOAD_OP_DONT_CARE)
+			.Sample(staticCache);
+		shadowData->shadowMapIndices[i] = static_cast<int>(images.shadowMapSlot);
+		sampledImages[i] = shadowMap;
+	}
+
+	return sampledImages;
+}
+
+void Renderer::drawShadowCasters(VkCommandBuffer cmd, uint32_t cascade, bool staticCasters, bool composite)
+{
+	ZoneScoped;
+
+	const VkViewport viewport{
+		.x = 0.0f,
+		.y = 0.0f,
+		.width = static_cast<float>(SHADOW_MAP_SIZE),
+		.height = static_cast<float>(SHADOW_MAP_SIZE),
+		.minDepth = 0.0f,
+		.maxDepth = 1.0f,
 	};
+	const VkRect2D scissor{
+		.offset = {.x = 0,.y = 0},
+		.extent = {.width = SHADOW_MAP_SIZE, .height = SHADOW_MAP_SIZE},
+	};
+	vkCmdSetViewport(cmd, 0, 1, &viewport);
+	vkCmdSetScissor(cmd, 0, 1, &scissor);
+
+	const VkDescriptorSet sets[] = { GetCurrentFrame().globalSet, GetCurrentFrame().sceneSet, m_bindlessTable.GetSet() };
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_shadowLayout, 0, static_cast<uint32_t>(std::size(sets)), sets, 0, nullptr);
 
-	const VkRenderingInfo renderInfo{
-		.sType = VK_STRUCTURE_TYPE_RENDERING_INFO,
-		.renderArea = scissor,
-		.layerCount = 1,
-		.colorAttachmentCount = 1,
-		.pColorAttachments = &colorAttachInfo,
-		.pDepthAttachment = &depthAttachInfo,
+	const VkShaderStageFlags pushStages = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+	GPUData::ShadowPushConstants constants{
+		.drawDataIndex = 0,
+		.cascade = static_cast<int>(cascade),
 	};
-	vkCmdBeginRendering(cmd, &renderInfo);
 
-	drawObjects(cmd, m_entities);
+	// Copies the static cache in as depth, dynamic casters are then depth tested against it
+	if (composite)
+	{
+		vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphicsDevice->m_pipelineManager->GetPipeline(m_shadowCompositePipeline));
+		vkCmdPushConstants(cmd, m_shadowLayout, pushStages, 0, sizeof(GPUData::ShadowPushConstants), &constants);
+		vkCmdDraw(cmd, 3, 1, 0, 0);
+	}
 
-	vkCmdEndRendering(cmd);
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphicsDevice->m_pipelineManager->GetPipeline(m_shadowPipeline));
 
-	m_graphicsDevice->AddImGuiToCommandBuffer();
+	const auto casts = [&](size_t item) {
+		const DrawItem& drawItem = m_drawItems[item];
+		return drawItem.isStatic == staticCasters && m_shadowCascades.Intersects(cascade, drawItem.boundsCenter, drawItem.boundsRadius);
+	};
 
-	vkEndCommandBuffer(cmd);
+	// Runs of casters with the same mesh are instanced, culled items split a batch
+	const RenderMesh* lastMesh = nullptr;
+	size_t item = 0;
+	while (item < m_drawItems.size())
+	{
+		if (!casts(item))
+		{
+			++item;
+			continue;
+		}
+		const DrawItem& drawItem = m_drawItems[item];
+		size_t end = item + 1;
+		while (end < m_drawItems.size() && m_drawItems[end].mesh == drawItem.mesh && casts(end))
+		{
+			++end;
+		}
+		const uint32_t instanceCount = static_cast<uint32_t>(end - item);
+
+		constants.drawDataIndex = static_cast<int>(item);
+		vkCmdPushConstants(cmd, m_shadowLayout, pushStages, 0, sizeof(GPUData::ShadowPushConstants), &constants);
+
+		const Runic::MeshDesc& meshDesc = drawItem.mesh->meshDesc;
+		if (drawItem.mesh != lastMesh)
+		{
+			const VkDeviceSize offset{ 0 };
+			const VkBuffer vertexBuffer = m_graphicsDevice->GetBuffer(drawItem.mesh->positionBuffer);
+			vkCmdBindVertexBuffers(cmd, 0, 1, &vertexBuffer, &offset);
+			if (meshDesc.hasIndices())
+			{
+				vkCmdBindIndexBuffer(cmd, m_graphicsDevice->GetBuffer(drawItem.mesh->indexBuffer), 0, drawItem.mesh->indexType);
+			}
+			lastMesh = drawItem.mesh;
+		}
+
+		if (meshDesc.hasIndices())
+		{
+			vkCmdDrawIndexed(cmd, static_cast<uint32_t>(meshDesc.indices.size()), instanceCount, 0, 0, 0);
+		}
+		else
+		{
+			vkCmdDraw(cmd, static_cast<uint32_t>(meshDesc.vertices.size()), instanceCount, 0, 0);
+		}
+		item = end;
+	}
+}
+
+void Renderer::Draw(Camera* const camera)
+{
+	ZoneScoped;
+
+	m_currentCamera = camera;
+
+	const uint64_t heapAllocationsBefore = GetHeapAllocationCount();
+
+	if (!m_graphicsDevice->BeginFrame())
+	{
+		return;
+	}
+
+	// The frame slot's last submission has finished, nothing still points into its arenas
+	m_frameArenas.BeginFrame(m_graphicsDevice->GetCurrentFrameNumber());
+
+	m_graphicsDevice->m_pipelineManager->Update();
+
+	// Decided before anything is recorded, texture demand and every scene viewport follow it
+	const VkExtent2D extent = m_graphicsDevice->GetBackBufferExtent();
+	VkExtent2D sceneExtent = extent;
+	m_renderExtent = extent;
+	if (m_dynamicResolutionEnabled)
+	{
+		m_dynamicResolution.Update(m_graphicsDevice->m_gpuProfiler.GetLastFrameMs());
+		sceneExtent = m_dynamicResolution.GetMaxExtent(extent);
+		m_renderExtent = m_dynamicResolution.GetRenderExtent(extent);
+	}
+	TracyPlot("Resolution scale", GetResolutionScale());
+
+	updateTextureDemand();
 
-	const VkPipelineStageFlags waitStage { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
+	const VkCommandBuffer cmd = m_graphicsDevice->m_graphics.commands[m_graphicsDevice->GetCurrentFrameNumber()].buffer;
 
-	const VkSubmitInfo submit = {
-		.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+	const VkCommandBufferBeginInfo cmdBeginInfo = {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
 		.pNext = nullptr,
-		.waitSemaphoreCount = 1,
-		.pWaitSemaphores = &m_graphicsDevice->GetCurrentFrame().presentSem,
-		.pWaitDstStageMask = &waitStage,
-		.commandBufferCount = 1,
-		.pCommandBuffers = &cmd,
-		.signalSemaphoreCount = 1,
-		.pSignalSemaphores = &m_graphicsDevice->GetCurrentFrame().renderSem,
+		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+		.pInheritanceInfo = nullptr,
+	};
+
+	vkBeginCommandBuffer(cmd, &cmdBeginInfo);
+	m_graphicsDevice->m_gpuProfiler.BeginFrame(cmd, m_graphicsDevice->GetCurrentFrameNumber());
+	m_commandRecorder.BeginFrame(m_graphicsDevice->GetCurrentFrameNumber());
+
+	std::optional<GpuZone> uploadZone;
+	uploadZone.emplace(m_graphicsDevice->m_gpuProfiler, cmd, "Uploads");
+
+	// Moved textures go to a fresh slot, frames in flight keep sampling the old view through the old slot.
+	// Every texture owns its image, so limiting moves to the free slots means each one gets a slot.
+	for (const ImageHandle moved : m_graphicsDevice->Defragment(cmd, m_bindlessTable.GetFreeSlots(), &m_frameArenas.Get()))
+	{
+		for (BindlessTexture& texture : m_textures)
+		{
+			if (texture.slot != 0U && texture.image() == moved())
+			{
+				const uint32_t slot = m_bindlessTable.Allocate();
+				assert(slot != 0U);
+				m_bindlessTable.Write(slot, m_graphicsDevice->GetImageView(moved), m_graphicsDevice->m_defaultSampler);
+				m_bindlessTable.Free(texture.slot);
+				texture.slot = slot;
+			}
+		}
+	}
+
+	// Mip uploads are recorded ahead of rendering, their descriptors go out with this frame's flush
+	m_textureStreamer.Update(cmd, &m_frameArenas.Get());
+	uploadZone.reset();
+	m_bindlessTable.Flush();
+
+	// The acquire semaphore is waited on at colour attachment output, the first transition chains onto it
+	const Image backBuffer = m_graphicsDevice->GetBackBuffer();
+	const RenderGraphImage backBufferImage = m_renderGraph.Import("Back buffer", ImportedImageDesc{
+		.image = backBuffer.image,
+		.imageView = backBuffer.imageView,
+		.format = m_graphicsDevice->GetBackBufferImageFormat(),
+		.extent = extent,
+		.initialStage = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+		.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+	});
+	const RenderGraphImage depthImage = m_renderGraph.CreateTransient("Depth", TransientImageDesc{ .format = DEPTH_FORMAT, .extent = sceneExtent, .depth = true });
+
+	// Scene passes only touch the rendered area of their maximum size targets
+	RenderGraphImage sceneImage = backBufferImage;
+	if (m_dynamicResolutionEnabled)
+	{
+		sceneImage = m_renderGraph.CreateTransient("Scene colour", TransientImageDesc{
+			.format = m_graphicsDevice->GetBackBufferImageFormat(),
+			.extent = sceneExtent,
+			.usage = VK_IMAGE_USAGE_SAMPLED_BIT,
+		});
+	}
+
+	drawRendererPanel();
+	prepareDraws(m_entities);
+
+	// Whichever pass shades samples the cascades, which orders it after the shadow passes
+	const std::array<RenderGraphImage, SHADOW_CASCADE_COUNT> shadowMaps = addShadowPasses();
+	const auto sampleShadowMaps = [&shadowMaps](RenderGraph::PassBuilder& pass) {
+		for (const RenderGraphImage shadowMap : shadowMaps)
+		{
+			if (shadowMap.IsValid())
+			{
+				pass.Sample(shadowMap);
+			}
+		}
 	};
 
-	vkQueueSubmit(m_graphicsDevice->m_graphics.queue, 1, &submit, m_graphicsDevice->GetCurrentFrame().renderFen);
+	// Draws are recorded in parallel, see drawObjects
+	if (m_renderPath == RenderPath::VISIBILITY_BUFFER)
+	{
+		const RenderGraphImage visibilityImage = m_renderGraph.CreateTransient("Visibility", TransientImageDesc{
+			.format = VISIBILITY_FORMAT,
+			.extent = sceneExtent,
+			.usage = VK_IMAGE_USAGE_SAMPLED_BIT,
+		});
+
+		m_renderGraph.AddPass("Visibility", [this](VkCommandBuffer passCmd) { drawObjects(passCmd, DrawMode::VISIBILITY); })
+			.Color(visibilityImage, VK_ATTACHMENT_LOAD_OP_CLEAR, VkClearColorValue{ .uint32 = { 0U, 0U, 0U, 0U } })
+			.Depth(depthImage, VK_ATTACHMENT_LOAD_OP_CLEAR, 1.0f)
+			.RenderingFlags(VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT)
+			.RenderArea(m_renderExtent);
+
+		// Shading cost is one full screen pass, whatever the triangle count and overdraw
+		RenderGraph::PassBuilder resolvePass = m_renderGraph.AddPass("Material resolve", [this, visibilityImage](VkCommandBuffer passCmd) { resolveVisibility(passCmd, m_renderGraph.GetImageView(visibilityImage)); });
+		resolvePass.Color(sceneImage, VK_ATTACHMENT_LOAD_OP_CLEAR, VkClearColorValue{ .float32 = { 0.0f, 0.0f, 0.0f, 1.0f } })
+			.Sample(visibilityImage)
+			.DepthTest(depthImage)
+			.RenderArea(m_renderExtent);
+		sampleShadowMaps(resolvePass);
+	}
+	else if (m_depthPrePass)
+	{
+		m_renderGraph.AddPass("Depth pre-pass", [this](VkCommandBuffer passCmd) { drawObjects(passCmd, DrawMode::DEPTH); })
+			.Depth(depthImage, VK_ATTACHMENT_LOAD_OP_CLEAR, 1.0f)
+			.RenderingFlags(VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT)
+			.RenderArea(m_renderExtent);
+
+		// Only the nearest surface passes the EQUAL test, so each pixel is shaded once
+		RenderGraph::PassBuilder mainPass = m_renderGraph.AddPass("Main pass", [this](VkCommandBuffer passCmd) { drawObjects(passCmd, DrawMode::SHADED); });
+		mainPass.Color(sceneImage, VK_ATTACHMENT_LOAD_OP_CLEAR, VkClearColorValue{ .float32 = { 0.0f, 0.0f, 0.0f, 1.0f } })
+			.DepthTest(depthImage)
+			.RenderingFlags(VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT)
+			.RenderArea(m_renderExtent);
+		sampleShadowMaps(mainPass);
+	}
+	else
+	{
+		RenderGraph::PassBuilder mainPass = m_renderGraph.AddPass("Main pass", [this](VkCommandBuffer passCmd) { drawObjects(passCmd, DrawMode::SHADED); });
+		mainPass.Color(sceneImage, VK_ATTACHMENT_LOAD_OP_CLEAR, VkClearColorValue{ .float32 = { 0.0f, 0.0f, 0.0f, 1.0f } })
+			.Depth(depthImage, VK_ATTACHMENT_LOAD_OP_CLEAR, 1.0f)
+			.RenderingFlags(VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT)
+			.RenderArea(m_renderExtent);
+		sampleShadowMaps(mainPass);
+	}
+
+	if (m_dynamicResolutionEnabled)
+	{
+		// Covers the whole back buffer, so its old contents are never loaded
+		m_renderGraph.AddPass("Upscale", [this, sceneImage, sceneExtent](VkCommandBuffer passCmd) { upscale(passCmd, m_renderGraph.GetImageView(sceneImage), sceneExtent); })
+			.Color(backBufferImage, VK_ATTACHMENT_LOAD_OP_DONT_CARE)
+			.Sample(sceneImage);
+	}
+
+	m_renderGraph.AddPass("ImGui", [this](VkCommandBuffer passCmd) { m_graphicsDevice->AddImGuiToCommandBuffer(passCmd); })
+		.Color(backBufferImage, VK_ATTACHMENT_LOAD_OP_LOAD)
+		.External();
+
+	m_renderGraph.Execute(cmd);
+	m_renderGraph.Reset();
+
+	vkEndCommandBuffer(cmd);
+
+	m_graphicsDevice->SubmitFrame(cmd);
 
 	m_graphicsDevice->EndFrame();
 	m_graphicsDevice->Present();
+
+	m_frameHeapAllocations = GetHeapAllocationCount() - heapAllocationsBefore;
+	TracyPlot("Heap allocations per frame", static_cast<int64_t>(m_frameHeapAllocations));
 }
 
 void Runic::Renderer::GiveRenderables(const std::vector<std::shared_ptr<Runic::Entity>>& entities)
@@ -366,6 +913,44 @@ void Runic::Renderer::GiveRenderables(const std::vector<std::shared_ptr<Runic::E
 			m_entities_with_lights[entity->GetComponent<LightComponent>().lightType].push_back(entity.get());
 		}
 	}
+
+	updateShadowBounds();
+}
+
+void Renderer::drawRendererPanel()
+{
+	ImGui::Begin("Renderer");
+
+	int renderPath = static_cast<int>(m_renderPath);
+	if (ImGui::Combo("Render path", &renderPath, "Forward\0Visibility buffer\0"))
+	{
+		SetRenderPath(static_cast<RenderPath>(renderPath));
+	}
+
+	// Compare the "Main pass" GPU time with and without
+	if (m_renderPath == RenderPath::FORWARD)
+	{
+		ImGui::Checkbox("Depth pre-pass", &m_depthPrePass);
+	}
+
+	ImGui::Checkbox("Dynamic resolution", &m_dynamicResolutionEnabled);
+	if (m_dynamicResolutionEnabled)
+	{
+		float budget = m_dynamicResolution.GetBudget();
+		if (ImGui::SliderFloat("GPU budget (ms)", &budget, 4.0f, 33.0f))
+		{
+			m_dynamicResolution.SetBudget(budget);
+		}
+		ImGui::Text("Resolution scale: %.2f (%ux%u)", m_dynamicResolution.GetScale(), m_renderExtent.width, m_renderExtent.height);
+	}
+
+	// Stats from the last executed graph
+	const RenderGraph::Stats& graphStats = m_renderGraph.GetStats();
+	ImGui::Text("Graph: %u passes, %u culled, %u barriers", graphStats.passes, graphStats.culledPasses, graphStats.barriers);
+	ImGui::Text("Draws: %zu objects in %zu instanced batches", m_drawItems.size(), m_drawBatches.size());
+	ImGui::Text("Shadow caches redrawn: %u of %u", m_shadowCacheRefreshes, SHADOW_CASCADE_COUNT);
+
+	ImGui::End();
 }
 
 void Renderer::initShaders()
@@ -377,7 +962,6 @@ void Renderer::initShaders()
 	{
 		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 10 },
 		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 10 },
-		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, MAX_TEXTURES },
 	};
 	const VkDescriptorPoolCreateInfo poolCreateInfo{
 		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
@@ -390,41 +974,28 @@ void Renderer::initShaders()
 
 	// create buffers
 
-	for (int i = 0; i < FRAME_OVERLAP; ++i)
+	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
 	{
-		m_frame[i].drawDataBuffer = m_graphicsDevice->CreateBuffer({ .size = sizeof(GPUData::DrawData) * MAX_OBJECTS, .usage = GFX::Buffer::Usage::STORAGE });
-		m_frame[i].transformBuffer =  m_graphicsDevice->CreateBuffer({ .size = sizeof(GPUData::Transform) * MAX_OBJECTS, .usage = GFX::Buffer::Usage::STORAGE });
-		m_frame[i].materialBuffer =  m_graphicsDevice->CreateBuffer({ .size = sizeof(GPUData::Material) * MAX_OBJECTS, .usage = GFX::Buffer::Usage::STORAGE });
-
-		m_frame[i].cameraBuffer =  m_graphicsDevice->CreateBuffer({ .size = sizeof(GPUData::Camera), .usage = GFX::Buffer::Usage::UNIFORM });
-		m_frame[i].dirLightBuffer =  m_graphicsDevice->CreateBuffer({ .size = sizeof(GPUData::DirectionalLight), .usage = GFX::Buffer::Usage::UNIFORM });
-		m_frame[i].pointLightBuffer =  m_graphicsDevice->CreateBuffer({ .size = sizeof(GPUData::PointLight) * MAX_POINT_LIGHTS, .usage = GFX::Buffer::Usage::STORAGE });
+		m_frame[i].drawDataBuffer = m_graphicsDevice->CreateBuffer({ .size = sizeof(GPUData::DrawData) * MAX_OBJECTS, .usage = GFX::Buffer::Usage::STORAGE, .memory = BufferCreateInfo::Memory::DIRECT_WRITE, .category = MemoryCategory::SCENE_BUFFER });
+		m_frame[i].transformBuffer =  m_graphicsDevice->CreateBuffer({ .size = sizeof(GPUData::Transform) * MAX_OBJECTS, .usage = GFX::Buffer::Usage::STORAGE, .memory = BufferCreateInfo::Memory::DIRECT_WRITE, .category = MemoryCategory::SCENE_BUFFER });
+		m_frame[i].materialBuffer =  m_graphicsDevice->CreateBuffer({ .size = sizeof(GPUData::Material) * MAX_OBJECTS, .usage = GFX::Buffer::Usage::STORAGE, .memory = BufferCreateInfo::Memory::DIRECT_WRITE, .category = MemoryCategory::SCENE_BUFFER });
+
+		m_frame[i].cameraBuffer =  m_graphicsDevice->CreateBuffer({ .size = sizeof(GPUData::Camera), .usage = GFX::Buffer::Usage::UNIFORM, .memory = BufferCreateInfo::Memory::DIRECT_WRITE, .category = MemoryCategory::SCENE_BUFFER });
+		m_frame[i].dirLightBuffer =  m_graphicsDevice->CreateBuffer({ .size = sizeof(GPUData::DirectionalLight), .usage = GFX::Buffer::Usage::UNIFORM, .memory = BufferCreateInfo::Memory::DIRECT_WRITE, .category = MemoryCategory::SCENE_BUFFER });
+		m_frame[i].pointLightBuffer =  m_graphicsDevice->CreateBuffer({ .size = sizeof(GPUData::PointLight) * MAX_POINT_LIGHTS, .usage = GFX::Buffer::Usage::STORAGE, .memory = BufferCreateInfo::Memory::DIRECT_WRITE, .category = MemoryCategory::SCENE_BUFFER });
+		m_frame[i].shadowBuffer =  m_graphicsDevice->CreateBuffer({ .size = sizeof(GPUData::Shadows), .usage = GFX::Buffer::Usage::UNIFORM, .memory = BufferCreateInfo::Memory::DIRECT_WRITE, .category = MemoryCategory::SCENE_BUFFER });
 	}
 	// create descriptor layout
 
-	const VkDescriptorBindingFlags flags[] = {
-		0,
-		0,
-		0,
-		VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT
-	};
-
-	const VkDescriptorSetLayoutBindingFlagsCreateInfo globalBindingFlags{
-		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO,
-		.bindingCount = static_cast<uint32_t>(std::size(flags)),
-		.pBindingFlags = flags,
-	};
-
 	const VkDescriptorSetLayoutBinding globalBindings[] = {
 		{VulkanInit::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0)},
 		{VulkanInit::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 1)},
 		{VulkanInit::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 2)},
-		{VulkanInit::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 3, MAX_TEXTURES)},
 	};
 
 	const VkDescriptorSetLayoutCreateInfo globalSetLayoutInfo = {
 		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
-		.pNext = &globalBindingFlags,
+		.pNext = nullptr,
 		.flags = 0,
 		.bindingCount = static_cast<uint32_t>(std::size(globalBindings)),
 		.pBindings = globalBindings,
@@ -433,7 +1004,8 @@ void Renderer::initShaders()
 	const VkDescriptorSetLayoutBinding sceneBindings[] = {
 		{VulkanInit::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0)},
 		{VulkanInit::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 1)},
-		{VulkanInit::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 2)}
+		{VulkanInit::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 2)},
+		{VulkanInit::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 3)},
 	};
 	const VkDescriptorSetLayoutCreateInfo sceneSetLayoutInfo = {
 		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
@@ -448,17 +1020,12 @@ void Renderer::initShaders()
 
 	// create descriptors
 
-	uint32_t counts[] = { MAX_TEXTURES };  // Set 0 has a variable count descriptor with a maximum of 32 elements
-
-	const VkDescriptorSetVariableDescriptorCountAllocateInfo globalSetCounts = {
-		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO,
-		.descriptorSetCount = 1,
-		.pDescriptorCounts = counts
-	};
+	// Textures live in one set shared by all frames, written after bind
+	m_bindlessTable.Init(m_graphicsDevice->m_device, std::min(MAX_TEXTURES, m_graphicsDevice->GetMaxBindlessTextures()), &m_graphicsDevice->m_retireQueue);
 
 	const VkDescriptorSetAllocateInfo allocInfo = {
 		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
-		.pNext = &globalSetCounts,
+		.pNext = nullptr,
 		.descriptorPool = m_globalPool,
 		.descriptorSetCount = 1,
 		.pSetLayouts = &m_globalSetLayout,
@@ -472,7 +1039,7 @@ void Renderer::initShaders()
 		.pSetLayouts = &m_sceneSetLayout,
 	};
 
-	for (int i = 0; i < FRAME_OVERLAP; ++i)
+	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
 	{
 		vkAllocateDescriptorSets(m_graphicsDevice->m_device, &allocInfo, &m_frame[i].globalSet);
 		vkAllocateDescriptorSets(m_graphicsDevice->m_device, &sceneAllocInfo, &m_frame[i].sceneSet);
@@ -485,7 +1052,8 @@ void Renderer::initShaders()
 		VkDescriptorBufferInfo sceneBuffers[] = {
 			{.buffer =m_graphicsDevice->GetBuffer(m_frame[i].cameraBuffer), .range =m_graphicsDevice->GetBufferSize(m_frame[i].cameraBuffer)},
 			{.buffer =m_graphicsDevice->GetBuffer(m_frame[i].dirLightBuffer), .range =m_graphicsDevice->GetBufferSize(m_frame[i].dirLightBuffer) },
-			{.buffer =m_graphicsDevice->GetBuffer(m_frame[i].pointLightBuffer), .range =m_graphicsDevice->GetBufferSize(m_frame[i].pointLightBuffer) }
+			{.buffer =m_graphicsDevice->GetBuffer(m_frame[i].pointLightBuffer), .range =m_graphicsDevice->GetBufferSize(m_frame[i].pointLightBuffer) },
+			{.buffer =m_graphicsDevice->GetBuffer(m_frame[i].shadowBuffer), .range =m_graphicsDevice->GetBufferSize(m_frame[i].shadowBuffer) },
 		};
 
 		const VkWriteDescriptorSet globalWrites[] = {
@@ -497,7 +1065,8 @@ void Renderer::initShaders()
 		const VkWriteDescriptorSet sceneWrites[] = {
 			VulkanInit::writeDescriptorBuffer(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, m_frame[i].sceneSet, &sceneBuffers[0], 0),
 			VulkanInit::writeDescriptorBuffer(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, m_frame[i].sceneSet, &sceneBuffers[1], 1),
-			VulkanInit::writeDescriptorBuffer(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_frame[i].sceneSet, &sceneBuffers[2], 2)
+			VulkanInit::writeDescriptorBuffer(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_frame[i].sceneSet, &sceneBuffers[2], 2),
+			VulkanInit::writeDescriptorBuffer(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, m_frame[i].sceneSet, &sceneBuffers[3], 3),
 		};
 		vkUpdateDescriptorSets(m_graphicsDevice->m_device, static_cast<uint32_t>(std::size(sceneWrites)), sceneWrites, 0, nullptr);
 	}
@@ -510,36 +1079,150 @@ void Renderer::initShaders()
 		.size = sizeof(GPUData::PushConstants),
 	};
 	const std::vector<VkPushConstantRange> pushConstants = { defaultPushConstants };
-	const std::vector<VkDescriptorSetLayout> setLayouts = { m_globalSetLayout, m_sceneSetLayout };
+	const std::vector<VkDescriptorSetLayout> setLayouts = { m_globalSetLayout, m_sceneSetLayout, m_bindlessTable.GetLayout() };
 
 	VkPipelineLayout defaultPipelineLayout = m_graphicsDevice->m_pipelineManager->CreatePipelineLayout(setLayouts, pushConstants);
 
 	const std::string defaultMaterialName = "defaultMaterial";
-	PipelineHandle defaultMat = m_graphicsDevice->m_pipelineManager->CreatePipeline({
-		.name = defaultMaterialName,
-		.pipelineLayout = defaultPipelineLayout,
-		.vertexShader = "../../assets/shaders/default.vert.spv",
-		.fragmentShader = "../../assets/shaders/default.frag.spv",
-		.vertexInputDesc = RenderMesh::getVertexDescription(),
-		.colourFormat = m_graphicsDevice->GetBackBufferImageFormat(),
-		.depthFormat = DEPTH_FORMAT,
+	const std::string defaultEqualMaterialName = "defaultMaterialDepthEqual";
+	const std::string skyboxMaterialName = "skyboxMaterial";
+	const std::string depthPrePassName = "depthPrePass";
+	const std::vector<PipelineHandle> pipelines = m_graphicsDevice->m_pipelineManager->CreatePipelines({
+		{
+			.name = defaultMaterialName,
+			.pipelineLayout = defaultPipelineLayout,
+			.vertexShader = shaderPath("default.vert.spv"),
+			.fragmentShader = shaderPath("default.frag.spv"),
+			.vertexInputDesc = RenderMesh::getVertexDescription(),
+			.colourFormat = m_graphicsDevice->GetBackBufferImageFormat(),
+			.depthFormat = DEPTH_FORMAT,
+		},
+		{
+			.name = skyboxMaterialName,
+			.pipelineLayout = defaultPipelineLayout,
+			.vertexShader = shaderPath("skybox.vert.spv"),
+			.fragmentShader = shaderPath("skybox.frag.spv"),
+			.vertexInputDesc = RenderMesh::getVertexDescription(),
+			.enableDepthWrite = false,
+			.colourFormat = m_graphicsDevice->GetBackBufferImageFormat(),
+			.depthFormat = DEPTH_FORMAT,
+		},
+		{
+			.name = defaultEqualMaterialName,
+			.pipelineLayout = defaultPipelineLayout,
+			.vertexShader = shaderPath("default.vert.spv"),
+			.fragmentShader = shaderPath("default.frag.spv"),
+			.vertexInputDesc = RenderMesh::getVertexDescription(),
+			.enableDepthWrite = false,
+			.depthCompareOp = VK_COMPARE_OP_EQUAL,
+			.colourFormat = m_graphicsDevice->GetBackBufferImageFormat(),
+			.depthFormat = DEPTH_FORMAT,
+		},
+		{
+			.name = depthPrePassName,
+			.pipelineLayout = defaultPipelineLayout,
+			.vertexShader = shaderPath("depth.vert.spv"),
+			.vertexInputDesc = RenderMesh::getPositionVertexDescription(),
+			.colourFormat = VK_FORMAT_UNDEFINED,
+			.depthFormat = DEPTH_FORMAT,
+		},
 	});
-	m_materials[defaultMaterialName] = { .pipeline = defaultMat, .pipelineLayout = defaultPipelineLayout };
+
+	// Materials created asynchronously later draw with the default material until they are ready
+	m_graphicsDevice->m_pipelineManager->SetFallbackPipeline(pipelines[0]);
+
+	m_materials[defaultMaterialName] = { .pipeline = pipelines[0], .depthEqualPipeline = pipelines[2], .pipelineLayout = defaultPipelineLayout };
 	LOG_CORE_INFO("Material created: " + defaultMaterialName);
 
-	const std::string skyboxMaterialName = "skyboxMaterial";
-	PipelineHandle skyboxMat = m_graphicsDevice->m_pipelineManager->CreatePipeline({
-		.name = skyboxMaterialName,
-		.pipelineLayout = defaultPipelineLayout,
-		.vertexShader = "../../assets/shaders/skybox.vert.spv",
-		.fragmentShader = "../../assets/shaders/skybox.frag.spv",
-		.vertexInputDesc = RenderMesh::getVertexDescription(),
-		.enableDepthWrite = false,
-		.colourFormat = m_graphicsDevice->GetBackBufferImageFormat(),
-		.depthFormat = DEPTH_FORMAT,
-		});
-	m_materials[skyboxMaterialName] = { .pipeline = skyboxMat, .pipelineLayout = defaultPipelineLayout };
+	// The skybox writes no depth and is tested against the far plane either way
+	m_materials[skyboxMaterialName] = { .pipeline = pipelines[1], .depthEqualPipeline = pipelines[1], .pipelineLayout = defaultPipelineLayout };
 	LOG_CORE_INFO("Material created: " + skyboxMaterialName);
+
+	m_depthPrePassPipeline = pipelines[3];
+
+	// Shadow passes push the cascade they draw into next to the draw index, the composite reads it too
+	const VkPushConstantRange shadowPushConstants{
+		.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+		.offset = 0,
+		.size = sizeof(GPUData::ShadowPushConstants),
+	};
+	m_shadowLayout = m_graphicsDevice->m_pipelineManager->CreatePipelineLayout(setLayouts, { shadowPushConstants });
+
+	const std::vector<PipelineHandle> shadowPipelines = m_graphicsDevice->m_pipelineManager->CreatePipelines({
+		{
+			.name = "shadow",
+			.pipelineLayout = m_shadowLayout,
+			.vertexShader = shaderPath("shadow.vert.spv"),
+			.vertexInputDesc = RenderMesh::getPositionVertexDescription(),
+			.colourFormat = VK_FORMAT_UNDEFINED,
+			.depthFormat = DEPTH_FORMAT,
+		},
+		{
+			.name = "shadowComposite",
+			.pipelineLayout = m_shadowLayout,
+			.vertexShader = shaderPath("fullscreen.vert.spv"),
+			.fragmentShader = shaderPath("shadow_composite.frag.spv"),
+			.depthCompareOp = VK_COMPARE_OP_ALWAYS,
+			.colourFormat = VK_FORMAT_UNDEFINED,
+			.depthFormat = DEPTH_FORMAT,
+		},
+	});
+	m_shadowPipeline = shadowPipelines[0];
+	m_shadowCompositePipeline = shadowPipelines[1];
+
+	// Visibility buffer path, the resolve pass reads its slot from a fragment push constant
+	if (m_graphicsDevice->IsFragmentPrimitiveIdSupported())
+	{
+		const VkPushConstantRange resolvePushConstants{
+			.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+			.offset = 0,
+			.size = sizeof(GPUData::VisibilityResolveConstants),
+		};
+		m_visibilityResolveLayout = m_graphicsDevice->m_pipelineManager->CreatePipelineLayout(setLayouts, { resolvePushConstants });
+
+		const std::vector<PipelineHandle> visibilityPipelines = m_graphicsDevice->m_pipelineManager->CreatePipelines({
+			{
+				.name = "visibility",
+				.pipelineLayout = defaultPipelineLayout,
+				.vertexShader = shaderPath("visibility.vert.spv"),
+				.fragmentShader = shaderPath("visibility.frag.spv"),
+				.vertexInputDesc = RenderMesh::getPositionVertexDescription(),
+				.colourFormat = VISIBILITY_FORMAT,
+				.depthFormat = DEPTH_FORMAT,
+			},
+			{
+				.name = "visibilityResolve",
+				.pipelineLayout = m_visibilityResolveLayout,
+				.vertexShader = shaderPath("fullscreen.vert.spv"),
+				.fragmentShader = shaderPath("visibility_resolve.frag.spv"),
+				.enableDepthWrite = false,
+				.depthCompareOp = VK_COMPARE_OP_ALWAYS,
+				.colourFormat = m_graphicsDevice->GetBackBufferImageFormat(),
+				.depthFormat = DEPTH_FORMAT,
+			},
+		});
+		m_visibilityPipeline = visibilityPipelines[0];
+		m_visibilityResolvePipeline = visibilityPipelines[1];
+	}
+
+	// Dynamic resolution upscale, only samples the bindless table
+	const VkPushConstantRange upscalePushConstants{
+		.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+		.offset = 0,
+		.size = sizeof(GPUData::UpscaleConstants),
+	};
+	m_upscaleLayout = m_graphicsDevice->m_pipelineManager->CreatePipelineLayout(setLayouts, { upscalePushConstants });
+	m_upscalePipeline = m_graphicsDevice->m_pipelineManager->CreatePipelines({
+		{
+			.name = "upscale",
+			.pipelineLayout = m_upscaleLayout,
+			.vertexShader = shaderPath("fullscreen.vert.spv"),
+			.fragmentShader = shaderPath("upscale.frag.spv"),
+			.enableDepthWrite = false,
+			.colourFormat = m_graphicsDevice->GetBackBufferImageFormat(),
+			.depthFormat = VK_FORMAT_UNDEFINED,
+		},
+	})[0];
 }
 
 void Renderer::Deinit() 
@@ -548,108 +1231,253 @@ void Renderer::Deinit()
 
 	m_graphicsDevice->WaitIdle();
 
+	// These retire their resources, which release bindless slots, so the queue is flushed before the table goes
+	for (const ShadowCascadeImages& images : m_shadowImages)
+	{
+		m_graphicsDevice->DestroyImage(images.staticCache);
+		m_graphicsDevice->DestroyImage(images.shadowMap);
+	}
+	m_textureStreamer.Deinit();
+	m_renderGraph.Deinit();
+	m_graphicsDevice->WaitIdle();
+
 	vkDestroyDescriptorPool(m_graphicsDevice->m_device, m_scenePool, nullptr);
 	vkDestroyDescriptorSetLayout(m_graphicsDevice->m_device, m_sceneSetLayout, nullptr);
 	vkDestroyDescriptorPool(m_graphicsDevice->m_device, m_globalPool, nullptr);
 	vkDestroyDescriptorSetLayout(m_graphicsDevice->m_device, m_globalSetLayout, nullptr);
+	vkDestroySampler(m_graphicsDevice->m_device, m_upscaleSampler, nullptr);
+	m_bindlessTable.Deinit();
+	m_commandRecorder.Deinit();
 }
 
 Runic::MeshHandle Renderer::UploadMesh(const Runic::MeshDesc& mesh)
 {
 	ZoneScoped;
 	RenderMesh renderMesh {.meshDesc = mesh};
+	// Vertices and indices are also fetched by address in the visibility buffer resolve
+	renderMesh.vertexBuffer = uploadMeshBuffer(mesh.vertices.data(), mesh.vertices.size() * sizeof(Runic::Vertex), GFX::Buffer::Usage::VERTEX, true);
+
+	// Depth only passes fetch 12 bytes per vertex instead of the whole vertex
+	std::vector<glm::vec3> positions(mesh.vertices.size());
+	for (size_t i = 0; i < mesh.vertices.size(); ++i)
 	{
-		const size_t bufferSize = mesh.vertices.size() * sizeof(Runic::Vertex);
+		positions[i] = mesh.vertices[i].position;
+	}
+	renderMesh.positionBuffer = uploadMeshBuffer(positions.data(), positions.size() * sizeof(glm::vec3), GFX::Buffer::Usage::VERTEX, false);
 
-		const BufferHandle stagingBuffer =  m_graphicsDevice->CreateBuffer(BufferCreateInfo{
-			.size = bufferSize,
-			.usage = GFX::Buffer::Usage::NONE,
-			.transfer = BufferCreateInfo::Transfer::SRC,
-			});
+	if (mesh.hasIndices())
+	{
+		// Most meshes have few enough vertices for 16 bit indices, which halves the index fetch
+		renderMesh.indexSize = mesh.GetIndexSize(m_graphicsDevice->IsIndexTypeUint8Supported());
+		renderMesh.indexType = renderMesh.indexSize == 1U ? VK_INDEX_TYPE_UINT8_EXT : renderMesh.indexSize == 2U ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+		const std::vector<uint32_t> indices = mesh.PackIndices(renderMesh.indexSize);
+		renderMesh.indexBuffer = uploadMeshBuffer(indices.data(), indices.size() * sizeof(uint32_t), GFX::Buffer::Usage::INDEX, true);
+	}
+
+	// Bounding sphere and average texel density for texture streaming
+	if (!mesh.vertices.empty())
+	{
+		glm::vec3 minBounds = mesh.vertices[0].position;
+		glm::vec3 maxBounds = mesh.vertices[0].position;
+		for (const Runic::Vertex& vertex : mesh.vertices)
+		{
+			minBounds = glm::min(minBounds, vertex.position);
+			maxBounds = glm::max(maxBounds, vertex.position);
+		}
+		renderMesh.boundsCenter = (minBounds + maxBounds) * 0.5f;
+		renderMesh.boundsRadius = glm::length(maxBounds - renderMesh.boundsCenter);
+
+		float worldArea = 0.0f;
+		float uvArea = 0.0f;
+		const size_t indexCount = mesh.hasIndices() ? mesh.indices.size() : mesh.vertices.size();
+		for (size_t i = 0; i + 2 < indexCount; i += 3)
+		{
+			const Runic::Vertex& a = mesh.vertices[mesh.hasIndices() ? mesh.indices[i] : i];
+			const Runic::Vertex& b = mesh.vertices[mesh.hasIndices() ? mesh.indices[i + 1] : i + 1];
+			const Runic::Vertex& c = mesh.vertices[mesh.hasIndices() ? mesh.indices[i + 2] : i + 2];
+
+			worldArea += glm::length(MeshDesc::CalculateSurfaceNormal(a.position, b.position, c.position)) * 0.5f;
+			const glm::vec2 uvAB = b.uv - a.uv;
+			const glm::vec2 uvAC = c.uv - a.uv;
+			uvArea += std::abs(uvAB.x * uvAC.y - uvAB.y * uvAC.x) * 0.5f;
+		}
+		renderMesh.uvDensity = worldArea > 0.0f ? std::sqrt(uvArea / worldArea) : 0.0f;
+	}
+
+	return m_meshes.add(renderMesh);
+}
+
+BufferHandle Renderer::uploadMeshBuffer(const void* data, size_t size, GFX::Buffer::Usage usage, bool shaderAddress)
+{
+	const BufferHandle stagingBuffer =  m_graphicsDevice->CreateBuffer(BufferCreateInfo{
+		.size = size,
+		.usage = GFX::Buffer::Usage::NONE,
+		.transfer = BufferCreateInfo::Transfer::SRC,
+		.memory = BufferCreateInfo::Memory::UPLOAD,
+		.category = MemoryCategory::STAGING,
+		});
 
-		memcpy(m_graphicsDevice->GetMappedData<void>(stagingBuffer), mesh.vertices.data(), bufferSize);
+	memcpy(m_graphicsDevice->GetMappedData<void>(stagingBuffer), data, size);
 
-		renderMesh.vertexBuffer =  m_graphicsDevice->CreateBuffer(BufferCreateInfo{
-			.size = bufferSize,
-			.usage = GFX::Buffer::Usage::VERTEX,
-			.transfer = BufferCreateInfo::Transfer::DST,
-			});
+	const BufferHandle buffer =  m_graphicsDevice->CreateBuffer(BufferCreateInfo{
+		.size = size,
+		.usage = usage,
+		.transfer = BufferCreateInfo::Transfer::DST,
+		.memory = BufferCreateInfo::Memory::GPU_ONLY,
+		.category = MemoryCategory::MESH,
+		.shaderAddress = shaderAddress,
+		});
 
-		m_graphicsDevice->ImmediateSubmit([=](VkCommandBuffer cmd) {
-			VkBufferCopy copy;
-			copy.dstOffset = 0;
-			copy.srcOffset = 0;
-			copy.size = bufferSize;
-			vkCmdCopyBuffer(cmd, m_graphicsDevice->GetBuffer(stagingBuffer), m_graphicsDevice->GetBuffer(renderMesh.vertexBuffer), 1, &copy);
-			});
+	m_graphicsDevice->ImmediateSubmit([=](VkCommandBuffer cmd) {
+		VkBufferCopy copy;
+		copy.dstOffset = 0;
+		copy.srcOffset = 0;
+		copy.size = size;
+		vkCmdCopyBuffer(cmd, m_graphicsDevice->GetBuffer(stagingBuffer), m_graphicsDevice->GetBuffer(buffer), 1, &copy);
+		});
+
+	m_graphicsDevice->DestroyStagingBuffer(stagingBuffer);
+	return buffer;
+}
 
-		m_graphicsDevice->DestroyBuffer(stagingBuffer);
+TextureHandle Renderer::UploadTexture(const Texture& texture)
+{
+	if (texture.ptr[0] == nullptr)
+	{
+		return TextureHandle(0);
 	}
 
-	if (mesh.hasIndices())
+	BindlessTexture bindless{};
+	if (texture.m_desc.type == TextureDesc::Type::TEXTURE_CUBEMAP)
 	{
-		const size_t bufferSize = mesh.indices.size() * sizeof(Runic::MeshDesc::Index);
+		bindless.slot = m_bindlessTable.Allocate();
+		if (bindless.slot == 0U)
+		{
+			return TextureHandle(0);
+		}
+		bindless.image = uploadTextureInternalCubemap(texture);
+		m_bindlessTable.Write(bindless.slot, m_graphicsDevice->GetImageView(bindless.image), m_graphicsDevice->m_defaultSampler);
+	}
 
-		const BufferHandle stagingBuffer =  m_graphicsDevice->CreateBuffer(BufferCreateInfo{
-			.size = bufferSize,
-			.usage = GFX::Buffer::Usage::INDEX,
-			.transfer = BufferCreateInfo::Transfer::SRC,
-			});
+	TextureHandle handle{ static_cast<TextureHandle>(m_textures.size()) };
+	if (!m_freeTextureHandles.empty())
+	{
+		handle = m_freeTextureHandles.back();
+		m_freeTextureHandles.pop_back();
+		m_textures[handle] = bindless;
+	}
+	else
+	{
+		m_textures.push_back(bindless);
+	}
 
-		memcpy(m_graphicsDevice->GetMappedData<void>(stagingBuffer), mesh.indices.data(), bufferSize);
+	// 2D textures are streamed, they have no slot until their first mips are uploaded
+	if (texture.m_desc.type != TextureDesc::Type::TEXTURE_CUBEMAP)
+	{
+		const VkFormat format = { texture.m_desc.format == Runic::TextureDesc::Format::DEFAULT ? DEFAULT_FORMAT : NORMAL_FORMAT };
+		m_textureStreamer.Register(handle, texture, format);
+	}
 
-		renderMesh.indexBuffer =  m_graphicsDevice->CreateBuffer(BufferCreateInfo{
-			.size = bufferSize,
-			.usage = GFX::Buffer::Usage::INDEX,
-			.transfer = BufferCreateInfo::Transfer::DST,
-			});
+	return handle;
+}
 
-		m_graphicsDevice->ImmediateSubmit([=](VkCommandBuffer cmd) {
-			VkBufferCopy copy;
-			copy.dstOffset = 0;
-			copy.srcOffset = 0;
-			copy.size = bufferSize;
-			vkCmdCopyBuffer(cmd, m_graphicsDevice->GetBuffer(stagingBuffer), m_graphicsDevice->GetBuffer(renderMesh.indexBuffer), 1, &copy);
-			});
+void Renderer::DestroyTexture(TextureHandle texture)
+{
+	if (texture == 0U || texture >= m_textures.size())
+	{
+		return;
+	}
 
-		m_graphicsDevice->DestroyBuffer(stagingBuffer);
+	if (m_textureStreamer.IsStreamed(texture))
+	{
+		m_textureStreamer.Unregister(texture);
+	}
+	else if (m_textures[texture].slot != 0U)
+	{
+		m_bindlessTable.Free(m_textures[texture].slot);
+		m_graphicsDevice->DestroyImage(m_textures[texture].image);
+		m_textures[texture] = BindlessTexture{};
+	}
+	else
+	{
+		return;
 	}
+	m_assets.RemoveTexture(texture);
+	m_freeTextureHandles.push_back(texture);
+}
 
-	return m_meshes.add(renderMesh);
+void Renderer::DestroyMesh(MeshHandle mesh)
+{
+	const RenderMesh& renderMesh = m_meshes.get(mesh);
+	m_graphicsDevice->DestroyBuffer(renderMesh.vertexBuffer);
+	m_graphicsDevice->DestroyBuffer(renderMesh.positionBuffer);
+	m_graphicsDevice->DestroyBuffer(renderMesh.indexBuffer);
+	m_meshes.remove(mesh);
+	m_assets.RemoveMesh(mesh);
 }
 
-TextureHandle Renderer::UploadTexture(const Texture& texture)
+void Renderer::ReleaseMesh(MeshHandle mesh)
 {
-	if (texture.ptr == nullptr)
+	if (m_assets.ReleaseMesh(mesh))
 	{
-		return TextureHandle(0);
+		DestroyMesh(mesh);
 	}
+}
 
-	const ImageHandle newTextureHandle = (texture.m_desc.type == TextureDesc::Type::TEXTURE_CUBEMAP ? uploadTextureInternalCubemap(texture) : uploadTextureInternal(texture));
-	const TextureHandle bindlessHandle = m_bindlessImages.add(newTextureHandle);
+void Renderer::ReleaseTexture(TextureHandle texture)
+{
+	if (m_assets.ReleaseTexture(texture))
+	{
+		DestroyTexture(texture);
+	}
+}
 
-	const VkDescriptorImageInfo bindlessImageInfo = {
-		.sampler = m_graphicsDevice->m_defaultSampler,
-		.imageView = m_graphicsDevice->GetImageView(m_bindlessImages.get(bindlessHandle)),
-		.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-	};
+int Renderer::getTextureSlot(const std::optional<TextureHandle>& texture) const
+{
+	if (!texture.has_value() || texture.value() >= m_textures.size())
+	{
+		return 0;
+	}
+	return static_cast<int>(m_textures[texture.value()].slot);
+}
+
+void Renderer::updateTextureDemand()
+{
+	ZoneScoped;
+
+	const glm::vec3 cameraPos = m_currentCamera->GetPosition();
+	// Screen pixels covered by one world unit at a distance of one
+	const float pixelsPerUnit = static_cast<float>(m_renderExtent.height) / (2.0f * std::tan(glm::radians(m_currentCamera->m_fov) * 0.5f));
 
-	for (int i = 0; i < FRAME_OVERLAP; ++i)
+	for (Runic::Entity* entity : m_entities)
 	{
-		const VkWriteDescriptorSet write{
-			.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-			.dstSet = m_frame[i].globalSet,
-			.dstBinding = 3,
-			.dstArrayElement = bindlessHandle,
-			.descriptorCount = static_cast<uint32_t>(1),
-			.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-			.pImageInfo = &bindlessImageInfo,
-		};
+		const RenderableComponent& object = entity->GetComponent<RenderableComponent>();
+		const RenderMesh& mesh = m_meshes.get(object.meshHandle);
 
-		vkUpdateDescriptorSets(m_graphicsDevice->m_device, 1, &write, 0, nullptr);
-	}
+		glm::vec3 center = mesh.boundsCenter;
+		float scale = 1.0f;
+		if (entity->HasComponent<TransformComponent>())
+		{
+			const glm::mat4 modelMatrix = entity->BuildWorldMatrix();
+			center = glm::vec3(modelMatrix * glm::vec4(mesh.boundsCenter, 1.0f));
+			scale = std::max({ glm::length(glm::vec3(modelMatrix[0])), glm::length(glm::vec3(modelMatrix[1])), glm::length(glm::vec3(modelMatrix[2])) });
+		}
 
-	return bindlessHandle;
+		// Nearest point of the bounding sphere decides the finest mip needed
+		const float distance = std::max(glm::length(center - cameraPos) - mesh.boundsRadius * scale, 0.1f);
+		const float uvPerPixel = (mesh.uvDensity / scale) * (distance / pixelsPerUnit);
+
+		for (const std::optional<TextureHandle>& texture : { object.textureHandle, object.normalHandle, object.roughnessHandle, object.emissionHandle })
+		{
+			if (!texture.has_value())
+			{
+				continue;
+			}
+			const float texelsPerPixel = uvPerPixel * static_cast<float>(m_textureStreamer.GetWidth(texture.value()));
+			const uint32_t mip = texelsPerPixel > 1.0f ? static_cast<uint32_t>(std::log2(texelsPerPixel)) : 0U;
+			m_textureStreamer.RequestMip(texture.value(), mip);
+		}
+	}
 }
 
 void Runic::Renderer::SetSkybox(TextureHandle texture)
@@ -668,6 +1496,8 @@ ImageHandle Renderer::uploadTextureInternal(const Runic::Texture& image)
 			.size = imageSize,
 			.usage = GFX::Buffer::Usage::NONE,
 			.transfer = BufferCreateInfo::Transfer::SRC,
+			.memory = BufferCreateInfo::Memory::UPLOAD,
+			.category = MemoryCategory::STAGING,
 		});
 
 	//copy data to buffer
@@ -682,6 +1512,7 @@ ImageHandle Renderer::uploadTextureInternal(const Runic::Texture& image)
 
 	const VkImageCreateInfo dimg_info = VulkanInit::imageCreateInfo(image_format, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, imageExtent);
 
+	// Left as OTHER so defragmentation never moves it, slot 0 can't be rebound while frames are in flight
 	ImageHandle newImage = m_graphicsDevice->CreateImage(ImageCreateInfo{ .imageInfo = dimg_info, .imageType = ImageCreateInfo::ImageType::TEXTURE_2D });
 
 	m_graphicsDevice->ImmediateSubmit([&](VkCommandBuffer cmd) {
@@ -747,7 +1578,7 @@ ImageHandle Renderer::uploadTextureInternal(const Runic::Texture& image)
 		vkCmdPipelineBarrier2(cmd, &imgRedableDependencyInfo);
 	});
 
-	m_graphicsDevice->DestroyBuffer(stagingBuffer);
+	m_graphicsDevice->DestroyStagingBuffer(stagingBuffer);
 
 	return newImage;
 }
@@ -777,6 +1608,8 @@ ImageHandle Renderer::uploadTextureInternalCubemap(const Runic::Texture& image)
 			.size = imageSize * 6,
 			.usage = GFX::Buffer::Usage::NONE,
 			.transfer = BufferCreateInfo::Transfer::SRC,
+			.memory = BufferCreateInfo::Memory::UPLOAD,
+			.category = MemoryCategory::STAGING,
 		});
 
 	for (int i = 0; i < 6; ++i)
@@ -790,9 +1623,9 @@ ImageHandle Renderer::uploadTextureInternalCubemap(const Runic::Texture& image)
 		.depth = 1,
 	};
 
-	const VkImageCreateInfo dimg_info = VulkanInit::imageCreateInfo(image_format, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, imageExtent, VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT, 6);
+	const VkImageCreateInfo dimg_info = VulkanInit::imageCreateInfo(image_format, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, imageExtent, VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT, 6);
 
-	const ImageHandle newImage = m_graphicsDevice->CreateImage(ImageCreateInfo{ .imageInfo = dimg_info, .imageType = ImageCreateInfo::ImageType::TEXTURE_CUBEMAP });
+	const ImageHandle newImage = m_graphicsDevice->CreateImage(ImageCreateInfo{ .imageInfo = dimg_info, .imageType = ImageCreateInfo::ImageType::TEXTURE_CUBEMAP, .category = MemoryCategory::TEXTURE });
 
 	m_graphicsDevice->ImmediateSubmit([&](VkCommandBuffer cmd) {
 		const VkImageSubresourceRange range{
@@ -857,7 +1690,7 @@ ImageHandle Renderer::uploadTextureInternalCubemap(const Runic::Texture& image)
 		vkCmdPipelineBarrier2(cmd, &imgReadableDependencyInfo);
 		});
 
-	m_graphicsDevice->DestroyBuffer(stagingBuffer);
+	m_graphicsDevice->DestroyStagingBuffer(stagingBuffer);
 
 	return newImage;
 }
@@ -921,3 +1754,23 @@ VertexInputDescription RenderMesh::getVertexDescription()
 
 	return description;
 }
+
+VertexInputDescription RenderMesh::getPositionVertexDescription()
+{
+	VertexInputDescription description;
+
+	description.bindings.push_back(VkVertexInputBindingDescription{
+		.binding = 0,
+		.stride = sizeof(glm::vec3),
+		.inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
+	});
+
+	description.attributes.push_back(VkVertexInputAttributeDescription{
+		.location = 0,
+		.binding = 0,
+		.format = VK_FORMAT_R32G32B32_SFLOAT,
+		.offset = 0,
+	});
+
+	return description;
+}
@@ -2,26 +2,36 @@
 
 #include <glm.hpp>
 
+#include <array>
 #include <functional>
 #include <imgui.h>
 #include <unordered_map>
 
+#include "Runic/Assets/AssetRegistry.h"
+#include "Runic/Graphics/Internal/BindlessTextureTable.h"
+#include "Runic/Graphics/Internal/DynamicResolution.h"
+#include "Runic/Graphics/Internal/ParallelCommandRecorder.h"
 #include "Runic/Graphics/Internal/PipelineBuilder.h"
 #include "Runic/Graphics/Internal/PipelineManager.h"
+#include "Runic/Graphics/Internal/RenderGraph.h"
+#include "Runic/Graphics/Internal/ShadowCascades.h"
+#include "Runic/Graphics/Internal/TextureStreamer.h"
 #include "Runic/Graphics/ResourceManager.h"
 
 #include "Runic/Graphics/Device.h"
 #include "Runic/Graphics/Mesh.h"
 #include "Runic/Graphics/Texture.h"
+#include "Runic/Structures/FrameArena.h"
 #include "Runic/Scene/Entity.h"
 #include "Runic/Scene/Components/RenderableComponent.h"
 #include "Runic/Scene/Components/LightComponent.h"
 #include "Runic/Scene/Camera.h"
 
-constexpr unsigned int MAX_OBJECTS = 1024;
-constexpr unsigned int MAX_TEXTURES = 128;
-constexpr unsigned int MAX_POINT_LIGHTS = 4U;
+constexpr unsigned int MAX_OBJECTS = 16384;
+constexpr unsigned int MAX_TEXTURES = 32768;  // Clamped to the device update after bind limit
+constexpr unsigned int MAX_POINT_LIGHTS = 128U;
 constexpr glm::vec3 UP_DIR = { 0.0f,1.0f,0.0f };
+constexpr VkFormat VISIBILITY_FORMAT = { VK_FORMAT_R32G32_UINT };	// Draw data index + 1, triangle index
 
 struct SDL_Window;
 
@@ -32,15 +42,39 @@ namespace Runic
 	{
 
 		struct PushConstants
+		{
+			int drawDataIndex;		// First draw data of the batch, shaders add gl_InstanceIndex
+		};
+
+		struct ShadowPushConstants
 		{
 			int drawDataIndex;
+			int cascade;
+		};
+
+		struct VisibilityResolveConstants
+		{
+			int visibilityIndex;	// Bindless slot of the visibility buffer
+			int padding;
+			glm::vec2 renderSize;	// Pixels rendered, the top left of the visibility buffer
+		};
+
+		struct UpscaleConstants
+		{
+			int sourceIndex;
+			int padding;
+			glm::vec2 pixelToUv;	// Output pixel to source uv
+			glm::vec2 maxUv;		// Keeps bilinear taps inside the rendered area
 		};
 
 		struct DrawData
 		{
 			int transformIndex;
 			int materialIndex;
-			int padding[2];
+			VkDeviceAddress vertexAddress;	// Fetched by the visibility buffer resolve
+			VkDeviceAddress indexAddress;	// 0 for meshes without indices
+			uint32_t indexSize;				// Bytes per index, narrower indices are packed into 32 bit words
+			uint32_t padding;
 		};
 
 		struct Material
@@ -82,22 +116,43 @@ namespace Runic
 		{
 			glm::mat4 view{};
 			glm::mat4 proj{};
-			glm::vec4 pos{};
+			glm::vec4 pos{};		// w: number of point lights
 		};
+
+		struct Shadows
+		{
+			glm::mat4 viewProj[SHADOW_CASCADE_COUNT];
+			glm::vec4 splitDepths;				// View space depth each cascade ends at
+			glm::vec4 texelSizes;				// World units per texel, scales the normal offset
+			glm::ivec4 shadowMapIndices;		// Bindless slot shading samples, the static cache when no dynamic caster was drawn
+			glm::ivec4 staticCacheIndices;
+			glm::vec4 params;					// x: 1 / SHADOW_MAP_SIZE, y: 1 when there is a directional light
+		};
+		static_assert(SHADOW_CASCADE_COUNT == 4U, "Shadows packs one value per cascade into a vec4");
 	}
 
 	struct RenderMesh
 	{
 		Runic::MeshDesc meshDesc;
 		BufferHandle vertexBuffer;
+		BufferHandle positionBuffer;	// Positions only, for depth only passes
 		BufferHandle indexBuffer;
+		VkIndexType indexType{ VK_INDEX_TYPE_UINT32 };	// The narrowest type the vertex count allows
+		uint32_t indexSize{ 4U };
+
+		// Used to pick the mip to stream in
+		glm::vec3 boundsCenter{ 0.0f };
+		float boundsRadius{ 0.0f };
+		float uvDensity{ 0.0f };	// UV units per mesh space unit
 
 		static VertexInputDescription getVertexDescription();
+		static VertexInputDescription getPositionVertexDescription();
 	};
 
 	struct MaterialType
 	{
 		PipelineHandle pipeline = { 0};
+		PipelineHandle depthEqualPipeline = { 0 };	// Used over a depth pre-pass, compares EQUAL and doesn't write depth
 		VkPipelineLayout pipelineLayout = { VK_NULL_HANDLE };
 	};
 
@@ -118,6 +173,27 @@ namespace Runic
 		BufferHandle cameraBuffer;
 		BufferHandle dirLightBuffer;
 		BufferHandle pointLightBuffer;
+		BufferHandle shadowBuffer;
+	};
+
+	/*
+	FORWARD:			Each draw is shaded as it is rasterised, optionally over a depth pre-pass.
+	VISIBILITY_BUFFER:	Draws only write their draw and triangle index, one full screen pass then shades each
+						pixel once. Needs IsFragmentPrimitiveIdSupported.
+	*/
+	enum class RenderPath
+	{
+		FORWARD,
+		VISIBILITY_BUFFER,
+	};
+
+	/*
+	Counts from the last Draw
+	*/
+	struct RendererFrameStats
+	{
+		uint32_t objects;		// Renderables drawn in the main pass
+		uint32_t drawCalls;		// Instanced draws they were batched into
 	};
 
 	class Renderer
@@ -131,13 +207,141 @@ namespace Runic
 		void GiveRenderables(const std::vector<std::shared_ptr<Runic::Entity>>& entities);
 		MeshHandle UploadMesh(const MeshDesc& mesh);
 		TextureHandle UploadTexture(const Texture& texture);
+		/*
+		The slot is reused and the image destroyed once no frame in flight can still sample it
+		*/
+		void DestroyTexture(TextureHandle texture);
+		/*
+		Buffers are destroyed once no frame in flight can still read them. Nothing may still draw the mesh.
+		*/
+		void DestroyMesh(MeshHandle mesh);
+		/*
+		Drop one reference taken through the AssetRegistry, destroying the asset with the last one
+		*/
+		void ReleaseMesh(MeshHandle mesh);
+		void ReleaseTexture(TextureHandle texture);
 		void SetSkybox(TextureHandle texture);
+
+		/*
+		IDs of the meshes and textures loaded from files, for saving scenes
+		*/
+		AssetRegistry& GetAssets() { return m_assets; }
+
+		/*
+		Fixed ceiling for streamed texture memory, on top of the device local heap budget
+		*/
+		void SetTextureMemoryBudget(uint64_t bytes) { m_textureStreamer.SetMemoryCeiling(bytes); }
+		TextureStreamer::Stats GetTextureStreamingStats() const { return m_textureStreamer.GetStats(); }
+
+		/*
+		Heap allocations made during the last Draw, debug builds only. Zero once the frame arenas have grown
+		to the frame's peak, unless draws were recorded on worker threads.
+		*/
+		uint64_t GetFrameHeapAllocations() const { return m_frameHeapAllocations; }
+
+		/*
+		Lays down depth with a position only pass first, so the main pass shades each pixel once
+		*/
+		void SetDepthPrePass(bool enabled) { m_depthPrePass = enabled; }
+		bool IsDepthPrePassEnabled() const { return m_depthPrePass; }
+
+		/*
+		Falls back to FORWARD when the device can't write primitive IDs
+		*/
+		void SetRenderPath(RenderPath path);
+		RenderPath GetRenderPath() const { return m_renderPath; }
+
+		/*
+		Renders the scene at a fraction of the back buffer size picked to keep the GPU frame time within budget,
+		then upscales. Scale limits are per axis.
+		*/
+		void SetDynamicResolution(bool enabled) { m_dynamicResolutionEnabled = enabled; }
+		bool IsDynamicResolutionEnabled() const { return m_dynamicResolutionEnabled; }
+		void SetGpuFrameBudget(float milliseconds) { m_dynamicResolution.SetBudget(milliseconds); }
+		void SetResolutionScaleLimits(float minScale, float maxScale) { m_dynamicResolution.SetScaleLimits(minScale, maxScale); }
+		float GetResolutionScale() const { return m_dynamicResolutionEnabled ? m_dynamicResolution.GetScale() : 1.0f; }
+
+		RendererFrameStats GetFrameStats() const
+		{
+			return RendererFrameStats{ .objects = static_cast<uint32_t>(m_drawItems.size()), .drawCalls = static_cast<uint32_t>(m_drawBatches.size()) };
+		}
 	private:
+		struct DrawItem
+		{
+			const MaterialType* material;
+			const RenderMesh* mesh;
+
+			// World space, for culling against shadow cascades
+			glm::vec3 boundsCenter;
+			float boundsRadius;
+			bool isStatic;
+
+			int transformIndex;
+			int materialIndex;
+		};
+
+		/*
+		Consecutive draw items sharing a material and mesh, drawn as one instanced draw
+		*/
+		struct DrawBatch
+		{
+			const MaterialType* material;
+			const RenderMesh* mesh;
+			int firstIndex;
+			uint32_t instanceCount;
+		};
+
+		/*
+		Persistent depth images of one cascade, their layouts are carried between frames for the graph
+		*/
+		struct ShadowCascadeImages
+		{
+			ImageHandle staticCache;
+			ImageHandle shadowMap;		// Static cache with this frame's dynamic casters on top
+			uint32_t staticCacheSlot;
+			uint32_t shadowMapSlot;
+			VkImageLayout staticCacheLayout;
+			VkImageLayout shadowMapLayout;
+		};
+
+		enum class DrawMode
+		{
+			DEPTH,			// Position only, no colour
+			VISIBILITY,		// Position only, writes the visibility buffer
+			SHADED,
+		};
+
 		void initShaders();
 
 		void initShaderData();
 
-		void drawObjects(VkCommandBuffer cmd, const std::vector<Runic::Entity*>& renderObjects);
+		/*
+		Fills this frame's draw data, camera and light buffers, the draw list sorted by material and mesh, and
+		the batches of it
+		*/
+		void prepareDraws(const std::vector<Runic::Entity*>& renderObjects);
+		void drawObjects(VkCommandBuffer cmd, DrawMode mode);
+		void recordDraws(VkCommandBuffer cmd, const DrawBatch* batches, uint32_t count, DrawMode mode);
+		void resolveVisibility(VkCommandBuffer cmd, VkImageView visibilityView);
+		void upscale(VkCommandBuffer cmd, VkImageView sceneView, VkExtent2D sceneExtent);
+		/*
+		Points a fresh bindless slot at an image the graph may move between frames, the old slot is freed once no
+		frame in flight reads it. Returns 0 when the table is full.
+		*/
+		uint32_t rebindFrameSlot(uint32_t& slot, VkImageView view, VkSampler sampler);
+
+		void initShadows();
+		/*
+		Fits the cascades, fills this frame's shadow buffer and adds the shadow passes. Returns the images shading
+		samples, invalid when there is no directional light.
+		*/
+		std::array<RenderGraphImage, SHADOW_CASCADE_COUNT> addShadowPasses();
+		void drawShadowCasters(VkCommandBuffer cmd, uint32_t cascade, bool staticCasters, bool composite);
+		void updateShadowBounds();
+		void drawRendererPanel();
+		BufferHandle uploadMeshBuffer(const void* data, size_t size, GFX::Buffer::Usage usage, bool shaderAddress);
+		void updateTextureDemand();
+		[[nodiscard]] int getTextureSlot(const std::optional<TextureHandle>& texture) const;
 
 		ImageHandle uploadTextureInternal(const Runic::Texture& image);
 		ImageHandle uploadTextureInternalCubemap(const Runic::Texture& image);
@@ -145,8 +349,7 @@ namespace Runic
 		[[nodiscard]] RenderFrameObjects& GetCurrentFrame() { return m_frame[m_graphicsDevice->GetCurrentFrameNumber()]; }
 
 		Device* m_graphicsDevice;
-		RenderFrameObjects m_frame[FRAME_OVERLAP];
-		RenderTargetHandle m_depthTarget;
+		RenderFrameObjects m_frame[MAX_FRAMES_IN_FLIGHT];
 
 		VkDescriptorSetLayout m_globalSetLayout;
 		VkDescriptorPool m_globalPool;
@@ -158,9 +361,44 @@ namespace Runic
 
 		Slotmap<RenderMesh> m_meshes;
 		std::unordered_map<std::string, MaterialType> m_materials;
-		Slotmap<ImageHandle> m_bindlessImages;
+		BindlessTextureTable m_bindlessTable;
+		std::vector<BindlessTexture> m_textures;  // Indexed by TextureHandle
+		std::vector<TextureHandle> m_freeTextureHandles;
+		TextureStreamer m_textureStreamer;
+		AssetRegistry m_assets;
+		ParallelCommandRecorder m_commandRecorder;
+		RenderGraph m_renderGraph;
+		FrameArenaSet m_frameArenas;
+		uint64_t m_frameHeapAllocations{ 0U };
+
+		std::vector<DrawItem> m_drawItems;
+		std::vector<DrawBatch> m_drawBatches;
+		PipelineHandle m_depthPrePassPipeline{ 0 };
+		bool m_depthPrePass{ true };
+
+		RenderPath m_renderPath{ RenderPath::FORWARD };
+		PipelineHandle m_visibilityPipeline{ 0 };
+		PipelineHandle m_visibilityResolvePipeline{ 0 };
+		VkPipelineLayout m_visibilityResolveLayout{ VK_NULL_HANDLE };
+		uint32_t m_visibilitySlot{ 0U };	// Rewritten every frame, the graph may move the image
+
+		DynamicResolution m_dynamicResolution;
+		bool m_dynamicResolutionEnabled{ true };
+		VkExtent2D m_renderExtent{};		// Pixels the scene is rendered at this frame
+		PipelineHandle m_upscalePipeline{ 0 };
+		VkPipelineLayout m_upscaleLayout{ VK_NULL_HANDLE };
+		VkSampler m_upscaleSampler{ VK_NULL_HANDLE };
+		uint32_t m_upscaleSlot{ 0U };
+
+		ShadowCascades m_shadowCascades;
+		std::array<ShadowCascadeImages, SHADOW_CASCADE_COUNT> m_shadowImages{};
+		PipelineHandle m_shadowPipeline{ 0 };
+		PipelineHandle m_shadowCompositePipeline{ 0 };
+		VkPipelineLayout m_shadowLayout{ VK_NULL_HANDLE };
+		uint32_t m_shadowCacheRefreshes{ 0U };		// Cascades whose static casters were drawn last frame
 
 		RenderableComponent m_skybox;
+		int m_skyboxDrawIndex{ 0 };		// After the objects drawn this frame, which may be fewer than m_entities
 		MeshHandle m_skyboxMesh;
 		TextureHandle m_skyboxTexture;
 
@@ -2,8 +2,32 @@
 #include "Runic/Graphics/Internal/VulkanInit.h"
 #include "Runic/Graphics/Internal/VulkanCommon.h"
 
+#include <Tracy.hpp>
+
+#include <algorithm>
+#include <chrono>
+
+namespace
+{
+	// Allocation user data holds the slotmap handle, with this bit set for images
+	constexpr uintptr_t IMAGE_USER_DATA_BIT = uintptr_t(1) << 31;
+}
+
 void ResourceManager::Deinit()
 {
+	if (defragContext != VK_NULL_HANDLE)
+	{
+		if (defragPassOpen)
+		{
+			endDefragmentationPass();
+		}
+		if (defragContext != VK_NULL_HANDLE)
+		{
+			vmaEndDefragmentation(allocator, defragContext, nullptr);
+			defragContext = VK_NULL_HANDLE;
+		}
+	}
+
 	for (const auto& buffer : buffers.m_array)
 	{
 		if (buffer.buffer != VK_NULL_HANDLE)
@@ -34,6 +58,10 @@ BufferHandle ResourceManager::CreateBuffer(const BufferCreateInfo& createInfo)
 		.size = createInfo.size,
 	};
 	bufferInfo.usage = VkCommon::ToVulkan(createInfo.usage);
+	if (createInfo.shaderAddress)
+	{
+		bufferInfo.usage = bufferInfo.usage | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+	}
 
 	switch (createInfo.transfer)
 	{
@@ -49,10 +77,30 @@ BufferHandle ResourceManager::CreateBuffer(const BufferCreateInfo& createInfo)
 		break;
 	}
 
-	VmaAllocationCreateInfo vmaallocInfo = {
-		.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT,
-		.usage = VMA_MEMORY_USAGE_AUTO,
-	};
+	VmaAllocationCreateInfo vmaallocInfo = {};
+	switch (createInfo.memory)
+	{
+	default:
+		break;
+	case BufferCreateInfo::Memory::GPU_ONLY:
+		vmaallocInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+		// Defragmentation moves these with a copy
+		bufferInfo.usage = bufferInfo.usage | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		break;
+	case BufferCreateInfo::Memory::UPLOAD:
+		vmaallocInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT;
+		vmaallocInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST;
+		break;
+	case BufferCreateInfo::Memory::READBACK:
+		vmaallocInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT;
+		vmaallocInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST;
+		break;
+	case BufferCreateInfo::Memory::DIRECT_WRITE:
+		// Device local and host visible if there is such a memory type, falls back to host memory otherwise
+		vmaallocInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT;
+		vmaallocInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+		break;
+	}
 
 	Buffer newBuffer;
 
@@ -67,7 +115,16 @@ BufferHandle ResourceManager::CreateBuffer(const BufferCreateInfo& createInfo)
 	newBuffer.ptr = allocInfo.pMappedData;
 	newBuffer.size = createInfo.size;
 
+	VkMemoryPropertyFlags memoryFlags{ 0 };
+	vmaGetAllocationMemoryProperties(allocator, newBuffer.allocation, &memoryFlags);
+	newBuffer.deviceLocal = (memoryFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) != 0;
+	newBuffer.bufferInfo = bufferInfo;
+	newBuffer.allocationSize = allocInfo.size;
+	newBuffer.category = createInfo.category;
+	trackAllocation(newBuffer.category, newBuffer.allocationSize, true);
+
 	const BufferHandle newHandle{ .handle = buffers.add(newBuffer) };
+	vmaSetAllocationUserData(allocator, newBuffer.allocation, reinterpret_cast<void*>(static_cast<uintptr_t>(newHandle.handle)));
 
 	return newHandle;
 }
@@ -75,11 +132,17 @@ BufferHandle ResourceManager::CreateBuffer(const BufferCreateInfo& createInfo)
 void ResourceManager::DestroyBuffer(const BufferHandle& buffer)
 {
 	Buffer& deleteBuffer = buffers.get(buffer());
+	if (deleteBuffer.buffer != VK_NULL_HANDLE && isMoving(deleteBuffer.allocation))
+	{
+		defragPendingBufferDestroys.push_back(buffer);
+		return;
+	}
 	if (deleteBuffer.buffer != VK_NULL_HANDLE)
 	{
+		trackAllocation(deleteBuffer.category, deleteBuffer.allocationSize, false);
 		vmaDestroyBuffer(allocator, deleteBuffer.buffer, deleteBuffer.allocation);
+		buffers.remove(buffer());
 	}
-	deleteBuffer.buffer = VK_NULL_HANDLE;
 }
 
 ImageHandle ResourceManager::CreateImage(const ImageCreateInfo& createInfo)
@@ -118,9 +181,20 @@ ImageHandle ResourceManager::CreateImage(const ImageCreateInfo& createInfo)
 		break;
 	}
 
+	imageinfo.subresourceRange.levelCount = createInfo.imageInfo.mipLevels;
+
 	vkCreateImageView(device, &imageinfo, nullptr, &newImage.imageView);
 
+	VmaAllocationInfo allocationInfo;
+	vmaGetAllocationInfo(allocator, newImage.allocation, &allocationInfo);
+	newImage.imageInfo = createInfo.imageInfo;
+	newImage.viewInfo = imageinfo;
+	newImage.allocationSize = allocationInfo.size;
+	newImage.category = createInfo.category;
+	trackAllocation(newImage.category, newImage.allocationSize, true);
+
 	ImageHandle newHandle{ .handle = images.add(newImage) };
+	vmaSetAllocationUserData(allocator, newImage.allocation, reinterpret_cast<void*>(static_cast<uintptr_t>(newHandle.handle) | IMAGE_USER_DATA_BIT));
 
 	return newHandle;
 }
@@ -133,12 +207,332 @@ Image ResourceManager::GetImage(const ImageHandle& image)
 void ResourceManager::DestroyImage(const ImageHandle& image)
 {
 	Image& deleteImage = images.get(image());
+	if (deleteImage.image != VK_NULL_HANDLE && isMoving(deleteImage.allocation))
+	{
+		defragPendingImageDestroys.push_back(image);
+		return;
+	}
 	if (deleteImage.image != VK_NULL_HANDLE)
 	{
+		trackAllocation(deleteImage.category, deleteImage.allocationSize, false);
 		vmaDestroyImage(allocator, deleteImage.image, deleteImage.allocation);
 		vkDestroyImageView(device, deleteImage.imageView, nullptr);
+		images.remove(image());
 	}
-	deleteImage.image = VK_NULL_HANDLE;
 }
 
+MemoryStats ResourceManager::GetMemoryStats()
+{
+	const VkPhysicalDeviceMemoryProperties* memoryProperties = nullptr;
+	vmaGetMemoryProperties(allocator, &memoryProperties);
 
+	VmaBudget budgets[VK_MAX_MEMORY_HEAPS];
+	vmaGetHeapBudgets(allocator, budgets);
+
+	MemoryStats stats{
+		.categories = categoryTotals,
+		.defragmenting = IsDefragmenting(),
+		.defragmentedAllocations = defragMovedAllocations,
+		.defragmentedBytes = defragMovedBytes,
+	};
+	for (uint32_t i = 0; i < memoryProperties->memoryHeapCount; ++i)
+	{
+		stats.heapArray[stats.heapCount++] = MemoryStats::Heap{
+			.usage = budgets[i].usage,
+			.budget = budgets[i].budget,
+			.blockBytes = budgets[i].statistics.blockBytes,
+			.allocationBytes = budgets[i].statistics.allocationBytes,
+			.blockCount = budgets[i].statistics.blockCount,
+			.allocationCount = budgets[i].statistics.allocationCount,
+			.deviceLocal = (memoryProperties->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0,
+		};
+	}
+	return stats;
+}
+
+void ResourceManager::BeginDefragmentation(VkDeviceSize maxBytesPerPass, uint32_t maxAllocationsPerPass)
+{
+	if (defragContext != VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	const VmaDefragmentationInfo defragInfo{
+		.flags = VMA_DEFRAGMENTATION_FLAG_ALGORITHM_BALANCED_BIT,
+		.maxBytesPerPass = maxBytesPerPass,
+		.maxAllocationsPerPass = maxAllocationsPerPass,
+	};
+	vmaBeginDefragmentation(allocator, &defragInfo, &defragContext);
+	defragMovedAllocations = 0U;
+	defragMovedBytes = 0U;
+}
+
+std::pmr::vector<ImageHandle> ResourceManager::DefragmentStep(VkCommandBuffer cmd, uint64_t completedValue, uint64_t retireValue, double timeBudgetMs, uint32_t maxImageMoves,
+	std::pmr::memory_resource* frameMemory)
+{
+	ZoneScoped;
+
+	std::pmr::vector<ImageHandle> movedImages(frameMemory);
+	if (defragContext == VK_NULL_HANDLE)
+	{
+		return movedImages;
+	}
+
+	// Wait for the frame that may still use the old resources, then let VMA release their memory
+	if (defragPassOpen)
+	{
+		if (completedValue >= defragRetireValue)
+		{
+			endDefragmentationPass();
+		}
+		return movedImages;
+	}
+
+	if (vmaBeginDefragmentationPass(allocator, defragContext, &defragPass) == VK_SUCCESS)
+	{
+		vmaEndDefragmentation(allocator, defragContext, nullptr);
+		defragContext = VK_NULL_HANDLE;
+		return movedImages;
+	}
+	defragPassOpen = true;
+	defragRetireValue = retireValue;
+
+	const auto start = std::chrono::steady_clock::now();
+	bool movedBuffers = false;
+	for (uint32_t i = 0; i < defragPass.moveCount; ++i)
+	{
+		VmaDefragmentationMove& move = defragPass.pMoves[i];
+
+		VmaAllocationInfo allocationInfo;
+		vmaGetAllocationInfo(allocator, move.srcAllocation, &allocationInfo);
+		const uintptr_t userData = reinterpret_cast<uintptr_t>(allocationInfo.pUserData);
+
+		const double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		if (elapsedMs > timeBudgetMs || userData == 0U)
+		{
+			move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+			continue;
+		}
+
+		if (userData & IMAGE_USER_DATA_BIT)
+		{
+			const ImageHandle handle{ .handle = static_cast<uint32_t>(userData & ~IMAGE_USER_DATA_BIT) };
+			Image& image = images.get(handle());
+
+			// Only sampled textures have a known layout, and a moved image needs somewhere to rebind its new view
+			if (image.category != MemoryCategory::TEXTURE || movedImages.size() >= maxImageMoves)
+			{
+				move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+				continue;
+			}
+
+			VkImage newImage{ VK_NULL_HANDLE };
+			vkCreateImage(device, &image.imageInfo, nullptr, &newImage);
+			vmaBindImageMemory(allocator, move.dstTmpAllocation, newImage);
+
+			VkImageViewCreateInfo viewInfo = image.viewInfo;
+			viewInfo.image = newImage;
+			VkImageView newView{ VK_NULL_HANDLE };
+			vkCreateImageView(device, &viewInfo, nullptr, &newView);
+
+			const VkImageSubresourceRange range{
+				.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+				.baseMipLevel = 0,
+				.levelCount = image.imageInfo.mipLevels,
+				.baseArrayLayer = 0,
+				.layerCount = image.imageInfo.arrayLayers,
+			};
+
+			const VkImageMemoryBarrier2 toTransfer[] = {
+				{
+					.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+					.srcStageMask = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+					.srcAccessMask = VK_ACCESS_2_SHADER_READ_BIT,
+					.dstStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+					.dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT,
+					.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+					.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+					.image = image.image,
+					.subresourceRange = range,
+				},
+				{
+					.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+					.srcStageMask = VK_PIPELINE_STAGE_2_NONE,
+					.srcAccessMask = 0,
+					.dstStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+					.dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+					.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+					.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+					.image = newImage,
+					.subresourceRange = range,
+				},
+			};
+			const VkDependencyInfo toTransferDependency{
+				.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+				.imageMemoryBarrierCount = static_cast<uint32_t>(std::size(toTransfer)),
+				.pImageMemoryBarriers = toTransfer,
+			};
+			vkCmdPipelineBarrier2(cmd, &toTransferDependency);
+
+			std::pmr::vector<VkImageCopy> regions(frameMemory);
+			for (uint32_t mip = 0; mip < image.imageInfo.mipLevels; ++mip)
+			{
+				const VkImageSubresourceLayers layers{
+					.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+					.mipLevel = mip,
+					.baseArrayLayer = 0,
+					.layerCount = image.imageInfo.arrayLayers,
+				};
+				regions.push_back(VkImageCopy{
+					.srcSubresource = layers,
+					.dstSubresource = layers,
+					.extent = {
+						.width = std::max(image.imageInfo.extent.width >> mip, 1U),
+						.height = std::max(image.imageInfo.extent.height >> mip, 1U),
+						.depth = 1,
+					},
+				});
+			}
+			vkCmdCopyImage(cmd, image.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, newImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(regions.size()), regions.data());
+
+			const VkImageMemoryBarrier2 toReadable{
+				.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+				.srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+				.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+				.dstStageMask = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+				.dstAccessMask = VK_ACCESS_2_SHADER_READ_BIT,
+				.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+				.image = newImage,
+				.subresourceRange = range,
+			};
+			const VkDependencyInfo toReadableDependency{
+				.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+				.imageMemoryBarrierCount = 1,
+				.pImageMemoryBarriers = &toReadable,
+			};
+			vkCmdPipelineBarrier2(cmd, &toReadableDependency);
+
+			defragOldResources.push_back(MovedResource{ .image = image.image, .imageView = image.imageView });
+			image.image = newImage;
+			image.imageView = newView;
+			movedImages.push_back(handle);
+		}
+		else
+		{
+			Buffer& buffer = buffers.get(static_cast<uint32_t>(userData));
+
+			// The CPU may be writing through the old mapping
+			if (buffer.ptr != nullptr)
+			{
+				move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+				continue;
+			}
+
+			VkBuffer newBuffer{ VK_NULL_HANDLE };
+			vkCreateBuffer(device, &buffer.bufferInfo, nullptr, &newBuffer);
+			vmaBindBufferMemory(allocator, move.dstTmpAllocation, newBuffer);
+
+			const VkBufferCopy region{ .srcOffset = 0, .dstOffset = 0, .size = buffer.bufferInfo.size };
+			vkCmdCopyBuffer(cmd, buffer.buffer, newBuffer, 1, &region);
+
+			defragOldResources.push_back(MovedResource{ .buffer = buffer.buffer });
+			buffer.buffer = newBuffer;
+			movedBuffers = true;
+		}
+
+		++defragMovedAllocations;
+		defragMovedBytes += allocationInfo.size;
+	}
+
+	if (movedBuffers)
+	{
+		const VkMemoryBarrier2 copyBarrier{
+			.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+			.srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+			.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+			.dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+			.dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT,
+		};
+		const VkDependencyInfo copyDependency{
+			.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+			.memoryBarrierCount = 1,
+			.pMemoryBarriers = &copyBarrier,
+		};
+		vkCmdPipelineBarrier2(cmd, &copyDependency);
+	}
+
+	return movedImages;
+}
+
+void ResourceManager::trackAllocation(MemoryCategory category, VkDeviceSize size, bool add)
+{
+	MemoryStats::Category& total = categoryTotals[static_cast<size_t>(category)];
+	if (add)
+	{
+		total.bytes += size;
+		++total.count;
+	}
+	else
+	{
+		total.bytes -= size;
+		--total.count;
+	}
+}
+
+bool ResourceManager::isMoving(VmaAllocation allocation) const
+{
+	if (!defragPassOpen)
+	{
+		return false;
+	}
+
+	for (uint32_t i = 0; i < defragPass.moveCount; ++i)
+	{
+		if (defragPass.pMoves[i].srcAllocation == allocation && defragPass.pMoves[i].operation != VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void ResourceManager::endDefragmentationPass()
+{
+	for (const MovedResource& old : defragOldResources)
+	{
+		if (old.buffer != VK_NULL_HANDLE)
+		{
+			vkDestroyBuffer(device, old.buffer, nullptr);
+		}
+		if (old.image != VK_NULL_HANDLE)
+		{
+			vkDestroyImageView(device, old.imageView, nullptr);
+			vkDestroyImage(device, old.image, nullptr);
+		}
+	}
+	defragOldResources.clear();
+
+	const VkResult result = vmaEndDefragmentationPass(allocator, defragContext, &defragPass);
+	defragPassOpen = false;
+
+	// Destroys that arrived while their allocation was being moved
+	const std::vector<BufferHandle> pendingBuffers = std::move(defragPendingBufferDestroys);
+	const std::vector<ImageHandle> pendingImages = std::move(defragPendingImageDestroys);
+	defragPendingBufferDestroys.clear();
+	defragPendingImageDestroys.clear();
+	for (const BufferHandle& buffer : pendingBuffers)
+	{
+		DestroyBuffer(buffer);
+	}
+	for (const ImageHandle& image : pendingImages)
+	{
+		DestroyImage(image);
+	}
+
+	if (result == VK_SUCCESS)
+	{
+		vmaEndDefragmentation(allocator, defragContext, nullptr);
+		defragContext = VK_NULL_HANDLE;
+	}
+}
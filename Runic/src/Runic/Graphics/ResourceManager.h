@@ -3,10 +3,28 @@
 #include <vulkan/vulkan.h>
 #include <vk_mem_alloc.h>
 #include <array>
+#include <memory_resource>
+#include <span>
+#include <vector>
 
 #include "Runic/Graphics/Common.h"
 #include "Runic/Structures/Slotmap.h"
 
+/*
+What an allocation is used for, memory telemetry is totalled per category
+*/
+enum class MemoryCategory
+{
+	OTHER,
+	MESH,
+	TEXTURE,
+	RENDER_TARGET,
+	SCENE_BUFFER,
+	STAGING,
+	COUNT
+};
+
+inline constexpr const char* MEMORY_CATEGORY_NAMES[] = { "Other", "Meshes", "Textures", "Render targets", "Scene buffers", "Staging" };
 
 struct BufferCreateInfo
 {
@@ -20,6 +38,25 @@ struct BufferCreateInfo
 		SRC,
 		DST
 	} transfer {Transfer::NONE};
+
+	/*
+	GPU_ONLY:		Device local, never mapped. Static geometry, filled through a staging copy.
+	UPLOAD:			Host memory, mapped, written sequentially. Staging and streaming sources.
+	READBACK:		Host memory, mapped and cached, for reading GPU results on the CPU.
+	DIRECT_WRITE:	Mapped device local memory (BAR/ReBAR) when the device has it, host memory otherwise.
+					Per-frame data written by the CPU and read by shaders without a copy.
+	*/
+	enum class Memory
+	{
+		GPU_ONLY,
+		UPLOAD,
+		READBACK,
+		DIRECT_WRITE,
+	} memory {Memory::GPU_ONLY};
+
+	MemoryCategory category {MemoryCategory::OTHER};
+
+	bool shaderAddress {false};		// Read from shaders through its device address
 };
 
 struct ImageCreateInfo
@@ -35,14 +72,21 @@ struct ImageCreateInfo
 		COLOR,
 		DEPTH
 	} usage;
+
+	MemoryCategory category {MemoryCategory::OTHER};
 };
 
 struct Buffer
 {
 	VkBuffer buffer{ VK_NULL_HANDLE };
 	VmaAllocation allocation{};
-	void* ptr {nullptr};
+	void* ptr {nullptr};		// Only set for mapped memory classes
 	std::size_t size{};
+	bool deviceLocal{ false };
+
+	VkBufferCreateInfo bufferInfo{};	// Kept to recreate the buffer when defragmentation moves it
+	VkDeviceSize allocationSize{};
+	MemoryCategory category{ MemoryCategory::OTHER };
 };
 
 struct Image
@@ -50,6 +94,40 @@ struct Image
 	VkImage image { VK_NULL_HANDLE };
 	VmaAllocation allocation{};
 	VkImageView imageView{ VK_NULL_HANDLE };
+
+	VkImageCreateInfo imageInfo{};		// Kept to recreate the image when defragmentation moves it
+	VkImageViewCreateInfo viewInfo{};
+	VkDeviceSize allocationSize{};
+	MemoryCategory category{ MemoryCategory::OTHER };
+};
+
+struct MemoryStats
+{
+	struct Heap
+	{
+		VkDeviceSize usage;
+		VkDeviceSize budget;
+		VkDeviceSize blockBytes;		// Reserved from Vulkan
+		VkDeviceSize allocationBytes;	// Used by allocations within those blocks
+		uint32_t blockCount;
+		uint32_t allocationCount;
+		bool deviceLocal;
+	};
+	// Fixed size so reading the stats every frame doesn't allocate
+	std::array<Heap, VK_MAX_MEMORY_HEAPS> heapArray{};
+	uint32_t heapCount{ 0U };
+	std::span<const Heap> heaps() const { return { heapArray.data(), heapCount }; }
+
+	struct Category
+	{
+		VkDeviceSize bytes;
+		uint32_t count;
+	};
+	std::array<Category, static_cast<size_t>(MemoryCategory::COUNT)> categories{};
+
+	bool defragmenting;
+	uint32_t defragmentedAllocations;
+	VkDeviceSize defragmentedBytes;
 };
 
 struct BufferHandle
@@ -77,10 +155,48 @@ public:
 	ImageHandle CreateImage(const ImageCreateInfo& createInfo);
 	Image GetImage(const ImageHandle& image);
 	void DestroyImage(const ImageHandle& image);
+
+	MemoryStats GetMemoryStats();
+
+	/*
+	Incremental defragmentation. Each step records the copies for one pass into cmd, within a CPU time and byte
+	budget, and swaps the new buffers and images into their existing handles. The old ones are released, and the
+	pass ended, by a later step once completedValue reaches the retireValue the copies were recorded with, both
+	graphics timeline values. Mapped buffers and render targets are never moved, and at most maxImageMoves images
+	are moved per step, the rest stay where they are.
+	Returns the images moved this step, whose views need rebinding, allocated from frameMemory.
+	*/
+	void BeginDefragmentation(VkDeviceSize maxBytesPerPass, uint32_t maxAllocationsPerPass);
+	std::pmr::vector<ImageHandle> DefragmentStep(VkCommandBuffer cmd, uint64_t completedValue, uint64_t retireValue, double timeBudgetMs, uint32_t maxImageMoves,
+		std::pmr::memory_resource* frameMemory);
+	bool IsDefragmenting() const { return defragContext != VK_NULL_HANDLE; }
 protected:
+	void trackAllocation(MemoryCategory category, VkDeviceSize size, bool add);
+	bool isMoving(VmaAllocation allocation) const;
+	void endDefragmentationPass();
+
 	const VkDevice device;
 	const VmaAllocator allocator;
 
+	std::array<MemoryStats::Category, static_cast<size_t>(MemoryCategory::COUNT)> categoryTotals{};
+
+	VmaDefragmentationContext defragContext{ VK_NULL_HANDLE };
+	VmaDefragmentationPassMoveInfo defragPass{};
+	bool defragPassOpen{ false };
+	uint64_t defragRetireValue{ 0U };
+	uint32_t defragMovedAllocations{ 0U };
+	VkDeviceSize defragMovedBytes{ 0U };
+
+	struct MovedResource
+	{
+		VkBuffer buffer{ VK_NULL_HANDLE };
+		VkImage image{ VK_NULL_HANDLE };
+		VkImageView imageView{ VK_NULL_HANDLE };
+	};
+	std::vector<MovedResource> defragOldResources;
+	std::vector<BufferHandle> defragPendingBufferDestroys;
+	std::vector<ImageHandle> defragPendingImageDestroys;
+
 	Slotmap<Buffer> buffers;
 	Slotmap<Image> images;
 };
@@ -27,3 +27,6 @@ private:
 #define LOG_CORE_WARN(...)  
 #define LOG_CORE_ERROR(...) 
 #endif
+
+// Not compiled out in release, for failures a release build still has to report, such as a benchmark that can't run
+#define LOG_CORE_ALWAYS(...) ::Log::GetCoreLogger()->error(__VA_ARGS__)
@@ -13,7 +13,7 @@ glm::mat4 Camera::BuildViewMatrix() const
 
 glm::mat4 Camera::BuildProjMatrix() const
 {
-	glm::mat4 projTemp = glm::perspective(glm::radians(70.f), 1700.f / 900.f, 0.1f, 1000.0f);
+	glm::mat4 projTemp = glm::perspective(glm::radians(m_fov), m_aspect, m_near, m_far);
 	projTemp[1][1] *= -1;
 	return projTemp;
 }
\ No newline at end of file
@@ -24,5 +24,9 @@ namespace Runic
 		float m_yaw = 0.0f;
 		float m_pitch = 0.0f;
 		glm::vec3 m_pos {0,0,0};
+		float m_fov = 70.0f;	// Vertical, in degrees
+		float m_aspect = 1700.0f / 900.0f;
+		float m_near = 0.1f;
+		float m_far = 1000.0f;
 	};
 }
\ No newline at end of file
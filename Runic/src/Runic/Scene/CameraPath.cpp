@@ -0,0 +1,88 @@
+#include "Runic/Scene/CameraPath.h"
+
+#include "Runic/Scene/Camera.h"
+
+#include <gtx/spline.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+using namespace Runic;
+
+void CameraPath::AddKeyframe(const Camera& camera)
+{
+	m_keyframes.push_back(Keyframe{ .position = camera.m_pos, .yaw = camera.m_yaw, .pitch = camera.m_pitch });
+}
+
+CameraPath::Keyframe CameraPath::Evaluate(float t) const
+{
+	if (m_keyframes.size() < 2)
+	{
+		return m_keyframes.empty() ? Keyframe{} : m_keyframes.front();
+	}
+
+	const float segments = static_cast<float>(m_keyframes.size() - 1);
+	const float position = std::clamp(t, 0.0f, 1.0f) * segments;
+	const size_t segment = std::min(static_cast<size_t>(position), m_keyframes.size() - 2);
+	const float s = position - static_cast<float>(segment);
+
+	// The end keyframes are repeated, so the spline starts and stops on them
+	const Keyframe& k0 = m_keyframes[segment == 0 ? 0 : segment - 1];
+	const Keyframe& k1 = m_keyframes[segment];
+	const Keyframe& k2 = m_keyframes[segment + 1];
+	const Keyframe& k3 = m_keyframes[std::min(segment + 2, m_keyframes.size() - 1)];
+
+	const glm::vec3 angles = glm::catmullRom(
+		glm::vec3{ k0.yaw, k0.pitch, 0.0f },
+		glm::vec3{ k1.yaw, k1.pitch, 0.0f },
+		glm::vec3{ k2.yaw, k2.pitch, 0.0f },
+		glm::vec3{ k3.yaw, k3.pitch, 0.0f },
+		s);
+
+	return Keyframe{
+		.position = glm::catmullRom(k0.position, k1.position, k2.position, k3.position, s),
+		.yaw = angles.x,
+		.pitch = angles.y,
+	};
+}
+
+void CameraPath::Apply(float t, Camera& camera) const
+{
+	const Keyframe keyframe = Evaluate(t);
+	camera.m_pos = keyframe.position;
+	camera.m_yaw = keyframe.yaw;
+	camera.m_pitch = keyframe.pitch;
+}
+
+bool CameraPath::LoadFromFile(const std::string& filename)
+{
+	std::ifstream file(filename);
+	if (!file)
+	{
+		return false;
+	}
+
+	m_keyframes.clear();
+	Keyframe keyframe;
+	while (file >> keyframe.position.x >> keyframe.position.y >> keyframe.position.z >> keyframe.yaw >> keyframe.pitch)
+	{
+		m_keyframes.push_back(keyframe);
+	}
+	return !m_keyframes.empty();
+}
+
+bool CameraPath::SaveToFile(const std::string& filename) const
+{
+	std::ofstream file(filename);
+	if (!file)
+	{
+		return false;
+	}
+
+	for (const Keyframe& keyframe : m_keyframes)
+	{
+		file << keyframe.position.x << " " << keyframe.position.y << " " << keyframe.position.z << " " << keyframe.yaw << " " << keyframe.pitch << "\n";
+	}
+	return true;
+}
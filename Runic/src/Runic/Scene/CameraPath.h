@@ -0,0 +1,45 @@
+#pragma once
+
+#include <glm.hpp>
+
+#include <string>
+#include <vector>
+
+namespace Runic
+{
+	class Camera;
+
+	/*
+	*
+	* CameraPath: Catmull-Rom spline through camera keyframes, evaluated from a 0..1 parameter so a flight is the same
+	*			  every run whatever the frame rate. Saved as text, one "x y z yaw pitch" keyframe per line.
+	*
+	*/
+	class CameraPath
+	{
+	public:
+		struct Keyframe
+		{
+			glm::vec3 position{ 0.0f };
+			float yaw{ 0.0f };		// Degrees, like Camera
+			float pitch{ 0.0f };
+		};
+
+		CameraPath() = default;
+		explicit CameraPath(std::vector<Keyframe> keyframes) : m_keyframes(std::move(keyframes)) {}
+
+		void AddKeyframe(const Camera& camera);
+		bool Empty() const { return m_keyframes.empty(); }
+
+		/*
+		Keyframes are spaced evenly in t, the path passes through each of them
+		*/
+		Keyframe Evaluate(float t) const;
+		void Apply(float t, Camera& camera) const;
+
+		bool LoadFromFile(const std::string& filename);
+		bool SaveToFile(const std::string& filename) const;
+	private:
+		std::vector<Keyframe> m_keyframes;
+	};
+}
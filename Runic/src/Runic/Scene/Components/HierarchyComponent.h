@@ -0,0 +1,15 @@
+#pragma once
+
+#include <entt/entt.hpp>
+
+namespace Runic
+{
+	struct HierarchyComponent
+	{
+		HierarchyComponent() = default;
+		HierarchyComponent(const HierarchyComponent&) = default;
+
+		// The entity this one is attached to, entt::null for a root
+		entt::entity parent{ entt::null };
+	};
+}
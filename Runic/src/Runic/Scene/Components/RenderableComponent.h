@@ -19,5 +19,8 @@ namespace Runic
 		std::optional<TextureHandle> normalHandle = {};
 		std::optional<TextureHandle> roughnessHandle = {};
 		std::optional<TextureHandle> emissionHandle = {};
+
+		// Never moves once given to the renderer, its shadows are cached instead of redrawn every frame
+		bool isStatic{ false };
 	};
 }
\ No newline at end of file
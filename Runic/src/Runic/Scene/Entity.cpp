@@ -1,8 +1,26 @@
 #pragma once
 
 #include "Runic/Scene/Entity.h"
+#include "Runic/Scene/Components/HierarchyComponent.h"
+#include "Runic/Scene/Components/TransformComponent.h"
 
 Runic::Entity::Entity(entt::entity handle, Scene* scene) : m_entityHandle(handle), m_scene(scene)
 {
 
-}
\ No newline at end of file
+}
+
+glm::mat4 Runic::Entity::BuildWorldMatrix() const
+{
+	const entt::registry& registry = m_scene->m_registry;
+	glm::mat4 worldMatrix{ 1.0f };
+	for (entt::entity entity = m_entityHandle; entity != entt::null;)
+	{
+		if (const TransformComponent* transform = registry.try_get<TransformComponent>(entity))
+		{
+			worldMatrix = transform->BuildMatrix() * worldMatrix;
+		}
+		const HierarchyComponent* hierarchy = registry.try_get<HierarchyComponent>(entity);
+		entity = hierarchy != nullptr ? hierarchy->parent : entt::null;
+	}
+	return worldMatrix;
+}
@@ -3,6 +3,7 @@
 #include "Runic/Scene/Scene.h"
 
 #include <entt/entt.hpp>
+#include <glm.hpp>
 #include <assert.h>
 
 namespace Runic
@@ -41,6 +42,13 @@ namespace Runic
 			return m_scene->m_registry.any_of<T>(m_entityHandle);
 		}
 
+		entt::entity GetHandle() const { return m_entityHandle; }
+
+		/*
+		Transform composed with every parent's, identity for an entity without any
+		*/
+		glm::mat4 BuildWorldMatrix() const;
+
 		operator bool() const { return m_entityHandle != entt::null; }
 	private:
 		entt::entity m_entityHandle {entt::null};
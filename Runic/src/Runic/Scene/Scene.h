@@ -17,6 +17,7 @@ namespace Runic
 	{
 		friend class Engine;
 		friend class Entity;
+		friend class SceneSerializer;
 	public:
 		Scene();
 		~Scene();
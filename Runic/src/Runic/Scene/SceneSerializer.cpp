@@ -0,0 +1,623 @@
+#include "Runic/Scene/SceneSerializer.h"
+
+#include <Tracy.hpp>
+
+#include "Runic/Assets/AssetRegistry.h"
+#include "Runic/Log.h"
+#include "Runic/Scene/Components/HierarchyComponent.h"
+#include "Runic/Scene/Components/LightComponent.h"
+#include "Runic/Scene/Components/RenderableComponent.h"
+#include "Runic/Scene/Components/TransformComponent.h"
+#include "Runic/Scene/Entity.h"
+#include "Runic/Scene/Scene.h"
+#include "Runic/Structures/MappedFile.h"
+
+#include <cstring>
+#include <fstream>
+#include <optional>
+#include <span>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+
+using namespace Runic;
+
+namespace
+{
+	enum class SectionType : uint32_t
+	{
+		ASSETS,
+		STRINGS,		// Asset paths, not attached to entities
+		TRANSFORMS,
+		RENDERABLES,
+		LIGHTS,
+		HIERARCHY,
+	};
+
+	struct FileHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t entityCount;
+		uint32_t sectionCount;
+	};
+
+	/*
+	Offsets are from the start of the file. Entity sections start with a uint32_t entity index per element.
+	*/
+	struct SectionHeader
+	{
+		SectionType type;
+		uint32_t elementSize;
+		uint64_t count;
+		uint64_t entitiesOffset;
+		uint64_t dataOffset;
+	};
+
+	struct AssetRecord
+	{
+		AssetID id;
+		AssetType type;
+		uint32_t index;
+		uint64_t pathOffset;		// Into the strings section
+		uint64_t pathLength;
+	};
+
+	/*
+	Indices into the asset section, whose records carry the IDs, so each ID is only looked up once per load.
+	NO_ASSET when the renderable has no such texture.
+	*/
+	struct RenderableRecord
+	{
+		uint32_t mesh;
+		uint32_t texture;
+		uint32_t normal;
+		uint32_t roughness;
+		uint32_t emission;
+		uint32_t isStatic;
+	};
+
+	struct HierarchyRecord
+	{
+		uint32_t parent;
+	};
+
+	constexpr uint32_t NO_ENTITY = UINT32_MAX;
+	constexpr uint32_t NO_ASSET = UINT32_MAX;
+	constexpr uint64_t SECTION_ALIGNMENT = 16U;
+
+	static_assert(std::is_trivially_copyable_v<TransformComponent> && sizeof(TransformComponent) == 36U, "TransformComponent changed, bump SCENE_FILE_VERSION");
+	static_assert(std::is_trivially_copyable_v<LightComponent> && sizeof(LightComponent) == 76U, "LightComponent changed, bump SCENE_FILE_VERSION");
+
+	uint32_t expectedElementSize(SectionType type)
+	{
+		switch (type)
+		{
+		case SectionType::ASSETS:		return sizeof(AssetRecord);
+		case SectionType::STRINGS:		return 1U;
+		case SectionType::TRANSFORMS:	return sizeof(TransformComponent);
+		case SectionType::RENDERABLES:	return sizeof(RenderableRecord);
+		case SectionType::LIGHTS:		return sizeof(LightComponent);
+		case SectionType::HIERARCHY:	return sizeof(HierarchyRecord);
+		}
+		return 0U;
+	}
+
+	bool isEntitySection(SectionType type)
+	{
+		return type != SectionType::ASSETS && type != SectionType::STRINGS;
+	}
+
+	uint64_t alignUp(uint64_t value)
+	{
+		return (value + SECTION_ALIGNMENT - 1U) & ~(SECTION_ALIGNMENT - 1U);
+	}
+
+	/*
+	Sections are laid out in a body buffer first, their offsets are moved past the headers once the number of
+	sections is known
+	*/
+	class SceneWriter
+	{
+	public:
+		template<typename T>
+		void AddSection(SectionType type, std::span<const uint32_t> entities, std::span<const T> data)
+		{
+			SectionHeader section{ .type = type, .elementSize = sizeof(T), .count = data.size(), .entitiesOffset = 0U, .dataOffset = 0U };
+			if (isEntitySection(type))
+			{
+				section.entitiesOffset = append(entities.data(), entities.size_bytes());
+			}
+			section.dataOffset = append(data.data(), data.size_bytes());
+			m_sections.push_back(section);
+		}
+
+		bool Write(const std::string& filename, uint32_t entityCount)
+		{
+			const FileHeader header{ .magic = SCENE_FILE_MAGIC, .version = SCENE_FILE_VERSION, .entityCount = entityCount, .sectionCount = static_cast<uint32_t>(m_sections.size()) };
+			const uint64_t bodyOffset = alignUp(sizeof(FileHeader) + m_sections.size() * sizeof(SectionHeader));
+			for (SectionHeader& section : m_sections)
+			{
+				section.entitiesOffset += isEntitySection(section.type) ? bodyOffset : 0U;
+				section.dataOffset += bodyOffset;
+			}
+
+			std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+			if (!file)
+			{
+				return false;
+			}
+			const char padding[SECTION_ALIGNMENT] = {};
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			file.write(reinterpret_cast<const char*>(m_sections.data()), static_cast<std::streamsize>(m_sections.size() * sizeof(SectionHeader)));
+			file.write(padding, static_cast<std::streamsize>(bodyOffset - sizeof(FileHeader) - m_sections.size() * sizeof(SectionHeader)));
+			file.write(reinterpret_cast<const char*>(m_body.data()), static_cast<std::streamsize>(m_body.size()));
+			return file.good();
+		}
+	private:
+		uint64_t append(const void* data, size_t size)
+		{
+			const uint64_t offset = alignUp(m_body.size());
+			m_body.resize(offset + size);
+			if (size > 0U)
+			{
+				memcpy(m_body.data() + offset, data, size);
+			}
+			return offset;
+		}
+
+		std::vector<SectionHeader> m_sections;
+		std::vector<std::byte> m_body;
+	};
+
+	/*
+	Everything Save and ExportText write, with entities numbered in the scene's creation order
+	*/
+	struct SceneContents
+	{
+		uint32_t entityCount{ 0U };
+		std::vector<uint32_t> transformEntities;
+		std::vector<TransformComponent> transforms;
+		std::vector<uint32_t> renderableEntities;
+		std::vector<RenderableRecord> renderables;
+		std::vector<uint32_t> lightEntities;
+		std::vector<LightComponent> lights;
+		std::vector<uint32_t> hierarchyEntities;
+		std::vector<HierarchyRecord> hierarchy;
+		std::vector<AssetRecord> assets;
+		std::string strings;
+		uint32_t droppedRenderables{ 0U };
+	};
+
+	/*
+	Converts the Component of each entity that has one to its record, in entity order. Entities whose convert
+	returns nothing are left out.
+	*/
+	template<typename Component, typename Record, typename Convert>
+	void collect(entt::registry& registry, const std::vector<entt::entity>& handles, std::vector<uint32_t>& entities, std::vector<Record>& records, Convert convert)
+	{
+		const auto& storage = registry.storage<Component>();
+		entities.reserve(storage.size());
+		records.reserve(storage.size());
+		for (uint32_t i = 0; i < handles.size(); ++i)
+		{
+			if (!storage.contains(handles[i]))
+			{
+				continue;
+			}
+
+			if (const std::optional<Record> record = convert(storage.get(handles[i])); record.has_value())
+			{
+				entities.push_back(i);
+				records.push_back(record.value());
+			}
+		}
+	}
+
+	SceneContents gatherScene(const Scene& scene, entt::registry& registry, const AssetRegistry& assets)
+	{
+		ZoneScoped;
+
+		SceneContents contents;
+		contents.entityCount = static_cast<uint32_t>(scene.m_entities.size());
+
+		// Parents are stored as indices, found by entity ID as only live entities are in the scene
+		std::vector<entt::entity> handles(contents.entityCount);
+		std::vector<uint32_t> indexOf;
+		for (uint32_t i = 0; i < contents.entityCount; ++i)
+		{
+			handles[i] = scene.m_entities[i]->GetHandle();
+			const size_t id = entt::to_entity(handles[i]);
+			if (id >= indexOf.size())
+			{
+				indexOf.resize(id + 1U, NO_ENTITY);
+			}
+			indexOf[id] = i;
+		}
+		const auto indexOfEntity = [&](entt::entity entity) {
+			const size_t id = entity != entt::null ? entt::to_entity(entity) : indexOf.size();
+			return id < indexOf.size() ? indexOf[id] : NO_ENTITY;
+		};
+
+		collect<TransformComponent>(registry, handles, contents.transformEntities, contents.transforms, [](const TransformComponent& transform) {
+			return std::optional<TransformComponent>(transform);
+		});
+		collect<LightComponent>(registry, handles, contents.lightEntities, contents.lights, [](const LightComponent& light) {
+			return std::optional<LightComponent>(light);
+		});
+		collect<HierarchyComponent>(registry, handles, contents.hierarchyEntities, contents.hierarchy, [&](const HierarchyComponent& hierarchy) {
+			return std::optional<HierarchyRecord>(HierarchyRecord{ .parent = indexOfEntity(hierarchy.parent) });
+		});
+
+		std::unordered_map<AssetID, uint32_t> referenced;
+		const auto reference = [&](AssetID id, AssetType type) {
+			const AssetSource* source = assets.GetSource(id);
+			if (source == nullptr)
+			{
+				return NO_ASSET;
+			}
+			const auto [it, added] = referenced.try_emplace(id, static_cast<uint32_t>(contents.assets.size()));
+			if (!added)
+			{
+				return it->second;
+			}
+			contents.assets.push_back(AssetRecord{
+				.id = id,
+				.type = type,
+				.index = source->index,
+				.pathOffset = contents.strings.size(),
+				.pathLength = source->path.size(),
+			});
+			contents.strings += source->path;
+			return it->second;
+		};
+		const auto texture = [&](const std::optional<TextureHandle>& texture) {
+			return texture.has_value() ? reference(assets.GetTextureID(texture.value()), AssetType::TEXTURE) : NO_ASSET;
+		};
+
+		collect<RenderableComponent>(registry, handles, contents.renderableEntities, contents.renderables, [&](const RenderableComponent& renderable) -> std::optional<RenderableRecord> {
+			const uint32_t mesh = reference(assets.GetMeshID(renderable.meshHandle), AssetType::MESH);
+			if (mesh == NO_ASSET)
+			{
+				++contents.droppedRenderables;
+				return std::nullopt;
+			}
+			return RenderableRecord{
+				.mesh = mesh,
+				.texture = texture(renderable.textureHandle),
+				.normal = texture(renderable.normalHandle),
+				.roughness = texture(renderable.roughnessHandle),
+				.emission = texture(renderable.emissionHandle),
+				.isStatic = renderable.isStatic ? 1U : 0U,
+			};
+		});
+
+		return contents;
+	}
+
+	/*
+	Checks a section fits in the file, is aligned and has the element size this version expects
+	*/
+	bool validateSection(const SectionHeader& section, size_t fileSize, uint32_t entityCount, const std::byte* data)
+	{
+		if (section.elementSize != expectedElementSize(section.type) || section.count > fileSize / section.elementSize)
+		{
+			return false;
+		}
+
+		const auto fits = [&](uint64_t offset, uint64_t size) {
+			return offset % SECTION_ALIGNMENT == 0U && offset <= fileSize && size <= fileSize - offset;
+		};
+		if (!fits(section.dataOffset, section.count * section.elementSize))
+		{
+			return false;
+		}
+		if (!isEntitySection(section.type))
+		{
+			return true;
+		}
+
+		if (!fits(section.entitiesOffset, section.count * sizeof(uint32_t)))
+		{
+			return false;
+		}
+		const uint32_t* entities = reinterpret_cast<const uint32_t*>(data + section.entitiesOffset);
+		for (uint64_t i = 0; i < section.count; ++i)
+		{
+			if (entities[i] >= entityCount)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/*
+	Components stored as they are in memory go from the mapped file into the registry without a copy in between.
+	Storage is grown once up front rather than element by element.
+	*/
+	template<typename Component>
+	void insertMappedComponents(entt::registry& registry, const std::vector<entt::entity>& entities, const SectionHeader& section, const std::byte* data)
+	{
+		const uint32_t* indices = reinterpret_cast<const uint32_t*>(data + section.entitiesOffset);
+		std::vector<entt::entity> owners(section.count);
+		for (size_t i = 0; i < owners.size(); ++i)
+		{
+			owners[i] = entities[indices[i]];
+		}
+
+		auto& storage = registry.storage<Component>();
+		storage.reserve(storage.size() + owners.size());
+		registry.insert<Component>(owners.begin(), owners.end(), reinterpret_cast<const Component*>(data + section.dataOffset));
+	}
+}
+
+SceneSerializer::SceneSerializer(AssetRegistry* assets) : m_assets(assets)
+{
+
+}
+
+bool SceneSerializer::Save(Scene& scene, const std::string& filename) const
+{
+	ZoneScoped;
+
+	const SceneContents contents = gatherScene(scene, scene.m_registry, *m_assets);
+	if (contents.droppedRenderables > 0U)
+	{
+		LOG_CORE_WARN("{} renderables use meshes that weren't loaded from a file, they aren't saved", contents.droppedRenderables);
+	}
+
+	SceneWriter writer;
+	writer.AddSection<AssetRecord>(SectionType::ASSETS, {}, contents.assets);
+	writer.AddSection<char>(SectionType::STRINGS, {}, contents.strings);
+	writer.AddSection<TransformComponent>(SectionType::TRANSFORMS, contents.transformEntities, contents.transforms);
+	writer.AddSection<RenderableRecord>(SectionType::RENDERABLES, contents.renderableEntities, contents.renderables);
+	writer.AddSection<LightComponent>(SectionType::LIGHTS, contents.lightEntities, contents.lights);
+	writer.AddSection<HierarchyRecord>(SectionType::HIERARCHY, contents.hierarchyEntities, contents.hierarchy);
+	if (!writer.Write(filename, contents.entityCount))
+	{
+		LOG_CORE_ERROR("Failed to write scene: " + filename);
+		return false;
+	}
+	return true;
+}
+
+bool SceneSerializer::Load(Scene& scene, const std::string& filename, const std::function<bool(const std::string&)>& loadSource) const
+{
+	ZoneScoped;
+
+	MappedFile file;
+	if (!file.Open(filename) || file.Size() < sizeof(FileHeader))
+	{
+		LOG_CORE_ERROR("Failed to open scene: " + filename);
+		return false;
+	}
+
+	const std::byte* data = file.Data();
+	FileHeader header;
+	memcpy(&header, data, sizeof(header));
+	if (header.magic != SCENE_FILE_MAGIC || header.version != SCENE_FILE_VERSION)
+	{
+		LOG_CORE_ERROR("Not a version {} scene file: {}", SCENE_FILE_VERSION, filename);
+		return false;
+	}
+	if (header.sectionCount > (file.Size() - sizeof(FileHeader)) / sizeof(SectionHeader))
+	{
+		LOG_CORE_ERROR("Corrupt scene file: " + filename);
+		return false;
+	}
+
+	// Everything is checked before the scene is touched, a bad file adds nothing
+	std::vector<SectionHeader> sections(header.sectionCount);
+	memcpy(sections.data(), data + sizeof(FileHeader), sections.size() * sizeof(SectionHeader));
+	const SectionHeader* assetSection = nullptr;
+	const SectionHeader* stringSection = nullptr;
+	for (const SectionHeader& section : sections)
+	{
+		if (!validateSection(section, file.Size(), header.entityCount, data))
+		{
+			LOG_CORE_ERROR("Corrupt scene file: " + filename);
+			return false;
+		}
+		assetSection = section.type == SectionType::ASSETS ? &section : assetSection;
+		stringSection = section.type == SectionType::STRINGS ? &section : stringSection;
+	}
+
+	const std::span<const AssetRecord> assets = assetSection != nullptr
+		? std::span<const AssetRecord>(reinterpret_cast<const AssetRecord*>(data + assetSection->dataOffset), assetSection->count)
+		: std::span<const AssetRecord>();
+	const std::string_view strings = stringSection != nullptr
+		? std::string_view(reinterpret_cast<const char*>(data + stringSection->dataOffset), stringSection->count)
+		: std::string_view();
+	for (const AssetRecord& asset : assets)
+	{
+		if (asset.pathOffset > strings.size() || asset.pathLength > strings.size() - asset.pathOffset)
+		{
+			LOG_CORE_ERROR("Corrupt scene file: " + filename);
+			return false;
+		}
+	}
+
+	for (const SectionHeader& section : sections)
+	{
+		if (section.type != SectionType::HIERARCHY)
+		{
+			continue;
+		}
+		const HierarchyRecord* hierarchy = reinterpret_cast<const HierarchyRecord*>(data + section.dataOffset);
+		for (uint64_t i = 0; i < section.count; ++i)
+		{
+			if (hierarchy[i].parent != NO_ENTITY && hierarchy[i].parent >= header.entityCount)
+			{
+				LOG_CORE_ERROR("Corrupt scene file: " + filename);
+				return false;
+			}
+		}
+	}
+
+	// Each asset record's handle, sources not loaded yet are loaded once each
+	std::vector<std::optional<uint32_t>> handles(assets.size());
+	std::unordered_set<std::string_view> loadedSources;
+	const auto find = [&](const AssetRecord& asset) -> std::optional<uint32_t> {
+		return asset.type == AssetType::MESH ? m_assets->FindMesh(asset.id) : m_assets->FindTexture(asset.id);
+	};
+	for (size_t i = 0; i < assets.size(); ++i)
+	{
+		handles[i] = find(assets[i]);
+		const std::string_view path = strings.substr(assets[i].pathOffset, assets[i].pathLength);
+		if (!handles[i].has_value() && loadSource && loadedSources.insert(path).second)
+		{
+			loadSource(std::string(path));
+			handles[i] = find(assets[i]);
+		}
+
+		if (!handles[i].has_value())
+		{
+			LOG_CORE_WARN("Scene asset missing from " + std::string(path));
+		}
+	}
+	const auto handle = [&](uint32_t asset) {
+		return asset < handles.size() ? handles[asset] : std::nullopt;
+	};
+
+	entt::registry& registry = scene.m_registry;
+	std::vector<entt::entity> entities(header.entityCount);
+	registry.create(entities.begin(), entities.end());
+
+	for (const SectionHeader& section : sections)
+	{
+		switch (section.type)
+		{
+		case SectionType::TRANSFORMS:
+			insertMappedComponents<TransformComponent>(registry, entities, section, data);
+			break;
+		case SectionType::LIGHTS:
+			insertMappedComponents<LightComponent>(registry, entities, section, data);
+			break;
+		case SectionType::HIERARCHY:
+		{
+			// Records that need converting are built in place in the storage
+			const uint32_t* indices = reinterpret_cast<const uint32_t*>(data + section.entitiesOffset);
+			const HierarchyRecord* records = reinterpret_cast<const HierarchyRecord*>(data + section.dataOffset);
+			auto& storage = registry.storage<HierarchyComponent>();
+			storage.reserve(storage.size() + section.count);
+			for (size_t i = 0; i < section.count; ++i)
+			{
+				storage.emplace(entities[indices[i]]).parent = records[i].parent != NO_ENTITY ? entities[records[i].parent] : entt::null;
+			}
+			break;
+		}
+		case SectionType::RENDERABLES:
+		{
+			const uint32_t* indices = reinterpret_cast<const uint32_t*>(data + section.entitiesOffset);
+			const RenderableRecord* records = reinterpret_cast<const RenderableRecord*>(data + section.dataOffset);
+			auto& storage = registry.storage<RenderableComponent>();
+			storage.reserve(storage.size() + section.count);
+			for (size_t i = 0; i < section.count; ++i)
+			{
+				const std::optional<MeshHandle> mesh = handle(records[i].mesh);
+				if (!mesh.has_value())
+				{
+					continue;
+				}
+
+				RenderableComponent& renderable = storage.emplace(entities[indices[i]]);
+				renderable.meshHandle = mesh.value();
+				renderable.textureHandle = handle(records[i].texture);
+				renderable.normalHandle = handle(records[i].normal);
+				renderable.roughnessHandle = handle(records[i].roughness);
+				renderable.emissionHandle = handle(records[i].emission);
+				renderable.isStatic = records[i].isStatic != 0U;
+
+				// Like a loaded model's renderables, each one holds a reference to what it draws
+				m_assets->RetainMesh(renderable.meshHandle);
+				for (const std::optional<TextureHandle>& texture : { renderable.textureHandle, renderable.normalHandle, renderable.roughnessHandle, renderable.emissionHandle })
+				{
+					if (texture.has_value())
+					{
+						m_assets->RetainTexture(texture.value());
+					}
+				}
+			}
+			break;
+		}
+		default:
+			break;
+		}
+	}
+
+	scene.m_entities.reserve(scene.m_entities.size() + entities.size());
+	for (const entt::entity entity : entities)
+	{
+		scene.m_entities.push_back(std::make_shared<Entity>(entity, &scene));
+	}
+
+	LOG_CORE_INFO("Scene loaded: " + filename);
+	return true;
+}
+
+bool SceneSerializer::ExportText(Scene& scene, const std::string& filename) const
+{
+	ZoneScoped;
+
+	std::ofstream out(filename, std::ios::trunc);
+	if (!out)
+	{
+		LOG_CORE_ERROR("Failed to write scene: " + filename);
+		return false;
+	}
+
+	const SceneContents contents = gatherScene(scene, scene.m_registry, *m_assets);
+	const auto vec3 = [&](const glm::vec3& v) -> std::ostream& {
+		return out << v.x << " " << v.y << " " << v.z;
+	};
+	const auto id = [&](uint32_t asset) -> std::ostream& {
+		return asset != NO_ASSET ? out << std::hex << contents.assets[asset].id << std::dec : out << "none";
+	};
+
+	out << "scene " << SCENE_FILE_VERSION << "\n";
+	out << "entities " << contents.entityCount << "\n";
+	for (const AssetRecord& asset : contents.assets)
+	{
+		out << (asset.type == AssetType::MESH ? "mesh " : "texture ") << std::hex << asset.id << std::dec << " \"" << contents.strings.substr(asset.pathOffset, asset.pathLength) << "\" " << asset.index << "\n";
+	}
+
+	// Sections are in entity order, so each is walked once
+	size_t transform = 0, renderable = 0, light = 0, hierarchy = 0;
+	for (uint32_t entity = 0; entity < contents.entityCount; ++entity)
+	{
+		out << "\nentity " << entity << "\n";
+		for (; transform < contents.transformEntities.size() && contents.transformEntities[transform] == entity; ++transform)
+		{
+			const TransformComponent& t = contents.transforms[transform];
+			out << "\ttransform ";
+			vec3(t.translation) << " rotation ";
+			vec3(t.rotation) << " scale ";
+			vec3(t.scale) << "\n";
+		}
+		for (; renderable < contents.renderableEntities.size() && contents.renderableEntities[renderable] == entity; ++renderable)
+		{
+			const RenderableRecord& r = contents.renderables[renderable];
+			out << "\trenderable mesh ";
+			id(r.mesh) << " texture ";
+			id(r.texture) << " normal ";
+			id(r.normal) << " roughness ";
+			id(r.roughness) << " emission ";
+			id(r.emission) << (r.isStatic != 0U ? " static" : "") << "\n";
+		}
+		for (; light < contents.lightEntities.size() && contents.lightEntities[light] == entity; ++light)
+		{
+			const LightComponent& l = contents.lights[light];
+			out << (l.lightType == LightComponent::LightType::Directional ? "\tlight directional direction " : "\tlight point position ");
+			vec3(l.lightType == LightComponent::LightType::Directional ? l.direction : l.position) << " ambient ";
+			vec3(l.ambient) << " diffuse ";
+			vec3(l.diffuse) << " specular ";
+			vec3(l.specular) << " attenuation " << l.constant << " " << l.linear << " " << l.quadratic << "\n";
+		}
+		for (; hierarchy < contents.hierarchyEntities.size() && contents.hierarchyEntities[hierarchy] == entity; ++hierarchy)
+		{
+			out << "\tparent " << static_cast<int64_t>(contents.hierarchy[hierarchy].parent == NO_ENTITY ? -1 : contents.hierarchy[hierarchy].parent) << "\n";
+		}
+	}
+	return out.good();
+}
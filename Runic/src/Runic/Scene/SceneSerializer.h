@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace Runic
+{
+	class AssetRegistry;
+	class Scene;
+
+	constexpr uint32_t SCENE_FILE_MAGIC = 0x4E435352U;		// "RSCN" in little endian
+	constexpr uint32_t SCENE_FILE_VERSION = 1U;
+
+	/*
+	*
+	* SceneSerializer: Saves the entities of a scene with their Transform, Renderable, Light and Hierarchy
+	*				   components to a flat binary file, and loads them back.
+	*
+	*	Each component type is one section holding the indices of its entities and then its components, packed
+	*	and 16 byte aligned. Transforms and lights are stored as they are in memory, so loading them is a bulk
+	*	insert into the registry straight from the mapped file. Renderables store asset IDs instead of handles.
+	*	Bump SCENE_FILE_VERSION whenever a stored component's layout changes, older files are then refused.
+	*
+	*/
+	class SceneSerializer
+	{
+	public:
+		explicit SceneSerializer(AssetRegistry* assets);
+
+		bool Save(Scene& scene, const std::string& filename) const;
+
+		/*
+		Appends the file's entities to the scene. Assets that aren't in the registry yet are loaded by passing
+		their source path to loadSource, once per path. Renderables whose mesh can't be found are dropped, the
+		others each take a reference to their mesh and textures.
+		*/
+		bool Load(Scene& scene, const std::string& filename, const std::function<bool(const std::string&)>& loadSource = {}) const;
+
+		/*
+		Readable dump of the same data, one entity per block, for diffing scenes. Can't be loaded back.
+		*/
+		bool ExportText(Scene& scene, const std::string& filename) const;
+	private:
+		AssetRegistry* m_assets;
+	};
+}
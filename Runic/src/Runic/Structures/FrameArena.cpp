@@ -0,0 +1,106 @@
+#include "Runic/Structures/FrameArena.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+void FrameArena::Reset()
+{
+	m_currentBlock = 0U;
+	m_offset = 0U;
+	m_bytesUsed = 0U;
+}
+
+std::size_t FrameArena::GetCapacity() const
+{
+	std::size_t capacity = 0U;
+	for (const Block& block : m_blocks)
+	{
+		capacity += block.size;
+	}
+	return capacity;
+}
+
+void* FrameArena::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+	while (m_currentBlock < m_blocks.size())
+	{
+		Block& block = m_blocks[m_currentBlock];
+		const std::uintptr_t base = reinterpret_cast<std::uintptr_t>(block.memory.get());
+		const std::uintptr_t aligned = (base + m_offset + alignment - 1U) & ~(static_cast<std::uintptr_t>(alignment) - 1U);
+		const std::size_t end = static_cast<std::size_t>(aligned - base) + bytes;
+		if (end <= block.size)
+		{
+			m_bytesUsed += end - m_offset;
+			m_peakBytes = std::max(m_peakBytes, m_bytesUsed);
+			m_offset = end;
+			return reinterpret_cast<void*>(aligned);
+		}
+
+		++m_currentBlock;
+		m_offset = 0U;
+	}
+
+	// Only grows until the frame's peak is reached
+	const std::size_t size = std::max(m_blockSize, bytes + alignment);
+	m_blocks.push_back(Block{ .memory = std::make_unique<std::byte[]>(size), .size = size });
+	m_currentBlock = m_blocks.size() - 1U;
+	return do_allocate(bytes, alignment);
+}
+
+void FrameArenaSet::Init(uint32_t framesInFlight, uint32_t threadCount)
+{
+	m_threadCount = threadCount;
+	m_arenas.clear();
+	for (uint32_t i = 0; i < framesInFlight * threadCount; ++i)
+	{
+		m_arenas.push_back(std::make_unique<FrameArena>());
+	}
+}
+
+void FrameArenaSet::BeginFrame(uint32_t frameIndex)
+{
+	m_currentFrame = frameIndex;
+	for (uint32_t thread = 0; thread < m_threadCount; ++thread)
+	{
+		m_arenas[m_currentFrame * m_threadCount + thread]->Reset();
+	}
+}
+
+#ifdef _DEBUG
+namespace
+{
+	std::atomic<uint64_t> heapAllocations{ 0U };
+}
+
+void* operator new(std::size_t size)
+{
+	heapAllocations.fetch_add(1U, std::memory_order_relaxed);
+	if (void* ptr = std::malloc(size == 0U ? 1U : size))
+	{
+		return ptr;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+	std::free(ptr);
+}
+
+uint64_t GetHeapAllocationCount()
+{
+	return heapAllocations.load(std::memory_order_relaxed);
+}
+#else
+uint64_t GetHeapAllocationCount()
+{
+	return 0U;
+}
+#endif
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+constexpr std::size_t FRAME_ARENA_BLOCK_SIZE = 1024 * 1024;
+
+/*
+*
+* FrameArena: Bump allocator for data that only lives for one frame, usable by std::pmr containers.
+*			  Deallocation does nothing, Reset rewinds every block at once. Blocks are kept across resets,
+*			  so once a frame's peak has been reached allocating no longer touches the heap.
+*
+*/
+class FrameArena final : public std::pmr::memory_resource
+{
+public:
+	explicit FrameArena(std::size_t blockSize = FRAME_ARENA_BLOCK_SIZE) : m_blockSize(blockSize) {}
+
+	FrameArena(const FrameArena&) = delete;
+	FrameArena& operator=(const FrameArena&) = delete;
+
+	void Reset();
+
+	std::size_t GetBytesUsed() const { return m_bytesUsed; }
+	std::size_t GetPeakBytes() const { return m_peakBytes; }
+	std::size_t GetCapacity() const;
+private:
+	void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+	void do_deallocate(void*, std::size_t, std::size_t) override {}
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+	struct Block
+	{
+		std::unique_ptr<std::byte[]> memory;
+		std::size_t size;
+	};
+
+	const std::size_t m_blockSize;
+	std::vector<Block> m_blocks;
+	std::size_t m_currentBlock{ 0U };
+	std::size_t m_offset{ 0U };
+	std::size_t m_bytesUsed{ 0U };
+	std::size_t m_peakBytes{ 0U };
+};
+
+/*
+*
+* FrameArenaSet: One FrameArena per frame in flight and per thread. A frame's arenas are reset together once
+*				 the GPU has finished the frame that last used them, by then nothing can reference their memory.
+*
+*/
+class FrameArenaSet
+{
+public:
+	void Init(uint32_t framesInFlight, uint32_t threadCount);
+
+	void BeginFrame(uint32_t frameIndex);
+
+	/*
+	Thread 0 is the thread running the frame, worker threads use their own index
+	*/
+	FrameArena& Get(uint32_t thread = 0U) { return *m_arenas[m_currentFrame * m_threadCount + thread]; }
+private:
+	std::vector<std::unique_ptr<FrameArena>> m_arenas;
+	uint32_t m_threadCount{ 0U };
+	uint32_t m_currentFrame{ 0U };
+};
+
+/*
+Heap allocations made through global operator new so far, counted in debug builds only. Steady state
+frames should not change it.
+*/
+uint64_t GetHeapAllocationCount();
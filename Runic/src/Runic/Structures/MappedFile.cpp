@@ -0,0 +1,124 @@
+#include "Runic/Structures/MappedFile.h"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#endif
+
+using namespace Runic;
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+bool MappedFile::Open(const std::string& filename)
+{
+	Close();
+
+#if defined(_WIN32)
+	m_file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (m_file == INVALID_HANDLE_VALUE)
+	{
+		m_file = nullptr;
+		return false;
+	}
+
+	LARGE_INTEGER size{};
+	if (!GetFileSizeEx(m_file, &size) || size.QuadPart == 0)
+	{
+		Close();
+		return false;
+	}
+
+	m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	const void* view = m_mapping != nullptr ? MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	if (view == nullptr)
+	{
+		Close();
+		return false;
+	}
+	m_data = static_cast<const std::byte*>(view);
+	m_size = static_cast<size_t>(size.QuadPart);
+#elif defined(__unix__) || defined(__APPLE__)
+	const int fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+	{
+		return false;
+	}
+
+	struct stat info {};
+	if (fstat(fd, &info) != 0 || info.st_size == 0)
+	{
+		close(fd);
+		return false;
+	}
+
+	// The mapping keeps its own reference to the file
+#ifdef MAP_POPULATE
+	// Callers read the whole file, faulting it in up front is cheaper than a page at a time
+	constexpr int flags = MAP_PRIVATE | MAP_POPULATE;
+#else
+	constexpr int flags = MAP_PRIVATE;
+#endif
+	void* mapped = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, flags, fd, 0);
+	close(fd);
+	if (mapped == MAP_FAILED)
+	{
+		return false;
+	}
+	m_mapped = mapped;
+	m_data = static_cast<const std::byte*>(mapped);
+	m_size = static_cast<size_t>(info.st_size);
+#else
+	std::ifstream file(filename, std::ios::binary | std::ios::ate);
+	if (!file || file.tellg() <= 0)
+	{
+		return false;
+	}
+	m_contents.resize(static_cast<size_t>(file.tellg()));
+	file.seekg(0);
+	file.read(reinterpret_cast<char*>(m_contents.data()), static_cast<std::streamsize>(m_contents.size()));
+	m_data = m_contents.data();
+	m_size = m_contents.size();
+#endif
+	return true;
+}
+
+void MappedFile::Close()
+{
+#if defined(_WIN32)
+	if (m_data != nullptr)
+	{
+		UnmapViewOfFile(m_data);
+	}
+	if (m_mapping != nullptr)
+	{
+		CloseHandle(m_mapping);
+	}
+	if (m_file != nullptr)
+	{
+		CloseHandle(m_file);
+	}
+	m_mapping = nullptr;
+	m_file = nullptr;
+#elif defined(__unix__) || defined(__APPLE__)
+	if (m_mapped != nullptr)
+	{
+		munmap(m_mapped, m_size);
+	}
+	m_mapped = nullptr;
+#else
+	m_contents.clear();
+#endif
+	m_data = nullptr;
+	m_size = 0U;
+}
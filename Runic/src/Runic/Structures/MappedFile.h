@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace Runic
+{
+	/*
+	*
+	* MappedFile: Read only view of a whole file. Memory mapped where the platform allows it, so only the pages
+	*			  that are touched get read, elsewhere falls back to reading the file into memory.
+	*
+	*/
+	class MappedFile
+	{
+	public:
+		MappedFile() = default;
+		~MappedFile();
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		bool Open(const std::string& filename);
+		void Close();
+
+		const std::byte* Data() const { return m_data; }
+		size_t Size() const { return m_size; }
+	private:
+		const std::byte* m_data{ nullptr };
+		size_t m_size{ 0U };
+#if defined(_WIN32)
+		void* m_file{ nullptr };
+		void* m_mapping{ nullptr };
+#elif defined(__unix__) || defined(__APPLE__)
+		void* m_mapped{ nullptr };
+#else
+		std::vector<std::byte> m_contents;
+#endif
+	};
+}
@@ -1,6 +1,9 @@
 #pragma once
 
 #include <array>
+#include <cassert>
+#include <cstdint>
+#include <vector>
 
 /*
 *
@@ -15,13 +18,25 @@ class Slotmap
 public:
 	uint32_t add(const T& object);
 	T& get(uint32_t handle);
+	/*
+	Handle is handed out again by a later add
+	*/
+	void remove(uint32_t handle);
 
 	// TODO: make private
 	std::array<T, 4096> m_array;
 private:
 	uint32_t lastHandle{ 0U };
+	std::vector<uint32_t> freeHandles;
 	[[nodiscard]] uint32_t getNewHandle()
 	{
+		if (!freeHandles.empty())
+		{
+			const uint32_t handle = freeHandles.back();
+			freeHandles.pop_back();
+			return handle;
+		}
+		assert(lastHandle + 1U < std::size(m_array));
 		return ++lastHandle;
 	}
 };
@@ -39,3 +54,10 @@ inline T& Slotmap<T>::get(uint32_t handle)
 {
 	return m_array[handle];
 }
+
+template<typename T>
+inline void Slotmap<T>::remove(uint32_t handle)
+{
+	m_array[handle] = T{};
+	freeHandles.push_back(handle);
+}
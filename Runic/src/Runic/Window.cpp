@@ -8,6 +8,12 @@
 
 void Runic::Window::Init(const WindowProps& props)
 {
+	m_windowData.props = props;
+	if (props.headless)
+	{
+		return;
+	}
+
 	SDL_Init(SDL_INIT_VIDEO);
 
 	const SDL_WindowFlags window_flags = (SDL_WindowFlags)(SDL_WINDOW_VULKAN | SDL_WINDOW_RESIZABLE);
@@ -24,11 +30,19 @@ void Runic::Window::Init(const WindowProps& props)
 
 void Runic::Window::Deinit()
 {
-	SDL_DestroyWindow(reinterpret_cast<SDL_Window*>(m_window));
+	if (m_window != nullptr)
+	{
+		SDL_DestroyWindow(reinterpret_cast<SDL_Window*>(m_window));
+	}
 }
 
 void Runic::Window::Update()
 {
+	if (m_window == nullptr)
+	{
+		return;
+	}
+
 	int w, h;
 	SDL_GetWindowSize(reinterpret_cast<SDL_Window*>(m_window), &w, &h);
 	m_windowData.props.width = static_cast<uint32_t>(w);
@@ -9,6 +9,8 @@ namespace Runic
 		std::string title = {"Runic Engine"};
 		uint32_t width = {1920U};
 		uint32_t height = { 1080U };
+		// No window or input, the device presents to a VK_EXT_headless_surface instead
+		bool headless = { false };
 	};
 
 	class Window
@@ -22,6 +24,7 @@ namespace Runic
 		inline uint32_t GetWidth() const { return m_windowData.props.width; }
 		inline uint32_t GetHeight() const { return m_windowData.props.height; }
 		inline void* GetWindowPointer() const { return m_window; };
+		inline bool IsHeadless() const { return m_windowData.props.headless; }
 	private:
 		struct WindowData
 		{
@@ -0,0 +1,146 @@
+#include "Runic/Assets/AssetRegistry.h"
+
+#include <cstdio>
+
+using namespace Runic;
+
+namespace
+{
+	int failures = 0;
+
+	void check(bool condition, const char* expression, int line)
+	{
+		if (!condition)
+		{
+			fprintf(stderr, "AssetRegistryTests.cpp:%d: check failed: %s\n", line, expression);
+			++failures;
+		}
+	}
+}
+
+#define CHECK(expression) check((expression), #expression, __LINE__)
+
+/*
+The same mesh loaded from two files: both IDs share the first upload's handle, and releasing the last reference
+removes both, so neither finds the handle once the slot is reused by another asset
+*/
+void TestMeshSharedByTwoIDs()
+{
+	AssetRegistry assets;
+	const MeshHandle mesh = 5U;
+	const uint64_t contentHash = AssetRegistry::HashContent("mesh", 4U);
+	const AssetID first = AssetRegistry::MakeID(AssetType::MESH, "a.gltf", 0U);
+	const AssetID second = AssetRegistry::MakeID(AssetType::MESH, "b.gltf", 0U);
+
+	CHECK(!assets.AcquireMesh(contentHash).has_value());
+	assets.AddMeshContent(contentHash, mesh);
+	assets.AddMesh(first, mesh, AssetSource{ .path = "a.gltf" });
+
+	const std::optional<MeshHandle> shared = assets.AcquireMesh(contentHash);
+	CHECK(shared == mesh);
+	assets.AddMesh(second, mesh, AssetSource{ .path = "b.gltf" });
+	CHECK(assets.GetMeshReferences(mesh) == 2U);
+	CHECK(assets.FindMesh(first) == mesh);
+	CHECK(assets.FindMesh(second) == mesh);
+	CHECK(assets.GetMeshID(mesh) == first);
+
+	CHECK(!assets.ReleaseMesh(mesh));
+	CHECK(assets.ReleaseMesh(mesh));
+	assets.RemoveMesh(mesh);
+	CHECK(!assets.FindMesh(first).has_value());
+	CHECK(!assets.FindMesh(second).has_value());
+	CHECK(assets.GetSource(first) == nullptr);
+	CHECK(assets.GetSource(second) == nullptr);
+	CHECK(assets.GetMeshID(mesh) == 0U);
+	CHECK(!assets.AcquireMesh(contentHash).has_value());
+
+	// The slot map hands the handle out again for unrelated content
+	const AssetID other = AssetRegistry::MakeID(AssetType::MESH, "c.gltf", 0U);
+	assets.AddMeshContent(AssetRegistry::HashContent("other", 5U), mesh);
+	assets.AddMesh(other, mesh, AssetSource{ .path = "c.gltf" });
+	CHECK(!assets.FindMesh(first).has_value());
+	CHECK(!assets.FindMesh(second).has_value());
+	CHECK(assets.FindMesh(other) == mesh);
+	CHECK(assets.GetMeshID(mesh) == other);
+}
+
+/*
+Several IDs of one file collapsing to a single texture, as with identical images in one glTF
+*/
+void TestTextureSharedByTwoIDs()
+{
+	AssetRegistry assets;
+	const TextureHandle texture = 3U;
+	const uint64_t contentHash = AssetRegistry::HashContent("pixels", 6U);
+	const AssetID first = AssetRegistry::MakeID(AssetType::TEXTURE, "a.gltf", 0U);
+	const AssetID second = AssetRegistry::MakeID(AssetType::TEXTURE, "a.gltf", 1U);
+
+	assets.AddTextureContent(contentHash, texture);
+	assets.AddTexture(first, texture, AssetSource{ .path = "a.gltf", .index = 0U });
+	CHECK(assets.HasTextureContent(contentHash));
+	CHECK(assets.AcquireTexture(contentHash) == texture);
+	assets.AddTexture(second, texture, AssetSource{ .path = "a.gltf", .index = 1U });
+
+	CHECK(!assets.ReleaseTexture(texture));
+	CHECK(assets.FindTexture(first) == texture);
+	CHECK(assets.FindTexture(second) == texture);
+	CHECK(assets.ReleaseTexture(texture));
+	assets.RemoveTexture(texture);
+	CHECK(!assets.FindTexture(first).has_value());
+	CHECK(!assets.FindTexture(second).has_value());
+	CHECK(assets.GetTextureID(texture) == 0U);
+	CHECK(!assets.HasTextureContent(contentHash));
+}
+
+/*
+Registering an ID again, e.g. when a file is reloaded after its asset was destroyed, moves it to the new handle
+*/
+void TestIDMovesToNewHandle()
+{
+	AssetRegistry assets;
+	const AssetID id = AssetRegistry::MakeID(AssetType::MESH, "a.gltf", 0U);
+	assets.AddMesh(id, 1U, AssetSource{ .path = "a.gltf" });
+	assets.AddMesh(id, 2U, AssetSource{ .path = "a.gltf" });
+	CHECK(assets.FindMesh(id) == 2U);
+	CHECK(assets.GetMeshID(1U) == 0U);
+	CHECK(assets.GetMeshID(2U) == id);
+
+	// Removing the old handle leaves the moved ID alone
+	assets.RemoveMesh(1U);
+	CHECK(assets.FindMesh(id) == 2U);
+}
+
+/*
+A renderable read from a scene file retains what the loaded model holds, so releasing the model keeps the asset
+*/
+void TestRetainedMeshOutlivesModel()
+{
+	AssetRegistry assets;
+	const MeshHandle mesh = 7U;
+	assets.AddMeshContent(AssetRegistry::HashContent("mesh", 4U), mesh);
+	assets.RetainMesh(mesh);
+	CHECK(assets.GetMeshReferences(mesh) == 2U);
+	CHECK(!assets.ReleaseMesh(mesh));
+	CHECK(assets.ReleaseMesh(mesh));
+
+	// Generated meshes aren't counted, retaining them does nothing
+	assets.RetainMesh(8U);
+	CHECK(assets.GetMeshReferences(8U) == 0U);
+	CHECK(!assets.ReleaseMesh(8U));
+}
+
+int main()
+{
+	TestMeshSharedByTwoIDs();
+	TestTextureSharedByTwoIDs();
+	TestIDMovesToNewHandle();
+	TestRetainedMeshOutlivesModel();
+
+	if (failures > 0)
+	{
+		fprintf(stderr, "%d checks failed\n", failures);
+		return 1;
+	}
+	printf("All checks passed\n");
+	return 0;
+}
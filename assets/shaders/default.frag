@@ -13,6 +13,8 @@ layout (location = 0) out vec4 outFragColor;
 struct DrawData{
 	int transformIndex;
 	int materialIndex;
+	uvec2 vertexAddress;
+	uvec2 indexAddress;
 };
 
 struct MaterialData{
@@ -30,7 +32,7 @@ layout(std140,set = 0, binding = 2) readonly buffer MaterialDataBuffer{
 	MaterialData objects[];
 } materialDataArray;
 
-layout (set = 0, binding = 3) uniform sampler2D bindlessTextures[];
+layout (set = 2, binding = 0) uniform sampler2D bindlessTextures[];
 
 layout(std140,set = 1, binding = 0) uniform  CameraBuffer{
 	mat4 viewMatrix;
@@ -65,8 +67,55 @@ layout(std140,set = 1, binding = 2) readonly buffer  PointLightBuffer{
 	PointLight lights[];
 } pointLightData;
 
+layout(std140,set = 1, binding = 3) uniform  ShadowBuffer{
+	mat4 viewProj[4];
+	vec4 splitDepths;
+	vec4 texelSizes;
+	ivec4 shadowMapIndices;
+	ivec4 staticCacheIndices;
+	vec4 params;
+} shadowData;
 
-vec3 CalcDirLight(DirectionalLight light, MaterialData material, vec3 normal, vec3 viewDir)
+
+// Fraction of the directional light reaching a point, 3x3 PCF in the cascade covering its view depth
+float CalcShadow(vec3 worldPos, vec3 normal, vec3 lightDir)
+{
+	if (shadowData.params.y == 0.0f)
+	{
+		return 1.0f;
+	}
+
+	float viewDepth = -(cameraData.viewMatrix * vec4(worldPos, 1.0f)).z;
+	int cascade = 0;
+	while (cascade < 4 && viewDepth > shadowData.splitDepths[cascade])
+	{
+		cascade++;
+	}
+	if (cascade == 4)
+	{
+		return 1.0f;
+	}
+
+	// Pushed off the surface by about a texel, more at grazing angles, against acne
+	float slope = 1.0f - clamp(dot(normal, lightDir), 0.0f, 1.0f);
+	vec3 offsetPos = worldPos + normal * shadowData.texelSizes[cascade] * (0.5f + 1.5f * slope);
+	vec4 shadowCoord = shadowData.viewProj[cascade] * vec4(offsetPos, 1.0f);
+	vec2 shadowUv = shadowCoord.xy * 0.5f + 0.5f;
+
+	int shadowIndex = shadowData.shadowMapIndices[cascade];
+	float lit = 0.0f;
+	for (int x = -1; x <= 1; x++)
+	{
+		for (int y = -1; y <= 1; y++)
+		{
+			float occluder = textureLod(bindlessTextures[nonuniformEXT(shadowIndex)], shadowUv + vec2(x, y) * shadowData.params.x, 0.0f).r;
+			lit += shadowCoord.z <= occluder ? 1.0f : 0.0f;
+		}
+	}
+	return lit / 9.0f;
+}
+
+vec3 CalcDirLight(DirectionalLight light, MaterialData material, vec3 normal, vec3 viewDir, float shadow)
 {
     vec3 lightDir = normalize(-light.direction.xyz);
     // diffuse shading
@@ -78,7 +127,7 @@ vec3 CalcDirLight(DirectionalLight light, MaterialData material, vec3 normal, ve
     vec3 ambient  = light.ambient.rgb  * texture(bindlessTextures[(nonuniformEXT(material.textureIndex.x))], inTexCoords).rgb;
     vec3 diffuse  = light.diffuse.rgb  * diff * texture(bindlessTextures[(nonuniformEXT(material.textureIndex.x))], inTexCoords).rgb;
     vec3 specular = light.specular.rgb * spec * material.specular.rgb;
-    return (ambient + diffuse + specular);
+    return (ambient + (diffuse + specular) * shadow);
 }  
 
 vec3 CalcPointLight(PointLight light, MaterialData material, vec3 normal, vec3 fragPos, vec3 viewDir)
@@ -121,9 +170,10 @@ void main(void)	{
 	vec3 viewDir = normalize(cameraData.cameraPos.xyz - inWorldPos);
 
 	// phase 1: Directional lighting
-    vec3 result = CalcDirLight(lightData.light, matData, norm, viewDir);
+    float shadow = CalcShadow(inWorldPos, normalize(inNormal), normalize(-lightData.light.direction.xyz));
+    vec3 result = CalcDirLight(lightData.light, matData, norm, viewDir, shadow);
     // phase 2: Point lights
-    for(int i = 0; i < 4; i++){
+    for(int i = 0; i < int(cameraData.cameraPos.w); i++){
         result += CalcPointLight(pointLightData.lights[i],matData, norm, inWorldPos, viewDir);   
 	}
 
@@ -13,6 +13,9 @@ layout (location = 3) out vec3 outWorldPos;
 layout (location = 4) out flat int outDrawDataIndex;
 layout (location = 5) out mat3 outTBN;
 
+// Must match depth.vert bit for bit, the main pass tests EQUAL against the depth pre-pass
+invariant gl_Position;
+
 layout( push_constant ) uniform constants
 {
 	int drawDataIndex;
@@ -21,6 +24,8 @@ layout( push_constant ) uniform constants
 struct DrawData{
 	int transformIndex;
 	int materialIndex;
+	uvec2 vertexAddress;
+	uvec2 indexAddress;
 };
 
 struct ObjectData{
@@ -51,13 +56,15 @@ layout(std140,set = 1, binding = 0) uniform  CameraBuffer{
 } cameraData;
 
 void main(void)		{
-	DrawData draw = drawDataArray.objects[pushConstants.drawDataIndex];
+	// Instances of one batch have consecutive draw data
+	int drawDataIndex = pushConstants.drawDataIndex + gl_InstanceIndex;
+	DrawData draw = drawDataArray.objects[drawDataIndex];
 	mat4 proj = cameraData.projMatrix;
 	mat4 view = cameraData.viewMatrix;
 
 	outColor = vColor;
 	outTexCoords = vTexCoord;
-	outDrawDataIndex = pushConstants.drawDataIndex;
+	outDrawDataIndex = drawDataIndex;
 
 	vec4 outPosition = vec4(vPosition, 1.0f);
 	if (draw.transformIndex != 0)
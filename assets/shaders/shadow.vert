@@ -0,0 +1,53 @@
+#version 460
+
+// Position only stream, drawn into one shadow cascade
+layout (location = 0) in vec3 vPosition;
+
+layout( push_constant ) uniform constants
+{
+	int drawDataIndex;
+	int cascade;
+} pushConstants;
+
+struct DrawData{
+	int transformIndex;
+	int materialIndex;
+	uvec2 vertexAddress;
+	uvec2 indexAddress;
+};
+
+struct ObjectData{
+	mat4 modelMatrix;
+	mat4 normalMatrix;
+};
+
+layout(std140,set = 0, binding = 0) readonly buffer DrawDataBuffer{
+	DrawData objects[];
+} drawDataArray;
+
+layout(std140,set = 0, binding = 1) readonly buffer TransformBuffer{
+	ObjectData objects[];
+} transformData;
+
+layout(std140,set = 1, binding = 3) uniform  ShadowBuffer{
+	mat4 viewProj[4];
+	vec4 splitDepths;
+	vec4 texelSizes;
+	ivec4 shadowMapIndices;
+	ivec4 staticCacheIndices;
+	vec4 params;
+} shadowData;
+
+void main(void)		{
+	// Instances of one batch have consecutive draw data
+	int drawDataIndex = pushConstants.drawDataIndex + gl_InstanceIndex;
+	DrawData draw = drawDataArray.objects[drawDataIndex];
+
+	mat4 model = mat4(1.0f);
+	if (draw.transformIndex != 0)
+	{
+		model = transformData.objects[draw.transformIndex].modelMatrix;
+	}
+
+	gl_Position = shadowData.viewProj[pushConstants.cascade] * model * vec4(vPosition, 1.0f);
+}
@@ -0,0 +1,24 @@
+#version 460
+#extension GL_EXT_nonuniform_qualifier : enable
+
+// Copies a cascade's static cache into its shadow map before the dynamic casters are drawn
+layout( push_constant ) uniform constants
+{
+	int drawDataIndex;
+	int cascade;
+} pushConstants;
+
+layout (set = 2, binding = 0) uniform sampler2D bindlessTextures[];
+
+layout(std140,set = 1, binding = 3) uniform  ShadowBuffer{
+	mat4 viewProj[4];
+	vec4 splitDepths;
+	vec4 texelSizes;
+	ivec4 shadowMapIndices;
+	ivec4 staticCacheIndices;
+	vec4 params;
+} shadowData;
+
+void main(void)	{
+	gl_FragDepth = texelFetch(bindlessTextures[shadowData.staticCacheIndices[pushConstants.cascade]], ivec2(gl_FragCoord.xy), 0).r;
+}
@@ -13,6 +13,8 @@ layout (location = 0) out vec4 outFragColor;
 struct DrawData{
 	int transformIndex;
 	int materialIndex;
+	uvec2 vertexAddress;
+	uvec2 indexAddress;
 };
 
 struct MaterialData{
@@ -43,8 +45,8 @@ layout(std140,set = 0, binding = 2) readonly buffer MaterialDataBuffer{
 	MaterialData objects[];
 } materialDataArray;
 
-//layout (set = 0, binding = 3) uniform sampler2D bindlessTextures[];
-layout (set = 0, binding = 3) uniform samplerCube bindlessTextures[];
+//layout (set = 2, binding = 0) uniform sampler2D bindlessTextures[];
+layout (set = 2, binding = 0) uniform samplerCube bindlessTextures[];
 
 void main(void)	{
 	DrawData draw = drawDataArray.objects[inDrawDataIndex];
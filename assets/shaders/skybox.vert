@@ -21,6 +21,8 @@ layout( push_constant ) uniform constants
 struct DrawData{
 	int transformIndex;
 	int materialIndex;
+	uvec2 vertexAddress;
+	uvec2 indexAddress;
 };
 
 struct ObjectData{
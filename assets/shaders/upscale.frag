@@ -0,0 +1,20 @@
+#version 460
+#extension GL_EXT_nonuniform_qualifier : enable
+
+// Stretches the dynamic resolution scene image over the back buffer with bilinear filtering
+layout (location = 0) out vec4 outFragColor;
+
+layout( push_constant ) uniform constants
+{
+	int sourceIndex;
+	int padding;
+	vec2 pixelToUv;
+	vec2 maxUv;		// Last rendered texel centre, so filtering never reads outside what was rendered
+} pushConstants;
+
+layout (set = 2, binding = 0) uniform sampler2D bindlessTextures[];
+
+void main(void)	{
+	vec2 uv = min(gl_FragCoord.xy * pushConstants.pixelToUv, pushConstants.maxUv);
+	outFragColor = textureLod(bindlessTextures[pushConstants.sourceIndex], uv, 0.0f);
+}
@@ -0,0 +1,10 @@
+#version 460
+
+layout (location = 0) in flat int inDrawDataIndex;
+
+// x: draw data index + 1, 0 where nothing was drawn. y: triangle within the draw.
+layout (location = 0) out uvec2 outVisibility;
+
+void main(void)	{
+	outVisibility = uvec2(inDrawDataIndex + 1, gl_PrimitiveID);
+}
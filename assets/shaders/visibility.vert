@@ -0,0 +1,57 @@
+#version 460
+
+// Position only stream, attributes are fetched again by the resolve pass
+layout (location = 0) in vec3 vPosition;
+
+layout (location = 0) out flat int outDrawDataIndex;
+
+layout( push_constant ) uniform constants
+{
+	int drawDataIndex;
+} pushConstants;
+
+struct DrawData{
+	int transformIndex;
+	int materialIndex;
+	uvec2 vertexAddress;
+	uvec2 indexAddress;
+};
+
+struct ObjectData{
+	mat4 modelMatrix;
+	mat4 normalMatrix;
+};
+
+layout(std140,set = 0, binding = 0) readonly buffer DrawDataBuffer{
+	DrawData objects[];
+} drawDataArray;
+
+layout(std140,set = 0, binding = 1) readonly buffer TransformBuffer{
+	ObjectData objects[];
+} transformData;
+
+layout(std140,set = 1, binding = 0) uniform  CameraBuffer{
+	mat4 viewMatrix;
+	mat4 projMatrix;
+	vec4 cameraPos;
+} cameraData;
+
+void main(void)		{
+	// Instances of one batch have consecutive draw data
+	int drawDataIndex = pushConstants.drawDataIndex + gl_InstanceIndex;
+	DrawData draw = drawDataArray.objects[drawDataIndex];
+	mat4 proj = cameraData.projMatrix;
+	mat4 view = cameraData.viewMatrix;
+
+	outDrawDataIndex = drawDataIndex;
+
+	vec4 outPosition = vec4(vPosition, 1.0f);
+	if (draw.transformIndex != 0)
+	{
+		mat4 model = transformData.objects[draw.transformIndex].modelMatrix;
+		mat4 transformMatrix = (proj * view * model);
+		outPosition = transformMatrix * vec4(vPosition, 1.0f);
+	}
+
+	gl_Position = outPosition;
+}
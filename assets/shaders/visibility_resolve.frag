@@ -0,0 +1,343 @@
+#version 460
+#extension GL_EXT_nonuniform_qualifier : enable
+#extension GL_EXT_buffer_reference : require
+#extension GL_EXT_buffer_reference_uvec2 : require
+
+// Shades every covered pixel once from the visibility buffer. The triangle is fetched again through the
+// draw's buffer addresses and its attributes interpolated with barycentrics rebuilt from the pixel position.
+
+layout (location = 0) out vec4 outFragColor;
+
+layout( push_constant ) uniform constants
+{
+	int visibilityIndex;
+	int padding;
+	vec2 renderSize;	// Only the top left of the visibility buffer is rendered under dynamic resolution
+} pushConstants;
+
+// Runic::Vertex, tightly packed floats
+const uint VERTEX_STRIDE = 14;
+const uint POSITION_OFFSET = 0;
+const uint NORMAL_OFFSET = 3;
+const uint UV_OFFSET = 9;
+const uint TANGENT_OFFSET = 11;
+
+layout(buffer_reference, std430, buffer_reference_align = 4) readonly buffer VertexBuffer{
+	float values[];
+};
+
+layout(buffer_reference, std430, buffer_reference_align = 4) readonly buffer IndexBuffer{
+	uint indices[];
+};
+
+struct DrawData{
+	int transformIndex;
+	int materialIndex;
+	uvec2 vertexAddress;
+	uvec2 indexAddress;
+	uint indexSize;
+};
+
+struct ObjectData{
+	mat4 modelMatrix;
+	mat4 normalMatrix;
+};
+
+struct MaterialData{
+	vec4 diffuse;
+	vec3 specular;
+	float shininess;
+	ivec4 textureIndex;
+};
+
+layout(std140,set = 0, binding = 0) readonly buffer DrawDataBuffer{
+	DrawData objects[];
+} drawDataArray;
+
+layout(std140,set = 0, binding = 1) readonly buffer TransformBuffer{
+	ObjectData objects[];
+} transformData;
+
+layout(std140,set = 0, binding = 2) readonly buffer MaterialDataBuffer{
+	MaterialData objects[];
+} materialDataArray;
+
+// The visibility buffer is an integer image in the same table
+layout (set = 2, binding = 0) uniform sampler2D bindlessTextures[];
+layout (set = 2, binding = 0) uniform usampler2D bindlessUintTextures[];
+
+layout(std140,set = 1, binding = 0) uniform  CameraBuffer{
+	mat4 viewMatrix;
+	mat4 projMatrix;
+	vec4 cameraPos;
+} cameraData;
+
+struct DirectionalLight{
+	vec4 ambient;
+	vec4 diffuse;
+	vec4 specular;
+	vec4 direction;
+};
+
+struct PointLight{
+	vec4 ambient;
+	vec4 diffuse;
+	vec4 specular;
+	vec4 position;
+
+	float constant;
+	float linear;
+	float quadratic;
+	float padding;
+};
+
+layout(std140,set = 1, binding = 1) uniform  DirLightBuffer{
+	DirectionalLight light;
+} lightData;
+
+layout(std140,set = 1, binding = 2) readonly buffer  PointLightBuffer{
+	PointLight lights[];
+} pointLightData;
+
+layout(std140,set = 1, binding = 3) uniform  ShadowBuffer{
+	mat4 viewProj[4];
+	vec4 splitDepths;
+	vec4 texelSizes;
+	ivec4 shadowMapIndices;
+	ivec4 staticCacheIndices;
+	vec4 params;
+} shadowData;
+
+struct Barycentrics{
+	vec3 lambda;
+	vec3 ddx;		// Change per pixel step, for texture LOD
+	vec3 ddy;
+};
+
+// Perspective correct barycentrics of a pixel and their screen space derivatives
+Barycentrics CalcBarycentrics(vec4 clip0, vec4 clip1, vec4 clip2, vec2 pixelNdc, vec2 screenSize)
+{
+	Barycentrics result;
+
+	vec3 invW = 1.0f / vec3(clip0.w, clip1.w, clip2.w);
+	vec2 ndc0 = clip0.xy * invW.x;
+	vec2 ndc1 = clip1.xy * invW.y;
+	vec2 ndc2 = clip2.xy * invW.z;
+
+	float invDet = 1.0f / determinant(mat2(ndc2 - ndc1, ndc0 - ndc1));
+	result.ddx = vec3(ndc1.y - ndc2.y, ndc2.y - ndc0.y, ndc0.y - ndc1.y) * invDet * invW;
+	result.ddy = vec3(ndc2.x - ndc1.x, ndc0.x - ndc2.x, ndc1.x - ndc0.x) * invDet * invW;
+	float ddxSum = dot(result.ddx, vec3(1.0f));
+	float ddySum = dot(result.ddy, vec3(1.0f));
+
+	vec2 delta = pixelNdc - ndc0;
+	float interpInvW = invW.x + delta.x * ddxSum + delta.y * ddySum;
+	float interpW = 1.0f / interpInvW;
+
+	result.lambda.x = interpW * (invW.x + delta.x * result.ddx.x + delta.y * result.ddy.x);
+	result.lambda.y = interpW * (delta.x * result.ddx.y + delta.y * result.ddy.y);
+	result.lambda.z = interpW * (delta.x * result.ddx.z + delta.y * result.ddy.z);
+
+	// From per NDC unit to per pixel, NDC y points down the screen in Vulkan
+	result.ddx *= 2.0f / screenSize.x;
+	result.ddy *= 2.0f / screenSize.y;
+	ddxSum *= 2.0f / screenSize.x;
+	ddySum *= 2.0f / screenSize.y;
+
+	float interpWdx = 1.0f / (interpInvW + ddxSum);
+	float interpWdy = 1.0f / (interpInvW + ddySum);
+	result.ddx = interpWdx * (result.lambda * interpInvW + result.ddx) - result.lambda;
+	result.ddy = interpWdy * (result.lambda * interpInvW + result.ddy) - result.lambda;
+
+	return result;
+}
+
+// 8 and 16 bit indices are packed into 32 bit words
+uint FetchIndex(IndexBuffer indexBuffer, uint index, uint indexSize)
+{
+	if (indexSize == 4)
+	{
+		return indexBuffer.indices[index];
+	}
+	uint indicesPerWord = 4 / indexSize;
+	uint word = indexBuffer.indices[index / indicesPerWord];
+	return bitfieldExtract(word, int((index % indicesPerWord) * indexSize * 8), int(indexSize * 8));
+}
+
+vec3 FetchVec3(VertexBuffer vertices, uint vertex, uint offset)
+{
+	uint base = vertex * VERTEX_STRIDE + offset;
+	return vec3(vertices.values[base], vertices.values[base + 1], vertices.values[base + 2]);
+}
+
+vec2 FetchVec2(VertexBuffer vertices, uint vertex, uint offset)
+{
+	uint base = vertex * VERTEX_STRIDE + offset;
+	return vec2(vertices.values[base], vertices.values[base + 1]);
+}
+
+// Fraction of the directional light reaching a point, 3x3 PCF in the cascade covering its view depth
+float CalcShadow(vec3 worldPos, vec3 normal, vec3 lightDir)
+{
+	if (shadowData.params.y == 0.0f)
+	{
+		return 1.0f;
+	}
+
+	float viewDepth = -(cameraData.viewMatrix * vec4(worldPos, 1.0f)).z;
+	int cascade = 0;
+	while (cascade < 4 && viewDepth > shadowData.splitDepths[cascade])
+	{
+		cascade++;
+	}
+	if (cascade == 4)
+	{
+		return 1.0f;
+	}
+
+	// Pushed off the surface by about a texel, more at grazing angles, against acne
+	float slope = 1.0f - clamp(dot(normal, lightDir), 0.0f, 1.0f);
+	vec3 offsetPos = worldPos + normal * shadowData.texelSizes[cascade] * (0.5f + 1.5f * slope);
+	vec4 shadowCoord = shadowData.viewProj[cascade] * vec4(offsetPos, 1.0f);
+	vec2 shadowUv = shadowCoord.xy * 0.5f + 0.5f;
+
+	int shadowIndex = shadowData.shadowMapIndices[cascade];
+	float lit = 0.0f;
+	for (int x = -1; x <= 1; x++)
+	{
+		for (int y = -1; y <= 1; y++)
+		{
+			float occluder = textureLod(bindlessTextures[nonuniformEXT(shadowIndex)], shadowUv + vec2(x, y) * shadowData.params.x, 0.0f).r;
+			lit += shadowCoord.z <= occluder ? 1.0f : 0.0f;
+		}
+	}
+	return lit / 9.0f;
+}
+
+vec3 CalcDirLight(DirectionalLight light, MaterialData material, vec3 albedo, vec3 normal, vec3 viewDir, float shadow)
+{
+	vec3 lightDir = normalize(-light.direction.xyz);
+	// diffuse shading
+	float diff = max(dot(normal, lightDir), 0.0);
+	// specular shading
+	vec3 reflectDir = reflect(-lightDir, normal);
+	float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+	// combine results
+	vec3 ambient  = light.ambient.rgb  * albedo;
+	vec3 diffuse  = light.diffuse.rgb  * diff * albedo;
+	vec3 specular = light.specular.rgb * spec * material.specular.rgb;
+	return (ambient + (diffuse + specular) * shadow);
+}
+
+vec3 CalcPointLight(PointLight light, MaterialData material, vec3 albedo, vec3 normal, vec3 fragPos, vec3 viewDir)
+{
+	vec3 lightDir = normalize(light.position.xyz - fragPos);
+	// diffuse shading
+	float diff = max(dot(normal, lightDir), 0.0);
+	// specular shading
+	vec3 reflectDir = reflect(-lightDir, normal);
+	float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+	// attenuation
+	float distance    = length(light.position.xyz - fragPos);
+	float attenuation = 1.0 / (light.constant + light.linear * distance +
+				 light.quadratic * (distance * distance));
+	// combine results
+	vec3 ambient  = light.ambient.rgb  * albedo;
+	vec3 diffuse  = light.diffuse.rgb  * diff * albedo;
+	vec3 specular = light.specular.rgb * spec * material.specular.rgb;
+	ambient  *= attenuation;
+	diffuse  *= attenuation;
+	specular *= attenuation;
+	return (ambient + diffuse + specular);
+}
+
+void main(void)	{
+	uvec2 visibility = texelFetch(bindlessUintTextures[pushConstants.visibilityIndex], ivec2(gl_FragCoord.xy), 0).xy;
+	if (visibility.x == 0)
+	{
+		discard;
+	}
+
+	DrawData draw = drawDataArray.objects[visibility.x - 1];
+	MaterialData matData = materialDataArray.objects[draw.materialIndex];
+
+	// Non indexed draws use three vertices per triangle
+	uvec3 triangle = uvec3(visibility.y * 3) + uvec3(0, 1, 2);
+	if (draw.indexAddress != uvec2(0))
+	{
+		IndexBuffer indexBuffer = IndexBuffer(draw.indexAddress);
+		triangle = uvec3(FetchIndex(indexBuffer, triangle.x, draw.indexSize), FetchIndex(indexBuffer, triangle.y, draw.indexSize), FetchIndex(indexBuffer, triangle.z, draw.indexSize));
+	}
+	VertexBuffer vertexBuffer = VertexBuffer(draw.vertexAddress);
+
+	vec3 position0 = FetchVec3(vertexBuffer, triangle.x, POSITION_OFFSET);
+	vec3 position1 = FetchVec3(vertexBuffer, triangle.y, POSITION_OFFSET);
+	vec3 position2 = FetchVec3(vertexBuffer, triangle.z, POSITION_OFFSET);
+
+	// Same transform as the visibility pass, so the rebuilt triangle lines up with the rasterised one
+	mat4 model = mat4(1.0f);
+	mat3 normalMatrix = mat3(1.0f);
+	vec4 clip0 = vec4(position0, 1.0f);
+	vec4 clip1 = vec4(position1, 1.0f);
+	vec4 clip2 = vec4(position2, 1.0f);
+	if (draw.transformIndex != 0)
+	{
+		model = transformData.objects[draw.transformIndex].modelMatrix;
+		normalMatrix = mat3(transformData.objects[draw.transformIndex].normalMatrix);
+		mat4 transformMatrix = (cameraData.projMatrix * cameraData.viewMatrix * model);
+		clip0 = transformMatrix * clip0;
+		clip1 = transformMatrix * clip1;
+		clip2 = transformMatrix * clip2;
+	}
+
+	vec2 screenSize = pushConstants.renderSize;
+	vec2 pixelNdc = (gl_FragCoord.xy / screenSize) * 2.0f - 1.0f;
+	Barycentrics bary = CalcBarycentrics(clip0, clip1, clip2, pixelNdc, screenSize);
+
+	mat3x2 uvs = mat3x2(FetchVec2(vertexBuffer, triangle.x, UV_OFFSET), FetchVec2(vertexBuffer, triangle.y, UV_OFFSET), FetchVec2(vertexBuffer, triangle.z, UV_OFFSET));
+	vec2 uv = uvs * bary.lambda;
+	vec2 uvDx = uvs * bary.ddx;
+	vec2 uvDy = uvs * bary.ddy;
+
+	mat3 normals = mat3(FetchVec3(vertexBuffer, triangle.x, NORMAL_OFFSET), FetchVec3(vertexBuffer, triangle.y, NORMAL_OFFSET), FetchVec3(vertexBuffer, triangle.z, NORMAL_OFFSET));
+	mat3 tangents = mat3(FetchVec3(vertexBuffer, triangle.x, TANGENT_OFFSET), FetchVec3(vertexBuffer, triangle.y, TANGENT_OFFSET), FetchVec3(vertexBuffer, triangle.z, TANGENT_OFFSET));
+	vec3 normal = normals * bary.lambda;
+	vec3 tangent = tangents * bary.lambda;
+	vec3 worldPos = vec3(model * vec4(mat3(position0, position1, position2) * bary.lambda, 1.0f));
+
+	vec3 T = normalize(vec3(model * vec4(tangent, 0.0f)));
+	vec3 B = normalize(vec3(model * vec4(cross(normal, tangent), 0.0f)));
+	vec3 N = normalize(vec3(model * vec4(normal, 0.0f)));
+	mat3 TBN = mat3(T, B, N);
+
+	int normalIndex = matData.textureIndex.y;
+	int emissiveIndex = matData.textureIndex.w;
+
+	vec3 norm;
+	if (normalIndex > 0){
+		norm = textureGrad(bindlessTextures[(nonuniformEXT(normalIndex))], uv, uvDx, uvDy).rgb;
+		norm = norm * 2.0 - 1.0;
+	} else {
+		norm = normalMatrix * normal;
+	}
+	norm = normalize(TBN * norm);
+	vec3 viewDir = normalize(cameraData.cameraPos.xyz - worldPos);
+
+	vec3 albedo = textureGrad(bindlessTextures[(nonuniformEXT(matData.textureIndex.x))], uv, uvDx, uvDy).rgb;
+
+	// phase 1: Directional lighting
+	float shadow = CalcShadow(worldPos, N, normalize(-lightData.light.direction.xyz));
+	vec3 result = CalcDirLight(lightData.light, matData, albedo, norm, viewDir, shadow);
+	// phase 2: Point lights
+	for(int i = 0; i < int(cameraData.cameraPos.w); i++){
+		result += CalcPointLight(pointLightData.lights[i], matData, albedo, norm, worldPos, viewDir);
+	}
+
+	// phase 3: add emission
+	vec3 emission = vec3(0.0f);
+	if (emissiveIndex > 0){
+		emission = textureGrad(bindlessTextures[(nonuniformEXT(emissiveIndex))], uv, uvDx, uvDy).rgb;
+	}
+
+	outFragColor = vec4(result + emission,1.0);
+}